@@ -1,6 +1,30 @@
+#ifdef _WIN32
+#include <winsock2.h>      // UDP 서버 / 클라이언트. windows.h(glew, freeglut이 포함)보다 먼저 와야 함
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#endif
 #include <GL/glew.h>
 #include <GL/glu.h>
 #include <gl/freeglut.h>
+#ifdef _WIN32
+#include <GL/wglew.h>
+#include <mmsystem.h>      // timeBeginPeriod: 프레임 페이싱의 sleep 해상도를 1ms로
+#pragma comment(lib, "winmm.lib")
+#include <psapi.h>         // GetProcessMemoryInfo: 지표의 메모리 게이지
+#pragma comment(lib, "psapi.lib")
+#include <intrin.h>
+#else
+#include <GL/glxew.h>      // glXSwapInterval*: 페이싱 모드의 vsync 켜기 / 끄기
+#include <unistd.h>        // sysconf: /proc/self/statm 페이지 크기
+#include <fcntl.h>
+#include <sys/mman.h>      // mmap: 미로 팩
+#include <sys/stat.h>
+#include <sys/socket.h>    // UDP 서버 / 클라이언트
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <time.h>          // clock_gettime: 스레드 CPU 시간
+#endif
 #include <gl/glm/glm.hpp>
 #include <gl/glm/ext.hpp>
 #include <gl/glm/gtc/matrix_transform.hpp>
@@ -16,11 +40,33 @@
 #include <algorithm>
 #include <fstream>
 #include <limits>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <iterator>
+
+// 창 없는 오프스크린 렌더(--offscreen)는 EGL surfaceless 컨텍스트를 쓴다 (Mesa llvmpipe 등).
+// Windows에서는 숨긴 GLUT 창의 컨텍스트로 대신한다.
+#if !defined(_WIN32) && !defined(PACMAN_NO_EGL)
+#define PACMAN_WITH_EGL 1
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 int g_windowWidth = 1024;
 int g_windowHeight = 768;
-int g_gridWidth = 11;
-int g_gridHeight = 11;
+// 게임 상태(미로, 플레이어, 유령, 점수 등)는 스레드마다 따로 둔다.
+// GLUT 스레드는 평소처럼 하나의 게임을 돌리고, 봇 러너는 워커 스레드마다 독립된 게임을 돌린다.
+thread_local int g_gridWidth = 11;
+thread_local int g_gridHeight = 11;
 const float CUBE_SIZE = 0.8f;
 const float GRID_SPACING = 0.2f;
 
@@ -31,47 +77,889 @@ GLsizei g_sphereIndexCount = 0;
 
 GLuint g_cylinderVAO = 0, g_cylinderVBO = 0, g_cylinderEBO = 0;
 GLsizei g_cylinderIndexCount = 0;
-GLint g_modelLoc = -1, g_viewLoc = -1, g_projLoc = -1, g_colorLoc = -1, g_clipSignLoc = -1, g_lightPosLoc = -1;
 
-glm::vec3 g_cameraPos = glm::vec3(0.0f, 10.0f, 15.0f);
-glm::vec3 g_cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
-glm::vec3 g_cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-float g_cameraYaw   = 0.0f;   // 마우스로 회전시킬 카메라 yaw
+GLuint g_pacmanVAO = 0, g_pacmanVBO = 0, g_pacmanEBO = 0;
+GLsizei g_pacmanIndexCount = 0;
+GLint g_modelLoc = -1, g_viewLoc = -1, g_projLoc = -1, g_colorLoc = -1, g_mouthAngleLoc = -1, g_lightPosLoc = -1;
+GLint g_lightRangeLoc = -1, g_shadowFarLoc = -1, g_shadowsEnabledLoc = -1;
+
+// 그림자 큐브맵 패스용 프로그램 (vertex.glsl + shadow_fragment.glsl)
+GLuint g_shadowProgram = 0;
+GLint g_shadowModelLoc = -1, g_shadowViewLoc = -1, g_shadowProjLoc = -1, g_shadowMouthAngleLoc = -1;
+GLint g_shadowLightPosLoc = -1, g_shadowFarPassLoc = -1;
+
+thread_local glm::vec3 g_cameraPos = glm::vec3(0.0f, 10.0f, 15.0f);
+thread_local glm::vec3 g_cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
+thread_local glm::vec3 g_cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+const int MAX_PLAYERS = 4;      // 분할 화면 협동 인원
+thread_local float g_playerYaw[MAX_PLAYERS] = {};   // 플레이어별 카메라 yaw. 1P는 마우스, 나머지는 좌우 키로 돌린다
+int g_playerCount = 1;         // --players N. reset()이 이만큼 만든다 (스레드를 띄우기 전에 정하고 바꾸지 않음)
 float g_cameraPitch = 0.0f;   // 상하는 고정할 것이라 pitch는 0 유지
 float g_lastMouseX  = -1.0f;  // 초기값
 float g_mouseSensitivity = 0.1f;
-float g_playerPosX = 0.0f;
-float g_playerPosZ = 0.0f;
-float g_playerAngleY = 0.0f;
-int g_mazeStartX = 0;
-int g_mazeEndX = 0;
+thread_local int g_mazeStartX = 0;
+thread_local int g_mazeEndX = 0;
 
 const float PLAYER_WIDTH = 0.3f;
 const float PLAYER_HEIGHT = 0.5f;
 const float PLAYER_DEPTH = 0.3f;
 const float PLAYER_MOVE_SPEED = 4.0f;
-float g_pacmanMouthAngle = 0.0f;          // 현재 입 각도(도)
-float g_pacmanMouthDir = 1.0f;             // 1 = 열리는 중, -1 = 닫히는 중
-
+const float PLAYER_TURN_SPEED = 180.0f;   // 마우스 없는 플레이어의 회전 속도 (도/초)
 const float PACMAN_MOUTH_MAX = 55.0f;      // 최대 입 벌림 각도 (더 크게 벌리기)
 const float PACMAN_MOUTH_SPEED = 120.0f;   // 1초에 120도 정도 회전
-bool g_keyStates[256];
-bool g_specialKeyStates[128];
+thread_local bool g_keyStates[256];
+thread_local bool g_specialKeyStates[128];
+thread_local bool g_keyTapped[256];          // 이번 스텝 사이에 눌렸던 키 (눌렀다 바로 뗀 입력도 한 스텝은 반영)
+thread_local bool g_specialKeyTapped[128];
 const float GRID_BASE_SCALE = 1.0f;
 const float WALL_SCALE = 2.0f;
 const float FLOOR_SCALE = 0.05f;
 bool g_isMinimapView = false;
 
-struct Ghost {
-    float x;
-    float z;
-    float angleY;
-    float speed;
-    int dirX;
-    int dirZ;
+// ---- 런타임 지표 (Prometheus 텍스트 내보내기) ----
+// 카운터 / 게이지 / 히스토그램은 프로세스 전역 atomic이고, 기록은 relaxed 증가 한두 번이라 락이 없다.
+// 백그라운드 스레드가 주기적으로 전부 읽어(MetricsSnapshot) Prometheus 텍스트 형식으로 파일에 쓴다.
+// 임시 파일에 쓴 뒤 이름을 바꾸므로 읽는 쪽(node_exporter textfile 수집기 등)은 항상 완성된 파일만 본다.
+// 지표마다 캐시 라인을 따로 써서 시뮬레이션 / 렌더 / 봇 스레드가 서로 다른 지표를 올릴 때 부딪히지 않는다.
+
+enum MetricCounter {
+    MC_FRAMES, MC_TICKS, MC_DRAW_CALLS, MC_PELLETS_EATEN, MC_GHOSTS_EATEN, MC_DEATHS, MC_RESETS, MC_COUNT
+};
+
+enum MetricGauge { MG_GHOSTS, MG_REMAINING_PELLETS, MG_COUNT };   // 메모리는 내보낼 때 직접 읽는다
+
+enum MetricHistogram { MH_TICK, MH_FRAME, MH_COUNT };
+
+struct MetricInfo {
+    const char* name;
+    const char* help;
+};
+
+const MetricInfo COUNTER_INFO[MC_COUNT] = {
+    { "pacman_frames_total", "Frames presented." },
+    { "pacman_ticks_total", "Simulation steps run." },
+    { "pacman_draw_calls_total", "OpenGL draw calls issued." },
+    { "pacman_pellets_eaten_total", "Pellets and power pellets eaten." },
+    { "pacman_ghosts_eaten_total", "Frightened ghosts eaten." },
+    { "pacman_deaths_total", "Lives lost to ghosts." },
+    { "pacman_resets_total", "Mazes generated (stage start, retry or death)." },
+};
+
+const MetricInfo GAUGE_INFO[MG_COUNT] = {
+    { "pacman_ghosts", "Ghosts in the current maze." },
+    { "pacman_remaining_pellets", "Pellets left in the current maze." },
+};
+
+const MetricInfo HISTOGRAM_INFO[MH_COUNT] = {
+    { "pacman_tick_seconds", "Wall time of one simulation step." },
+    { "pacman_frame_seconds", "Time between presented frames." },
+};
+
+// HDR 방식 로그-선형 버킷(나노초): 2의 거듭제곱 구간마다 8칸이라 상대 오차는 12.5% 이하.
+// 기록은 최상위 비트 찾기 + 시프트뿐이고 버킷 경계가 2의 거듭제곱에 맞아 내보낼 때 le로 그대로 묶인다.
+const int HISTOGRAM_SUB_BITS = 3;
+const int HISTOGRAM_SUB_COUNT = 1 << HISTOGRAM_SUB_BITS;
+const int HISTOGRAM_MAX_EXPONENT = 40;        // 2^41 ns(약 36분) 이상은 마지막 칸
+const int HISTOGRAM_BUCKETS = (HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_COUNT;
+const int HISTOGRAM_EXPORT_MIN_EXPONENT = 14;   // 내보내는 le: 2^14 ns(16us) ~ 2^30 ns(1.07s)
+const int HISTOGRAM_EXPORT_MAX_EXPONENT = 30;
+
+struct alignas(64) MetricCell {
+    std::atomic<uint64_t> value;
+};
+
+struct alignas(64) Histogram {
+    std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> sumNs;
+};
+
+// 전역이라 0으로 초기화된 상태에서 시작한다
+struct Metrics {
+    MetricCell counters[MC_COUNT];
+    MetricCell gauges[MG_COUNT];
+    Histogram histograms[MH_COUNT];
+    std::atomic<bool> timing;        // 내보내는 중일 때만 틱 시간을 잰다 (시계 읽기도 비용이라)
+};
+
+Metrics g_metrics;
+uint64_t g_frameDrawCalls = 0;       // GL 스레드 전용. 프레임이 끝날 때 카운터로 한 번에 넘긴다
+
+inline void countMetric(MetricCounter counter, uint64_t amount = 1) {
+    g_metrics.counters[counter].value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+inline void setMetricGauge(MetricGauge gauge, uint64_t value) {
+    g_metrics.gauges[gauge].value.store(value, std::memory_order_relaxed);
+}
+
+inline bool metricsTiming() {
+    return g_metrics.timing.load(std::memory_order_relaxed);
+}
+
+inline int highestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+inline int histogramBucket(uint64_t ns) {
+    if (ns < HISTOGRAM_SUB_COUNT) return static_cast<int>(ns);
+    int exponent = highestBit(ns);
+    if (exponent > HISTOGRAM_MAX_EXPONENT) return HISTOGRAM_BUCKETS - 1;
+    int sub = static_cast<int>((ns >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_COUNT - 1));
+    return ((exponent - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) | sub;
+}
+
+// 버킷 i에 들어가는 값의 상한 (이 값 미만)
+uint64_t histogramBucketLimit(int bucket) {
+    if (bucket < HISTOGRAM_SUB_COUNT) return static_cast<uint64_t>(bucket) + 1;
+    int exponent = (bucket >> HISTOGRAM_SUB_BITS) + HISTOGRAM_SUB_BITS - 1;
+    uint64_t sub = static_cast<uint64_t>(bucket & (HISTOGRAM_SUB_COUNT - 1)) + HISTOGRAM_SUB_COUNT;
+    return (sub + 1) << (exponent - HISTOGRAM_SUB_BITS);
+}
+
+inline void recordMetricNs(MetricHistogram histogram, uint64_t ns) {
+    Histogram& h = g_metrics.histograms[histogram];
+    h.buckets[histogramBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+    h.sumNs.fetch_add(ns, std::memory_order_relaxed);
+}
+
+inline void recordMetricSeconds(MetricHistogram histogram, double seconds) {
+    recordMetricNs(histogram, seconds > 0.0 ? static_cast<uint64_t>(seconds * 1e9) : 0);
+}
+
+uint64_t residentMemoryBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.WorkingSetSize;
+    return 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    uint64_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) return 0;
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// 내보내기 스레드가 읽는 사본. 각 값은 따로 읽으므로 지표끼리 한 순간에 맞춰져 있지는 않다
+struct MetricsSnapshot {
+    uint64_t counters[MC_COUNT];
+    uint64_t gauges[MG_COUNT];
+    uint64_t residentBytes;
+    uint64_t buckets[MH_COUNT][HISTOGRAM_BUCKETS];
+    uint64_t sumNs[MH_COUNT];
+};
+
+void takeMetricsSnapshot(MetricsSnapshot& s) {
+    for (int i = 0; i < MC_COUNT; ++i) s.counters[i] = g_metrics.counters[i].value.load(std::memory_order_relaxed);
+    for (int i = 0; i < MG_COUNT; ++i) s.gauges[i] = g_metrics.gauges[i].value.load(std::memory_order_relaxed);
+    for (int h = 0; h < MH_COUNT; ++h) {
+        for (int b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+            s.buckets[h][b] = g_metrics.histograms[h].buckets[b].load(std::memory_order_relaxed);
+        }
+        s.sumNs[h] = g_metrics.histograms[h].sumNs.load(std::memory_order_relaxed);
+    }
+    s.residentBytes = residentMemoryBytes();
+}
+
+void formatPrometheusMetrics(const MetricsSnapshot& s, std::string& out) {
+    char line[192];
+    auto header = [&](const MetricInfo& info, const char* type) {
+        out += "# HELP "; out += info.name; out += ' '; out += info.help; out += '\n';
+        out += "# TYPE "; out += info.name; out += ' '; out += type; out += '\n';
+    };
+
+    out.clear();
+    for (int i = 0; i < MC_COUNT; ++i) {
+        header(COUNTER_INFO[i], "counter");
+        std::snprintf(line, sizeof(line), "%s %llu\n", COUNTER_INFO[i].name, static_cast<unsigned long long>(s.counters[i]));
+        out += line;
+    }
+    for (int i = 0; i < MG_COUNT; ++i) {
+        header(GAUGE_INFO[i], "gauge");
+        std::snprintf(line, sizeof(line), "%s %llu\n", GAUGE_INFO[i].name, static_cast<unsigned long long>(s.gauges[i]));
+        out += line;
+    }
+    const MetricInfo memoryInfo = { "pacman_resident_memory_bytes", "Resident set size of the process." };
+    header(memoryInfo, "gauge");
+    std::snprintf(line, sizeof(line), "%s %llu\n", memoryInfo.name, static_cast<unsigned long long>(s.residentBytes));
+    out += line;
+
+    const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (int h = 0; h < MH_COUNT; ++h) {
+        const MetricInfo& info = HISTOGRAM_INFO[h];
+        const uint64_t* buckets = s.buckets[h];
+        uint64_t total = 0;
+        for (int b = 0; b < HISTOGRAM_BUCKETS; ++b) total += buckets[b];
+
+        // le는 2의 거듭제곱 ns: 그 아래 버킷을 모두 더하면 누적 개수가 된다
+        header(info, "histogram");
+        uint64_t cumulative = 0;
+        int b = 0;
+        for (int e = HISTOGRAM_EXPORT_MIN_EXPONENT; e <= HISTOGRAM_EXPORT_MAX_EXPONENT; ++e) {
+            uint64_t le = 1ull << e;
+            while (b < HISTOGRAM_BUCKETS && histogramBucketLimit(b) <= le) cumulative += buckets[b++];
+            std::snprintf(line, sizeof(line), "%s_bucket{le=\"%.9g\"} %llu\n", info.name, le * 1e-9,
+                static_cast<unsigned long long>(cumulative));
+            out += line;
+        }
+        std::snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.9g\n%s_count %llu\n",
+            info.name, static_cast<unsigned long long>(total), info.name, s.sumNs[h] * 1e-9,
+            info.name, static_cast<unsigned long long>(total));
+        out += line;
+
+        // 히스토그램 원본 해상도(12.5%)로 계산한 분위수. 버킷 상한을 보고한다
+        std::string quantileName = std::string(info.name) + "_quantile";
+        const MetricInfo quantileInfo = { quantileName.c_str(), "Quantiles estimated from the full-resolution histogram." };
+        header(quantileInfo, "gauge");
+        for (double q : quantiles) {
+            uint64_t rank = static_cast<uint64_t>(std::ceil(q * total));
+            uint64_t seen = 0;
+            uint64_t valueNs = 0;
+            for (int i = 0; i < HISTOGRAM_BUCKETS && total > 0; ++i) {
+                seen += buckets[i];
+                if (seen >= rank && seen > 0) {
+                    valueNs = histogramBucketLimit(i);
+                    break;
+                }
+            }
+            std::snprintf(line, sizeof(line), "%s{quantile=\"%g\"} %.9g\n", quantileInfo.name, q, valueNs * 1e-9);
+            out += line;
+        }
+    }
+}
+
+// 임시 파일에 다 쓴 뒤 바꿔치기 (읽는 쪽이 반쯤 쓴 파일을 보지 않게)
+bool writeMetricsFile(const std::string& path, const std::string& text) {
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!file) return false;
+    }
+#ifdef _WIN32
+    return MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+#endif
+}
+
+struct MetricsExporter {
+    std::string path;
+    double intervalSeconds = 1.0;
+    std::thread thread;
+    std::mutex mutex;                // 멈춤 신호 전용 (기록 경로와 무관)
+    std::condition_variable wake;
+    bool stopRequested = false;
+};
+
+MetricsExporter g_metricsExporter;
+
+void metricsExporterLoop() {
+    MetricsExporter& ex = g_metricsExporter;
+    MetricsSnapshot* snapshot = new MetricsSnapshot();   // 약 5KB, 스택 대신 한 번만 할당
+    std::string text;
+    bool warned = false;
+    std::unique_lock<std::mutex> lock(ex.mutex);
+    for (;;) {
+        bool stopping = ex.wake.wait_for(lock, std::chrono::duration<double>(ex.intervalSeconds),
+            [&] { return ex.stopRequested; });
+        lock.unlock();
+        takeMetricsSnapshot(*snapshot);
+        formatPrometheusMetrics(*snapshot, text);
+        if (!writeMetricsFile(ex.path, text) && !warned) {
+            std::cerr << "[metrics] failed to write " << ex.path << std::endl;
+            warned = true;
+        }
+        lock.lock();
+        if (stopping) break;   // 멈출 때도 마지막 값을 한 번 쓴다
+    }
+    delete snapshot;
+}
+
+void startMetricsExporter(const std::string& path, double intervalSeconds) {
+    MetricsExporter& ex = g_metricsExporter;
+    ex.path = path;
+    ex.intervalSeconds = std::max(0.05, intervalSeconds);
+    ex.stopRequested = false;
+    g_metrics.timing.store(true, std::memory_order_relaxed);
+    ex.thread = std::thread(metricsExporterLoop);
+}
+
+void stopMetricsExporter() {
+    MetricsExporter& ex = g_metricsExporter;
+    if (!ex.thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(ex.mutex);
+        ex.stopRequested = true;
+    }
+    ex.wake.notify_one();
+    ex.thread.join();
+    g_metrics.timing.store(false, std::memory_order_relaxed);
+}
+
+// ---- 파일 매핑 / 바이트 버퍼 ----
+// 읽기 전용 메모리 매핑 (POSIX mmap / Win32 파일 매핑)
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+void unmapFile(MappedFile& mapped) {
+#ifdef _WIN32
+    if (mapped.data) UnmapViewOfFile(mapped.data);
+    if (mapped.mapping) CloseHandle(mapped.mapping);
+    if (mapped.file != INVALID_HANDLE_VALUE) CloseHandle(mapped.file);
+    mapped.file = INVALID_HANDLE_VALUE;
+    mapped.mapping = nullptr;
+#else
+    if (mapped.data) munmap(const_cast<uint8_t*>(mapped.data), mapped.size);
+    if (mapped.fd >= 0) close(mapped.fd);
+    mapped.fd = -1;
+#endif
+    mapped.data = nullptr;
+    mapped.size = 0;
+}
+
+bool mapFile(MappedFile& mapped, const std::string& path) {
+    unmapFile(mapped);
+#ifdef _WIN32
+    mapped.file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mapped.file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mapped.file, &size) || size.QuadPart == 0) {
+        unmapFile(mapped);
+        return false;
+    }
+    mapped.mapping = CreateFileMappingA(mapped.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapped.mapping) mapped.data = static_cast<const uint8_t*>(MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!mapped.data) {
+        unmapFile(mapped);
+        return false;
+    }
+    mapped.size = static_cast<size_t>(size.QuadPart);
+#else
+    mapped.fd = open(path.c_str(), O_RDONLY);
+    if (mapped.fd < 0) return false;
+    struct stat info;
+    if (fstat(mapped.fd, &info) != 0 || info.st_size == 0) {
+        unmapFile(mapped);
+        return false;
+    }
+    void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, mapped.fd, 0);
+    if (data == MAP_FAILED) {
+        unmapFile(mapped);
+        return false;
+    }
+    mapped.data = static_cast<const uint8_t*>(data);
+    mapped.size = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+// 값을 바이트 그대로 덧붙인다 (타일 압축, 세이브 스테이트, 네트워크 패킷이 같이 씀)
+template <typename T>
+void putStateValue(std::vector<uint8_t>& out, T value) {
+    size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+// ---- 타일 월드 (초대형 탐험 맵: --build-tiled-world, --tile-stress, --explore) ----
+// 16k x 16k 이상 맵은 스테이지처럼 칸마다 층을 펼쳐 둘 수 없다. g_maze(칸당 4바이트), 펠릿마다 엔티티,
+// collectibleAt을 합치면 칸당 100바이트가 넘어 수십 GB가 된다.
+// 그래서 맵을 64x64 타일로 나눠 파일에 압축해 두고 메모리 매핑한다. 플레이어(탐험자) 주변 타일만 칸당 2비트로
+// 풀어서 고정 크기 캐시에 두고, 가장 오래 안 쓴 타일부터 내보낸다(LRU).
+// 칸 코드는 0 = 벽, 1 = 빈 길, 2 = 펠릿, 3 = 파워 펠릿이다. 높이와 배율은 스테이지와 같이 종류에서 나온다.
+// 타일 -> 캐시 슬롯 표가 있어서 올라와 있는 타일의 칸 조회는 나눗셈 없이 시프트 / 마스크 몇 번이면 된다.
+// 먹어서 바뀐 타일은 내보낼 때 다시 압축해 메모리 오버레이에 두고(파일은 읽기 전용), 다시 올릴 때 그쪽을 쓴다.
+// 탐험 스테이지(--explore)가 이 위에서 돈다. 길 칸 / 펠릿 조회는 타일 월드로 가고, 렌더와 봇은 플레이어 주변
+// 창만 g_maze / 엔티티로 펼친 사본을 본다 (아래 "탐험 스테이지" 참고).
+//
+// 파일 (리틀 엔디언, 구조체 그대로):
+//   [TiledWorldHeader][TiledWorldTile x tilesX * tilesY (행 우선)][타일 데이터...]
+//   타일 데이터: FILL = 없음 (칸 전부 fill 코드), RAW = 칸당 2비트 (행 우선, 바이트 안은 하위 비트부터),
+//                RLE = u16 * n (상위 2비트 코드, 하위 14비트 길이 - 1)
+
+const char TILED_WORLD_MAGIC[4] = { 'P', 'M', 'T', 'W' };
+const uint32_t TILED_WORLD_VERSION = 1;
+const int TILE_SHIFT = 6;
+const int TILE_SIZE = 1 << TILE_SHIFT;                       // 한 변 칸 수
+const int TILE_CELLS = TILE_SIZE * TILE_SIZE;
+const int TILE_BYTES = TILE_CELLS / 4;                       // 칸당 2비트로 푼 크기
+const uint32_t TILED_WORLD_MAX_DIM = 1u << 20;
+
+enum TiledCellCode : uint8_t { TILE_WALL, TILE_PATH, TILE_PELLET, TILE_POWER_PELLET };
+enum TileEncoding : uint8_t { TILE_FILL, TILE_RAW, TILE_RLE };
+
+struct TiledWorldHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tilesX;
+    uint32_t tilesZ;
+    uint32_t startX;          // 탐험자 시작 칸
+    uint32_t startZ;
+    uint32_t seed;
+    uint32_t reserved;
+};
+
+struct TiledWorldTile {
+    uint64_t offset;          // 파일 처음부터
+    uint32_t size;
+    uint8_t encoding;
+    uint8_t fill;             // FILL일 때 칸 코드
+    uint16_t reserved;
+};
+static_assert(sizeof(TiledWorldHeader) == 40 && sizeof(TiledWorldTile) == 16, "tiled world records are written as raw structs");
+
+inline int tileCellCode(const uint8_t* cells, int index) {
+    return (cells[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+inline void setTileCellCode(uint8_t* cells, int index, int code) {
+    int shift = (index & 3) * 2;
+    cells[index >> 2] = static_cast<uint8_t>((cells[index >> 2] & ~(3 << shift)) | (code << shift));
+}
+
+// 칸당 2비트로 푼 타일을 가장 작은 표현으로. FILL이면 out은 비고 fill에 코드
+TileEncoding encodeTile(const uint8_t* cells, std::vector<uint8_t>& out, uint8_t& fill) {
+    out.clear();
+    fill = static_cast<uint8_t>(tileCellCode(cells, 0));
+    int runs = 0;
+    for (int i = 0; i < TILE_CELLS;) {
+        int code = tileCellCode(cells, i);
+        int end = i + 1;
+        while (end < TILE_CELLS && tileCellCode(cells, end) == code) ++end;
+        putStateValue<uint16_t>(out, static_cast<uint16_t>((code << 14) | (end - i - 1)));
+        runs++;
+        i = end;
+    }
+    if (runs == 1) {
+        out.clear();
+        return TILE_FILL;
+    }
+    if (out.size() < static_cast<size_t>(TILE_BYTES)) return TILE_RLE;
+    out.assign(cells, cells + TILE_BYTES);
+    return TILE_RAW;
+}
+
+bool decodeTile(TileEncoding encoding, uint8_t fill, const uint8_t* data, size_t size, uint8_t* cells) {
+    if (encoding == TILE_FILL) {
+        uint8_t byte = static_cast<uint8_t>((fill & 3) * 0x55);
+        std::memset(cells, byte, TILE_BYTES);
+        return true;
+    }
+    if (encoding == TILE_RAW) {
+        if (size != static_cast<size_t>(TILE_BYTES)) return false;
+        std::memcpy(cells, data, TILE_BYTES);
+        return true;
+    }
+    int cell = 0;
+    for (size_t at = 0; at + 2 <= size; at += 2) {
+        uint16_t run;
+        std::memcpy(&run, data + at, sizeof(run));
+        int code = run >> 14;
+        int length = (run & 0x3FFF) + 1;
+        if (cell + length > TILE_CELLS) return false;
+        for (int end = cell + length; cell < end; ++cell) setTileCellCode(cells, cell, code);
+    }
+    return cell == TILE_CELLS;
+}
+
+struct TiledWorldStats {
+    long long lookups = 0;
+    long long misses = 0;          // 조회한 타일이 캐시에 없어 올림
+    long long loads = 0;           // 올린 타일 (미리 올림 포함)
+    long long loadsByEncoding[3] = {};   // 그중 FILL / RAW / RLE에서 푼 것 (오버레이 포함)
+    long long evictions = 0;
+    long long writebacks = 0;      // 바뀐 채로 내보내 오버레이에 저장
+    long long decodedBytes = 0;
+    double loadSeconds = 0.0;
+};
+
+struct TiledWorld {
+    MappedFile file;
+    TiledWorldHeader header{};
+    const TiledWorldTile* index = nullptr;
+
+    // 캐시: 슬롯마다 풀린 타일 하나. lruPrev / lruNext는 슬롯 번호 (-1 = 끝), lruHead가 가장 최근
+    int capacity = 0;
+    std::vector<uint8_t> cells;            // capacity * TILE_BYTES
+    std::vector<int32_t> slotOfTile;       // 타일 -> 슬롯 (-1 = 안 올라옴)
+    std::vector<int32_t> tileOfSlot;       // 슬롯 -> 타일 (-1 = 빔)
+    std::vector<int32_t> lruPrev;
+    std::vector<int32_t> lruNext;
+    std::vector<uint8_t> dirty;
+    int lruHead = -1;
+    int lruTail = -1;
+    int used = 0;
+
+    std::unordered_map<uint32_t, std::vector<uint8_t>> overlay;   // 바뀐 타일: 앞 2바이트 = encoding, fill
+    size_t overlayBytes = 0;
+    std::vector<uint8_t> scratch;
+    TiledWorldStats stats;
+};
+
+void tiledLruUnlink(TiledWorld& w, int slot) {
+    int prev = w.lruPrev[slot];
+    int next = w.lruNext[slot];
+    if (prev >= 0) w.lruNext[prev] = next;
+    else w.lruHead = next;
+    if (next >= 0) w.lruPrev[next] = prev;
+    else w.lruTail = prev;
+}
+
+void tiledLruPushFront(TiledWorld& w, int slot) {
+    w.lruPrev[slot] = -1;
+    w.lruNext[slot] = w.lruHead;
+    if (w.lruHead >= 0) w.lruPrev[w.lruHead] = slot;
+    w.lruHead = slot;
+    if (w.lruTail < 0) w.lruTail = slot;
+}
+
+bool openTiledWorld(TiledWorld& w, const std::string& path, int cacheTiles) {
+    if (!mapFile(w.file, path)) {
+        std::cerr << "tiled world: cannot map " << path << std::endl;
+        return false;
+    }
+    bool valid = w.file.size >= sizeof(TiledWorldHeader);
+    if (valid) {
+        std::memcpy(&w.header, w.file.data, sizeof(w.header));
+        const TiledWorldHeader& h = w.header;
+        valid = std::memcmp(h.magic, TILED_WORLD_MAGIC, 4) == 0 && h.version == TILED_WORLD_VERSION
+            && h.width >= 3 && h.height >= 3 && h.width <= TILED_WORLD_MAX_DIM && h.height <= TILED_WORLD_MAX_DIM
+            && h.tilesX == (h.width + TILE_SIZE - 1) / TILE_SIZE && h.tilesZ == (h.height + TILE_SIZE - 1) / TILE_SIZE
+            && h.startX < h.width && h.startZ < h.height
+            && w.file.size >= sizeof(h) + static_cast<size_t>(h.tilesX) * h.tilesZ * sizeof(TiledWorldTile);
+    }
+    if (valid) {
+        w.index = reinterpret_cast<const TiledWorldTile*>(w.file.data + sizeof(TiledWorldHeader));
+        size_t tileCount = static_cast<size_t>(w.header.tilesX) * w.header.tilesZ;
+        for (size_t t = 0; valid && t < tileCount; ++t) {
+            const TiledWorldTile& tile = w.index[t];
+            valid = tile.encoding <= TILE_RLE && tile.offset <= w.file.size && tile.size <= w.file.size - tile.offset;
+        }
+    }
+    if (!valid) {
+        std::cerr << "tiled world: " << path << " is not a valid tiled world" << std::endl;
+        unmapFile(w.file);
+        return false;
+    }
+    size_t tileCount = static_cast<size_t>(w.header.tilesX) * w.header.tilesZ;
+    w.capacity = std::max(1, cacheTiles);
+    w.cells.assign(static_cast<size_t>(w.capacity) * TILE_BYTES, 0);
+    w.slotOfTile.assign(tileCount, -1);
+    w.tileOfSlot.assign(w.capacity, -1);
+    w.lruPrev.assign(w.capacity, -1);
+    w.lruNext.assign(w.capacity, -1);
+    w.dirty.assign(w.capacity, 0);
+    return true;
+}
+
+void closeTiledWorld(TiledWorld& w) {
+    unmapFile(w.file);
+    w = TiledWorld();
+}
+
+// 가장 오래 안 쓴 타일을 내보내고 빈 슬롯을 돌려준다
+int tiledEvict(TiledWorld& w) {
+    int slot = w.lruTail;
+    int tile = w.tileOfSlot[slot];
+    if (w.dirty[slot]) {
+        uint8_t fill;
+        TileEncoding encoding = encodeTile(&w.cells[static_cast<size_t>(slot) * TILE_BYTES], w.scratch, fill);
+        std::vector<uint8_t>& saved = w.overlay[static_cast<uint32_t>(tile)];
+        w.overlayBytes -= saved.size();
+        saved.assign({ static_cast<uint8_t>(encoding), fill });
+        saved.insert(saved.end(), w.scratch.begin(), w.scratch.end());
+        w.overlayBytes += saved.size();
+        w.dirty[slot] = 0;
+        w.stats.writebacks++;
+    }
+    tiledLruUnlink(w, slot);
+    w.slotOfTile[tile] = -1;
+    w.tileOfSlot[slot] = -1;
+    w.used--;
+    w.stats.evictions++;
+    return slot;
+}
+
+// 타일을 캐시에 올려 슬롯을 돌려준다 (이미 있으면 가장 최근으로만)
+int tiledLoad(TiledWorld& w, int tile) {
+    int slot = w.slotOfTile[tile];
+    if (slot >= 0) {
+        if (slot != w.lruHead) {
+            tiledLruUnlink(w, slot);
+            tiledLruPushFront(w, slot);
+        }
+        return slot;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (w.used < w.capacity) slot = w.used;
+    else slot = tiledEvict(w);
+    uint8_t* cells = &w.cells[static_cast<size_t>(slot) * TILE_BYTES];
+
+    bool ok;
+    TileEncoding encoding;
+    auto saved = w.overlay.find(static_cast<uint32_t>(tile));
+    if (saved != w.overlay.end()) {
+        const std::vector<uint8_t>& data = saved->second;
+        encoding = static_cast<TileEncoding>(data[0]);
+        ok = decodeTile(encoding, data[1], data.data() + 2, data.size() - 2, cells);
+    }
+    else {
+        const TiledWorldTile& entry = w.index[tile];
+        encoding = static_cast<TileEncoding>(entry.encoding);
+        ok = decodeTile(encoding, entry.fill, w.file.data + entry.offset, entry.size, cells);
+    }
+    if (!ok) std::memset(cells, 0, TILE_BYTES);   // 깨진 타일은 벽으로
+    w.stats.loadsByEncoding[encoding]++;
+
+    w.slotOfTile[tile] = slot;
+    w.tileOfSlot[slot] = tile;
+    tiledLruPushFront(w, slot);
+    w.used++;
+    w.stats.loads++;
+    w.stats.decodedBytes += TILE_BYTES;
+    w.stats.loadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return slot;
+}
+
+// 칸 코드. 맵 밖은 벽. 타일이 올라와 있으면 표 한 번 + 비트 연산, 아니면 그 자리에서 올린다
+inline int tiledCell(TiledWorld& w, int x, int z) {
+    if (x < 0 || z < 0 || static_cast<uint32_t>(x) >= w.header.width || static_cast<uint32_t>(z) >= w.header.height) return TILE_WALL;
+    w.stats.lookups++;
+    int tile = (z >> TILE_SHIFT) * static_cast<int>(w.header.tilesX) + (x >> TILE_SHIFT);
+    int slot = w.slotOfTile[tile];
+    if (slot < 0) {
+        w.stats.misses++;
+        slot = tiledLoad(w, tile);
+    }
+    else if (slot != w.lruHead) {
+        tiledLruUnlink(w, slot);
+        tiledLruPushFront(w, slot);
+    }
+    int index = ((z & (TILE_SIZE - 1)) << TILE_SHIFT) | (x & (TILE_SIZE - 1));
+    return tileCellCode(&w.cells[static_cast<size_t>(slot) * TILE_BYTES], index);
+}
+
+void setTiledCell(TiledWorld& w, int x, int z, int code) {
+    if (x < 0 || z < 0 || static_cast<uint32_t>(x) >= w.header.width || static_cast<uint32_t>(z) >= w.header.height) return;
+    int tile = (z >> TILE_SHIFT) * static_cast<int>(w.header.tilesX) + (x >> TILE_SHIFT);
+    int slot = tiledLoad(w, tile);
+    int index = ((z & (TILE_SIZE - 1)) << TILE_SHIFT) | (x & (TILE_SIZE - 1));
+    setTileCellCode(&w.cells[static_cast<size_t>(slot) * TILE_BYTES], index, code);
+    w.dirty[slot] = 1;
+}
+
+// (x, z) 칸이 든 타일과 그 둘레 radius 타일을 미리 올린다
+void tiledPrefetch(TiledWorld& w, int x, int z, int radius) {
+    int tx = x >> TILE_SHIFT;
+    int tz = z >> TILE_SHIFT;
+    for (int dz = -radius; dz <= radius; ++dz) {
+        for (int dx = -radius; dx <= radius; ++dx) {
+            int nx = tx + dx;
+            int nz = tz + dz;
+            if (nx < 0 || nz < 0 || nx >= static_cast<int>(w.header.tilesX) || nz >= static_cast<int>(w.header.tilesZ)) continue;
+            tiledLoad(w, nz * static_cast<int>(w.header.tilesX) + nx);
+        }
+    }
+}
+
+size_t tiledResidentBytes(const TiledWorld& w) {
+    return w.cells.size() + (w.slotOfTile.size() + w.tileOfSlot.size() + w.lruPrev.size() + w.lruNext.size()) * sizeof(int32_t)
+        + w.dirty.size() + w.overlayBytes + w.overlay.size() * (sizeof(uint32_t) + sizeof(std::vector<uint8_t>) + 2 * sizeof(void*));
+}
+
+// ---- 엔티티 / 컴포넌트 ----
+// 플레이어, 유령, 펠릿/아이템은 모두 엔티티다. 컴포넌트는 종류별 밀집 배열에 모아 두고
+// 시스템(유령 AI/이동, 충돌, 그리기)은 필요한 배열을 앞에서부터 훑는다. 가상 함수 없음.
+// 새 액터(과일, 다른 유령 등)는 전역 변수를 늘리지 않고 컴포넌트 조합으로 만든다.
+
+typedef uint32_t Entity;
+const Entity INVALID_ENTITY = 0xFFFFFFFFu;
+
+struct Transform {
+    float x = 0.0f;
+    float z = 0.0f;
+    float angleY = 0.0f;     // 바라보는 방향(도)
+};
+
+struct GridCell {
+    int x = 0;
+    int z = 0;
+};
+
+// 칸 중심을 따라 움직이는 액터 (지금은 유령)
+const int SIM_LOD_LEVELS = 4;              // 시뮬레이션 LOD 갱신 간격 1, 1/2, 1/4, 1/8
+
+struct Movement {
+    float speed = 0.0f;
+    int dirX = 0;
+    int dirZ = 0;
+    float lodPending = 0.0f;   // 시뮬레이션 LOD: 아직 적분하지 않은 시간 (초)
+    uint8_t lodWait = 0;       // 다음 갱신까지 건너뛸 틱 수 (< 2^(SIM_LOD_LEVELS - 1))
+};
+
+// 유령 성격 = 행동 프로그램 번호 (GHOST_PROGRAMS 참고)
+enum class GhostPersonality : uint8_t { CHASER, AMBUSHER, PATROL, WANDERER, COUNT };
+
+// 겁먹음(파워 펠릿) / 잡혀서 집으로 돌아가는 중이면 행동 프로그램 대신 거리 필드를 따른다
+enum class GhostMode : uint8_t { NORMAL, FRIGHTENED, EATEN };
+
+struct GhostBrain {
+    GhostPersonality personality = GhostPersonality::CHASER;
+    uint8_t corner = 0;      // 흩어지기 단계에 갈 구석 (0~3)
+    GhostMode mode = GhostMode::NORMAL;
+};
+
+enum class RenderKind : uint8_t { PACMAN, GHOST, PELLET, SLOW_ITEM, POWER_PELLET };
+
+struct Render {
+    RenderKind kind = RenderKind::PELLET;
+    glm::vec3 color = glm::vec3(1.0f);
+    float anim = 0.0f;       // 종류별 애니메이션 값 (팩맨: 입 각도(도))
+    float animDir = 1.0f;    // 1 = 열리는 중, -1 = 닫히는 중
+};
+
+enum class CollectibleKind : uint8_t { PELLET, SLOW_ITEM, POWER_PELLET };
+
+struct Collectible {
+    CollectibleKind kind = CollectibleKind::PELLET;
+    int score = 0;
+};
+
+// 희소 집합: slot[entity] = data 위치. 지울 때는 마지막 원소를 빈자리로 옮겨 배열을 빽빽하게 유지.
+template <typename T>
+struct ComponentArray {
+    std::vector<T> data;
+    std::vector<Entity> owner;   // data[i]의 엔티티
+    std::vector<int> slot;       // 엔티티 -> data 위치 (-1 = 없음)
+};
+
+template <typename T>
+T& addComponent(ComponentArray<T>& arr, Entity e, const T& value) {
+    if (e >= arr.slot.size()) arr.slot.resize(e + 1, -1);
+    if (arr.slot[e] < 0) {
+        arr.slot[e] = static_cast<int>(arr.data.size());
+        arr.data.push_back(value);
+        arr.owner.push_back(e);
+    }
+    else {
+        arr.data[arr.slot[e]] = value;
+    }
+    return arr.data[arr.slot[e]];
+}
+
+template <typename T>
+bool hasComponent(const ComponentArray<T>& arr, Entity e) {
+    return e < arr.slot.size() && arr.slot[e] >= 0;
+}
+
+template <typename T>
+T& getComponent(ComponentArray<T>& arr, Entity e) {
+    return arr.data[arr.slot[e]];
+}
+
+template <typename T>
+void removeComponent(ComponentArray<T>& arr, Entity e) {
+    if (!hasComponent(arr, e)) return;
+    int i = arr.slot[e];
+    int last = static_cast<int>(arr.data.size()) - 1;
+    if (i != last) {
+        arr.data[i] = arr.data[last];
+        arr.owner[i] = arr.owner[last];
+        arr.slot[arr.owner[i]] = i;
+    }
+    arr.data.pop_back();
+    arr.owner.pop_back();
+    arr.slot[e] = -1;
+}
+
+template <typename T>
+void clearComponents(ComponentArray<T>& arr) {
+    // clear()는 용량을 남기므로 reset()마다 다시 할당하지 않음
+    arr.data.clear();
+    arr.owner.clear();
+    arr.slot.clear();
+}
+
+struct World {
+    Entity nextEntity = 0;
+    std::vector<Entity> freeEntities;
+
+    ComponentArray<Transform> transforms;
+    ComponentArray<GridCell> cells;
+    ComponentArray<Movement> movements;
+    ComponentArray<GhostBrain> brains;
+    ComponentArray<Render> renders;
+    ComponentArray<Collectible> collectibles;
+
+    std::vector<Entity> collectibleAt;   // 칸 인덱스 -> 그 칸의 아이템 (먹기 판정에서 격자를 훑지 않게)
+    Entity players[MAX_PLAYERS] = { INVALID_ENTITY, INVALID_ENTITY, INVALID_ENTITY, INVALID_ENTITY };   // 0번 = 1P
+    int playerCount = 0;
+};
+
+thread_local World g_world;
+
+// 아이템이 사라지거나 (잘못 예측한 획득을 되돌려) 다시 생긴 칸. 렌더 미러가 순서대로 따라 한다
+struct ItemChange {
+    int cell;                        // 칸 인덱스 (z * width + x)
+    uint8_t item;                    // 0 = 사라짐, 1 + CollectibleKind = 생김
 };
 
-std::vector<Ghost> g_ghosts;
+thread_local std::vector<ItemChange> g_itemChanges;   // 마지막 렌더 스냅샷 이후 (순서대로)
+
+Entity createEntity() {
+    if (!g_world.freeEntities.empty()) {
+        Entity e = g_world.freeEntities.back();
+        g_world.freeEntities.pop_back();
+        return e;
+    }
+    return g_world.nextEntity++;
+}
+
+void destroyEntity(Entity e) {
+    removeComponent(g_world.transforms, e);
+    removeComponent(g_world.cells, e);
+    removeComponent(g_world.movements, e);
+    removeComponent(g_world.brains, e);
+    removeComponent(g_world.renders, e);
+    removeComponent(g_world.collectibles, e);
+    g_world.freeEntities.push_back(e);
+}
+
+void clearWorld() {
+    g_world.nextEntity = 0;
+    g_world.freeEntities.clear();
+    clearComponents(g_world.transforms);
+    clearComponents(g_world.cells);
+    clearComponents(g_world.movements);
+    clearComponents(g_world.brains);
+    clearComponents(g_world.renders);
+    clearComponents(g_world.collectibles);
+    g_world.collectibleAt.clear();
+    for (Entity& player : g_world.players) player = INVALID_ENTITY;
+    g_world.playerCount = 0;
+    g_itemChanges.clear();   // 월드를 새로 만들면 렌더 쪽은 어차피 전체를 다시 받는다
+}
+
+Transform& playerTransform(int index = 0) {
+    return getComponent(g_world.transforms, g_world.players[index]);
+}
 
 const float GHOST_WIDTH = 0.3f;
 const float GHOST_HEIGHT = 0.5f;
@@ -79,25 +967,64 @@ const float GHOST_DEPTH = 0.3f;
 const float GHOST_MOVE_SPEED = 2.0f;  // 플레이어보다 느리게 이동
 
 
-std::vector<std::vector<float>> g_cubeCurrentHeight;
-std::vector<std::vector<float>> g_cubeCurrentScale;
-std::vector<std::vector<bool>> g_pellets;      // 해당 칸에 펠릿이 있는지 여부
-std::vector<std::vector<bool>> g_slowItems;    // Stage 2에서만 등장하는 특수 아이템
-int g_totalPellets = 0;                        // 맵 전체 펠릿 수
-int g_remainingPellets = 0;                    // 아직 안 먹은 펠릿 수
+thread_local int g_totalPellets = 0;                        // 맵 전체 펠릿 수
+thread_local int g_remainingPellets = 0;                    // 아직 안 먹은 펠릿 수
 
-bool  g_ghostSlowActive = false;
-float g_ghostSlowTimer = 0.0f;
-float g_ghostSpeedScale = 1.0f;      // 1.0 = 기본, 0.5 = 절반 속도 등
+thread_local bool  g_ghostSlowActive = false;
+thread_local float g_ghostSlowTimer = 0.0f;
+thread_local float g_ghostSpeedScale = 1.0f;      // 1.0 = 기본, 0.5 = 절반 속도 등
 
 const float GHOST_SLOW_DURATION = 5.0f;   // 5초 동안 지속 (나중에 조절 가능)
 const float GHOST_SLOW_SCALE    = 0.5f;   // 유령 속도 50%로 감소
 
+const float GHOST_FRIGHTENED_DURATION = 6.0f;
+const float GHOST_FRIGHTENED_FLASH = 2.0f;     // 끝나기 이만큼 전부터 흰색으로 깜박임
+const float GHOST_FRIGHTENED_SCALE = 0.5f;     // 겁먹은 유령 속도
+const float GHOST_EATEN_SCALE = 2.0f;          // 집으로 돌아가는 유령 속도 (슬로우 아이템 영향 없음)
+const int GHOST_EAT_BASE_SCORE = 200;          // 200, 400, 800, 1600
+const int GHOST_EAT_MAX_COMBO = 3;
+thread_local float g_frightenedTimer = 0.0f;   // 0보다 크면 겁먹음 모드
+
+// 모드 배율을 곱하기 전 유령 속도 (Movement::speed가 0이면 기본값)
+inline float ghostBaseSpeed(const Movement& move) {
+    return move.speed > 0.0f ? move.speed : GHOST_MOVE_SPEED;
+}
+
+// 지금 규칙에서 이 유령이 낼 수 있는 가장 빠른 속도 (어느 모드로 바뀌어도)
+inline float ghostTopSpeed(const Movement& move) {
+    return ghostBaseSpeed(move) * std::max(GHOST_EATEN_SCALE, g_ghostSpeedScale * std::max(1.0f, GHOST_FRIGHTENED_SCALE));
+}
+thread_local int g_ghostEatCombo = 0;          // 이번 파워 펠릿으로 잡은 유령 수
+
+// 흩어지기/쫓기 단계 (아케이드와 같은 순서). 짝수 번째 = 흩어지기, 표가 끝나면 계속 쫓기
+const float GHOST_PHASE_SECONDS[] = { 7.0f, 20.0f, 7.0f, 20.0f, 5.0f, 20.0f, 5.0f };
+const int GHOST_PHASE_COUNT = sizeof(GHOST_PHASE_SECONDS) / sizeof(GHOST_PHASE_SECONDS[0]);
+thread_local int g_ghostPhaseIndex = 0;
+thread_local float g_ghostPhaseTimer = 0.0f;   // 현재 단계에서 흐른 시간
+
+// 성격별 몸 색 (GhostPersonality 순서)
+const glm::vec3 GHOST_COLORS[] = {
+    glm::vec3(0.9f, 0.25f, 0.2f),   // 추격: 빨강
+    glm::vec3(1.0f, 0.6f, 0.8f),    // 매복: 분홍
+    glm::vec3(1.0f, 0.6f, 0.2f),    // 순찰: 주황
+    glm::vec3(0.6f, 0.6f, 0.6f),    // 배회: 회색
+};
+
 enum CellType { WALL, PATH };
-std::vector<std::vector<CellType>> g_maze;
+thread_local std::vector<std::vector<CellType>> g_maze;
+thread_local int g_mazeVersion = 0;   // reset()으로 미로가 새로 만들어질 때마다 증가 (정적 그림자 캐시 무효화용)
+
+// 칸 큐브의 세로 배율과 중심 높이는 칸 종류로 정해지므로 칸마다 저장하지 않는다
+inline float cellScaleY(int x, int z) {
+    return g_maze[z][x] == WALL ? WALL_SCALE : FLOOR_SCALE;
+}
+
+inline float cellCenterY(int x, int z) {
+    return cellScaleY(x, z) * CUBE_SIZE * 0.5f;
+}
 
-std::mt19937 g_randomEngine;
-int g_lastTime = 0;
+thread_local std::mt19937 g_randomEngine;
+thread_local bool g_seedLocked = false;   // true면 reset()에서 시간으로 다시 시드하지 않음 (봇/재현용)
 
 enum class GameState {
     TITLE,
@@ -106,12 +1033,31 @@ enum class GameState {
     GAME_OVER
 };
 
-GameState g_gameState = GameState::TITLE;
+thread_local GameState g_gameState = GameState::TITLE;
 
-int g_score = 0;
-int g_lives = 3;
-int g_currentStage = 1;   // 1 = Stage 1, 2 = Stage 2
+thread_local int g_score = 0;
+thread_local int g_lives = 3;
+thread_local int g_currentStage = 1;   // 1 = Stage 1, 2 = Stage 2, 3 = 탐험 (--explore가 있을 때만)
 const int MAX_STAGE = 2;
+const int EXPLORE_STAGE = MAX_STAGE + 1;
+
+// 탐험 스테이지에서는 타일 월드가 칸의 원본이고, g_maze / collectibleAt은 (0, 0) 칸이 월드의
+// (g_exploreOriginX, g_exploreOriginZ) 칸인 창이다. 칸 조회는 창 좌표에 원점을 더해 타일 월드로 간다
+std::string g_exploreWorldPath;                 // --explore FILE (비어 있으면 탐험 스테이지 없음)
+thread_local TiledWorld g_exploreWorld;         // 게임(스레드)마다 따로 연다. 캐시와 먹은 칸 오버레이가 게임 상태라서
+thread_local bool g_exploreActive = false;
+thread_local int g_exploreOriginX = 0;
+thread_local int g_exploreOriginZ = 0;
+
+// --explore가 있으면 일반 스테이지 뒤에 탐험 스테이지가 붙는다
+int lastStage() {
+    return g_exploreWorldPath.empty() ? MAX_STAGE : EXPLORE_STAGE;
+}
+
+// 창 칸 (x, z)의 타일 월드 칸 코드
+inline int exploreCell(int x, int z) {
+    return tiledCell(g_exploreWorld, g_exploreOriginX + x, g_exploreOriginZ + z);
+}
 
 std::string readShaderSource(const char* filePath) {
     std::ifstream file(filePath);
@@ -180,6 +1126,59 @@ glm::ivec2 getGridCoord(float worldX, float worldZ) {
     return glm::ivec2(gridX, gridZ);
 }
 
+// 탐험 스테이지도 창 밖은 막힌 칸으로 본다. 창이 1P를 따라 옮겨지므로 움직임에는 걸리지 않고,
+// 창 크기 배열로 도는 BFS(봇, 갈림길 그래프)가 밖으로 넘치지 않는다
+bool isPathCell(int x, int z) {
+    if (x < 0 || x >= g_gridWidth || z < 0 || z >= g_gridHeight) return false;
+    if (g_exploreActive) return exploreCell(x, z) != TILE_WALL;
+    return g_maze[z][x] == PATH;
+}
+
+// 그리드 DDA: 선분 (x0,z0)->(x1,z1)이 지나가는 칸을 순서대로 방문한다.
+// 새 칸에 들어갈 때마다 visit(x, z)를 부르고, false를 돌려주면(막힌 칸) 그 칸 경계까지의 비율 t를 반환.
+// 끝까지 막히지 않으면 1. 비용은 지나간 칸 수에 비례하므로 deltaTime이 커도 칸을 건너뛰지 않는다.
+template <typename Visit>
+float sweepGrid(float x0, float z0, float x1, float z1, Visit visit) {
+    float totalGridWidth = (g_gridWidth - 1) * (CUBE_SIZE + GRID_SPACING);
+    float totalGridHeight = (g_gridHeight - 1) * (CUBE_SIZE + GRID_SPACING);
+    float startX = -totalGridWidth / 2.0f;
+    float startZ = -totalGridHeight / 2.0f;
+    float unitSize = CUBE_SIZE + GRID_SPACING;
+
+    // 칸 경계가 정수가 되는 그리드 좌표 (칸 중심 = 정수 + 0.5)
+    float gx0 = (x0 - startX) / unitSize + 0.5f;
+    float gz0 = (z0 - startZ) / unitSize + 0.5f;
+    float dx = (x1 - startX) / unitSize + 0.5f - gx0;
+    float dz = (z1 - startZ) / unitSize + 0.5f - gz0;
+
+    int cx = (int)std::floor(gx0);
+    int cz = (int)std::floor(gz0);
+    int stepX = (dx > 0.0f) ? 1 : -1;
+    int stepZ = (dz > 0.0f) ? 1 : -1;
+
+    const float INF = std::numeric_limits<float>::max();
+    float tDeltaX = (dx != 0.0f) ? 1.0f / std::abs(dx) : INF;
+    float tDeltaZ = (dz != 0.0f) ? 1.0f / std::abs(dz) : INF;
+    float tMaxX = (dx > 0.0f) ? (cx + 1 - gx0) * tDeltaX : (dx < 0.0f) ? (gx0 - cx) * tDeltaX : INF;
+    float tMaxZ = (dz > 0.0f) ? (cz + 1 - gz0) * tDeltaZ : (dz < 0.0f) ? (gz0 - cz) * tDeltaZ : INF;
+
+    for (;;) {
+        float t;
+        if (tMaxX < tMaxZ) {
+            t = tMaxX;
+            cx += stepX;
+            tMaxX += tDeltaX;
+        }
+        else {
+            t = tMaxZ;
+            cz += stepZ;
+            tMaxZ += tDeltaZ;
+        }
+        if (t > 1.0f) return 1.0f;
+        if (!visit(cx, cz)) return t;
+    }
+}
+
 void generateMaze(int x, int z) {
     g_maze[z][x] = PATH;
 
@@ -226,47 +1225,188 @@ void initCubes() {
     // and later indexing with the new width crashes. `assign` rebuilds each row with
     // the correct column count for the current stage.
     g_maze.assign(g_gridHeight, std::vector<CellType>(g_gridWidth, WALL));
-    g_cubeCurrentHeight.assign(g_gridHeight, std::vector<float>(g_gridWidth, 0.0f));
-    g_cubeCurrentScale.assign(g_gridHeight, std::vector<float>(g_gridWidth, 0.0f));
-    g_pellets.assign(g_gridHeight, std::vector<bool>(g_gridWidth, false));
-    g_slowItems.assign(g_gridHeight, std::vector<bool>(g_gridWidth, false));
-    g_randomEngine.seed(static_cast<unsigned int>(std::time(0)));
 }
 
-void reset() {
-    int stageGridWidth = 11;
-    int stageGridHeight = 11;
-    float loopProbability = 0.35f;
-    int ghostCount = 3;
+// 1P는 노란색, 나머지는 유령 색과 겹치지 않게
+const glm::vec3 PLAYER_COLORS[MAX_PLAYERS] = {
+    glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(0.3f, 1.0f, 0.3f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0.7f, 0.4f, 1.0f)
+};
 
-    g_ghostSlowActive = false;
-    g_ghostSlowTimer = 0.0f;
-    g_ghostSpeedScale = 1.0f;
+Entity spawnPlayer(int gridX, int gridZ, int index = 0) {
+    Entity e = createEntity();
+    glm::vec3 pos = getWorldPos(gridX, gridZ);
+    Transform t;
+    t.x = pos.x;
+    t.z = pos.z;
+    addComponent(g_world.transforms, e, t);
+    addComponent(g_world.cells, e, GridCell{ gridX, gridZ });
+    Render r;
+    r.kind = RenderKind::PACMAN;
+    r.color = PLAYER_COLORS[index];
+    addComponent(g_world.renders, e, r);
+    g_world.players[index] = e;
+    g_world.playerCount = std::max(g_world.playerCount, index + 1);
+    return e;
+}
 
-    if (g_currentStage == 2) {
-        stageGridWidth = 25;
-        stageGridHeight = 25;
-        loopProbability = 0.5f;
-        ghostCount = 7;
+Entity spawnGhost(int gridX, int gridZ, int dirX, int dirZ,
+    GhostPersonality personality = GhostPersonality::CHASER, uint8_t corner = 0) {
+    Entity e = createEntity();
+    glm::vec3 pos = getWorldPos(gridX, gridZ);
+    Transform t;
+    t.x = pos.x;
+    t.z = pos.z;
+    addComponent(g_world.transforms, e, t);
+    addComponent(g_world.cells, e, GridCell{ gridX, gridZ });
+    Movement m;
+    m.speed = GHOST_MOVE_SPEED;
+    m.dirX = dirX;
+    m.dirZ = dirZ;
+    addComponent(g_world.movements, e, m);
+    addComponent(g_world.brains, e, GhostBrain{ personality, corner });
+    Render r;
+    r.kind = RenderKind::GHOST;
+    r.color = GHOST_COLORS[static_cast<int>(personality)];
+    addComponent(g_world.renders, e, r);
+    return e;
+}
+
+Entity spawnCollectible(int gridX, int gridZ, CollectibleKind kind) {
+    Entity e = createEntity();
+    glm::vec3 pos = getWorldPos(gridX, gridZ);
+    Transform t;
+    t.x = pos.x;
+    t.z = pos.z;
+    addComponent(g_world.transforms, e, t);
+    addComponent(g_world.cells, e, GridCell{ gridX, gridZ });
+    Render r;
+    Collectible c;
+    c.kind = kind;
+    if (kind == CollectibleKind::PELLET) {
+        r.kind = RenderKind::PELLET;
+        r.color = glm::vec3(1.0f, 0.9f, 0.2f);
+        c.score = 10;
+    }
+    else if (kind == CollectibleKind::POWER_PELLET) {
+        r.kind = RenderKind::POWER_PELLET;
+        r.color = glm::vec3(1.0f, 0.95f, 0.6f);
+        c.score = 50;
+    }
+    else {
+        r.kind = RenderKind::SLOW_ITEM;
+        r.color = glm::vec3(0.2f, 0.8f, 1.0f);
     }
+    addComponent(g_world.renders, e, r);
+    addComponent(g_world.collectibles, e, c);
+    g_world.collectibleAt[gridZ * g_gridWidth + gridX] = e;
+    return e;
+}
 
-    g_gridWidth = stageGridWidth;
-    g_gridHeight = stageGridHeight;
+Entity collectibleAt(int x, int z) {
+    if (x < 0 || x >= g_gridWidth || z < 0 || z >= g_gridHeight) return INVALID_ENTITY;
+    return g_world.collectibleAt[z * g_gridWidth + x];
+}
 
-    g_cameraPos = glm::vec3(0.0f, 10.0f, 15.0f);
-    g_cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
-    g_cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
-    g_playerAngleY = 0.0f;
+void removeCollectibleAt(int x, int z) {
+    Entity e = collectibleAt(x, z);
+    if (e == INVALID_ENTITY) return;
+    g_world.collectibleAt[z * g_gridWidth + x] = INVALID_ENTITY;
+    g_itemChanges.push_back(ItemChange{ z * g_gridWidth + x, 0 });
+    destroyEntity(e);
+}
 
-    for (int i = 0; i < 256; i++) g_keyStates[i] = false;
-    for (int i = 0; i < 128; i++) g_specialKeyStates[i] = false;
+// ---- 가장 가까운 길 칸 표 ----
+// 칸마다 가장 가까운 PATH 칸(4방향 걸음 수 기준)을 미리 구해 둔다. 모든 길 칸에서 동시에 시작하는 BFS라
+// 스테이지마다 O(W*H) 한 번이고, 그 뒤 유령 배치 / 벽에 낀 유령 복구는 표를 한 번 읽으면 끝난다.
 
-    initCubes();
+struct NearestPathMap {
+    int mazeVersion = -1;
+    int width = 0;
+    std::vector<int> nearest;        // 칸 -> 가장 가까운 길 칸 인덱스 (-1 = 미로에 길이 없음)
+    std::vector<int> dist;           // 그 칸까지 걸음 수
+    std::vector<int> queue;          // BFS 작업 버퍼 (재사용)
+};
+
+thread_local NearestPathMap g_nearestPath;
+
+void nearestPathExpand(NearestPathMap& m) {
+    for (size_t head = 0; head < m.queue.size(); ++head) {
+        int idx = m.queue[head];
+        int x = idx % g_gridWidth;
+        int z = idx / g_gridWidth;
+        const int dirX[4] = { 1, -1, 0, 0 };
+        const int dirZ[4] = { 0, 0, 1, -1 };
+        for (int i = 0; i < 4; ++i) {
+            int nx = x + dirX[i];
+            int nz = z + dirZ[i];
+            if (nx < 0 || nx >= g_gridWidth || nz < 0 || nz >= g_gridHeight) continue;
+            int nIdx = nz * g_gridWidth + nx;
+            if (m.dist[nIdx] <= m.dist[idx] + 1) continue;
+            m.dist[nIdx] = m.dist[idx] + 1;
+            m.nearest[nIdx] = m.nearest[idx];
+            m.queue.push_back(nIdx);
+        }
+    }
+}
+
+const NearestPathMap& nearestPathMap() {
+    NearestPathMap& m = g_nearestPath;
+    if (m.mazeVersion == g_mazeVersion && m.width == g_gridWidth && m.nearest.size() == static_cast<size_t>(g_gridWidth * g_gridHeight)) {
+        return m;
+    }
+    const int cellCount = g_gridWidth * g_gridHeight;
+    m.width = g_gridWidth;
+    m.nearest.assign(cellCount, -1);
+    m.dist.assign(cellCount, std::numeric_limits<int>::max());
+    m.queue.clear();
+    for (int z = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x) {
+            if (g_maze[z][x] != PATH) continue;
+            int idx = z * g_gridWidth + x;
+            m.nearest[idx] = idx;
+            m.dist[idx] = 0;
+            m.queue.push_back(idx);
+        }
+    }
+    nearestPathExpand(m);
+    m.mazeVersion = g_mazeVersion;
+    return m;
+}
+
+// 격자 밖 좌표는 가장자리 칸으로 당겨서 찾는다. 길이 하나도 없으면 입구 칸
+glm::ivec2 nearestPathCell(int gridX, int gridZ) {
+    const NearestPathMap& m = nearestPathMap();
+    int x = std::max(0, std::min(gridX, g_gridWidth - 1));
+    int z = std::max(0, std::min(gridZ, g_gridHeight - 1));
+    int idx = m.nearest[z * g_gridWidth + x];
+    if (idx < 0) return glm::ivec2(g_mazeStartX, 0);
+    return glm::ivec2(idx % g_gridWidth, idx / g_gridWidth);
+}
 
+// ---- 스테이지 미로 / 미로 팩 ----
+// 미로 팩: --build-maze-pack으로 미리 만들고 검사한 미로 묶음. 게임은 파일을 메모리 매핑하고
+// 스테이지마다 항목 하나를 바로 고른다 (파싱/복사 없음). 정수는 리틀 엔디언 그대로 쓴다.
+//   [MazePackHeader][MazePackStage x stageCount][MazePackEntry x entryCount][데이터...]
+//   데이터: 벽 비트(행 우선, 바이트 안은 LSB부터) + 유령 시작 칸 (u16 x, u16 z) x ghostCount
+
+struct StageParams {
+    int width;
+    int height;
+    float loopProbability;
+    int ghostCount;
+};
+
+StageParams stageParams(int stage) {
+    if (stage == 2) return StageParams{ 25, 25, 0.5f, 7 };
+    return StageParams{ 11, 11, 0.35f, 3 };
+}
+
+// 현재 스레드의 미로를 새로 만든다 (벽으로 채우고 입구/출구를 뚫은 뒤 고리 추가)
+void generateStageMaze(const StageParams& params) {
+    g_gridWidth = params.width;
+    g_gridHeight = params.height;
     g_maze.assign(g_gridHeight, std::vector<CellType>(g_gridWidth, WALL));
-    g_slowItems.assign(g_gridHeight, std::vector<bool>(g_gridWidth, false));
-    g_totalPellets = 0;
-    g_remainingPellets = 0;
+    g_mazeVersion++;
     int range = (g_gridWidth - 3) / 2;
     if (range < 0) range = 0;
     std::uniform_int_distribution<int> xDist(0, range);
@@ -277,72 +1417,343 @@ void reset() {
     g_maze[1][g_mazeStartX] = PATH;
     g_maze[g_gridHeight - 1][g_mazeEndX] = PATH;
 
-    addMazeLoops(loopProbability);
-
-    glm::vec3 playerStartPos = getWorldPos(g_mazeStartX, 0);
-    g_playerPosX = playerStartPos.x;
-    g_playerPosZ = playerStartPos.z;
+    addMazeLoops(params.loopProbability);
+}
 
-    g_ghosts.clear();
+// 무작위 칸에서 가장 가까운 길 칸을 유령 시작 칸으로 고른다
+void pickGhostSpawns(int count, std::vector<glm::ivec2>& spawns) {
+    std::uniform_int_distribution<int> ghostXDist(1, g_gridWidth - 2);
+    std::uniform_int_distribution<int> ghostZDist(1, g_gridHeight - 2);
+    spawns.clear();
+    for (int i = 0; i < count; ++i) {
+        int x = ghostXDist(g_randomEngine);
+        int z = ghostZDist(g_randomEngine);
+        spawns.push_back(nearestPathCell(x, z));
+    }
+}
 
-    auto findNearestPath = [&](int gridX, int gridZ) {
-        int maxRadius = 3;
-        for (int radius = 0; radius <= maxRadius; ++radius) {
-            for (int dz = -radius; dz <= radius; ++dz) {
-                for (int dx = -radius; dx <= radius; ++dx) {
-                    int nx = gridX + dx;
-                    int nz = gridZ + dz;
-                    if (nx < 0 || nx >= g_gridWidth || nz < 0 || nz >= g_gridHeight) continue;
-                    if (g_maze[nz][nx] == PATH) {
-                        return glm::ivec2(nx, nz);
-                    }
-                }
-            }
+// 1P는 entrance 칸(칸 인덱스), 나머지는 거기서 BFS 순서로 두 칸씩 건너뛴 길 칸 (겹쳐 서지 않게)
+void pickPlayerSpawns(int count, std::vector<glm::ivec2>& spawns, int entrance) {
+    std::vector<int> order(1, entrance);
+    std::vector<uint8_t> seen(g_gridWidth * g_gridHeight, 0);
+    seen[entrance] = 1;
+    const int dirX[4] = { 1, -1, 0, 0 };
+    const int dirZ[4] = { 0, 0, 1, -1 };
+    for (size_t head = 0; head < order.size() && static_cast<int>(order.size()) < count * 2; ++head) {
+        int x = order[head] % g_gridWidth;
+        int z = order[head] / g_gridWidth;
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + dirX[d];
+            int nz = z + dirZ[d];
+            if (!isPathCell(nx, nz) || seen[nz * g_gridWidth + nx]) continue;
+            seen[nz * g_gridWidth + nx] = 1;
+            order.push_back(nz * g_gridWidth + nx);
         }
+    }
+    spawns.clear();
+    for (int i = 0; i < count; ++i) {
+        int cell = order[std::min(static_cast<size_t>(i * 2), order.size() - 1)];
+        spawns.push_back(glm::ivec2(cell % g_gridWidth, cell / g_gridWidth));
+    }
+}
 
-        return glm::ivec2(g_mazeStartX, 0);
-    };
+const char MAZE_PACK_MAGIC[4] = { 'P', 'M', 'P', 'K' };
+const uint32_t MAZE_PACK_VERSION = 1;
+
+struct MazePackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t stageCount;      // 스테이지 1부터 stageCount까지의 표가 뒤따름
+};
+
+struct MazePackStage {
+    uint32_t first;           // 이 스테이지 항목의 시작 인덱스
+    uint32_t count;
+};
+
+struct MazePackEntry {
+    uint32_t seed;            // 같은 시드로 generateStageMaze + pickGhostSpawns를 돌리면 같은 미로
+    uint16_t stage;
+    uint16_t width;
+    uint16_t height;
+    uint16_t startX;
+    uint16_t endX;
+    uint16_t ghostCount;
+    uint32_t dataOffset;      // 파일 처음부터의 위치
+    float loopDensity;
+};
+static_assert(sizeof(MazePackHeader) == 16 && sizeof(MazePackStage) == 8 && sizeof(MazePackEntry) == 24,
+    "maze pack records are written as raw structs");
+
+inline size_t mazePackWallBytes(int width, int height) {
+    return (static_cast<size_t>(width) * height + 7) / 8;
+}
+
+inline size_t mazePackDataSize(int width, int height, int ghostCount) {
+    return mazePackWallBytes(width, height) + static_cast<size_t>(ghostCount) * 4;
+}
+
+// 모든 스레드가 같이 읽는다. 메인에서 스레드를 띄우기 전에 열고 이후에는 바꾸지 않는다
+struct MazePack {
+    MappedFile file;
+    const MazePackStage* stages = nullptr;
+    const MazePackEntry* entries = nullptr;
+    uint32_t stageCount = 0;
+    uint32_t entryCount = 0;
+};
+
+MazePack g_mazePack;
+
+// 헤더와 항목 범위를 한 번만 검사해 두고, 고를 때는 인덱스만 계산한다
+bool openMazePack(MazePack& pack, const std::string& path) {
+    pack = MazePack();
+    MappedFile& file = pack.file;
+    if (!mapFile(file, path)) {
+        std::cerr << "maze pack: cannot map " << path << std::endl;
+        return false;
+    }
+    MazePackHeader header;
+    bool valid = file.size >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, file.data, sizeof(header));
+        valid = std::memcmp(header.magic, MAZE_PACK_MAGIC, 4) == 0 && header.version == MAZE_PACK_VERSION
+            && header.stageCount <= MAX_STAGE
+            && file.size >= sizeof(header) + header.stageCount * sizeof(MazePackStage) + static_cast<size_t>(header.entryCount) * sizeof(MazePackEntry);
+    }
+    if (valid) {
+        pack.stageCount = header.stageCount;
+        pack.entryCount = header.entryCount;
+        pack.stages = reinterpret_cast<const MazePackStage*>(file.data + sizeof(header));
+        pack.entries = reinterpret_cast<const MazePackEntry*>(file.data + sizeof(header) + header.stageCount * sizeof(MazePackStage));
+        for (uint32_t s = 0; valid && s < pack.stageCount; ++s) {
+            valid = pack.stages[s].first <= pack.entryCount && pack.stages[s].count <= pack.entryCount - pack.stages[s].first;
+        }
+        for (uint32_t i = 0; valid && i < pack.entryCount; ++i) {
+            const MazePackEntry& e = pack.entries[i];
+            valid = e.width >= 3 && e.height >= 3 && e.width <= 255 && e.height <= 255
+                && e.startX < e.width && e.endX < e.width
+                && e.dataOffset <= file.size && mazePackDataSize(e.width, e.height, e.ghostCount) <= file.size - e.dataOffset;
+        }
+    }
+    if (!valid) {
+        std::cerr << "maze pack: " << path << " is not a valid maze pack" << std::endl;
+        unmapFile(file);
+        pack = MazePack();
+        return false;
+    }
+    std::cout << "[maze-pack] " << path << ": " << pack.entryCount << " mazes";
+    for (uint32_t s = 0; s < pack.stageCount; ++s) std::cout << (s ? ", " : " (") << "stage " << (s + 1) << ": " << pack.stages[s].count;
+    std::cout << (pack.stageCount ? ")" : "") << std::endl;
+    return true;
+}
+
+// 팩이 없거나 이 스테이지 항목이 없으면 nullptr (그때는 실시간으로 생성)
+const MazePackEntry* pickPackedMaze(int stage) {
+    const MazePack& pack = g_mazePack;
+    if (!pack.entries || stage < 1 || static_cast<uint32_t>(stage) > pack.stageCount) return nullptr;
+    const MazePackStage& range = pack.stages[stage - 1];
+    if (range.count == 0) return nullptr;
+    std::uniform_int_distribution<uint32_t> pick(0, range.count - 1);
+    return &pack.entries[range.first + pick(g_randomEngine)];
+}
+
+void loadPackedMaze(const MazePackEntry& entry, std::vector<glm::ivec2>& spawns) {
+    const uint8_t* data = g_mazePack.file.data + entry.dataOffset;
+    g_gridWidth = entry.width;
+    g_gridHeight = entry.height;
+    g_maze.assign(g_gridHeight, std::vector<CellType>(g_gridWidth, WALL));
+    g_mazeVersion++;
+    for (int z = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x) {
+            int bit = z * g_gridWidth + x;
+            g_maze[z][x] = ((data[bit >> 3] >> (bit & 7)) & 1) ? WALL : PATH;
+        }
+    }
+    g_mazeStartX = entry.startX;
+    g_mazeEndX = entry.endX;
+
+    const uint8_t* ghostData = data + mazePackWallBytes(entry.width, entry.height);
+    spawns.clear();
+    for (int i = 0; i < entry.ghostCount; ++i) {
+        uint16_t xz[2];
+        std::memcpy(xz, ghostData + i * 4, sizeof(xz));
+        spawns.push_back(glm::ivec2(xz[0], xz[1]));
+    }
+}
+
+// ---- 탐험 스테이지 (--explore FILE) ----
+// 타일 월드 하나를 통째로 도는 스테이지. 유령 없이 펠릿을 EXPLORE_PELLET_GOAL개 먹으면 클리어.
+// 충돌과 펠릿 먹기는 isPathCell / collectItemsAt이 타일 월드에 바로 묻는다. 렌더 / 렌더 스냅샷 / 봇은 지금처럼
+// g_maze와 아이템 엔티티를 읽으므로, 1P 둘레 EXPLORE_WINDOW칸 창만 거기에 펼쳐 둔다. 1P가 창 가운데에서
+// 벗어나면 창을 옮기고 액터 좌표를 반대로 밀어서(떠다니는 원점) 맵이 커도 float 좌표는 창 크기 안에 머문다.
+
+const int EXPLORE_WINDOW = 65;             // 창 한 변 칸 수 (홀수: 1P가 가운데 칸)
+const int EXPLORE_RECENTER = 12;           // 1P가 창 가운데에서 이 칸 수보다 멀어지면 창을 옮긴다
+const int EXPLORE_CACHE_TILES = 64;        // 풀린 타일 1KB씩
+const int EXPLORE_PREFETCH_RADIUS = 1;     // 1P 타일 둘레 몇 타일까지 미리 올릴지 (창 반폭 32칸 < 타일 64칸)
+const int EXPLORE_PELLET_GOAL = 300;
+
+// 창 안의 칸을 타일 월드에서 g_maze / 아이템 엔티티로 다시 펼친다. 플레이어 엔티티는 그대로 둔다
+void loadExploreWindow() {
+    std::vector<Entity> items = g_world.collectibles.owner;
+    for (Entity e : items) destroyEntity(e);
+    g_world.collectibleAt.assign(g_gridWidth * g_gridHeight, INVALID_ENTITY);
+    g_itemChanges.clear();   // 창이 바뀌면 렌더 쪽은 어차피 전체를 다시 받는다
+    for (int z = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x) {
+            int code = exploreCell(x, z);
+            g_maze[z][x] = (code == TILE_WALL) ? WALL : PATH;
+            if (code == TILE_PELLET) spawnCollectible(x, z, CollectibleKind::PELLET);
+            else if (code == TILE_POWER_PELLET) spawnCollectible(x, z, CollectibleKind::POWER_PELLET);
+        }
+    }
+    g_mazeVersion++;
+}
+
+// 타일 월드를 다시 열고(먹은 칸 오버레이를 비움) 시작 칸이 가운데인 창을 펼친다. 못 열면 false
+bool resetExploreStage() {
+    closeTiledWorld(g_exploreWorld);
+    if (!openTiledWorld(g_exploreWorld, g_exploreWorldPath, EXPLORE_CACHE_TILES)) return false;
+    const TiledWorldHeader& h = g_exploreWorld.header;
+    g_exploreActive = true;
+    g_gridWidth = EXPLORE_WINDOW;
+    g_gridHeight = EXPLORE_WINDOW;
+    g_exploreOriginX = static_cast<int>(h.startX) - EXPLORE_WINDOW / 2;
+    g_exploreOriginZ = static_cast<int>(h.startZ) - EXPLORE_WINDOW / 2;
+    g_mazeStartX = EXPLORE_WINDOW / 2;
+    g_mazeEndX = EXPLORE_WINDOW / 2;
+    tiledPrefetch(g_exploreWorld, h.startX, h.startZ, EXPLORE_PREFETCH_RADIUS);
+
+    initCubes();
+    clearWorld();
+    loadExploreWindow();
+    g_totalPellets = EXPLORE_PELLET_GOAL;
+    g_remainingPellets = EXPLORE_PELLET_GOAL;
+
+    std::vector<glm::ivec2> playerSpawns;
+    pickPlayerSpawns(g_playerCount, playerSpawns, (EXPLORE_WINDOW / 2) * g_gridWidth + EXPLORE_WINDOW / 2);
+    for (int p = 0; p < g_playerCount; ++p) spawnPlayer(playerSpawns[p].x, playerSpawns[p].y, p);
+    return true;
+}
+
+// 스텝마다: 1P 칸에서 타일을 미리 올리고, 1P가 가운데에서 멀어졌으면 1P 칸이 가운데 오게 창을 옮긴다.
+// 창 밖으로 밀려난 다른 플레이어는 1P 칸으로 데려온다
+void updateExploreWindow() {
+    Transform& lead = playerTransform(0);
+    glm::ivec2 cell = getGridCoord(lead.x, lead.z);
+    tiledPrefetch(g_exploreWorld, g_exploreOriginX + cell.x, g_exploreOriginZ + cell.y, EXPLORE_PREFETCH_RADIUS);
+    int dx = cell.x - EXPLORE_WINDOW / 2;
+    int dz = cell.y - EXPLORE_WINDOW / 2;
+    if (std::abs(dx) <= EXPLORE_RECENTER && std::abs(dz) <= EXPLORE_RECENTER) return;
+
+    g_exploreOriginX += dx;
+    g_exploreOriginZ += dz;
+    float unitSize = CUBE_SIZE + GRID_SPACING;
+    for (int p = 0; p < g_world.playerCount; ++p) {
+        Transform& t = playerTransform(p);
+        t.x -= dx * unitSize;
+        t.z -= dz * unitSize;
+        glm::ivec2 moved = getGridCoord(t.x, t.z);
+        if (!isPathCell(moved.x, moved.y)) {
+            t.x = lead.x;
+            t.z = lead.z;
+            moved = getGridCoord(t.x, t.z);
+        }
+        getComponent(g_world.cells, g_world.players[p]) = GridCell{ moved.x, moved.y };
+    }
+    loadExploreWindow();
+}
+
+void reset() {
+    StageParams params = stageParams(g_currentStage);
+
+    countMetric(MC_RESETS);
+    g_ghostSlowActive = false;
+    g_ghostSlowTimer = 0.0f;
+    g_ghostSpeedScale = 1.0f;
+    g_ghostPhaseIndex = 0;
+    g_ghostPhaseTimer = 0.0f;
+    g_frightenedTimer = 0.0f;
+    g_ghostEatCombo = 0;
+
+    g_gridWidth = params.width;
+    g_gridHeight = params.height;
+
+    g_cameraPos = glm::vec3(0.0f, 10.0f, 15.0f);
+    g_cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
+    g_cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
-    auto addGhostAt = [&](int gridX, int gridZ, int dirX, int dirZ) {
-        glm::ivec2 pathCell = findNearestPath(gridX, gridZ);
-        glm::vec3 worldPos = getWorldPos(pathCell.x, pathCell.y);
-        Ghost ghost;
-        ghost.x = worldPos.x;
-        ghost.z = worldPos.z;
-        ghost.angleY = 0.0f;
-        ghost.speed = GHOST_MOVE_SPEED;
-        ghost.dirX = dirX;
-        ghost.dirZ = dirZ;
-        g_ghosts.push_back(ghost);
+    for (int i = 0; i < 256; i++) g_keyStates[i] = g_keyTapped[i] = false;
+    for (int i = 0; i < 128; i++) g_specialKeyStates[i] = g_specialKeyTapped[i] = false;
+
+    if (!g_seedLocked) {
+        g_randomEngine.seed(static_cast<unsigned int>(std::time(0)));
+    }
+
+    if (g_currentStage == EXPLORE_STAGE && resetExploreStage()) return;
+    closeTiledWorld(g_exploreWorld);
+    g_exploreActive = false;
+
+    // 미로 팩이 있으면 검사를 마친 미로 하나를 고르고, 없으면 지금 만든다
+    std::vector<glm::ivec2> ghostSpawns;
+    if (const MazePackEntry* packed = pickPackedMaze(g_currentStage)) {
+        g_gridWidth = packed->width;
+        g_gridHeight = packed->height;
+        initCubes();
+        loadPackedMaze(*packed, ghostSpawns);
+    }
+    else {
+        initCubes();
+        generateStageMaze(params);
+        pickGhostSpawns(params.ghostCount, ghostSpawns);
+    }
+
+    clearWorld();
+    g_world.collectibleAt.assign(g_gridWidth * g_gridHeight, INVALID_ENTITY);
+    g_totalPellets = 0;
+    g_remainingPellets = 0;
+
+    std::vector<glm::ivec2> playerSpawns;
+    pickPlayerSpawns(g_playerCount, playerSpawns, g_mazeStartX);
+    for (int p = 0; p < g_playerCount; ++p) spawnPlayer(playerSpawns[p].x, playerSpawns[p].y, p);
+
+    auto addGhostAt = [&](int gridX, int gridZ, int dirX, int dirZ, int index) {
+        glm::ivec2 pathCell = nearestPathCell(gridX, gridZ);
+        GhostPersonality personality = static_cast<GhostPersonality>(index % static_cast<int>(GhostPersonality::COUNT));
+        spawnGhost(pathCell.x, pathCell.y, dirX, dirZ, personality, static_cast<uint8_t>(index % 4));
     };
 
-    std::uniform_int_distribution<int> ghostXDist(1, g_gridWidth - 2);
-    std::uniform_int_distribution<int> ghostZDist(1, g_gridHeight - 2);
     const int dirChoices[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
 
-    for (int i = 0; i < ghostCount; ++i) {
+    for (int i = 0; i < static_cast<int>(ghostSpawns.size()); ++i) {
         int dirIndex = i % 4;
         int dirX = dirChoices[dirIndex][0];
         int dirZ = dirChoices[dirIndex][1];
-        addGhostAt(ghostXDist(g_randomEngine), ghostZDist(g_randomEngine), dirX, dirZ);
+        addGhostAt(ghostSpawns[i].x, ghostSpawns[i].y, dirX, dirZ, i);
     }
 
     for (int i = 0; i < g_gridHeight; ++i) {
         for (int j = 0; j < g_gridWidth; ++j) {
-            if (g_maze[i][j] == WALL) {
-                g_cubeCurrentScale[i][j] = WALL_SCALE;
-                g_pellets[i][j] = false;
-            }
-            else {
-                g_cubeCurrentScale[i][j] = FLOOR_SCALE;
-                g_pellets[i][j] = true;
+            if (g_maze[i][j] != WALL) {
+                spawnCollectible(j, i, CollectibleKind::PELLET);
                 g_totalPellets++;
                 g_remainingPellets++;
             }
-            g_cubeCurrentHeight[i][j] = (g_cubeCurrentScale[i][j] * CUBE_SIZE) / 2.0f;
         }
     }
 
+    // 파워 펠릿: 네 구석에서 가장 가까운 길 칸. 일반 펠릿 자리를 바꾸므로 남은 펠릿 수는 그대로
+    for (int corner = 0; corner < 4; ++corner) {
+        glm::ivec2 cell = nearestPathCell((corner & 1) ? g_gridWidth - 2 : 1, (corner & 2) ? g_gridHeight - 2 : 1);
+        int x = cell.x;
+        int z = cell.y;
+        if (collectibleAt(x, z) == INVALID_ENTITY
+            || getComponent(g_world.collectibles, collectibleAt(x, z)).kind != CollectibleKind::PELLET) continue;
+        removeCollectibleAt(x, z);
+        spawnCollectible(x, z, CollectibleKind::POWER_PELLET);
+    }
+
     if (g_currentStage == 2) {
         std::vector<std::pair<int, int>> pathCells;
         for (int i = 0; i < g_gridHeight; ++i) {
@@ -361,12 +1772,15 @@ void reset() {
             for (int idx = 0; idx < slowItemCount; ++idx) {
                 int x = pathCells[idx].first;
                 int y = pathCells[idx].second;
-                g_slowItems[y][x] = true;
-                if (g_pellets[y][x]) {
-                    g_pellets[y][x] = false;
+                Entity existing = collectibleAt(x, y);
+                if (existing != INVALID_ENTITY
+                    && getComponent(g_world.collectibles, existing).kind == CollectibleKind::POWER_PELLET) continue;
+                if (existing != INVALID_ENTITY) {
+                    removeCollectibleAt(x, y);
                     g_totalPellets--;
                     g_remainingPellets--;
                 }
+                spawnCollectible(x, y, CollectibleKind::SLOW_ITEM);
             }
         }
     }
@@ -397,13 +1811,266 @@ void goToGameClear() {
     }
 }
 
-void initSphereMesh(int sectorCount, int stackCount) {
+// ---- 메쉬 정점 형식 ----
+// 기본 메쉬(큐브, 구, 원기둥, 팩맨)는 모두 정점이 몇백 개뿐이라 float 위치 / 법선과 32비트 인덱스는 대역폭 낭비다.
+// 만들 때는 MeshData(float)로 만들고, GPU에는 정점당 12바이트로 올린다:
+//   위치 + 턱 가중치: int16 x 4 정규화. 메쉬 좌표는 모두 [-1, 1] 안이라 배율이 필요 없고 셰이더에는 vec3 / float로 읽힌다
+//   법선: 팔면체(octahedral) 인코딩 int16 x 2 정규화. vertex.glsl이 푼다
+// 인덱스는 16비트. 올리기 전에 정점 캐시에 맞게 삼각형 순서를 다시 잡고(Forsyth), 정점도 처음 쓰이는 순서로 옮긴다.
+
+typedef GLushort MeshIndex;
+const GLenum MESH_INDEX_TYPE = GL_UNSIGNED_SHORT;
+const int MESH_VCACHE_SIZE = 32;       // 순서 최적화가 가정하는 정점 캐시 크기
+
+struct MeshData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<float> jaws;           // 비어 있으면 전부 0 (팩맨만 씀)
+    std::vector<GLuint> indices;
+    std::vector<size_t> sections;      // 순서를 바꿔도 서로 섞이면 안 되는 인덱스 구간의 시작 (큐브 윗면 / 옆면)
+};
+
+struct PackedVertex {
+    int16_t position[4];               // xyz + 턱 가중치
+    int16_t normal[2];                 // 팔면체 인코딩
+};
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex is uploaded as a raw array");
+
+inline int16_t packSnorm16(float value) {
+    return static_cast<int16_t>(std::lround(std::max(-1.0f, std::min(value, 1.0f)) * 32767.0f));
+}
+
+// 단위 벡터를 팔면체 위에 펴서 xy 두 값으로. 아래 반구(z < 0)는 네 귀퉁이로 접는다
+void octEncode(const glm::vec3& n, float& u, float& v) {
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    u = n.x / l1;
+    v = n.y / l1;
+    if (n.z < 0.0f) {
+        float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = foldedU;
+        v = foldedV;
+    }
+}
+
+// Forsyth 점수: 캐시 앞쪽 정점일수록, 남은 삼각형이 적은 정점일수록 높다
+float vertexCacheScore(int cachePosition, int remainingTriangles) {
+    if (remainingTriangles == 0) return -1.0f;
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // 방금 쓴 삼각형의 세 정점은 일부러 조금 낮춰 같은 부채꼴만 계속 물지 않게 한다
+        if (cachePosition < 3) score = 0.75f;
+        else score = std::pow(1.0f - (cachePosition - 3) / static_cast<float>(MESH_VCACHE_SIZE - 3), 1.5f);
+    }
+    return score + 2.0f * std::pow(static_cast<float>(remainingTriangles), -0.5f);
+}
+
+// indices[first, first + count)의 삼각형 순서를 정점 캐시 적중이 많도록 다시 잡는다
+void optimizeVertexCache(std::vector<GLuint>& indices, size_t first, size_t count, size_t vertexCount) {
+    const size_t triangleCount = count / 3;
+    if (triangleCount < 2) return;
+    const GLuint* tri = &indices[first];
+
+    // 정점마다 붙은 삼각형 목록 (CSR)
+    std::vector<int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) remaining[tri[i]]++;
+    std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+    std::vector<int> adjacency(triangleCount * 3);
+    std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) adjacency[fill[tri[t * 3 + k]]++] = static_cast<int>(t);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = vertexCacheScore(-1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[tri[t * 3]] + vertexScore[tri[t * 3 + 1]] + vertexScore[tri[t * 3 + 2]];
+    }
+
+    std::vector<GLuint> output;
+    output.reserve(triangleCount * 3);
+    std::vector<int> cache;                     // 앞이 가장 최근
+    std::vector<int> nextCache;
+    size_t scanStart = 0;
+    int best = -1;
+    while (output.size() < triangleCount * 3) {
+        if (best < 0) {
+            // 캐시 주변에 후보가 없으면 남은 것 중 점수가 가장 높은 삼각형
+            float bestScore = -1.0f;
+            while (scanStart < triangleCount && emitted[scanStart]) ++scanStart;
+            for (size_t t = scanStart; t < triangleCount; ++t) {
+                if (!emitted[t] && triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = static_cast<int>(t);
+                }
+            }
+        }
+        emitted[best] = 1;
+        nextCache.clear();
+        for (int k = 0; k < 3; ++k) {
+            int v = static_cast<int>(tri[best * 3 + k]);
+            output.push_back(static_cast<GLuint>(v));
+            nextCache.push_back(v);
+            remaining[v]--;
+            // 내보낸 삼각형은 인접 목록 뒤로 보내 남은 것만 앞에 둔다
+            size_t begin = adjacencyStart[v];
+            size_t end = begin + remaining[v] + 1;
+            for (size_t a = begin; a < end; ++a) {
+                if (adjacency[a] == best) {
+                    std::swap(adjacency[a], adjacency[end - 1]);
+                    break;
+                }
+            }
+        }
+        for (int v : cache) {
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) nextCache.push_back(v);
+        }
+        // 캐시에서 밀려난 정점은 점수만 다시 (캐시 밖)
+        for (size_t i = MESH_VCACHE_SIZE; i < nextCache.size(); ++i) {
+            cachePosition[nextCache[i]] = -1;
+            vertexScore[nextCache[i]] = vertexCacheScore(-1, remaining[nextCache[i]]);
+        }
+        if (nextCache.size() > static_cast<size_t>(MESH_VCACHE_SIZE)) nextCache.resize(MESH_VCACHE_SIZE);
+        cache.swap(nextCache);
+
+        for (size_t i = 0; i < cache.size(); ++i) {
+            cachePosition[cache[i]] = static_cast<int>(i);
+            vertexScore[cache[i]] = vertexCacheScore(static_cast<int>(i), remaining[cache[i]]);
+        }
+        best = -1;
+        float bestScore = -1.0f;
+        for (int v : cache) {
+            for (size_t a = adjacencyStart[v]; a < adjacencyStart[v] + remaining[v]; ++a) {
+                int t = adjacency[a];
+                triangleScore[t] = vertexScore[tri[t * 3]] + vertexScore[tri[t * 3 + 1]] + vertexScore[tri[t * 3 + 2]];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+    std::copy(output.begin(), output.end(), indices.begin() + first);
+}
+
+// 정점을 인덱스에서 처음 쓰이는 순서로 옮긴다 (정점 가져오기가 버퍼를 앞에서부터 읽게)
+void reorderVerticesForFetch(MeshData& mesh) {
+    const size_t vertexCount = mesh.positions.size();
+    std::vector<GLuint> remap(vertexCount, UINT32_MAX);
+    GLuint next = 0;
+    for (GLuint& index : mesh.indices) {
+        if (remap[index] == UINT32_MAX) remap[index] = next++;
+        index = remap[index];
+    }
+    MeshData sorted;
+    sorted.positions.resize(next);
+    sorted.normals.resize(next);
+    if (!mesh.jaws.empty()) sorted.jaws.resize(next);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (remap[v] == UINT32_MAX) continue;   // 쓰이지 않는 정점은 버림
+        sorted.positions[remap[v]] = mesh.positions[v];
+        sorted.normals[remap[v]] = mesh.normals[v];
+        if (!mesh.jaws.empty()) sorted.jaws[remap[v]] = mesh.jaws[v];
+    }
+    mesh.positions.swap(sorted.positions);
+    mesh.normals.swap(sorted.normals);
+    mesh.jaws.swap(sorted.jaws);
+}
+
+void optimizeMesh(MeshData& mesh) {
+    std::vector<size_t> bounds = mesh.sections;
+    if (bounds.empty() || bounds.front() != 0) bounds.insert(bounds.begin(), 0);
+    bounds.push_back(mesh.indices.size());
+    for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+        optimizeVertexCache(mesh.indices, bounds[i], bounds[i + 1] - bounds[i], mesh.positions.size());
+    }
+    reorderVerticesForFetch(mesh);
+}
+
+// FIFO 정점 캐시에서 삼각형당 정점 셰이더 실행 수 (ACMR, 0.5 ~ 3)
+float meshCacheMissRatio(const std::vector<GLuint>& indices, int cacheSize) {
+    std::deque<GLuint> cache;
+    size_t misses = 0;
+    for (GLuint index : indices) {
+        if (std::find(cache.begin(), cache.end(), index) != cache.end()) continue;
+        misses++;
+        cache.push_back(index);
+        if (cache.size() > static_cast<size_t>(cacheSize)) cache.pop_front();
+    }
+    return indices.empty() ? 0.0f : misses / (indices.size() / 3.0f);
+}
+
+// 압축 형식으로 올리고 인덱스 수를 돌려준다. 속성: 0 위치, 1 턱 가중치, 2 팔면체 법선
+GLsizei uploadMesh(const MeshData& mesh, GLuint& vao, GLuint& vbo, GLuint& ebo) {
+    if (mesh.positions.size() > 0xFFFF) {
+        std::cerr << "mesh has " << mesh.positions.size() << " vertices, more than 16-bit indices can address" << std::endl;
+        return 0;
+    }
+    std::vector<PackedVertex> vertices(mesh.positions.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        const glm::vec3& p = mesh.positions[v];
+        float u, w;
+        octEncode(mesh.normals[v], u, w);
+        vertices[v] = { { packSnorm16(p.x), packSnorm16(p.y), packSnorm16(p.z), packSnorm16(mesh.jaws.empty() ? 0.0f : mesh.jaws[v]) },
+            { packSnorm16(u), packSnorm16(w) } };
+    }
+    std::vector<MeshIndex> indices(mesh.indices.begin(), mesh.indices.end());
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(MeshIndex), indices.data(), GL_STATIC_DRAW);
+
+    const GLsizei stride = sizeof(PackedVertex);
+    glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 1, GL_SHORT, GL_TRUE, stride, (void*)(3 * sizeof(int16_t)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (void*)(4 * sizeof(int16_t)));
+    glEnableVertexAttribArray(2);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    return static_cast<GLsizei>(indices.size());
+}
+
+// 큐브: 면마다 정점 4개(면 법선). drawCube가 윗면만 따로 칠하므로 윗면이 첫 6개 인덱스
+MeshData buildCubeMesh() {
+    float s = 0.5f;
+    const glm::vec3 faceNormals[6] = {
+        glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+        glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(1, 0, 0)
+    };
+    MeshData mesh;
+    for (const glm::vec3& n : faceNormals) {
+        // u x v = n 이 되게 잡아서 바깥에서 봤을 때 반시계 방향
+        glm::vec3 u = (n.y != 0.0f) ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+        glm::vec3 v = glm::cross(n, u);
+        const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+        GLuint base = static_cast<GLuint>(mesh.positions.size());
+        for (const auto& c : corners) {
+            mesh.positions.push_back((n + u * c[0] + v * c[1]) * s);
+            mesh.normals.push_back(n);
+        }
+        mesh.indices.insert(mesh.indices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+    }
+    mesh.sections = { 0, 6 };
+    return mesh;
+}
+
+MeshData buildSphereMesh(int sectorCount, int stackCount) {
     const float radius = 0.5f;
     const float PI = 3.14159265358979323846f;
 
-    std::vector<GLfloat> vertices;
-    std::vector<GLuint> indices;
-
+    MeshData mesh;
     for (int i = 0; i <= stackCount; ++i) {
         float stackAngle = PI / 2.0f - i * (PI / stackCount);
         float xy = radius * cosf(stackAngle);
@@ -413,9 +2080,9 @@ void initSphereMesh(int sectorCount, int stackCount) {
             float sectorAngle = j * (2 * PI / sectorCount);
             float x = xy * cosf(sectorAngle);
             float z = xy * sinf(sectorAngle);
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
+            mesh.positions.push_back(glm::vec3(x, y, z));
+            // 구의 법선 = 중심에서 정점 방향
+            mesh.normals.push_back(glm::vec3(x / radius, y / radius, z / radius));
         }
     }
 
@@ -425,277 +2092,903 @@ void initSphereMesh(int sectorCount, int stackCount) {
 
         for (int j = 0; j < sectorCount; ++j) {
             if (i != 0) {
-                indices.push_back(k1 + j);
-                indices.push_back(k2 + j);
-                indices.push_back(k1 + j + 1);
+                mesh.indices.push_back(k1 + j);
+                mesh.indices.push_back(k2 + j);
+                mesh.indices.push_back(k1 + j + 1);
             }
             if (i != (stackCount - 1)) {
-                indices.push_back(k1 + j + 1);
-                indices.push_back(k2 + j);
-                indices.push_back(k2 + j + 1);
+                mesh.indices.push_back(k1 + j + 1);
+                mesh.indices.push_back(k2 + j);
+                mesh.indices.push_back(k2 + j + 1);
             }
         }
     }
-
-    g_sphereIndexCount = static_cast<GLsizei>(indices.size());
-
-    glGenVertexArrays(1, &g_sphereVAO);
-    glGenBuffers(1, &g_sphereVBO);
-    glGenBuffers(1, &g_sphereEBO);
-
-    glBindVertexArray(g_sphereVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, g_sphereVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_sphereEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    return mesh;
 }
 
-void initCylinderMesh(int sectorCount) {
+MeshData buildCylinderMesh(int sectorCount) {
     const float radius = 0.6f;
     const float height = 2.0f;
     const float halfHeight = height / 2.0f;
     const float PI = 3.14159265358979323846f;
 
-    std::vector<GLfloat> vertices;
-    std::vector<GLuint> indices;
+    // 뚜껑과 옆면은 법선이 달라서 테두리 정점을 따로 둔다
+    MeshData mesh;
+    auto pushVertex = [&](float x, float y, float z, float nx, float ny, float nz) {
+        mesh.positions.push_back(glm::vec3(x, y, z));
+        mesh.normals.push_back(glm::vec3(nx, ny, nz));
+    };
 
-    vertices.push_back(0.0f); vertices.push_back(halfHeight); vertices.push_back(0.0f);   // top center
-    vertices.push_back(0.0f); vertices.push_back(-halfHeight); vertices.push_back(0.0f);  // bottom center
+    pushVertex(0.0f, halfHeight, 0.0f, 0.0f, 1.0f, 0.0f);    // top center
+    pushVertex(0.0f, -halfHeight, 0.0f, 0.0f, -1.0f, 0.0f);  // bottom center
 
     float sectorStep = 2 * PI / sectorCount;
-    for (int i = 0; i <= sectorCount; ++i) {
+    for (int i = 0; i <= sectorCount; ++i) {       // 윗뚜껑 테두리
         float angle = i * sectorStep;
-        float x = radius * cosf(angle);
-        float z = radius * sinf(angle);
-        vertices.push_back(x);
-        vertices.push_back(halfHeight);
-        vertices.push_back(z);
+        pushVertex(radius * cosf(angle), halfHeight, radius * sinf(angle), 0.0f, 1.0f, 0.0f);
     }
-
-    for (int i = 0; i <= sectorCount; ++i) {
+    for (int i = 0; i <= sectorCount; ++i) {       // 아랫뚜껑 테두리
+        float angle = i * sectorStep;
+        pushVertex(radius * cosf(angle), -halfHeight, radius * sinf(angle), 0.0f, -1.0f, 0.0f);
+    }
+    for (int i = 0; i <= sectorCount; ++i) {       // 옆면 위/아래
         float angle = i * sectorStep;
-        float x = radius * cosf(angle);
-        float z = radius * sinf(angle);
-        vertices.push_back(x);
-        vertices.push_back(-halfHeight);
-        vertices.push_back(z);
+        float c = cosf(angle);
+        float sn = sinf(angle);
+        pushVertex(radius * c, halfHeight, radius * sn, c, 0.0f, sn);
+        pushVertex(radius * c, -halfHeight, radius * sn, c, 0.0f, sn);
     }
 
     GLuint topCenter = 0;
     GLuint bottomCenter = 1;
     GLuint topStart = 2;
     GLuint bottomStart = topStart + sectorCount + 1;
+    GLuint sideStart = bottomStart + sectorCount + 1;
 
     for (int i = 0; i < sectorCount; ++i) {
-        indices.push_back(topCenter);
-        indices.push_back(topStart + i);
-        indices.push_back(topStart + i + 1);
+        mesh.indices.push_back(topCenter);
+        mesh.indices.push_back(topStart + i);
+        mesh.indices.push_back(topStart + i + 1);
 
-        indices.push_back(bottomCenter);
-        indices.push_back(bottomStart + i + 1);
-        indices.push_back(bottomStart + i);
+        mesh.indices.push_back(bottomCenter);
+        mesh.indices.push_back(bottomStart + i + 1);
+        mesh.indices.push_back(bottomStart + i);
 
-        GLuint k1 = topStart + i;
-        GLuint k2 = bottomStart + i;
+        GLuint k1 = sideStart + i * 2;
+        GLuint k2 = k1 + 1;
 
-        indices.push_back(k1);
-        indices.push_back(k2);
-        indices.push_back(k1 + 1);
+        mesh.indices.push_back(k1);
+        mesh.indices.push_back(k2);
+        mesh.indices.push_back(k1 + 2);
 
-        indices.push_back(k1 + 1);
-        indices.push_back(k2);
-        indices.push_back(k2 + 1);
+        mesh.indices.push_back(k1 + 2);
+        mesh.indices.push_back(k2);
+        mesh.indices.push_back(k2 + 2);
     }
+    return mesh;
+}
 
-    g_cylinderIndexCount = static_cast<GLsizei>(indices.size());
+MeshData buildPacmanMesh(int sectorCount, int stackCount) {
+    // 정점마다 턱 가중치(jaw)가 붙는다
+    // jaw = +1 : 윗턱, -1 : 아랫턱. 정점 셰이더가 mouthAngle * jaw 만큼 X축 회전시킴
+    // 적도 링은 턱마다 따로 두어야 입이 벌어질 때 틈이 생긴다
+    const float radius = 0.5f;
+    const float PI = 3.14159265358979323846f;
+    const int halfStacks = stackCount / 2;
 
-    glGenVertexArrays(1, &g_cylinderVAO);
-    glGenBuffers(1, &g_cylinderVBO);
-    glGenBuffers(1, &g_cylinderEBO);
+    MeshData mesh;
+    auto pushVertex = [&](float x, float y, float z, float jaw, float nx, float ny, float nz) {
+        mesh.positions.push_back(glm::vec3(x, y, z));
+        mesh.jaws.push_back(jaw);
+        mesh.normals.push_back(glm::vec3(nx, ny, nz));
+    };
 
-    glBindVertexArray(g_cylinderVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, g_cylinderVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_cylinderEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    auto addJaw = [&](float jaw) {
+        GLuint base = static_cast<GLuint>(mesh.positions.size());
+
+        // 반구 껍질 (윗턱: 북극 -> 적도, 아랫턱: 적도 -> 남극)
+        for (int i = 0; i <= halfStacks; ++i) {
+            float stackAngle = (jaw > 0.0f)
+                ? PI / 2.0f - i * (PI / stackCount)
+                : -i * (PI / stackCount);
+            float xy = radius * cosf(stackAngle);
+            float y = radius * sinf(stackAngle);
+
+            for (int j = 0; j <= sectorCount; ++j) {
+                float sectorAngle = j * (2 * PI / sectorCount);
+                float x = xy * cosf(sectorAngle);
+                float z = xy * sinf(sectorAngle);
+                pushVertex(x, y, z, jaw, x / radius, y / radius, z / radius);
+            }
+        }
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(0);
+        for (int i = 0; i < halfStacks; ++i) {
+            GLuint k1 = base + i * (sectorCount + 1);
+            GLuint k2 = k1 + sectorCount + 1;
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+            for (int j = 0; j < sectorCount; ++j) {
+                if (!(jaw > 0.0f && i == 0)) {
+                    mesh.indices.push_back(k1 + j);
+                    mesh.indices.push_back(k2 + j);
+                    mesh.indices.push_back(k1 + j + 1);
+                }
+                if (!(jaw < 0.0f && i == halfStacks - 1)) {
+                    mesh.indices.push_back(k1 + j + 1);
+                    mesh.indices.push_back(k2 + j);
+                    mesh.indices.push_back(k2 + j + 1);
+                }
+            }
+        }
+
+        // 입 안쪽 단면 (y = 0 원판). 입을 벌렸을 때 속이 비어 보이지 않게 막아줌
+        // 윗턱 단면은 아래를, 아랫턱 단면은 위를 향한다
+        float capNormalY = -jaw;
+        GLuint center = static_cast<GLuint>(mesh.positions.size());
+        pushVertex(0.0f, 0.0f, 0.0f, jaw, 0.0f, capNormalY, 0.0f);
+        GLuint ringStart = center + 1;
+        for (int j = 0; j <= sectorCount; ++j) {
+            float sectorAngle = j * (2 * PI / sectorCount);
+            pushVertex(radius * cosf(sectorAngle), 0.0f, radius * sinf(sectorAngle), jaw, 0.0f, capNormalY, 0.0f);
+        }
+
+        for (int j = 0; j < sectorCount; ++j) {
+            mesh.indices.push_back(center);
+            if (jaw > 0.0f) {
+                mesh.indices.push_back(ringStart + j + 1);
+                mesh.indices.push_back(ringStart + j);
+            }
+            else {
+                mesh.indices.push_back(ringStart + j);
+                mesh.indices.push_back(ringStart + j + 1);
+            }
+        }
+    };
+
+    addJaw(+1.0f);
+    addJaw(-1.0f);
+    return mesh;
+}
+
+// 기본 메쉬를 최적화해 압축 형식으로 올린다 (initRenderer)
+void initMeshes() {
+    MeshData cube = buildCubeMesh();
+    MeshData sphere = buildSphereMesh(24, 16);
+    MeshData cylinder = buildCylinderMesh(24);
+    MeshData pacman = buildPacmanMesh(24, 16);
+    for (MeshData* mesh : { &cube, &sphere, &cylinder, &pacman }) optimizeMesh(*mesh);
+    uploadMesh(cube, g_cubeVAO, g_cubeVBO, g_cubeEBO);
+    g_sphereIndexCount = uploadMesh(sphere, g_sphereVAO, g_sphereVBO, g_sphereEBO);
+    g_cylinderIndexCount = uploadMesh(cylinder, g_cylinderVAO, g_cylinderVBO, g_cylinderEBO);
+    g_pacmanIndexCount = uploadMesh(pacman, g_pacmanVAO, g_pacmanVBO, g_pacmanEBO);
 }
 
 void drawSphere()
 {
     glBindVertexArray(g_sphereVAO);
-    glDrawElements(GL_TRIANGLES, g_sphereIndexCount, GL_UNSIGNED_INT, (void*)0);
+    glDrawElements(GL_TRIANGLES, g_sphereIndexCount, MESH_INDEX_TYPE, (void*)0);
+    g_frameDrawCalls++;
 }
 
 void drawCylinder()
 {
     glBindVertexArray(g_cylinderVAO);
-    glDrawElements(GL_TRIANGLES, g_cylinderIndexCount, GL_UNSIGNED_INT, (void*)0);
+    glDrawElements(GL_TRIANGLES, g_cylinderIndexCount, MESH_INDEX_TYPE, (void*)0);
+    g_frameDrawCalls++;
 }
 
-void init() {
-    glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK) {}
+// ---- 포인트 라이트 그림자 (큐브맵) ----
+// 스테이지 빛은 미로 중앙 위에 고정된 포인트 라이트. 벽은 움직이지 않으므로 벽의 깊이 큐브맵은
+// 미로가 바뀔 때(g_mazeVersion)만 다시 그리고, 매 프레임에는 팩맨/유령만 작은 동적 큐브맵에 그린다.
+// 셰이더는 두 맵 중 가까운 값을 써서 그림자를 판정한다.
+
+const int SHADOW_STATIC_SIZE = 1024;
+const int SHADOW_DYNAMIC_SIZE = 512;
+const GLint SHADOW_STATIC_UNIT = 1;    // 텍스처 유닛
+const GLint SHADOW_DYNAMIC_UNIT = 2;
+const float SHADOW_NEAR = 0.05f;
+
+struct ShadowMaps {
+    GLuint fbo = 0;
+    GLuint staticCube = 0;
+    GLuint dynamicCube = 0;
+    int cachedMazeVersion = -1;      // staticCube가 그려진 미로 (-1 = 아직 없음)
+    glm::vec3 lightPos = glm::vec3(0.0f, 10.0f, 0.0f);
+    float lightRange = 10.0f;
+    float farPlane = 30.0f;
+    bool enabled = true;
+};
 
-    std::string vsCode = readShaderSource("vertex.glsl");
-    std::string fsCode = readShaderSource("fragment.glsl");
+ShadowMaps g_shadow;
 
-    if (vsCode.empty() || fsCode.empty()) {
-        std::cerr << "̴ ҽ  ֽϴ.  θ Ȯϼ." << std::endl;
-        exit(EXIT_FAILURE);
+GLuint createShadowCube(int size) {
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, tex);
+    for (int face = 0; face < 6; ++face) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, size, size, 0,
+            GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
     }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    return tex;
+}
 
-    g_shaderProgram = createShaderProgram(vsCode.c_str(), fsCode.c_str());
-    if (g_shaderProgram == 0) exit(EXIT_FAILURE);
-
-    g_modelLoc = glGetUniformLocation(g_shaderProgram, "model");
-    g_viewLoc = glGetUniformLocation(g_shaderProgram, "view");
-    g_projLoc = glGetUniformLocation(g_shaderProgram, "projection");
-    g_colorLoc = glGetUniformLocation(g_shaderProgram, "objectColor");
-    g_clipSignLoc = glGetUniformLocation(g_shaderProgram, "clipSign");
-    g_lightPosLoc = glGetUniformLocation(g_shaderProgram, "lightPos");
-
-    float s = 0.5f;
-    GLfloat vertices[] = { -s, -s,  s,  s, -s,  s,  s,  s,  s, -s,  s,  s, -s, -s, -s,  s, -s, -s,  s,  s, -s, -s,  s, -s };
-    GLuint indices[] = { 3, 2, 6, 6, 7, 3, 0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4, 4, 0, 3, 3, 7, 4, 1, 5, 6, 6, 2, 1, 0, 1, 5, 5, 4, 0 };
-    glGenVertexArrays(1, &g_cubeVAO); glGenBuffers(1, &g_cubeVBO); glGenBuffers(1, &g_cubeEBO);
-    glBindVertexArray(g_cubeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, g_cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_cubeEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0); glBindVertexArray(0);
-
-    initSphereMesh(24, 16);
-    initCylinderMesh(24);
+void initShadowMaps() {
+    glGenFramebuffers(1, &g_shadow.fbo);
+    g_shadow.staticCube = createShadowCube(SHADOW_STATIC_SIZE);
+    g_shadow.dynamicCube = createShadowCube(SHADOW_DYNAMIC_SIZE);
+    g_shadow.cachedMazeVersion = -1;
+}
 
-    glEnable(GL_DEPTH_TEST);
-    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-    g_lastTime = glutGet(GLUT_ELAPSED_TIME);
-    reset();
+void destroyShadowMaps() {
+    glDeleteTextures(1, &g_shadow.staticCube);
+    glDeleteTextures(1, &g_shadow.dynamicCube);
+    glDeleteFramebuffers(1, &g_shadow.fbo);
+    g_shadow = ShadowMaps();
 }
 
-void renderText(float x, float y, const std::string& text)
-{
-    // --- Modern OpenGL 상태 차단 ---
-    glUseProgram(0);          // 셰이더 OFF
-    glBindVertexArray(0);     // VAO OFF (이거 안 하면 텍스트 안 보임!!)
-    glDisable(GL_DEPTH_TEST); // 깊이 테스트 OFF
+// ---- GPU 파티클 (트랜스폼 피드백) ----
+// 펠릿 먹기 / 슬로우 아이템 / 유령 꼬리 효과. 파티클 상태는 GPU 버퍼 두 개를 번갈아 쓰며(핑퐁)
+// 적분, 수명 정리(지오메트리 셰이더에서 죽은 것은 안 내보냄), 생성까지 모두 GPU에서 한다.
+// 게임 로직은 emitParticles()로 이미터 파라미터만 쌓고, 렌더러가 프레임마다 이를 소비한다.
+// 그리기는 효과 종류마다 점 그리기 한 번 (지오메트리 셰이더가 빌보드로 펼침).
+// 살아있는 개수는 트랜스폼 피드백 객체가 GPU에 기억하고 glDrawTransformFeedback이 그대로 쓴다(GL 4.0 /
+// ARB_transform_feedback2). 개수 쿼리는 통계와 빈 효과 건너뛰기용으로 몇 프레임 늦게 읽고 기다리지 않는다.
+// 확장이 없으면 쿼리 결과가 나온 효과만 갱신한다 (GPU가 밀리면 그 효과는 한 프레임 쉰다).
+
+enum class ParticleType {
+    PELLET_BURST,   // 펠릿을 먹은 자리에서 튀는 불꽃
+    SLOW_BURST,     // 슬로우 아이템 발동
+    GHOST_TRAIL,    // 유령 꼬리
+    COUNT
+};
+const int PARTICLE_TYPE_COUNT = static_cast<int>(ParticleType::COUNT);
 
-    // --- 색상 ---
-    glColor3f(1.0f, 1.0f, 1.0f);
+struct ParticleTypeInfo {
+    int capacity;       // 동시에 살아있을 수 있는 최대 파티클 수 (넘치면 트랜스폼 피드백이 버림)
+    int perEmit;        // 이미터 하나가 만드는 파티클 수 (emitParticles의 count가 0일 때)
+    float speed;
+    float upBias;
+    float life;
+    float gravity;
+    float drag;
+    float size;
+};
 
-    // --- 화면 좌표 직접 지정 ---
-    // glRasterPos는 클리핑되면 작동 안 하므로, glWindowPos로 직접 찍음
-    glWindowPos2f(x, y);
+const ParticleTypeInfo PARTICLE_TYPES[PARTICLE_TYPE_COUNT] = {
+    //  capacity perEmit speed upBias life gravity drag  size
+    {   4096,    24,     2.5f, 0.8f,  0.6f, 6.0f,  1.0f, 0.10f },
+    {   4096,    400,    4.0f, 0.3f,  1.2f, 1.0f,  2.0f, 0.12f },
+    {   8192,    2,      0.3f, 1.0f,  0.8f, -0.4f, 3.0f, 0.12f },
+};
 
-    // --- 글자 출력 ---
-    for (char c : text) {
-        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, c);
-    }
+const int PARTICLE_MAX_EMITS = 32;   // 셰이더의 MAX_EMITS와 같아야 함
+const int PARTICLE_QUERY_COUNT = 3;  // 효과마다 진행 중일 수 있는 개수 쿼리
+const int PARTICLE_FLOATS = 11;      // pos(3) vel(3) ageLife(2) color(3)
 
-    // --- 상태 복구 ---
-    glEnable(GL_DEPTH_TEST);
-}
+struct ParticleEmit {
+    glm::vec3 pos;
+    glm::vec3 color;
+    int count;
+};
 
+// 다음 렌더 프레임까지 쌓인 이미터 요청. 창 없는 봇 러너에서는 아무도 소비하지 않으므로 꽉 차면 버린다.
+struct ParticleEmitQueue {
+    ParticleEmit items[PARTICLE_MAX_EMITS];
+    int size = 0;
+};
 
-void drawCube() {
-    glBindVertexArray(g_cubeVAO);
+thread_local ParticleEmitQueue g_particleEmits[PARTICLE_TYPE_COUNT];
+thread_local double g_simTime = 0.0;   // PLAYING 동안 흐른 시뮬레이션 시간. 파티클 적분 간격의 기준
 
-    if (g_isMinimapView) {
-        // 미니맵에서는 바깥에서 지정한 색을 그대로 사용
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)(0));
-    }
-    else {
-        // 메인 3D 화면용: 윗면/옆면 색 다르게
-        glUniform3f(g_colorLoc, 0.0f, 0.0f, 1.0f); // 윗면
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(0));
-        glUniform3f(g_colorLoc, 0.0f, 0.0f, 0.0f); // 나머지
-        glDrawElements(GL_TRIANGLES, 30, GL_UNSIGNED_INT, (void*)(6 * sizeof(GLuint)));
-    }
+void emitParticles(ParticleType type, glm::vec3 pos, glm::vec3 color, int count = 0) {
+    ParticleEmitQueue& queue = g_particleEmits[static_cast<int>(type)];
+    if (queue.size >= PARTICLE_MAX_EMITS) return;
+    queue.items[queue.size++] = ParticleEmit{ pos, color, count > 0 ? count : PARTICLE_TYPES[static_cast<int>(type)].perEmit };
 }
 
-void drawHemisphere(float clipSign) {
-    // clipSign = +1 : y >= 0만 남김 (위쪽 반구)
-    // clipSign = -1 : y <= 0만 남김 (아래쪽 반구)
-    glEnable(GL_CLIP_DISTANCE0);
-    glUniform1f(g_clipSignLoc, clipSign);
+struct ParticleBuffers {
+    GLuint vbo[2] = { 0, 0 };
+    GLuint feedback[2] = { 0, 0 };   // vbo[i]에 쓴 파티클 수를 기억하는 트랜스폼 피드백 객체
+    GLuint updateVAO[2] = { 0, 0 };
+    GLuint renderVAO[2] = { 0, 0 };
+    GLuint queries[PARTICLE_QUERY_COUNT] = {};
+    int queryHead = 0;            // 가장 오래된 진행 중 쿼리
+    int queriesInFlight = 0;
+    int current = 0;              // 살아있는 파티클이 든 버퍼
+    GLuint liveCount = 0;         // 마지막으로 결과가 나온 갱신의 파티클 수 (진행 중 쿼리가 없으면 vbo[current]의 수)
+    double lastSimTime = -1.0;    // 마지막으로 적분한 시각 (효과마다 쉴 수 있으므로 따로)
+};
 
-    glBindVertexArray(g_sphereVAO);
-    glDrawElements(GL_TRIANGLES, g_sphereIndexCount, GL_UNSIGNED_INT, (void*)0);
+struct ParticleSystem {
+    GLuint updateProgram = 0;
+    GLuint renderProgram = 0;
+    GLuint emptyVAO = 0;          // 생성 패스용 (속성 입력 없음)
+    bool feedbackDraw = false;    // glDrawTransformFeedback을 쓸 수 있음
+    ParticleBuffers types[PARTICLE_TYPE_COUNT];
+    uint32_t frame = 0;
+
+    GLint emitModeLoc = -1, dtLoc = -1, gravityLoc = -1, dragLoc = -1, floorYLoc = -1;
+    GLint emitCountLoc = -1, emitPosLoc = -1, emitColorLoc = -1, emitEndLoc = -1;
+    GLint emitSpeedLoc = -1, emitUpBiasLoc = -1, emitLifeLoc = -1, seedLoc = -1;
+    GLint viewLoc = -1, projLoc = -1, sizeLoc = -1;
+};
 
-    glDisable(GL_CLIP_DISTANCE0);
+ParticleSystem g_particles;
+
+void setParticleAttribs(bool update) {
+    const GLsizei stride = PARTICLE_FLOATS * sizeof(GLfloat);
+    // 갱신 패스: 0 pos, 1 vel, 2 ageLife, 3 color / 그리기 패스: 0 pos, 1 ageLife, 2 color
+    GLuint loc = 0;
+    glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(loc++);
+    if (update) {
+        glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(loc++);
+    }
+    glVertexAttribPointer(loc, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(loc++);
+    glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(loc);
 }
 
-void drawPacman(const glm::vec3& worldPos) {
-    // 팩맨 전체 스케일 (반구가 정확한 구 형태가 되도록 동일 반지름 사용)
-    float radius = PLAYER_HEIGHT; // 높이와 동일한 반지름
-    float radiusX = radius;
-    float radiusY = radius;
-    float radiusZ = radius;
-
-    // 공통 회전 (플레이어 방향)
-    glm::mat4 baseRot = glm::rotate(glm::mat4(1.0f),
-        glm::radians(g_playerAngleY),
-        glm::vec3(0.0f, 1.0f, 0.0f));
-
-    // 위 턱(반구)
-    {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, worldPos);
+GLuint createParticleUpdateProgram(const char* vsSource, const char* gsSource) {
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vsSource);
+    GLuint gs = compileShader(GL_GEOMETRY_SHADER, gsSource);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, gs);
+    // 버퍼 레이아웃(PARTICLE_FLOATS)과 같은 순서로 한 버퍼에 교차 저장
+    const char* varyings[] = { "tfPos", "tfVel", "tfAgeLife", "tfColor" };
+    glTransformFeedbackVaryings(program, 4, varyings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(program);
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cerr << "particle update program link failed: " << infoLog << std::endl;
+    }
+    glDeleteShader(vs);
+    glDeleteShader(gs);
+    return program;
+}
 
-        // 팩맨 전체 회전 + 입 회전 (위쪽으로 열림)
-        model *= baseRot;
-        model = glm::rotate(model,
-            glm::radians(+g_pacmanMouthAngle),
-            glm::vec3(1.0f, 0.0f, 0.0f)); // X축 기준으로 회전
+GLuint createParticleRenderProgram(const char* vsSource, const char* gsSource, const char* fsSource) {
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vsSource);
+    GLuint gs = compileShader(GL_GEOMETRY_SHADER, gsSource);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fsSource);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, gs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cerr << "particle render program link failed: " << infoLog << std::endl;
+    }
+    glDeleteShader(vs);
+    glDeleteShader(gs);
+    glDeleteShader(fs);
+    return program;
+}
 
-        model = glm::scale(model, glm::vec3(radiusX, radiusY, radiusZ));
+void initParticles() {
+    std::string updateVs = readShaderSource("particle_update_vertex.glsl");
+    std::string updateGs = readShaderSource("particle_update_geometry.glsl");
+    std::string renderVs = readShaderSource("particle_vertex.glsl");
+    std::string renderGs = readShaderSource("particle_geometry.glsl");
+    std::string renderFs = readShaderSource("particle_fragment.glsl");
+    if (updateVs.empty() || updateGs.empty() || renderVs.empty() || renderGs.empty() || renderFs.empty()) {
+        std::cerr << "particle shaders not found" << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
-        glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform3f(g_colorLoc, 1.0f, 1.0f, 0.0f);  // 노란 팩맨
-        drawHemisphere(+1.0f);
+    ParticleSystem& ps = g_particles;
+    ps.updateProgram = createParticleUpdateProgram(updateVs.c_str(), updateGs.c_str());
+    ps.renderProgram = createParticleRenderProgram(renderVs.c_str(), renderGs.c_str(), renderFs.c_str());
+    ps.feedbackDraw = GLEW_VERSION_4_0 || GLEW_ARB_transform_feedback2;
+
+    GLuint up = ps.updateProgram;
+    ps.emitModeLoc = glGetUniformLocation(up, "emitMode");
+    ps.dtLoc = glGetUniformLocation(up, "dt");
+    ps.gravityLoc = glGetUniformLocation(up, "gravity");
+    ps.dragLoc = glGetUniformLocation(up, "drag");
+    ps.floorYLoc = glGetUniformLocation(up, "floorY");
+    ps.emitCountLoc = glGetUniformLocation(up, "emitCount");
+    ps.emitPosLoc = glGetUniformLocation(up, "emitPos");
+    ps.emitColorLoc = glGetUniformLocation(up, "emitColor");
+    ps.emitEndLoc = glGetUniformLocation(up, "emitEnd");
+    ps.emitSpeedLoc = glGetUniformLocation(up, "emitSpeed");
+    ps.emitUpBiasLoc = glGetUniformLocation(up, "emitUpBias");
+    ps.emitLifeLoc = glGetUniformLocation(up, "emitLife");
+    ps.seedLoc = glGetUniformLocation(up, "seed");
+    ps.viewLoc = glGetUniformLocation(ps.renderProgram, "view");
+    ps.projLoc = glGetUniformLocation(ps.renderProgram, "projection");
+    ps.sizeLoc = glGetUniformLocation(ps.renderProgram, "particleSize");
+
+    glGenVertexArrays(1, &ps.emptyVAO);
+
+    for (int t = 0; t < PARTICLE_TYPE_COUNT; ++t) {
+        ParticleBuffers& pb = ps.types[t];
+        glGenBuffers(2, pb.vbo);
+        glGenVertexArrays(2, pb.updateVAO);
+        glGenVertexArrays(2, pb.renderVAO);
+        glGenQueries(PARTICLE_QUERY_COUNT, pb.queries);
+        if (ps.feedbackDraw) glGenTransformFeedbacks(2, pb.feedback);
+        for (int i = 0; i < 2; ++i) {
+            glBindBuffer(GL_ARRAY_BUFFER, pb.vbo[i]);
+            glBufferData(GL_ARRAY_BUFFER, PARTICLE_TYPES[t].capacity * PARTICLE_FLOATS * sizeof(GLfloat), nullptr, GL_DYNAMIC_COPY);
+
+            glBindVertexArray(pb.updateVAO[i]);
+            setParticleAttribs(true);
+            glBindVertexArray(pb.renderVAO[i]);
+            setParticleAttribs(false);
+
+            if (ps.feedbackDraw) {
+                glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, pb.feedback[i]);
+                glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, pb.vbo[i]);
+            }
+        }
+        pb.current = 0;
+        pb.liveCount = 0;
+        pb.queryHead = 0;
+        pb.queriesInFlight = 0;
+        pb.lastSimTime = -1.0;
     }
+    if (ps.feedbackDraw) glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    // 아래 턱(반구)
-    {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, worldPos);
+void destroyParticles() {
+    ParticleSystem& ps = g_particles;
+    for (ParticleBuffers& pb : ps.types) {
+        glDeleteBuffers(2, pb.vbo);
+        glDeleteVertexArrays(2, pb.updateVAO);
+        glDeleteVertexArrays(2, pb.renderVAO);
+        glDeleteQueries(PARTICLE_QUERY_COUNT, pb.queries);
+        if (ps.feedbackDraw) glDeleteTransformFeedbacks(2, pb.feedback);
+    }
+    glDeleteVertexArrays(1, &ps.emptyVAO);
+    glDeleteProgram(ps.updateProgram);
+    glDeleteProgram(ps.renderProgram);
+    ps = ParticleSystem();
+}
+
+// 끝난 개수 쿼리를 읽는다. 결과가 아직 없으면 다음 프레임에 다시 본다 (기다리지 않음).
+// glDrawTransformFeedback이 없으면 결과가 나온 뒤에야 새 버퍼로 넘어간다 (그리기에 개수가 필요하므로)
+void collectParticleQueries(ParticleBuffers& pb, bool swapOnResult) {
+    while (pb.queriesInFlight > 0) {
+        GLuint query = pb.queries[pb.queryHead];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &pb.liveCount);
+        pb.queryHead = (pb.queryHead + 1) % PARTICLE_QUERY_COUNT;
+        pb.queriesInFlight--;
+        if (swapOnResult) pb.current ^= 1;
+    }
+}
 
-        model *= baseRot;
-        model = glm::rotate(model,
-            glm::radians(-g_pacmanMouthAngle),
-            glm::vec3(1.0f, 0.0f, 0.0f));
+// vbo[current]가 비어 있는 게 확실함 (마지막 갱신의 결과까지 읽었고 0개)
+bool particlesKnownEmpty(const ParticleBuffers& pb) {
+    return pb.queriesInFlight == 0 && pb.liveCount == 0;
+}
 
-        model = glm::scale(model, glm::vec3(radiusX, radiusY, radiusZ));
+// 쌓인 이미터를 소비하고 효과마다 파티클을 g_simTime 기준으로 한 번 적분한다.
+// 살아있는 파티클은 vbo[current]에서 읽어 다른 버퍼에 쓰고, 그리기는 그 사이 vbo[current]를 쓴다.
+void updateParticles() {
+    ParticleSystem& ps = g_particles;
+    ps.frame++;
+
+    glUseProgram(ps.updateProgram);
+    glUniform1f(ps.floorYLoc, FLOOR_SCALE * CUBE_SIZE * 0.5f);
+    glUniform1f(ps.seedLoc, static_cast<float>(ps.frame % 4096) * 13.37f);
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    for (int t = 0; t < PARTICLE_TYPE_COUNT; ++t) {
+        ParticleBuffers& pb = ps.types[t];
+        ParticleEmitQueue& queue = g_particleEmits[t];
+        const ParticleTypeInfo& info = PARTICLE_TYPES[t];
+
+        collectParticleQueries(pb, !ps.feedbackDraw);
+        bool liveMayExist = !particlesKnownEmpty(pb);
+        if (!liveMayExist && queue.size == 0) {
+            pb.lastSimTime = g_simTime;   // 빈 효과는 패스 자체를 건너뜀
+            continue;
+        }
+        // 쿼리 고리가 찼거나 (GPU가 몇 프레임 밀림), 개수를 CPU로 받아야 하는데 아직 없으면 이번 프레임은 쉰다.
+        // 이미터는 큐에 남고 밀린 시간은 다음 적분에 더해진다
+        if (pb.queriesInFlight == PARTICLE_QUERY_COUNT || (!ps.feedbackDraw && pb.queriesInFlight > 0)) continue;
+
+        float dt = (pb.lastSimTime < 0.0) ? 0.0f : static_cast<float>(g_simTime - pb.lastSimTime);
+        pb.lastSimTime = g_simTime;
+        dt = std::max(0.0f, std::min(dt, 0.1f));   // 일시정지 후 한꺼번에 튀지 않게
+
+        GLint emitEnd[PARTICLE_MAX_EMITS];
+        glm::vec3 emitPos[PARTICLE_MAX_EMITS];
+        glm::vec3 emitColor[PARTICLE_MAX_EMITS];
+        int spawnTotal = 0;
+        for (int i = 0; i < queue.size; ++i) {
+            spawnTotal += queue.items[i].count;
+            emitEnd[i] = spawnTotal;
+            emitPos[i] = queue.items[i].pos;
+            emitColor[i] = queue.items[i].color;
+        }
 
-        glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform3f(g_colorLoc, 1.0f, 1.0f, 0.0f);
-        drawHemisphere(-1.0f);
+        glUniform1f(ps.dtLoc, dt);
+        glUniform1f(ps.gravityLoc, info.gravity);
+        glUniform1f(ps.dragLoc, info.drag);
+
+        int next = pb.current ^ 1;
+        if (ps.feedbackDraw) glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, pb.feedback[next]);
+        else glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, pb.vbo[next]);
+        int slot = (pb.queryHead + pb.queriesInFlight) % PARTICLE_QUERY_COUNT;
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, pb.queries[slot]);
+        glBeginTransformFeedback(GL_POINTS);
+
+        // 같은 피드백 세션 안의 두 번째 그리기는 첫 번째 결과 뒤에 이어서 쓴다
+        if (liveMayExist) {
+            glUniform1i(ps.emitModeLoc, 0);
+            glBindVertexArray(pb.updateVAO[pb.current]);
+            if (ps.feedbackDraw) glDrawTransformFeedback(GL_POINTS, pb.feedback[pb.current]);
+            else glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(pb.liveCount));
+            g_frameDrawCalls++;
+        }
+        if (spawnTotal > 0) {
+            glUniform1i(ps.emitModeLoc, 1);
+            glUniform1i(ps.emitCountLoc, queue.size);
+            glUniform3fv(ps.emitPosLoc, queue.size, glm::value_ptr(emitPos[0]));
+            glUniform3fv(ps.emitColorLoc, queue.size, glm::value_ptr(emitColor[0]));
+            glUniform1iv(ps.emitEndLoc, queue.size, emitEnd);
+            glUniform1f(ps.emitSpeedLoc, info.speed);
+            glUniform1f(ps.emitUpBiasLoc, info.upBias);
+            glUniform1f(ps.emitLifeLoc, info.life);
+            glBindVertexArray(ps.emptyVAO);
+            glDrawArrays(GL_POINTS, 0, spawnTotal);
+            g_frameDrawCalls++;
+        }
+
+        glEndTransformFeedback();
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        pb.queriesInFlight++;
+        if (ps.feedbackDraw) pb.current = next;   // 개수는 피드백 객체에 있으니 바로 새 버퍼를 그린다
+        queue.size = 0;
+    }
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    if (ps.feedbackDraw) glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+// 가산 블렌딩, 깊이 테스트는 하되 깊이는 안 씀 (그리는 순서 무관)
+void drawParticles(const glm::mat4& view, const glm::mat4& projection) {
+    ParticleSystem& ps = g_particles;
+    glUseProgram(ps.renderProgram);
+    glUniformMatrix4fv(ps.viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(ps.projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    for (int t = 0; t < PARTICLE_TYPE_COUNT; ++t) {
+        const ParticleBuffers& pb = ps.types[t];
+        if (ps.feedbackDraw ? particlesKnownEmpty(pb) : pb.liveCount == 0) continue;
+        glUniform1f(ps.sizeLoc, PARTICLE_TYPES[t].size);
+        glBindVertexArray(pb.renderVAO[pb.current]);
+        if (ps.feedbackDraw) glDrawTransformFeedback(GL_POINTS, pb.feedback[pb.current]);
+        else glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(pb.liveCount));
+        g_frameDrawCalls++;
+    }
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+// 통계용: 마지막으로 결과가 나온 갱신 기준 (몇 프레임 늦을 수 있음)
+int liveParticleCount() {
+    int total = 0;
+    for (const ParticleBuffers& pb : g_particles.types) total += static_cast<int>(pb.liveCount);
+    return total;
+}
+
+// ---- 인스턴스 칸 그리기 ----
+// 메인 화면의 칸 / 아이템 큐브는 모두 같은 큐브 메쉬에 색도 윗면 파랑, 옆면 검정으로 같아서 모델 행렬만 다르다.
+// 행렬은 프레임마다 한 번 텍스처 버퍼(TBO)에 올리고, 화면(플레이어)마다는 걸러지고 남은 인스턴스 번호 목록만
+// 정점 속성(location 3, divisor 1)으로 넘겨 윗면 / 옆면 두 번의 드로우로 그린다.
+
+const GLint INSTANCE_MODEL_UNIT = 3;   // 텍스처 유닛
+
+struct SceneInstances {
+    GLuint modelBuffer = 0;            // TBO 저장소: 행렬마다 RGBA32F 텍셀 4개 (열 순서)
+    GLuint modelTexture = 0;
+    GLuint idBuffer = 0;               // 모든 화면의 인스턴스 번호 목록을 이어 붙인 것
+    GLint useInstancesLoc = -1;
+    size_t modelCapacity = 0;          // 행렬 수
+    size_t idCapacity = 0;
+    std::vector<glm::mat4> models;     // 칸 (z * 너비 + x), 그 뒤에 아이템
+    std::vector<int> itemCells;        // models[칸 수 + i] 아이템이 놓인 칸
+    std::vector<GLint> ids;
+};
+
+SceneInstances g_sceneInstances;
+
+void initSceneInstances() {
+    SceneInstances& si = g_sceneInstances;
+    glGenBuffers(1, &si.modelBuffer);
+    glGenTextures(1, &si.modelTexture);
+    glGenBuffers(1, &si.idBuffer);
+
+    // 인스턴스 드로우가 아닐 때도 속성 0번 원소는 읽힐 수 있으므로 한 칸은 잡아 둔다 (useInstances = 0이면 무시)
+    si.idCapacity = 1;
+    glBindBuffer(GL_ARRAY_BUFFER, si.idBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLint), nullptr, GL_STREAM_DRAW);
+    glBindVertexArray(g_cubeVAO);
+    glVertexAttribIPointer(3, 1, GL_INT, 0, (void*)0);
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(3);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // 셰이더는 그림자 패스와 같이 쓰므로 두 프로그램 모두 샘플러 유닛을 맞춘다
+    for (GLuint program : { g_shaderProgram, g_shadowProgram }) {
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "instanceModels"), INSTANCE_MODEL_UNIT);
+    }
+    glUseProgram(0);
+    si.useInstancesLoc = glGetUniformLocation(g_shaderProgram, "useInstances");
+}
+
+// GL 리소스(셰이더, 메쉬) 초기화. GLUT 창이든 오프스크린 컨텍스트든 현재 컨텍스트에 만든다.
+void initRenderer() {
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {}
+
+    std::string vsCode = readShaderSource("vertex.glsl");
+    std::string fsCode = readShaderSource("fragment.glsl");
+
+    if (vsCode.empty() || fsCode.empty()) {
+        std::cerr << "̴ ҽ  ֽϴ.  θ Ȯϼ." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    g_shaderProgram = createShaderProgram(vsCode.c_str(), fsCode.c_str());
+    if (g_shaderProgram == 0) exit(EXIT_FAILURE);
+
+    g_modelLoc = glGetUniformLocation(g_shaderProgram, "model");
+    g_viewLoc = glGetUniformLocation(g_shaderProgram, "view");
+    g_projLoc = glGetUniformLocation(g_shaderProgram, "projection");
+    g_colorLoc = glGetUniformLocation(g_shaderProgram, "objectColor");
+    g_mouthAngleLoc = glGetUniformLocation(g_shaderProgram, "mouthAngle");
+    g_lightPosLoc = glGetUniformLocation(g_shaderProgram, "lightPos");
+    g_lightRangeLoc = glGetUniformLocation(g_shaderProgram, "lightRange");
+    g_shadowFarLoc = glGetUniformLocation(g_shaderProgram, "shadowFar");
+    g_shadowsEnabledLoc = glGetUniformLocation(g_shaderProgram, "shadowsEnabled");
+    glUseProgram(g_shaderProgram);
+    glUniform1i(glGetUniformLocation(g_shaderProgram, "staticShadowMap"), SHADOW_STATIC_UNIT);
+    glUniform1i(glGetUniformLocation(g_shaderProgram, "dynamicShadowMap"), SHADOW_DYNAMIC_UNIT);
+    glUseProgram(0);
+
+    std::string shadowFsCode = readShaderSource("shadow_fragment.glsl");
+    if (shadowFsCode.empty()) {
+        std::cerr << "shadow_fragment.glsl not found" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    g_shadowProgram = createShaderProgram(vsCode.c_str(), shadowFsCode.c_str());
+    g_shadowModelLoc = glGetUniformLocation(g_shadowProgram, "model");
+    g_shadowViewLoc = glGetUniformLocation(g_shadowProgram, "view");
+    g_shadowProjLoc = glGetUniformLocation(g_shadowProgram, "projection");
+    g_shadowMouthAngleLoc = glGetUniformLocation(g_shadowProgram, "mouthAngle");
+    g_shadowLightPosLoc = glGetUniformLocation(g_shadowProgram, "lightPos");
+    g_shadowFarPassLoc = glGetUniformLocation(g_shadowProgram, "shadowFar");
+
+    initMeshes();
+    initSceneInstances();
+
+    initShadowMaps();
+    initParticles();
+
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+}
+
+// 내장 5x7 비트맵 폰트 (' ' ~ 'Z'). GLUT 비트맵 폰트는 glutInit이 필요해서
+// 창 없는 오프스크린 컨텍스트에서는 이 폰트로 HUD를 그린다. 소문자는 대문자로 그림.
+const int BUILTIN_FONT_FIRST = 32;
+const int BUILTIN_FONT_LAST = 90;
+const int BUILTIN_FONT_SCALE = 2;
+const unsigned char BUILTIN_FONT[BUILTIN_FONT_LAST - BUILTIN_FONT_FIRST + 1][7] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // ' '
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 },   // '!'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '"'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '#'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '$'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '%'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '&'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '''
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 },   // '('
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 },   // ')'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '*'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // ','
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },   // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C },   // '.'
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },   // '/'
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },   // '0'
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },   // '1'
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },   // '2'
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },   // '3'
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },   // '4'
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },   // '5'
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },   // '6'
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },   // '7'
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },   // '8'
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },   // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 },   // ':'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // ';'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '<'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '='
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '>'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '?'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '@'
+    { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },   // 'A'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },   // 'B'
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },   // 'C'
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },   // 'D'
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },   // 'E'
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },   // 'F'
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },   // 'G'
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },   // 'H'
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },   // 'I'
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },   // 'J'
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },   // 'K'
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },   // 'L'
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },   // 'M'
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },   // 'N'
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },   // 'O'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },   // 'P'
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },   // 'Q'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },   // 'R'
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },   // 'S'
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },   // 'T'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },   // 'U'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },   // 'V'
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },   // 'W'
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },   // 'X'
+    { 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04 },   // 'Y'
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },   // 'Z'
+};
+
+bool g_useBuiltinFont = false;
+
+void drawBuiltinText(const std::string& text) {
+    const int glyphW = 5 * BUILTIN_FONT_SCALE;
+    const int glyphH = 7 * BUILTIN_FONT_SCALE;
+    const int rowBytes = (glyphW + 7) / 8;
+
+    // 확대된 글리프 비트맵 (glBitmap은 아래 줄부터 읽음)
+    static std::vector<GLubyte> bitmaps;
+    const int glyphBytes = rowBytes * glyphH;
+    if (bitmaps.empty()) {
+        const int glyphCount = BUILTIN_FONT_LAST - BUILTIN_FONT_FIRST + 1;
+        bitmaps.assign(glyphCount * glyphBytes, 0);
+        for (int g = 0; g < glyphCount; ++g) {
+            GLubyte* dst = &bitmaps[g * glyphBytes];
+            for (int y = 0; y < glyphH; ++y) {
+                unsigned char bits = BUILTIN_FONT[g][6 - y / BUILTIN_FONT_SCALE];
+                for (int x = 0; x < glyphW; ++x) {
+                    if (bits & (0x10 >> (x / BUILTIN_FONT_SCALE))) {
+                        dst[y * rowBytes + x / 8] |= static_cast<GLubyte>(0x80 >> (x % 8));
+                    }
+                }
+            }
+        }
+    }
+
+    GLint unpackAlignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (char c : text) {
+        int code = static_cast<unsigned char>(c);
+        if (code >= 'a' && code <= 'z') code -= 32;
+        if (code < BUILTIN_FONT_FIRST || code > BUILTIN_FONT_LAST) code = ' ';
+        glBitmap(glyphW, glyphH, 0.0f, 0.0f, static_cast<GLfloat>(glyphW + BUILTIN_FONT_SCALE), 0.0f,
+            &bitmaps[(code - BUILTIN_FONT_FIRST) * glyphBytes]);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+}
+
+void renderText(float x, float y, const std::string& text)
+{
+    // --- Modern OpenGL 상태 차단 ---
+    glUseProgram(0);          // 셰이더 OFF
+    glBindVertexArray(0);     // VAO OFF (이거 안 하면 텍스트 안 보임!!)
+    glDisable(GL_DEPTH_TEST); // 깊이 테스트 OFF
+
+    // --- 색상 ---
+    glColor3f(1.0f, 1.0f, 1.0f);
+
+    // --- 화면 좌표 직접 지정 ---
+    // glRasterPos는 클리핑되면 작동 안 하므로, glWindowPos로 직접 찍음
+    glWindowPos2f(x, y);
+
+    // --- 글자 출력 ---
+    if (g_useBuiltinFont) {
+        drawBuiltinText(text);
+    }
+    else {
+        for (char c : text) {
+            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, c);
+        }
+    }
+
+    // --- 상태 복구 ---
+    glEnable(GL_DEPTH_TEST);
+}
+
+
+void drawCube() {
+    glBindVertexArray(g_cubeVAO);
+
+    if (g_isMinimapView) {
+        // 미니맵에서는 바깥에서 지정한 색을 그대로 사용
+        glDrawElements(GL_TRIANGLES, 36, MESH_INDEX_TYPE, (void*)(0));
+        g_frameDrawCalls++;
+    }
+    else {
+        // 메인 3D 화면용: 윗면/옆면 색 다르게
+        glUniform3f(g_colorLoc, 0.0f, 0.0f, 1.0f); // 윗면
+        glDrawElements(GL_TRIANGLES, 6, MESH_INDEX_TYPE, (void*)(0));
+        g_frameDrawCalls++;
+        glUniform3f(g_colorLoc, 0.0f, 0.0f, 0.0f); // 나머지
+        glDrawElements(GL_TRIANGLES, 30, MESH_INDEX_TYPE, (void*)(6 * sizeof(MeshIndex)));
+        g_frameDrawCalls++;
     }
 }
 
-void drawGhost(const Ghost& ghost) {
-    glm::ivec2 gGrid = getGridCoord(ghost.x, ghost.z);
+void drawPacman(const glm::vec3& worldPos, const Transform& transform, const Render& render) {
+    // 팩맨 전체 스케일 (높이와 동일한 반지름)
+    float radius = PLAYER_HEIGHT;
+
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, worldPos);
+    model = glm::rotate(model,
+        glm::radians(transform.angleY),
+        glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(radius, radius, radius));
+
+    glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    glUniform3fv(g_colorLoc, 1, glm::value_ptr(render.color));
+
+    // 위/아래 턱 회전은 정점 셰이더에서 턱 가중치로 처리 -> 한 번의 드로우
+    glUniform1f(g_mouthAngleLoc, glm::radians(render.anim));
+
+    glBindVertexArray(g_pacmanVAO);
+    glDrawElements(GL_TRIANGLES, g_pacmanIndexCount, MESH_INDEX_TYPE, (void*)0);
+    g_frameDrawCalls++;
+}
+
+void drawGhost(const Transform& ghost, const GridCell& gGrid, const Render& render) {
     float gTileY = 0.0f;
     float gTileScale = FLOOR_SCALE;
-    if (gGrid.y >= 0 && gGrid.y < g_gridHeight &&
+    if (gGrid.z >= 0 && gGrid.z < g_gridHeight &&
         gGrid.x >= 0 && gGrid.x < g_gridWidth) {
-        gTileY = g_cubeCurrentHeight[gGrid.y][gGrid.x];
-        gTileScale = g_cubeCurrentScale[gGrid.y][gGrid.x];
+        gTileY = cellCenterY(gGrid.x, gGrid.z);
+        gTileScale = cellScaleY(gGrid.x, gGrid.z);
     }
 
     float baseY = gTileY + (gTileScale * CUBE_SIZE * 0.5f);
@@ -711,7 +3004,7 @@ void drawGhost(const Ghost& ghost) {
         model = glm::scale(model, glm::vec3(GHOST_WIDTH, bodyHeight, GHOST_DEPTH));
 
         glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform3f(g_colorLoc, 0.6f, 0.6f, 0.6f);  // 회색 유령
+        glUniform3fv(g_colorLoc, 1, glm::value_ptr(render.color));
         drawCylinder();
     }
 
@@ -723,39 +3016,188 @@ void drawGhost(const Ghost& ghost) {
         model = glm::scale(model, glm::vec3(headRadius, headRadius, headRadius));
 
         glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform3f(g_colorLoc, 0.6f, 0.6f, 0.6f);
+        glUniform3fv(g_colorLoc, 1, glm::value_ptr(render.color));
         drawSphere();
     }
 }
 
 
-void drawGrid(glm::mat4 view, glm::mat4 projection) {
+// 미로 칸(벽/바닥) 큐브의 모델 행렬
+glm::mat4 cellModelMatrix(int gridX, int gridZ) {
+    glm::vec3 pos = getWorldPos(gridX, gridZ);
+    pos.y = cellCenterY(gridX, gridZ);
+    float scaleY = cellScaleY(gridX, gridZ);
+
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, pos);
+    model = glm::scale(model, glm::vec3(CUBE_SIZE, scaleY * CUBE_SIZE, CUBE_SIZE));
+    return model;
+}
+
+// 엔티티가 서 있는 칸 윗면 높이
+float tileTopAt(const GridCell& cell) {
+    float tileY = 0.0f;
+    float tileScale = 0.0f;
+    if (cell.z >= 0 && cell.z < g_gridHeight && cell.x >= 0 && cell.x < g_gridWidth) {
+        tileY = cellCenterY(cell.x, cell.z);
+        tileScale = cellScaleY(cell.x, cell.z);
+    }
+    return tileY + (tileScale * CUBE_SIZE * 0.5f);
+}
+
+// 아이템(펠릿 / 슬로우 / 파워 펠릿) 큐브의 모델 행렬. 미니맵에서는 칸 크기에 맞춰, 메인 화면에서는 고정 크기로
+glm::mat4 itemModelMatrix(RenderKind kind, const Transform& transform, float tileTop, bool minimap) {
+    bool pellet = (kind == RenderKind::PELLET);
+    bool power = (kind == RenderKind::POWER_PELLET);
+    float lift;
+    float itemScale;
+    if (minimap) {
+        lift = pellet ? 0.02f : 0.025f;
+        itemScale = CUBE_SIZE * (pellet ? 0.2f : power ? 0.3f : 0.22f);
+    }
+    else {
+        lift = pellet ? 0.05f : 0.06f;
+        itemScale = pellet ? 0.2f : power ? 0.35f : 0.25f;
+    }
+
+    glm::mat4 itemModel = glm::mat4(1.0f);
+    itemModel = glm::translate(itemModel, glm::vec3(transform.x, tileTop + lift, transform.z));
+    itemModel = glm::scale(itemModel, glm::vec3(itemScale, itemScale, itemScale));
+    return itemModel;
+}
+
+// 액터 그리기: Render 컴포넌트 배열을 한 번 훑는다. castersOnly면 팩맨/유령만
+// (그림자 패스, 그리고 칸 / 아이템을 인스턴스로 따로 그리는 메인 화면)
+void drawActors(bool castersOnly) {
+    for (size_t i = 0; i < g_world.renders.data.size(); ++i) {
+        const Render& render = g_world.renders.data[i];
+        if (castersOnly && render.kind != RenderKind::PACMAN && render.kind != RenderKind::GHOST) continue;
+
+        Entity e = g_world.renders.owner[i];
+        const Transform& transform = getComponent(g_world.transforms, e);
+        const GridCell& cell = getComponent(g_world.cells, e);
+        float tileTop = tileTopAt(cell);
+
+        switch (render.kind) {
+        case RenderKind::PACMAN:
+            drawPacman(glm::vec3(transform.x, tileTop + (PLAYER_HEIGHT / 2.0f), transform.z), transform, render);
+            break;
+
+        case RenderKind::GHOST:
+            drawGhost(transform, cell, render);
+            break;
+
+        case RenderKind::PELLET:
+        case RenderKind::SLOW_ITEM:
+        case RenderKind::POWER_PELLET: {
+            glm::mat4 itemModel = itemModelMatrix(render.kind, transform, tileTop, g_isMinimapView);
+            glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(itemModel));
+            glUniform3fv(g_colorLoc, 1, glm::value_ptr(render.color));
+            drawCube();
+            break;
+        }
+        }
+    }
+}
+
+// ---- 절두체 컬링 ----
+// 3인칭 카메라는 플레이어 뒤 CAMERA_DISTANCE, 위 CAMERA_HEIGHT에 있고 yaw는 마음대로 돈다.
+// 메인 화면의 칸/아이템은 카메라 절두체 밖이면 그리지 않는다. 카메라가 벽 꼭대기보다 한참 높아서
+// 벽이 가리는 칸은 거의 없다 (칸별 가시 집합을 미리 구해 봐도 절두체 뒤에 1~2%밖에 더 못 걸렀다).
+
+const float CAMERA_DISTANCE = 6.0f;     // 얼마나 뒤로 떨어질지
+const float CAMERA_HEIGHT = 4.0f;       // 얼마나 위에 있을지
+const float CAMERA_LOOK_HEIGHT = 1.0f;  // 팩맨의 어느 높이를 볼지
+const float CAMERA_FOV_DEGREES = 45.0f;
+const float CAMERA_NEAR = 0.1f;
+const float CAMERA_FAR = 100.0f;
+
+const float CULL_ITEM_HEIGHT = 0.3f;    // 바닥 칸은 그 위 아이템 꼭대기까지를 상자로 본다
+
+struct CullStats {
+    long long cells = 0;                // 메인 화면에서 그릴 수 있었던 칸
+    long long frustumCulled = 0;
+};
+
+CullStats g_cullStats;
+
+// view-projection 행렬의 여섯 평면 (ax + by + cz + d >= 0 이 안쪽)
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+Frustum frustumFromMatrix(const glm::mat4& m) {
+    Frustum f;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    f.planes[0] = row3 + row0;
+    f.planes[1] = row3 - row0;
+    f.planes[2] = row3 + row1;
+    f.planes[3] = row3 - row1;
+    f.planes[4] = row3 + row2;
+    f.planes[5] = row3 - row2;
+    return f;
+}
+
+bool boxInFrustum(const Frustum& f, const glm::vec3& lo, const glm::vec3& hi) {
+    for (const glm::vec4& p : f.planes) {
+        glm::vec3 corner(p.x >= 0.0f ? hi.x : lo.x, p.y >= 0.0f ? hi.y : lo.y, p.z >= 0.0f ? hi.z : lo.z);
+        if (p.x * corner.x + p.y * corner.y + p.z * corner.z + p.w < 0.0f) return false;
+    }
+    return true;
+}
+
+// player의 화면에서 이번 프레임에 그릴 칸 표시. 칸과 그 칸의 아이템이 같이 걸러진다
+void computeCellCulling(const glm::mat4& viewProjection, int player, std::vector<uint8_t>& drawCells) {
+    const int cellCount = g_gridWidth * g_gridHeight;
+    drawCells.assign(cellCount, 1);
+    g_cullStats.cells += cellCount;
+
+    Frustum frustum = frustumFromMatrix(viewProjection);
+    const float half = CUBE_SIZE * 0.5f;
+
+    for (int z = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x) {
+            int idx = z * g_gridWidth + x;
+            glm::vec3 c = getWorldPos(x, z);
+            float top = std::max(cellScaleY(x, z) * CUBE_SIZE, CULL_ITEM_HEIGHT);
+            if (!boxInFrustum(frustum, glm::vec3(c.x - half, 0.0f, c.z - half), glm::vec3(c.x + half, top, c.z + half))) {
+                drawCells[idx] = 0;
+                g_cullStats.frustumCulled++;
+            }
+        }
+    }
+}
+
+// 카메라와 조명 uniform. 미니맵이면 그림자 없는 위쪽 고정 조명
+void setSceneUniforms(const glm::mat4& view, const glm::mat4& projection) {
     glUseProgram(g_shaderProgram);
     glUniformMatrix4fv(g_viewLoc, 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(g_projLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
     if (g_isMinimapView) {
-        // 미니맵은 위쪽 고정 조명
+        // 미니맵은 위쪽 고정 조명, 그림자 없음
         glUniform3f(g_lightPosLoc, 0.0f, 30.0f, 0.0f);
+        glUniform1f(g_lightRangeLoc, 1000.0f);
+        glUniform1i(g_shadowsEnabledLoc, 0);
     } else {
-        // 메인 화면: 카메라 위치에서 빛이 나옴
-        glUniform3f(g_lightPosLoc, g_cameraPos.x, g_cameraPos.y, g_cameraPos.z);
+        // 메인 화면: 미로 위에 고정된 스테이지 빛 + 그림자 큐브맵
+        glUniform3fv(g_lightPosLoc, 1, glm::value_ptr(g_shadow.lightPos));
+        glUniform1f(g_lightRangeLoc, g_shadow.lightRange);
+        glUniform1f(g_shadowFarLoc, g_shadow.farPlane);
+        glUniform1i(g_shadowsEnabledLoc, g_shadow.enabled ? 1 : 0);
     }
-    float totalGridWidth = (g_gridWidth - 1) * (CUBE_SIZE + GRID_SPACING);
-    float totalGridHeight = (g_gridHeight - 1) * (CUBE_SIZE + GRID_SPACING);
-    float startX = -totalGridWidth / 2.0f;
-    float startZ = -totalGridHeight / 2.0f;
+}
+
+// 미로 전체를 칸마다 한 번씩 그린다 (미니맵). 메인 화면은 drawSplitViews가 인스턴스로 그림
+void drawGrid(glm::mat4 view, glm::mat4 projection) {
+    setSceneUniforms(view, projection);
 
     for (int i = 0; i < g_gridHeight; ++i) {
         for (int j = 0; j < g_gridWidth; ++j) {
-            float x = startX + j * (CUBE_SIZE + GRID_SPACING);
-            float z = startZ + i * (CUBE_SIZE + GRID_SPACING);
-            float y = g_cubeCurrentHeight[i][j];
-            float scaleY = g_cubeCurrentScale[i][j];
-
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(x, y, z));
-            model = glm::scale(model, glm::vec3(CUBE_SIZE, scaleY * CUBE_SIZE, CUBE_SIZE));
+            glm::mat4 model = cellModelMatrix(j, i);
             glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
             // ★ 여기서 색 결정
@@ -780,127 +3222,527 @@ void drawGrid(glm::mat4 view, glm::mat4 projection) {
             }
 
             drawCube();
+        }
+    }
 
-            // --- 미니맵용 펠릿 표시 ---
-            if (g_isMinimapView && g_maze[i][j] == PATH && g_pellets[i][j]) {
-                glm::mat4 pelletModel = glm::mat4(1.0f);
-
-                float pelletY = g_cubeCurrentHeight[i][j]
-                    + (g_cubeCurrentScale[i][j] * CUBE_SIZE * 0.5f)
-                    + 0.02f;
+    drawActors(false);
+}
 
-                pelletModel = glm::translate(pelletModel, glm::vec3(x, pelletY, z));
+// 큐브맵 면 순서(+X, -X, +Y, -Y, +Z, -Z)에 맞춘 시선/위쪽 방향
+const glm::vec3 SHADOW_FACE_DIRS[6] = {
+    glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+    glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+};
+const glm::vec3 SHADOW_FACE_UPS[6] = {
+    glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+    glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0)
+};
 
-                float pelletScale = CUBE_SIZE * 0.2f;
-                pelletModel = glm::scale(pelletModel, glm::vec3(pelletScale, pelletScale, pelletScale));
+// 스테이지 빛 위치/범위: 미로 중앙 위, 미로가 클수록 높게
+void updateStageLight() {
+    float halfW = (g_gridWidth - 1) * (CUBE_SIZE + GRID_SPACING) * 0.5f;
+    float halfH = (g_gridHeight - 1) * (CUBE_SIZE + GRID_SPACING) * 0.5f;
+    float extent = std::max(halfW, halfH);
+    g_shadow.lightPos = glm::vec3(0.0f, extent * 0.8f + 3.0f, 0.0f);
+    g_shadow.lightRange = extent + g_shadow.lightPos.y;
+    g_shadow.farPlane = glm::length(glm::vec3(halfW + CUBE_SIZE, g_shadow.lightPos.y, halfH + CUBE_SIZE)) * 1.05f;
+}
 
-                glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(pelletModel));
-                glUniform3f(g_colorLoc, 1.0f, 0.9f, 0.2f);
-                drawCube();
-            }
+// 중심이 빛 기준 rel, 반지름 r인 구가 큐브맵 face의 90도 절두체에 걸치는지 (보수적으로 판정)
+bool sphereTouchesCubeFace(const glm::vec3& rel, float r, int face) {
+    int axis = face / 2;
+    float along = (face % 2 == 0) ? rel[axis] : -rel[axis];
+    float side1 = std::abs(rel[(axis + 1) % 3]);
+    float side2 = std::abs(rel[(axis + 2) % 3]);
+    return along + r * 1.4143f >= std::max(side1, side2);
+}
 
-            if (g_isMinimapView && g_maze[i][j] == PATH && g_slowItems[i][j]) {
-                glm::mat4 itemModel = glm::mat4(1.0f);
+// 그림자 패스 동안 그리기 함수들이 그림자 프로그램의 uniform 위치를 쓰게 바꿔 둔다
+struct ShadowPassScope {
+    GLint model, color, mouthAngle;
+    bool minimap;
 
-                float itemY = g_cubeCurrentHeight[i][j]
-                    + (g_cubeCurrentScale[i][j] * CUBE_SIZE * 0.5f)
-                    + 0.025f;
+    ShadowPassScope() : model(g_modelLoc), color(g_colorLoc), mouthAngle(g_mouthAngleLoc), minimap(g_isMinimapView) {
+        g_modelLoc = g_shadowModelLoc;
+        g_colorLoc = -1;                 // 색은 쓰지 않음 (-1 위치의 glUniform은 무시됨)
+        g_mouthAngleLoc = g_shadowMouthAngleLoc;
+        g_isMinimapView = false;
+    }
+    ~ShadowPassScope() {
+        g_modelLoc = model;
+        g_colorLoc = color;
+        g_mouthAngleLoc = mouthAngle;
+        g_isMinimapView = minimap;
+    }
+};
 
-                itemModel = glm::translate(itemModel, glm::vec3(x, itemY, z));
+void beginShadowFace(GLuint cube, int face, int size) {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, cube, 0);
+    glViewport(0, 0, size, size);
+    glClear(GL_DEPTH_BUFFER_BIT);
 
-                float itemScale = CUBE_SIZE * 0.22f;
-                itemModel = glm::scale(itemModel, glm::vec3(itemScale, itemScale, itemScale));
+    glm::mat4 view = glm::lookAt(g_shadow.lightPos, g_shadow.lightPos + SHADOW_FACE_DIRS[face], SHADOW_FACE_UPS[face]);
+    glUniformMatrix4fv(g_shadowViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+}
 
-                glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(itemModel));
-                glUniform3f(g_colorLoc, 0.2f, 0.8f, 1.0f);
-                drawCube();
+// 프레임 시작에 호출. 미로가 바뀌었으면 벽 큐브맵을 다시 굽고, 동적 큐브맵은 매번 다시 그린다.
+void updateShadowMaps() {
+    if (!g_shadow.enabled || g_shadow.fbo == 0) return;
+
+    GLint prevFbo = 0;
+    GLint prevViewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+    glGetIntegerv(GL_VIEWPORT, prevViewport);
+
+    glUseProgram(g_shadowProgram);
+    glBindFramebuffer(GL_FRAMEBUFFER, g_shadow.fbo);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    ShadowPassScope scope;
+    bool mazeChanged = (g_shadow.cachedMazeVersion != g_mazeVersion);
+    if (mazeChanged) updateStageLight();
+
+    glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_NEAR, g_shadow.farPlane);
+    glUniformMatrix4fv(g_shadowProjLoc, 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform3fv(g_shadowLightPosLoc, 1, glm::value_ptr(g_shadow.lightPos));
+    glUniform1f(g_shadowFarPassLoc, g_shadow.farPlane);
+
+    // 정적: 미로가 바뀐 프레임에만 벽 전체를 여섯 면에 굽는다
+    if (mazeChanged) {
+        glUniform1f(g_shadowMouthAngleLoc, 0.0f);
+        glBindVertexArray(g_cubeVAO);
+        for (int face = 0; face < 6; ++face) {
+            beginShadowFace(g_shadow.staticCube, face, SHADOW_STATIC_SIZE);
+            for (int i = 0; i < g_gridHeight; ++i) {
+                for (int j = 0; j < g_gridWidth; ++j) {
+                    if (g_maze[i][j] != WALL) continue;
+                    glm::mat4 model = cellModelMatrix(j, i);
+                    glUniformMatrix4fv(g_shadowModelLoc, 1, GL_FALSE, glm::value_ptr(model));
+                    glDrawElements(GL_TRIANGLES, 36, MESH_INDEX_TYPE, (void*)0);
+                    g_frameDrawCalls++;
+                }
             }
+        }
+        g_shadow.cachedMazeVersion = g_mazeVersion;
+    }
 
-            // 펠릿 그리기 (메인 화면에서만)
-            if (!g_isMinimapView && g_maze[i][j] == PATH && g_pellets[i][j]) {
-                glm::mat4 pelletModel = glm::mat4(1.0f);
-
-                float pelletY = g_cubeCurrentHeight[i][j] + (g_cubeCurrentScale[i][j] * CUBE_SIZE * 0.5f) + 0.05f;
-                pelletModel = glm::translate(pelletModel, glm::vec3(x, pelletY, z));
+    // 동적: 액터가 걸친 면만 그린다 (나머지 면은 비우기만)
+    const float casterRadius = 0.8f;
+    for (int face = 0; face < 6; ++face) {
+        beginShadowFace(g_shadow.dynamicCube, face, SHADOW_DYNAMIC_SIZE);
+
+        bool anyCaster = false;
+        for (size_t i = 0; i < g_world.renders.data.size() && !anyCaster; ++i) {
+            RenderKind kind = g_world.renders.data[i].kind;
+            if (kind != RenderKind::PACMAN && kind != RenderKind::GHOST) continue;
+            const Transform& t = getComponent(g_world.transforms, g_world.renders.owner[i]);
+            glm::vec3 rel = glm::vec3(t.x, 0.5f, t.z) - g_shadow.lightPos;
+            anyCaster = sphereTouchesCubeFace(rel, casterRadius, face);
+        }
+        if (anyCaster) drawActors(true);
+    }
 
-                float pelletScale = 0.2f;
-                pelletModel = glm::scale(pelletModel, glm::vec3(pelletScale, pelletScale, pelletScale));
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, prevFbo);
+    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_STATIC_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, g_shadow.staticCube);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_DYNAMIC_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, g_shadow.dynamicCube);
+    glActiveTexture(GL_TEXTURE0);
+}
 
-                glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(pelletModel));
-                glUniform3f(g_colorLoc, 1.0f, 0.9f, 0.2f);
-                drawCube();
-            }
+// ---- 동적 해상도 ----
+// GPU 없이 llvmpipe로 도는 기계에서는 창 크기 그대로 그리는 메인 3D 화면의 채우기가 프레임 시간 대부분이다.
+// 그래서 메인 화면만 창보다 작을 수 있는 색 / 깊이 타깃에 그리고, 창 크기로 늘려(선형 필터) 붙인다.
+// 미니맵과 HUD는 그 위에 창 해상도 그대로 그린다.
+// 배율은 타이머 쿼리로 잰 GPU 프레임 시간을 보고 정한다. 예산을 넘으면 내리고, 예산의 80% 아래면 올린다.
+// 쿼리 결과는 몇 프레임 늦게 읽으므로 기다리지 않는다. 배율을 바꾼 뒤에는 새 배율로 잰 결과가 쌓일 때까지
+// 다시 바꾸지 않는다. 타깃은 최대 배율 크기로 한 번 만들고, 배율이 바뀌면 그 안에 그리는 영역만 바꾼다.
+// 배율이 1이면 타깃을 거치지 않고 예전처럼 바로 그린다.
+
+const int DYNRES_QUERY_COUNT = 4;
+const float DYNRES_DEFAULT_BUDGET_MS = 1000.0f / 60.0f;
+const float DYNRES_UPPER = 1.0f;         // 예산 대비 이보다 느리면 내림
+const float DYNRES_LOWER = 0.8f;         // 이보다 빠르면 올림 (사이는 그대로: 오르내림 반복 방지)
+const float DYNRES_AIM = 0.9f;           // 바꿀 때 노리는 예산 비율
+const float DYNRES_MAX_DROP = 0.75f;     // 한 번에 바꾸는 폭 (내릴 때는 빨리, 올릴 때는 천천히)
+const float DYNRES_MAX_RISE = 1.1f;
+const float DYNRES_STEP = 1.0f / 32.0f;  // 배율 눈금
+const float DYNRES_EMA = 0.25f;
+const int DYNRES_SETTLE_SAMPLES = 4;     // 새 배율로 이만큼 재고 나서 다시 판단
+const float DYNRES_SAMPLE_CLAMP = 4.0f;  // 예산의 이 배수보다 긴 측정값은 여기까지만 반영
+
+struct DynamicResolution {
+    float minScale = 0.5f;               // --render-scale MIN:MAX (창 해상도 대비 한 변 배율)
+    float maxScale = 1.0f;
+    float budgetMs = 0.0f;               // --frame-budget MS. 0 = 페이싱 목표 FPS에서 (main이 채움)
+    float scale = 1.0f;
+
+    GLuint queries[DYNRES_QUERY_COUNT] = {};
+    float queryScale[DYNRES_QUERY_COUNT] = {};   // 쿼리를 건 프레임의 배율 (다른 배율 결과는 버림)
+    int queryHead = 0;                   // 가장 오래된 진행 중 쿼리
+    int queriesInFlight = 0;
+    bool queryActive = false;
+
+    float gpuMs = 0.0f;                  // 지금 배율로 잰 GPU 프레임 시간 (지수 평균)
+    int samples = 0;
+
+    GLuint fbo = 0;
+    GLuint colorRb = 0;
+    GLuint depthRb = 0;
+    int targetWidth = 0;
+    int targetHeight = 0;
+
+    long long frames = 0;                // 통계 (종료 시 출력)
+    double scaleSum = 0.0;
+    double gpuMsSum = 0.0;
+    long long gpuSamples = 0;
+    int changes = 0;
+    float lowestScale = 1.0f;
+};
 
-            if (!g_isMinimapView && g_maze[i][j] == PATH && g_slowItems[i][j]) {
-                glm::mat4 itemModel = glm::mat4(1.0f);
+DynamicResolution g_dynres;
 
-                float itemY = g_cubeCurrentHeight[i][j] + (g_cubeCurrentScale[i][j] * CUBE_SIZE * 0.5f) + 0.06f;
-                itemModel = glm::translate(itemModel, glm::vec3(x, itemY, z));
+bool dynresAdaptive() {
+    return g_dynres.minScale < g_dynres.maxScale;
+}
 
-                float itemScale = 0.25f;
-                itemModel = glm::scale(itemModel, glm::vec3(itemScale, itemScale, itemScale));
+void destroyDynamicResolution() {
+    DynamicResolution& d = g_dynres;
+    if (d.queries[0] != 0) glDeleteQueries(DYNRES_QUERY_COUNT, d.queries);
+    glDeleteFramebuffers(1, &d.fbo);
+    glDeleteRenderbuffers(1, &d.colorRb);
+    glDeleteRenderbuffers(1, &d.depthRb);
+    d.fbo = d.colorRb = d.depthRb = 0;
+    d.targetWidth = d.targetHeight = 0;
+}
 
-                glUniformMatrix4fv(g_modelLoc, 1, GL_FALSE, glm::value_ptr(itemModel));
-                glUniform3f(g_colorLoc, 0.2f, 0.8f, 1.0f);
-                drawCube();
-            }
-        }
+// 끝난 쿼리를 읽어 배율을 조정한다. 결과가 아직 없으면 다음 프레임에 다시 본다
+void dynresCollect() {
+    DynamicResolution& d = g_dynres;
+    while (d.queriesInFlight > 0) {
+        GLuint query = d.queries[d.queryHead];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+        float scale = d.queryScale[d.queryHead];
+        d.queryHead = (d.queryHead + 1) % DYNRES_QUERY_COUNT;
+        d.queriesInFlight--;
+        if (scale != d.scale) continue;
+
+        // 한 번 튄 값(첫 쿼리, 창 이동 등)이 평균을 오래 끌고 가지 않게 자른다
+        float ms = std::min(static_cast<float>(ns / 1e6), d.budgetMs * DYNRES_SAMPLE_CLAMP);
+        d.gpuMs = (d.samples == 0) ? ms : d.gpuMs + (ms - d.gpuMs) * DYNRES_EMA;
+        d.samples++;
+        d.gpuMsSum += ms;
+        d.gpuSamples++;
+        if (d.samples < DYNRES_SETTLE_SAMPLES) continue;
+
+        float ratio = d.gpuMs / d.budgetMs;
+        if (ratio <= DYNRES_UPPER && ratio >= DYNRES_LOWER) continue;
+        // 메인 화면 비용은 화소 수(배율 제곱)에 비례한다고 보고, 고정 비용은 다음 판단에서 다시 맞춘다
+        float next = d.scale * std::sqrt(DYNRES_AIM / std::max(ratio, 1e-3f));
+        next = std::max(d.scale * DYNRES_MAX_DROP, std::min(next, d.scale * DYNRES_MAX_RISE));
+        next = std::round(next / DYNRES_STEP) * DYNRES_STEP;
+        next = std::max(d.minScale, std::min(next, d.maxScale));
+        if (next == d.scale) continue;
+        d.scale = next;
+        d.samples = 0;
+        d.changes++;
+        d.lowestScale = std::min(d.lowestScale, next);
     }
+}
 
-    glm::ivec2 gridPos = getGridCoord(g_playerPosX, g_playerPosZ);
-    float tileY = 0.0f;
-    float tileScale = 0.0f;
-    if (gridPos.y >= 0 && gridPos.y < g_gridHeight && gridPos.x >= 0 && gridPos.x < g_gridWidth) {
-        tileY = g_cubeCurrentHeight[gridPos.y][gridPos.x];
-        tileScale = g_cubeCurrentScale[gridPos.y][gridPos.x];
-    }
-    float playerDrawY = tileY + (tileScale * CUBE_SIZE / 2.0f) + (PLAYER_HEIGHT / 2.0f);
-    glm::vec3 playerWorldPos(g_playerPosX, playerDrawY, g_playerPosZ);
-    drawPacman(playerWorldPos);
+// renderFrame 전체를 GL_TIME_ELAPSED로 잰다 (적응할 때만)
+void dynresBeginFrame() {
+    DynamicResolution& d = g_dynres;
+    if (!dynresAdaptive()) return;
+    if (d.queries[0] == 0) glGenQueries(DYNRES_QUERY_COUNT, d.queries);
+    dynresCollect();
+    if (d.queriesInFlight == DYNRES_QUERY_COUNT) return;
+    int slot = (d.queryHead + d.queriesInFlight) % DYNRES_QUERY_COUNT;
+    d.queryScale[slot] = d.scale;
+    glBeginQuery(GL_TIME_ELAPSED, d.queries[slot]);
+    d.queryActive = true;
+}
 
-    for (const Ghost& ghost : g_ghosts) {
-        drawGhost(ghost);
+void dynresEndFrame() {
+    DynamicResolution& d = g_dynres;
+    if (d.queryActive) {
+        glEndQuery(GL_TIME_ELAPSED);
+        d.queryActive = false;
+        d.queriesInFlight++;
     }
 }
 
-void display() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glViewport(0, 0, g_windowWidth, g_windowHeight);
-
-    // TITLE 화면에서는 3D 그리기 자체를 하지 않음
-    if (g_gameState == GameState::PLAYING) {
-
-        glm::ivec2 gridPos = getGridCoord(g_playerPosX, g_playerPosZ);
-        float tileY = 0.0f;
-        if (gridPos.y >= 0 && gridPos.y < g_gridHeight && gridPos.x >= 0 && gridPos.x < g_gridWidth) {
-            tileY = g_cubeCurrentHeight[gridPos.y][gridPos.x];
+// 메인 화면을 배율 타깃에 그릴 준비. 배율이 1이면 false (지금 프레임버퍼에 바로 그림)
+bool dynresBeginScene(int& width, int& height) {
+    DynamicResolution& d = g_dynres;
+    d.frames++;
+    d.scaleSum += d.scale;
+    width = g_windowWidth;
+    height = g_windowHeight;
+    if (d.scale == 1.0f) return false;
+
+    // 최대 배율 크기로 만들어 두고 창 크기가 바뀔 때만 다시 만든다
+    int needWidth = std::max(1, static_cast<int>(std::ceil(g_windowWidth * d.maxScale)));
+    int needHeight = std::max(1, static_cast<int>(std::ceil(g_windowHeight * d.maxScale)));
+    if (d.fbo == 0 || d.targetWidth != needWidth || d.targetHeight != needHeight) {
+        if (d.fbo == 0) {
+            glGenFramebuffers(1, &d.fbo);
+            glGenRenderbuffers(1, &d.colorRb);
+            glGenRenderbuffers(1, &d.depthRb);
+        }
+        glBindRenderbuffer(GL_RENDERBUFFER, d.colorRb);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, needWidth, needHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, d.depthRb);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, needWidth, needHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, d.fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, d.colorRb);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, d.depthRb);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "[dynres] framebuffer incomplete, rendering at native resolution" << std::endl;
+            d.minScale = d.maxScale = d.scale = 1.0f;
+            return false;
         }
+        d.targetWidth = needWidth;
+        d.targetHeight = needHeight;
+    }
 
-        glm::vec3 playerWorldPos = glm::vec3(g_playerPosX, tileY, g_playerPosZ);
+    width = std::max(1, static_cast<int>(std::lround(g_windowWidth * d.scale)));
+    height = std::max(1, static_cast<int>(std::lround(g_windowHeight * d.scale)));
+    glBindFramebuffer(GL_FRAMEBUFFER, d.fbo);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    return true;
+}
 
-        float yawRad = glm::radians(g_cameraYaw);
-        glm::vec3 camForward(sin(yawRad), 0.0f, cos(yawRad));
+// 배율 타깃을 창 크기로 늘려 target에 붙이고 target으로 돌아간다. 깊이는 복사하지 않는다
+// (뒤에 그리는 미니맵은 자기 영역 깊이를 지우고, HUD는 깊이를 쓰지 않음)
+void dynresEndScene(GLuint target, int width, int height) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, g_dynres.fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, g_windowWidth, g_windowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+}
 
-        // 3인칭 카메라 파라미터
-        const float CAM_DISTANCE = 6.0f;   // 얼마나 뒤로 떨어질지
-        const float CAM_HEIGHT   = 4.0f;   // 얼마나 위에 있을지
-        const float LOOK_HEIGHT  = 1.0f;   // 팩맨의 어느 높이를 볼지
+// "0.5" = 고정, "0.5:1" = 0.5~1 사이에서 조절
+bool parseRenderScaleArg(const std::string& text) {
+    size_t colon = text.find(':');
+    float lo = static_cast<float>(std::atof(text.substr(0, colon).c_str()));
+    float hi = (colon == std::string::npos) ? lo : static_cast<float>(std::atof(text.substr(colon + 1).c_str()));
+    if (!(lo > 0.0f) || !(hi >= lo) || hi > 1.0f) {
+        std::cerr << "--render-scale wants MIN[:MAX] with 0 < MIN <= MAX <= 1" << std::endl;
+        return false;
+    }
+    g_dynres.minScale = lo;
+    g_dynres.maxScale = hi;
+    g_dynres.scale = hi;   // 빠른 기계에서는 바로 최대 배율
+    g_dynres.lowestScale = hi;
+    return true;
+}
 
-        glm::vec3 camOffset =
-            -camForward * CAM_DISTANCE +
-            glm::vec3(0.0f, CAM_HEIGHT, 0.0f);
+void printDynamicResolutionStats() {
+    const DynamicResolution& d = g_dynres;
+    if (d.frames == 0 || (!dynresAdaptive() && d.scale == 1.0f)) return;
+    std::cout << "[dynres] scale " << d.minScale << ".." << d.maxScale << ": avg " << (d.scaleSum / d.frames)
+        << ", lowest " << d.lowestScale << ", final " << d.scale << ", " << d.changes << " changes; gpu frame avg "
+        << (d.gpuSamples > 0 ? d.gpuMsSum / d.gpuSamples : 0.0) << " ms (budget " << d.budgetMs << " ms)\n";
+}
 
-        g_cameraPos    = playerWorldPos + camOffset;
-        g_cameraTarget = playerWorldPos + glm::vec3(0.0f, LOOK_HEIGHT, 0.0f);
+// ---- 화면 분할 (로컬 멀티플레이) ----
+// 플레이어가 여럿이면 화면을 나눠(2명 좌우, 3~4명 2x2) 각자의 3인칭 카메라로 그린다. 그림자 맵, 파티클 갱신,
+// 칸 / 아이템 행렬 업로드는 프레임당 한 번이고, 화면마다 따로 하는 건 걸러내기와 드로우뿐이다.
+// 화면별 인스턴스 번호 목록도 모두 이어 붙여 한 번에 올린다. 미니맵과 HUD는 화면 전체에 한 번만 그린다.
 
-        glm::mat4 view = glm::lookAt(g_cameraPos, g_cameraTarget, g_cameraUp);
+struct ViewRect {
+    int x, y, width, height;
+};
 
-        float aspect = (float)g_windowWidth / g_windowHeight;
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+// w x h = 메인 화면 전체 (동적 해상도 타깃이면 창보다 작음)
+ViewRect splitViewRect(int index, int count, int w, int h) {
+    if (count <= 1) return ViewRect{ 0, 0, w, h };
+    if (count == 2) return (index == 0) ? ViewRect{ 0, 0, w / 2, h } : ViewRect{ w / 2, 0, w - w / 2, h };
+    // 1P 왼쪽 위, 2P 오른쪽 위, 3P 왼쪽 아래, 4P 오른쪽 아래 (GL 뷰포트는 아래쪽이 y = 0)
+    int col = index % 2;
+    int row = index / 2;
+    int left = col * (w / 2);
+    int width = (col == 0) ? w / 2 : w - w / 2;
+    int bottom = (row == 0) ? h - h / 2 : 0;
+    int height = (row == 0) ? h / 2 : h - h / 2;
+    return ViewRect{ left, bottom, width, height };
+}
+
+// player 뒤 위쪽의 3인칭 카메라 (파라미터는 절두체 컬링과 같이 씀)
+void playerCamera(int player, float aspect, glm::mat4& view, glm::mat4& projection) {
+    const Transform& transform = playerTransform(player);
+    glm::ivec2 gridPos = getGridCoord(transform.x, transform.z);
+    float tileY = 0.0f;
+    if (gridPos.y >= 0 && gridPos.y < g_gridHeight && gridPos.x >= 0 && gridPos.x < g_gridWidth) {
+        tileY = cellCenterY(gridPos.x, gridPos.y);
+    }
+
+    glm::vec3 playerWorldPos = glm::vec3(transform.x, tileY, transform.z);
+
+    float yawRad = glm::radians(g_playerYaw[player]);
+    glm::vec3 camForward(sin(yawRad), 0.0f, cos(yawRad));
+    glm::vec3 camOffset =
+        -camForward * CAMERA_DISTANCE +
+        glm::vec3(0.0f, CAMERA_HEIGHT, 0.0f);
+
+    glm::vec3 eye = playerWorldPos + camOffset;
+    glm::vec3 target = playerWorldPos + glm::vec3(0.0f, CAMERA_LOOK_HEIGHT, 0.0f);
+    if (player == 0) {
+        g_cameraPos = eye;
+        g_cameraTarget = target;
+    }
+
+    view = glm::lookAt(eye, target, g_cameraUp);
+    projection = glm::perspective(glm::radians(CAMERA_FOV_DEGREES), aspect, CAMERA_NEAR, CAMERA_FAR);
+}
+
+// 칸 행렬과 메인 화면 크기의 아이템 행렬을 TBO에 올린다 (프레임당 한 번)
+void uploadSceneModels() {
+    SceneInstances& si = g_sceneInstances;
+    si.models.clear();
+    si.itemCells.clear();
+    for (int z = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x) {
+            si.models.push_back(cellModelMatrix(x, z));
+        }
+    }
+    for (size_t i = 0; i < g_world.renders.data.size(); ++i) {
+        const Render& render = g_world.renders.data[i];
+        if (render.kind == RenderKind::PACMAN || render.kind == RenderKind::GHOST) continue;
+        Entity e = g_world.renders.owner[i];
+        const GridCell& cell = getComponent(g_world.cells, e);
+        si.models.push_back(itemModelMatrix(render.kind, getComponent(g_world.transforms, e), tileTopAt(cell), false));
+        bool inside = cell.z >= 0 && cell.z < g_gridHeight && cell.x >= 0 && cell.x < g_gridWidth;
+        si.itemCells.push_back(inside ? cell.z * g_gridWidth + cell.x : -1);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, si.modelBuffer);
+    if (si.models.size() > si.modelCapacity) {
+        si.modelCapacity = si.models.size();
+        glBufferData(GL_TEXTURE_BUFFER, si.modelCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+        glActiveTexture(GL_TEXTURE0 + INSTANCE_MODEL_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, si.modelTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, si.modelBuffer);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, si.models.size() * sizeof(glm::mat4), si.models.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// 걸러지고 남은 칸과 그 칸의 아이템 번호를 ids 뒤에 붙인다
+void collectViewInstances(const std::vector<uint8_t>& drawCells) {
+    SceneInstances& si = g_sceneInstances;
+    const int cellCount = g_gridWidth * g_gridHeight;
+    for (int idx = 0; idx < cellCount; ++idx) {
+        if (drawCells[idx]) si.ids.push_back(idx);
+    }
+    for (size_t i = 0; i < si.itemCells.size(); ++i) {
+        int cell = si.itemCells[i];
+        if (cell < 0 || drawCells[cell]) si.ids.push_back(cellCount + static_cast<GLint>(i));
+    }
+}
+
+// ids[first, first + count)의 큐브를 윗면 파랑 / 옆면 검정으로 (drawCube의 메인 화면 색과 같음)
+void drawSceneInstances(size_t first, size_t count) {
+    if (count == 0) return;
+    SceneInstances& si = g_sceneInstances;
+    glBindVertexArray(g_cubeVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, si.idBuffer);
+    glVertexAttribIPointer(3, 1, GL_INT, 0, (void*)(first * sizeof(GLint)));
+    glUniform1i(si.useInstancesLoc, 1);
+
+    glUniform3f(g_colorLoc, 0.0f, 0.0f, 1.0f); // 윗면
+    glDrawElementsInstanced(GL_TRIANGLES, 6, MESH_INDEX_TYPE, (void*)(0), static_cast<GLsizei>(count));
+    g_frameDrawCalls++;
+    glUniform3f(g_colorLoc, 0.0f, 0.0f, 0.0f); // 나머지
+    glDrawElementsInstanced(GL_TRIANGLES, 30, MESH_INDEX_TYPE, (void*)(6 * sizeof(MeshIndex)), static_cast<GLsizei>(count));
+    g_frameDrawCalls++;
+
+    // 다음 프레임에 버퍼가 작아져도 인스턴스 아닌 드로우가 범위 밖을 읽지 않게 처음으로 되돌림
+    glUniform1i(si.useInstancesLoc, 0);
+    glVertexAttribIPointer(3, 1, GL_INT, 0, (void*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// 플레이어마다 화면 한 칸씩 메인 3D 화면을 그린다
+void drawSplitViews() {
+    SceneInstances& si = g_sceneInstances;
+    // 네트워크 클라이언트의 월드에는 다른 사람들도 있지만 화면은 자기(0번) 것만
+    const int views = std::min(g_world.playerCount, g_playerCount);
+    if (views == 0) return;
+    static std::vector<uint8_t> drawCells;
+
+    uploadSceneModels();
+    GLint targetFbo = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &targetFbo);
+    int sceneWidth, sceneHeight;
+    bool scaled = dynresBeginScene(sceneWidth, sceneHeight);
+
+    ViewRect rects[MAX_PLAYERS];
+    glm::mat4 views3d[MAX_PLAYERS];
+    glm::mat4 projections[MAX_PLAYERS];
+    size_t first[MAX_PLAYERS];
+    size_t count[MAX_PLAYERS];
+    si.ids.clear();
+    for (int p = 0; p < views; ++p) {
+        rects[p] = splitViewRect(p, views, sceneWidth, sceneHeight);
+        playerCamera(p, (float)rects[p].width / rects[p].height, views3d[p], projections[p]);
+        computeCellCulling(projections[p] * views3d[p], p, drawCells);
+        first[p] = si.ids.size();
+        collectViewInstances(drawCells);
+        count[p] = si.ids.size() - first[p];
+    }
 
-        // 메인 화면
+    glBindBuffer(GL_ARRAY_BUFFER, si.idBuffer);
+    if (si.ids.size() > si.idCapacity) {
+        si.idCapacity = si.ids.size();
+        glBufferData(GL_ARRAY_BUFFER, si.idCapacity * sizeof(GLint), nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, si.ids.size() * sizeof(GLint), si.ids.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // 화면 경계 밖으로 번지는 파티클이 옆 화면에 그려지지 않게 가위 영역도 같이
+    if (views > 1) glEnable(GL_SCISSOR_TEST);
+    for (int p = 0; p < views; ++p) {
+        const ViewRect& r = rects[p];
+        glViewport(r.x, r.y, r.width, r.height);
+        glScissor(r.x, r.y, r.width, r.height);
         g_isMinimapView = false;
-        drawGrid(view, projection);
+        setSceneUniforms(views3d[p], projections[p]);
+        drawSceneInstances(first[p], count[p]);
+        drawActors(true);
+        drawParticles(views3d[p], projections[p]);
+    }
+    glDisable(GL_SCISSOR_TEST);
+    if (scaled) dynresEndScene(static_cast<GLuint>(targetFbo), sceneWidth, sceneHeight);
+    glViewport(0, 0, g_windowWidth, g_windowHeight);
+}
+
+std::string g_frameStatsText;   // F3 프레임 통계 오버레이 (비어 있으면 그리지 않음)
+
+// 메인 화면 + 미니맵 + HUD를 현재 바인딩된 프레임버퍼에 그린다 (스왑은 호출하는 쪽에서)
+void renderFrame() {
+    dynresBeginFrame();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glViewport(0, 0, g_windowWidth, g_windowHeight);
+
+    // TITLE 화면에서는 3D 그리기 자체를 하지 않음
+    if (g_gameState == GameState::PLAYING) {
+        updateShadowMaps();
+        updateParticles();
+
+        // 메인 화면 (플레이어 수만큼 나눠서)
+        drawSplitViews();
         // --- Mini-map (top-right square) ---
         int padding = 10;
         int minimapSize = std::min(g_windowWidth, g_windowHeight) / 4; // 정사각형
@@ -965,11 +3807,17 @@ void display() {
     case GameState::PLAYING:
     {
         std::string hud = "SCORE: " + std::to_string(g_score) + "   LIVES: " + std::to_string(g_lives);
+        if (g_currentStage == EXPLORE_STAGE) hud += "   EXPLORE";
         renderText(20.0f, g_windowHeight - 30.0f, hud);
 
+        float hudY = g_windowHeight - 60.0f;
         if (g_ghostSlowActive) {
             std::string hud2 = "SLOW TIME: " + std::to_string((int)std::ceil(g_ghostSlowTimer));
-            renderText(20.0f, g_windowHeight - 60.0f, hud2);
+            renderText(20.0f, hudY, hud2);
+            hudY -= 30.0f;
+        }
+        if (g_frightenedTimer > 0.0f) {
+            renderText(20.0f, hudY, "POWER: " + std::to_string((int)std::ceil(g_frightenedTimer)));
         }
     }
     break;
@@ -983,359 +3831,6137 @@ void display() {
         break;
     }
 
-    glutSwapBuffers();
+    if (!g_frameStatsText.empty()) {
+        renderText(20.0f, 20.0f, g_frameStatsText);
+    }
+    dynresEndFrame();
 }
 
+// ---- 이미지 파일 / PBO 리드백 (오프스크린 모드와 게임 화면 캡처가 같이 씀) ----
 
-void reshape(int w, int h) {
-    g_windowWidth = w;
-    g_windowHeight = h;
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgb;   // 위쪽 줄부터, 픽셀당 3바이트
+};
+
+uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t size) {
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : (c >> 1);
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
 }
 
-void handlePlayerInput(float deltaTime) {
-    glm::vec3 moveVector(0.0f, 0.0f, 0.0f);
+void appendBigEndian32(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back(static_cast<unsigned char>(value >> 24));
+    out.push_back(static_cast<unsigned char>(value >> 16));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
 
-    float yawRad = glm::radians(g_cameraYaw);
-    glm::vec3 camForward(sin(yawRad), 0.0f, cos(yawRad));
-    glm::vec3 camRight = glm::normalize(glm::cross(camForward, glm::vec3(0.0f, 1.0f, 0.0f)));
+uint32_t readBigEndian32(const unsigned char* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
 
-    glm::vec3 camForwardDir = glm::normalize(camForward);
-    glm::vec3 camRightDir   = glm::normalize(camRight);
+bool writePPM(const std::string& path, const Image& image) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    file << "P6\n" << image.width << " " << image.height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(image.rgb.data()), image.rgb.size());
+    return file.good();
+}
 
-    if (g_specialKeyStates[GLUT_KEY_UP] || g_keyStates['w'] || g_keyStates['W'])    moveVector += camForwardDir;
-    if (g_specialKeyStates[GLUT_KEY_DOWN] || g_keyStates['s'] || g_keyStates['S'])  moveVector -= camForwardDir;
-    if (g_specialKeyStates[GLUT_KEY_LEFT] || g_keyStates['a'] || g_keyStates['A'])  moveVector -= camRightDir;
-    if (g_specialKeyStates[GLUT_KEY_RIGHT] || g_keyStates['d'] || g_keyStates['D']) moveVector += camRightDir;
+// 무압축(stored) deflate 블록으로 쓰는 PNG. 외부 라이브러리 없이 빠르게 쓰는 것이 목적.
+bool writePNG(const std::string& path, const Image& image) {
+    std::vector<unsigned char> raw;
+    const size_t stride = static_cast<size_t>(image.width) * 3;
+    raw.reserve((stride + 1) * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        raw.push_back(0);   // 필터 없음
+        raw.insert(raw.end(), image.rgb.begin() + y * stride, image.rgb.begin() + (y + 1) * stride);
+    }
 
-    if (glm::length(moveVector) > 0.0f) {
-        glm::vec3 moveDir = glm::normalize(moveVector);
-        moveVector = moveDir * PLAYER_MOVE_SPEED * deltaTime;
-        float newX = g_playerPosX + moveVector.x;
-        float newZ = g_playerPosZ + moveVector.z;
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    size_t offset = 0;
+    do {
+        size_t blockSize = std::min<size_t>(65535, raw.size() - offset);
+        bool last = (offset + blockSize == raw.size());
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<unsigned char>(blockSize & 0xFF));
+        zlib.push_back(static_cast<unsigned char>(blockSize >> 8));
+        zlib.push_back(static_cast<unsigned char>(~blockSize & 0xFF));
+        zlib.push_back(static_cast<unsigned char>((~blockSize >> 8) & 0xFF));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;   // adler32
+    for (unsigned char c : raw) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian32(zlib, (b << 16) | a);
+
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    auto appendChunk = [&](const char* type, const std::vector<unsigned char>& data) {
+        appendBigEndian32(png, static_cast<uint32_t>(data.size()));
+        size_t typeStart = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        appendBigEndian32(png, crc32Update(0, &png[typeStart], png.size() - typeStart));
+    };
+
+    std::vector<unsigned char> header;
+    appendBigEndian32(header, static_cast<uint32_t>(image.width));
+    appendBigEndian32(header, static_cast<uint32_t>(image.height));
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });   // 8비트 RGB
+    appendChunk("IHDR", header);
+    appendChunk("IDAT", zlib);
+    appendChunk("IEND", std::vector<unsigned char>());
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    file.write(reinterpret_cast<const char*>(png.data()), png.size());
+    return file.good();
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
 
-        glm::ivec2 gridPos = getGridCoord(newX, g_playerPosZ);
-        if (gridPos.x >= 0 && gridPos.x < g_gridWidth && gridPos.y >= 0 && gridPos.y < g_gridHeight && g_maze[gridPos.y][gridPos.x] == PATH) {
-            g_playerPosX = newX;
+bool writeImage(const std::string& path, const Image& image) {
+    return endsWith(path, ".ppm") ? writePPM(path, image) : writePNG(path, image);
+}
+
+bool readPPM(const std::string& path, Image& image) {
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int maxValue = 0;
+    if (!(file >> magic >> image.width >> image.height >> maxValue) || magic != "P6" || maxValue != 255) return false;
+    file.get();
+    image.rgb.resize(static_cast<size_t>(image.width) * image.height * 3);
+    file.read(reinterpret_cast<char*>(image.rgb.data()), image.rgb.size());
+    return file.gcount() == static_cast<std::streamsize>(image.rgb.size());
+}
+
+// writePNG가 만든 형식(8비트 RGB, 필터 없음, stored deflate)만 읽는다. 골든 이미지 비교용.
+bool readPNG(const std::string& path, Image& image) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 8 || data[1] != 'P' || data[2] != 'N' || data[3] != 'G') return false;
+
+    std::vector<unsigned char> zlib;
+    size_t pos = 8;
+    while (pos + 12 <= data.size()) {
+        uint32_t length = readBigEndian32(&data[pos]);
+        std::string type(reinterpret_cast<const char*>(&data[pos + 4]), 4);
+        const unsigned char* body = &data[pos + 8];
+        if (pos + 12 + length > data.size()) return false;
+        if (type == "IHDR") {
+            image.width = static_cast<int>(readBigEndian32(body));
+            image.height = static_cast<int>(readBigEndian32(body + 4));
+            if (body[8] != 8 || body[9] != 2 || body[12] != 0) return false;
         }
-        gridPos = getGridCoord(g_playerPosX, newZ);
-        if (gridPos.x >= 0 && gridPos.x < g_gridWidth && gridPos.y >= 0 && gridPos.y < g_gridHeight && g_maze[gridPos.y][gridPos.x] == PATH) {
-            g_playerPosZ = newZ;
+        else if (type == "IDAT") {
+            zlib.insert(zlib.end(), body, body + length);
         }
+        pos += 12 + length;
+    }
 
-        float ang = std::atan2(moveDir.x, moveDir.z);
-        g_playerAngleY = glm::degrees(ang);
+    std::vector<unsigned char> raw;
+    size_t zpos = 2;
+    bool last = false;
+    while (!last && zpos + 5 <= zlib.size()) {
+        last = (zlib[zpos] & 1) != 0;
+        if ((zlib[zpos] & 0x06) != 0) return false;   // 압축된 블록은 지원하지 않음
+        size_t blockSize = zlib[zpos + 1] | (zlib[zpos + 2] << 8);
+        zpos += 5;
+        if (zpos + blockSize > zlib.size()) return false;
+        raw.insert(raw.end(), zlib.begin() + zpos, zlib.begin() + zpos + blockSize);
+        zpos += blockSize;
+    }
 
+    const size_t stride = static_cast<size_t>(image.width) * 3;
+    if (raw.size() != (stride + 1) * image.height) return false;
+    image.rgb.resize(stride * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        if (raw[y * (stride + 1)] != 0) return false;
+        std::memcpy(&image.rgb[y * stride], &raw[y * (stride + 1) + 1], stride);
     }
+    return true;
+}
 
-    glm::ivec2 playerGrid = getGridCoord(g_playerPosX, g_playerPosZ);
-    if (playerGrid.y >= 0 && playerGrid.y < g_gridHeight &&
-        playerGrid.x >= 0 && playerGrid.x < g_gridWidth) {
+bool readImage(const std::string& path, Image& image) {
+    return endsWith(path, ".ppm") ? readPPM(path, image) : readPNG(path, image);
+}
 
-        if (g_maze[playerGrid.y][playerGrid.x] == PATH && g_pellets[playerGrid.y][playerGrid.x]) {
-            g_pellets[playerGrid.y][playerGrid.x] = false;
+struct ImageDiff {
+    int maxChannelDiff = 0;
+    double mismatchRatio = 1.0;   // 허용 오차를 넘는 픽셀 비율
+};
 
-            g_remainingPellets--;
-            g_score += 10;
+ImageDiff compareImages(const Image& a, const Image& b, int tolerance) {
+    ImageDiff diff;
+    if (a.width != b.width || a.height != b.height || a.rgb.size() != b.rgb.size()) return diff;
 
-            if (g_remainingPellets <= 0) {
-                goToGameClear();
-            }
+    size_t mismatched = 0;
+    const size_t pixelCount = static_cast<size_t>(a.width) * a.height;
+    for (size_t i = 0; i < pixelCount; ++i) {
+        int worst = 0;
+        for (int c = 0; c < 3; ++c) {
+            worst = std::max(worst, std::abs(int(a.rgb[i * 3 + c]) - int(b.rgb[i * 3 + c])));
         }
+        diff.maxChannelDiff = std::max(diff.maxChannelDiff, worst);
+        if (worst > tolerance) mismatched++;
+    }
+    diff.mismatchRatio = pixelCount > 0 ? double(mismatched) / pixelCount : 0.0;
+    return diff;
+}
 
-        if (g_maze[playerGrid.y][playerGrid.x] == PATH && g_slowItems[playerGrid.y][playerGrid.x]) {
-            g_slowItems[playerGrid.y][playerGrid.x] = false;
-            g_ghostSlowActive = true;
-            g_ghostSlowTimer = GHOST_SLOW_DURATION;
-            g_ghostSpeedScale = GHOST_SLOW_SCALE;
-        }
+// PBO 링 비동기 리드백: glReadPixels는 PBO로 복사 명령만 넣고 바로 돌아오며,
+// 몇 프레임 뒤 펜스가 끝난 슬롯만 맵해서 읽는다. 렌더 스레드가 GPU를 기다리지 않게 하는 것이 목적.
+const int READBACK_RING_SIZE = 3;
+
+struct PixelReadback {
+    int width = 0;
+    int height = 0;
+    int next = 0;
+    GLuint pbo[READBACK_RING_SIZE] = {};
+    GLsync fence[READBACK_RING_SIZE] = {};
+    int frame[READBACK_RING_SIZE] = { -1, -1, -1 };   // -1 = 빈 슬롯
+};
+
+void readbackInit(PixelReadback& rb, int width, int height) {
+    rb.width = width;
+    rb.height = height;
+    glGenBuffers(READBACK_RING_SIZE, rb.pbo);
+    for (int i = 0; i < READBACK_RING_SIZE; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4, nullptr, GL_STREAM_READ);
+        rb.frame[i] = -1;
+        rb.fence[i] = 0;
     }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 }
 
-void updateGhosts(float deltaTime) {
-    const float turnThreshold = 0.05f;
+void readbackDestroy(PixelReadback& rb) {
+    for (int i = 0; i < READBACK_RING_SIZE; ++i) {
+        if (rb.fence[i]) glDeleteSync(rb.fence[i]);
+        rb.fence[i] = 0;
+        rb.frame[i] = -1;
+    }
+    glDeleteBuffers(READBACK_RING_SIZE, rb.pbo);
+}
 
-    auto isInside = [](int x, int z) {
-        return x >= 0 && x < g_gridWidth && z >= 0 && z < g_gridHeight;
-    };
+// 슬롯 하나를 회수. wait가 false면 GPU 복사가 아직 안 끝났을 때 그냥 돌아온다.
+// sink(frameIndex, rgba, width, height)에 넘기는 픽셀은 아래 줄부터다.
+template <typename Sink>
+bool readbackCollectSlot(PixelReadback& rb, int slot, bool wait, Sink& sink) {
+    if (rb.frame[slot] < 0) return false;
+
+    GLenum status = glClientWaitSync(rb.fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+        wait ? 1000000000ull : 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo[slot]);
+    const GLsizeiptr size = static_cast<GLsizeiptr>(rb.width) * rb.height * 4;
+    const unsigned char* pixels = static_cast<const unsigned char*>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+    if (pixels) {
+        sink(rb.frame[slot], pixels, rb.width, rb.height);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-    auto findNearestPath = [&](int gridX, int gridZ) {
-        int maxRadius = std::max(g_gridWidth, g_gridHeight);
-        for (int radius = 0; radius <= maxRadius; ++radius) {
-            for (int dz = -radius; dz <= radius; ++dz) {
-                for (int dx = -radius; dx <= radius; ++dx) {
-                    int nx = gridX + dx;
-                    int nz = gridZ + dz;
-                    if (!isInside(nx, nz)) continue;
-                    if (g_maze[nz][nx] == PATH) {
-                        return glm::ivec2(nx, nz);
-                    }
-                }
-            }
-        }
-        return glm::ivec2(gridX, gridZ);
-    };
+    glDeleteSync(rb.fence[slot]);
+    rb.fence[slot] = 0;
+    rb.frame[slot] = -1;
+    return true;
+}
 
-    for (Ghost& ghost : g_ghosts) {
-        glm::ivec2 grid = getGridCoord(ghost.x, ghost.z);
-        if (!isInside(grid.x, grid.y) || g_maze[grid.y][grid.x] == WALL) {
-            glm::ivec2 nearest = findNearestPath(grid.x, grid.y);
-            glm::vec3 nearestPos = getWorldPos(nearest.x, nearest.y);
-            ghost.x = nearestPos.x;
-            ghost.z = nearestPos.z;
-            grid = nearest;
-        }
+// 끝난 슬롯을 모두 회수 (wait이면 남은 복사가 끝날 때까지 기다림)
+template <typename Sink>
+void readbackCollect(PixelReadback& rb, bool wait, Sink& sink) {
+    // 요청 순서대로 회수해야 프레임 순서가 유지된다
+    for (int i = 0; i < READBACK_RING_SIZE; ++i) {
+        int slot = (rb.next + i) % READBACK_RING_SIZE;
+        if (rb.frame[slot] < 0) continue;
+        if (!readbackCollectSlot(rb, slot, wait, sink)) break;
+    }
+}
 
-        glm::vec3 cellCenter = getWorldPos(grid.x, grid.y);
-        glm::vec2 ghostPos2D(ghost.x, ghost.z);
-        glm::vec2 playerPos2D(g_playerPosX, g_playerPosZ);
-        bool canTurn = glm::length(ghostPos2D - glm::vec2(cellCenter.x, cellCenter.z)) < turnThreshold;
-
-        if (canTurn) {
-            struct Candidate {
-                int dx;
-                int dz;
-                bool isReverse;
-                float distanceToPlayer;
-            };
-
-            std::vector<Candidate> candidates;
-            const int dirX[4] = { 1, -1, 0, 0 };
-            const int dirZ[4] = { 0, 0, 1, -1 };
-            for (int i = 0; i < 4; ++i) {
-                int nx = grid.x + dirX[i];
-                int nz = grid.y + dirZ[i];
-                if (!isInside(nx, nz) || g_maze[nz][nx] != PATH) continue;
-
-                glm::vec3 nextCenter = getWorldPos(nx, nz);
-                float distanceToPlayer = glm::length(glm::vec2(nextCenter.x, nextCenter.z) - playerPos2D);
-                bool isReverse = (dirX[i] == -ghost.dirX && dirZ[i] == -ghost.dirZ);
-
-                candidates.push_back({ dirX[i], dirZ[i], isReverse, distanceToPlayer });
-            }
-
-            if (!candidates.empty()) {
-                std::vector<Candidate> bestCandidates;
-
-                auto evaluateCandidates = [&](bool allowReverse) {
-                    float localBest = std::numeric_limits<float>::max();
-                    std::vector<Candidate> localCandidates;
-                    for (const Candidate& c : candidates) {
-                        if (!allowReverse && c.isReverse) continue;
-                        if (c.distanceToPlayer < localBest - 1e-4f) {
-                            localBest = c.distanceToPlayer;
-                            localCandidates.clear();
-                            localCandidates.push_back(c);
-                        }
-                        else if (std::abs(c.distanceToPlayer - localBest) < 1e-4f) {
-                            localCandidates.push_back(c);
-                        }
-                    }
-                    return std::make_pair(localBest, localCandidates);
-                };
+// 현재 READ 프레임버퍼의 복사를 예약. 링이 꽉 찼을 때 waitIfFull이면 가장 오래된 슬롯을 기다려 비우고,
+// 아니면 기다리지 않고 false를 돌려준다 (이번 프레임은 건너뜀).
+template <typename Sink>
+bool readbackRequest(PixelReadback& rb, int frameIndex, Sink& sink, bool waitIfFull) {
+    int slot = rb.next;
+    if (rb.frame[slot] >= 0 && !readbackCollectSlot(rb, slot, waitIfFull, sink)) {
+        return false;
+    }
 
-                auto nonReverseResult = evaluateCandidates(false);
-                if (!nonReverseResult.second.empty()) {
-                    bestCandidates = nonReverseResult.second;
-                }
-                else {
-                    auto anyResult = evaluateCandidates(true);
-                    bestCandidates = anyResult.second;
-                }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, rb.width, rb.height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-                if (!bestCandidates.empty()) {
-                    std::uniform_int_distribution<size_t> dist(0, bestCandidates.size() - 1);
-                    const Candidate& chosen = bestCandidates[dist(g_randomEngine)];
-                    ghost.dirX = chosen.dx;
-                    ghost.dirZ = chosen.dz;
-                }
-            }
-        }
+    rb.fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    rb.frame[slot] = frameIndex;
+    rb.next = (slot + 1) % READBACK_RING_SIZE;
+    return true;
+}
 
-        float moveSpeed = (ghost.speed > 0.0f ? ghost.speed : GHOST_MOVE_SPEED) * g_ghostSpeedScale;
-        ghost.x += ghost.dirX * moveSpeed * deltaTime;
-        ghost.z += ghost.dirZ * moveSpeed * deltaTime;
+bool readbackBusy(const PixelReadback& rb) {
+    for (int i = 0; i < READBACK_RING_SIZE; ++i) {
+        if (rb.frame[i] >= 0) return true;
+    }
+    return false;
+}
 
-        if (ghost.dirX != 0 || ghost.dirZ != 0) {
-            float angleRad = std::atan2(static_cast<float>(ghost.dirX), static_cast<float>(ghost.dirZ));
-            ghost.angleY = glm::degrees(angleRad);
+// 아래 줄부터인 RGBA 픽셀을 위쪽 줄부터인 RGB 이미지로
+void rgbaToImage(const unsigned char* rgba, int width, int height, Image& image) {
+    image.width = width;
+    image.height = height;
+    image.rgb.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* src = rgba + static_cast<size_t>(height - 1 - y) * width * 4;
+        unsigned char* dst = &image.rgb[static_cast<size_t>(y) * width * 3];
+        for (int x = 0; x < width; ++x) {
+            dst[x * 3 + 0] = src[x * 4 + 0];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
         }
+    }
+}
+
+// ---- 게임 화면 캡처 (P: 스크린샷, M: 연속 녹화 토글) ----
+// 렌더 스레드는 백버퍼를 PBO 링에 복사 예약만 하고, 몇 프레임 뒤 맵한 픽셀을 복사해서
+// 인코더 스레드에 넘긴다. PNG 인코딩과 파일 쓰기는 전부 인코더 스레드에서 한다.
+// 링이 아직 비지 않았거나 인코더가 밀려 있으면 기다리지 않고 녹화 프레임을 버린다.
+
+const int CAPTURE_FLAG_SCREENSHOT = 1;
+const int CAPTURE_FLAG_VIDEO = 2;
+const int CAPTURE_FLAG_BITS = 2;            // 리드백 슬롯 번호 = (프레임 번호 << 2) | 플래그
+const size_t CAPTURE_MAX_QUEUED = 8;        // 인코더 대기열 한도 (넘으면 녹화 프레임을 버림)
+
+enum class CaptureJobType { FRAME, VIDEO_BEGIN, VIDEO_END };
+
+struct CaptureJob {
+    CaptureJobType type = CaptureJobType::FRAME;
+    int flags = 0;
+    int width = 0;
+    int height = 0;
+    std::string path;                       // 스크린샷 파일 또는 녹화 파일
+    std::vector<unsigned char> rgba;        // 아래 줄부터
+};
+
+struct CaptureState {
+    PixelReadback readback;
+    bool readbackReady = false;
+    bool screenshotPending = false;
+    bool recording = false;
+    bool videoEndPending = false;
+    int frameCounter = 0;
+    int fileCounter = 0;
+
+    int videoWidth = 0;
+    int videoHeight = 0;
+    int videoFrames = 0;
+    int droppedFrames = 0;
+    std::string videoPath;
+    std::chrono::steady_clock::time_point videoStart;
+
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<CaptureJob> jobs;
+    std::vector<std::vector<unsigned char>> freeBuffers;   // 프레임 버퍼 재사용 풀
+    bool stopEncoder = false;
+};
+
+CaptureState g_capture;
 
-        float dx = ghost.x - g_playerPosX;
-        float dz = ghost.z - g_playerPosZ;
-        float dist2 = dx * dx + dz * dz;
-        const float collisionDistance = 0.4f;
+void captureEncoderLoop() {
+    std::ofstream video;
+    Image image;
+
+    for (;;) {
+        CaptureJob job;
+        {
+            std::unique_lock<std::mutex> lock(g_capture.mutex);
+            g_capture.wake.wait(lock, [] { return g_capture.stopEncoder || !g_capture.jobs.empty(); });
+            if (g_capture.jobs.empty()) break;
+            job = std::move(g_capture.jobs.front());
+            g_capture.jobs.pop_front();
+        }
 
-        if (dist2 < collisionDistance * collisionDistance) {
-            g_lives--;
-            if (g_lives <= 0) {
-                goToGameOver();
+        switch (job.type) {
+        case CaptureJobType::VIDEO_BEGIN:
+            video.open(job.path, std::ios::binary);
+            if (!video.is_open()) std::cerr << "[capture] cannot open " << job.path << std::endl;
+            break;
+        case CaptureJobType::VIDEO_END:
+            video.close();
+            break;
+        case CaptureJobType::FRAME:
+            rgbaToImage(job.rgba.data(), job.width, job.height, image);
+            if (job.flags & CAPTURE_FLAG_SCREENSHOT) {
+                if (writePNG(job.path, image)) std::cout << "[capture] saved " << job.path << std::endl;
+                else std::cerr << "[capture] failed to write " << job.path << std::endl;
             }
-            else {
-                reset();
-                g_gameState = GameState::PLAYING;
+            if ((job.flags & CAPTURE_FLAG_VIDEO) && video.is_open()) {
+                // 원시 RGB24 스트림 (위쪽 줄부터). 재생/변환은 녹화 종료 시 출력되는 ffmpeg 명령 참고
+                video.write(reinterpret_cast<const char*>(image.rgb.data()), image.rgb.size());
             }
-            return;
+            {
+                std::lock_guard<std::mutex> lock(g_capture.mutex);
+                g_capture.freeBuffers.push_back(std::move(job.rgba));
+            }
+            break;
         }
     }
 }
 
-void update(int value) {
-    int currentTime = glutGet(GLUT_ELAPSED_TIME);
-    float deltaTime = (currentTime - g_lastTime) / 1000.0f;
-    if (deltaTime < 0.001f) deltaTime = 0.001f;
-    g_lastTime = currentTime;
+void capturePushJob(CaptureJob&& job) {
+    {
+        std::lock_guard<std::mutex> lock(g_capture.mutex);
+        g_capture.jobs.push_back(std::move(job));
+    }
+    g_capture.wake.notify_one();
+}
 
-    if (g_ghostSlowActive) {
-        g_ghostSlowTimer -= deltaTime;
-        if (g_ghostSlowTimer <= 0.0f) {
-            g_ghostSlowActive = false;
-            g_ghostSlowTimer = 0.0f;
-            g_ghostSpeedScale = 1.0f;
-        }
+void captureEnsureEncoder() {
+    if (!g_capture.encoder.joinable()) {
+        g_capture.stopEncoder = false;
+        g_capture.encoder = std::thread(captureEncoderLoop);
     }
+}
 
-    if (g_gameState == GameState::PLAYING) {
-        handlePlayerInput(deltaTime);
-        updateGhosts(deltaTime);
+std::string captureNextFileName(const char* prefix, const char* extension) {
+    return std::string(prefix) + "_" + std::to_string(static_cast<long long>(std::time(0))) +
+        "_" + std::to_string(g_capture.fileCounter++) + extension;
+}
 
-        // 팩맨 입 애니메이션
-        g_pacmanMouthAngle += g_pacmanMouthDir * PACMAN_MOUTH_SPEED * deltaTime;
-        if (g_pacmanMouthAngle > PACMAN_MOUTH_MAX) {
-            g_pacmanMouthAngle = PACMAN_MOUTH_MAX;
-            g_pacmanMouthDir = -1.0f;
+// 리드백 슬롯에서 회수된 픽셀을 인코더에 넘긴다 (렌더 스레드)
+void captureSink(int slotId, const unsigned char* rgba, int width, int height) {
+    int flags = slotId & ((1 << CAPTURE_FLAG_BITS) - 1);
+
+    CaptureJob job;
+    job.type = CaptureJobType::FRAME;
+    job.width = width;
+    job.height = height;
+    {
+        std::lock_guard<std::mutex> lock(g_capture.mutex);
+        bool backlogged = g_capture.jobs.size() >= CAPTURE_MAX_QUEUED;
+        if ((flags & CAPTURE_FLAG_VIDEO) && backlogged) {
+            flags &= ~CAPTURE_FLAG_VIDEO;
+            g_capture.videoFrames--;
+            g_capture.droppedFrames++;
         }
-        else if (g_pacmanMouthAngle < 0.0f) {
-            g_pacmanMouthAngle = 0.0f;
-            g_pacmanMouthDir = 1.0f;
+        if (flags == 0) return;
+        if (!g_capture.freeBuffers.empty()) {
+            job.rgba = std::move(g_capture.freeBuffers.back());
+            g_capture.freeBuffers.pop_back();
         }
     }
+    job.flags = flags;
+    if (flags & CAPTURE_FLAG_SCREENSHOT) {
+        job.path = captureNextFileName("screenshot", ".png");
+    }
+    job.rgba.assign(rgba, rgba + static_cast<size_t>(width) * height * 4);
+    capturePushJob(std::move(job));
+}
 
-    glutPostRedisplay();
-    glutTimerFunc(16, update, 0);
+void requestScreenshot() {
+    captureEnsureEncoder();
+    g_capture.screenshotPending = true;
 }
 
-void keyboard(unsigned char key, int x, int y) {
-    g_keyStates[key] = true;
+void stopRecording() {
+    if (!g_capture.recording) return;
+    g_capture.recording = false;
+    g_capture.videoEndPending = true;   // 아직 링에 남은 녹화 프레임을 다 넘긴 뒤 스트림을 닫는다
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - g_capture.videoStart).count();
+    double fps = seconds > 0.0 ? g_capture.videoFrames / seconds : 0.0;
+    std::cout << "[capture] recording stopped: " << g_capture.videoPath << ", " << g_capture.videoFrames
+        << " frames (" << fps << " fps), " << g_capture.droppedFrames << " dropped\n"
+        << "[capture] ffmpeg -f rawvideo -pix_fmt rgb24 -s " << g_capture.videoWidth << "x" << g_capture.videoHeight
+        << " -r " << static_cast<int>(fps + 0.5) << " -i " << g_capture.videoPath << " capture.mp4" << std::endl;
+}
 
-    // 공통 종료 키
-    if (key == 'q' || key == 'Q') {
-        glutLeaveMainLoop();
+void toggleRecording() {
+    if (g_capture.recording) {
+        stopRecording();
         return;
     }
+    captureEnsureEncoder();
+    g_capture.recording = true;
+    g_capture.videoWidth = g_windowWidth;
+    g_capture.videoHeight = g_windowHeight;
+    g_capture.videoFrames = 0;
+    g_capture.droppedFrames = 0;
+    g_capture.videoPath = captureNextFileName("capture", ".rgb");
+    g_capture.videoStart = std::chrono::steady_clock::now();
+
+    CaptureJob begin;
+    begin.type = CaptureJobType::VIDEO_BEGIN;
+    begin.path = g_capture.videoPath;
+    capturePushJob(std::move(begin));
+    std::cout << "[capture] recording " << g_capture.videoWidth << "x" << g_capture.videoHeight
+        << " to " << g_capture.videoPath << std::endl;
+}
 
-    switch (g_gameState) {
-    case GameState::TITLE:
-        if (key == 13 || key == ' ') {
-            startNewGame();
-        }
-        break;
+// renderFrame() 직후, 스왑 전에 호출. 백버퍼 복사를 예약하고 끝난 슬롯을 회수한다.
+void captureAfterRender() {
+    bool busy = g_capture.readbackReady && readbackBusy(g_capture.readback);
+    if (!g_capture.screenshotPending && !g_capture.recording && !busy && !g_capture.videoEndPending) return;
 
-    case GameState::PLAYING:
-        if (key == 'k' || key == 'K') {
-            goToGameOver();
-        }
-        else if (key == 'v' || key == 'V') {
-            goToGameClear();
-        }
-        else {
-            switch (key) {
-            case 27:
-                glutLeaveMainLoop();
-                break;
-            case 'c': case 'C':
-                reset();
-                break;
-            }
-        }
-        break;
+    // 녹화 중 창 크기가 바뀌면 원시 스트림의 프레임 크기가 깨지므로 녹화를 끝낸다
+    if (g_capture.recording && (g_windowWidth != g_capture.videoWidth || g_windowHeight != g_capture.videoHeight)) {
+        stopRecording();
+    }
 
-    case GameState::GAME_OVER:
-        if (key == 'r' || key == 'R') {
-            startNewGame();
+    auto sink = [](int slotId, const unsigned char* rgba, int width, int height) {
+        captureSink(slotId, rgba, width, height);
+    };
+
+    if (g_capture.readbackReady &&
+        (g_capture.readback.width != g_windowWidth || g_capture.readback.height != g_windowHeight) && !busy) {
+        readbackDestroy(g_capture.readback);
+        g_capture.readbackReady = false;
+    }
+    if (!g_capture.readbackReady) {
+        readbackInit(g_capture.readback, g_windowWidth, g_windowHeight);
+        g_capture.readbackReady = true;
+    }
+
+    int flags = (g_capture.screenshotPending ? CAPTURE_FLAG_SCREENSHOT : 0) | (g_capture.recording ? CAPTURE_FLAG_VIDEO : 0);
+    bool sizeMatches = g_capture.readback.width == g_windowWidth && g_capture.readback.height == g_windowHeight;
+    if (flags != 0 && sizeMatches) {
+        int slotId = (g_capture.frameCounter++ << CAPTURE_FLAG_BITS) | flags;
+        glReadBuffer(GL_BACK);
+        if (readbackRequest(g_capture.readback, slotId, sink, false)) {
+            g_capture.screenshotPending = false;
+            if (flags & CAPTURE_FLAG_VIDEO) g_capture.videoFrames++;
         }
-        else if (key == 't' || key == 'T') {
-            goToTitle();
+        else if (g_capture.recording) {
+            g_capture.droppedFrames++;   // GPU 복사가 밀림: 기다리지 않고 이 프레임은 건너뜀
         }
-        break;
+    }
+    readbackCollect(g_capture.readback, false, sink);
 
-    case GameState::GAME_CLEAR:
-        if (key == 'n' || key == 'N') {
-            if (g_currentStage < MAX_STAGE) {
-                g_currentStage++;
-                reset();
-                g_gameState = GameState::PLAYING;
-            }
-        }
-        else if (key == 'r' || key == 'R') {
-            reset();
-            g_gameState = GameState::PLAYING;
+    if (g_capture.videoEndPending) {
+        bool videoInFlight = false;
+        for (int i = 0; i < READBACK_RING_SIZE; ++i) {
+            if (g_capture.readback.frame[i] >= 0 && (g_capture.readback.frame[i] & CAPTURE_FLAG_VIDEO)) videoInFlight = true;
         }
-        else if (key == 't' || key == 'T') {
-            goToTitle();
+        if (!videoInFlight) {
+            CaptureJob end;
+            end.type = CaptureJobType::VIDEO_END;
+            capturePushJob(std::move(end));
+            g_capture.videoEndPending = false;
         }
-        break;
     }
 }
 
-void keyboardUp(unsigned char key, int x, int y) {
-    g_keyStates[key] = false;
-    if (key >= 'a' && key <= 'z') {
-        g_keyStates[key - 32] = false;
+// 종료 직전(GL 컨텍스트가 살아 있을 때) 남은 리드백을 모두 회수
+void captureFlush() {
+    if (g_capture.recording) stopRecording();
+    if (!g_capture.readbackReady) return;
+
+    auto sink = [](int slotId, const unsigned char* rgba, int width, int height) {
+        captureSink(slotId, rgba, width, height);
+    };
+    readbackCollect(g_capture.readback, true, sink);
+    readbackDestroy(g_capture.readback);
+    g_capture.readbackReady = false;
+
+    if (g_capture.videoEndPending) {
+        CaptureJob end;
+        end.type = CaptureJobType::VIDEO_END;
+        capturePushJob(std::move(end));
+        g_capture.videoEndPending = false;
     }
-    else if (key >= 'A' && key <= 'Z') {
-        g_keyStates[key + 32] = false;
+}
+
+// 인코더 스레드가 대기열을 다 비우고 끝나기를 기다린다
+void captureShutdown() {
+    if (!g_capture.encoder.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(g_capture.mutex);
+        g_capture.stopEncoder = true;
     }
+    g_capture.wake.notify_one();
+    g_capture.encoder.join();
 }
 
-void specialKey(int key, int x, int y) {
-    if (key >= 0 && key < 128) {
-        g_specialKeyStates[key] = true;
+void display() {
+    renderFrame();
+    captureAfterRender();
+    glutSwapBuffers();
+}
+
+
+void reshape(int w, int h) {
+    g_windowWidth = w;
+    g_windowHeight = h;
+}
+
+// ---- 세이브 스테이트 (스냅샷 / 되감기) ----
+// 게임 진행 상태 전체(미로, 액터, 아이템, 점수, 슬로우 타이머, 난수 엔진)를 버전 있는 바이너리로 직렬화한다.
+// 격자 레이어(벽 / 펠릿 / 슬로우 아이템 / 파워 펠릿)는 칸당 1비트로 묶어서 25x25 스테이지도 수백 바이트면 된다.
+// 복원은 reset()처럼 월드를 새로 만들되 유령은 저장된 순서대로 만들어, 복원 뒤 진행이 원래와 같다.
+//
+// 레이아웃 (리틀 엔디언, 패딩 없음):
+//   "PMSS" u32 version
+//   u16 width, u16 height, i32 startX, i32 endX, i32 stage, i32 score, i32 lives, u8 gameState
+//   u8 slowActive, f32 slowTimer, f32 speedScale, i32 totalPellets, i32 remainingPellets, f64 simTime
+//   u8 ghostPhaseIndex, f32 ghostPhaseTimer, f32 frightenedTimer, u8 ghostEatCombo
+//   u8 playerCount, player: f32 x, z, angleY, i16 cellX, cellZ, f32 anim, animDir, yaw
+//   u16 ghostCount, ghost: f32 x, z, angleY, i16 cellX, cellZ, f32 speed, i8 dirX, dirZ, f32 r, g, b, u8 personality, corner, mode, f32 lodPending, u8 lodWait
+//   layer wall, layer pellet, layer slowItem, layer powerPellet: 각 ceil(width * height / 8) 바이트, 행 우선
+//   u16 rngWordCount, u32 rngWords[] (엔진 텍스트 표현의 숫자들)
+
+const char SAVE_STATE_MAGIC[4] = { 'P', 'M', 'S', 'S' };
+const uint32_t SAVE_STATE_VERSION = 5;   // 2: 유령 성격 / 흩어지기-쫓기 단계, 3: 파워 펠릿 / 겁먹음, 4: 여러 플레이어, 5: 유령 LOD
+const int SAVE_STATE_MAX_DIM = 4096;
+const char* QUICKSAVE_PATH = "quicksave.pmss";
+
+struct StateReader {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    bool ok = true;
+};
+
+template <typename T>
+T readStateValue(StateReader& r) {
+    T value{};
+    if (r.pos + sizeof(T) > r.size) {
+        r.ok = false;
+        return value;
     }
+    std::memcpy(&value, r.data + r.pos, sizeof(T));
+    r.pos += sizeof(T);
+    return value;
 }
 
-void specialKeyUp(int key, int x, int y) {
-    if (key >= 0 && key < 128) {
-        g_specialKeyStates[key] = false;
+// 칸마다 test(x, z)를 1비트로
+template <typename Test>
+void putGridLayer(std::vector<uint8_t>& out, Test test) {
+    size_t at = out.size();
+    int cells = g_gridWidth * g_gridHeight;
+    out.resize(at + (cells + 7) / 8, 0);
+    uint8_t* bits = out.data() + at;
+    for (int z = 0, i = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x, ++i) {
+            if (test(x, z)) bits[i >> 3] |= static_cast<uint8_t>(1u << (i & 7));
+        }
     }
 }
 
-void mouseMotion(int x, int y) {
-    (void)y;
-    if (g_lastMouseX < 0) {
-        g_lastMouseX = static_cast<float>(x);
-        return;
+const uint8_t* readGridLayer(StateReader& r, int width, int height) {
+    size_t bytes = (static_cast<size_t>(width) * height + 7) / 8;
+    if (r.pos + bytes > r.size) {
+        r.ok = false;
+        return nullptr;
     }
+    const uint8_t* bits = r.data + r.pos;
+    r.pos += bytes;
+    return bits;
+}
 
-    float dx = static_cast<float>(x) - g_lastMouseX;
-    g_lastMouseX = static_cast<float>(x);
+bool gridLayerBit(const uint8_t* bits, int index) {
+    return (bits[index >> 3] >> (index & 7)) & 1;
+}
 
-    g_cameraYaw += dx * g_mouseSensitivity;
+// mt19937의 내부 상태는 표준 텍스트 표현으로만 꺼낼 수 있으므로 그 숫자들을 u32로 저장
+void putRandomEngine(std::vector<uint8_t>& out, const std::mt19937& engine) {
+    std::stringstream text;
+    text << engine;
+    std::vector<uint32_t> words;
+    words.reserve(std::mt19937::state_size + 1);
+    unsigned long long word = 0;
+    while (text >> word) words.push_back(static_cast<uint32_t>(word));
+    putStateValue<uint16_t>(out, static_cast<uint16_t>(words.size()));
+    for (uint32_t w : words) putStateValue<uint32_t>(out, w);
 }
 
-int main(int argc, char** argv) {
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
-    glutInitWindowSize(g_windowWidth, g_windowHeight);
-    glutInitContextVersion(3, 3);
-    glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
-    glutCreateWindow("FreeGLUT Maze Project");
+bool readRandomEngine(StateReader& r, std::mt19937& engine) {
+    uint16_t count = readStateValue<uint16_t>(r);
+    if (!r.ok || r.pos + count * sizeof(uint32_t) > r.size) return r.ok = false;
+    std::stringstream text;
+    for (uint16_t i = 0; i < count; ++i) text << readStateValue<uint32_t>(r) << ' ';
+    std::mt19937 restored;
+    text >> restored;
+    if (text.fail()) return r.ok = false;
+    engine = restored;
+    return true;
+}
 
-    glutDisplayFunc(display);
-    glutReshapeFunc(reshape);
-    glutSetKeyRepeat(GLUT_KEY_REPEAT_OFF);
-    glutKeyboardFunc(keyboard);
-    glutKeyboardUpFunc(keyboardUp);
-    glutSpecialFunc(specialKey);
-    glutSpecialUpFunc(specialKeyUp);
-    glutPassiveMotionFunc(mouseMotion);
-    glutTimerFunc(16, update, 0);
+// out을 비우고 현재 상태를 쓴다. 되감기 링처럼 같은 버퍼를 재사용하면 할당이 없다.
+void saveGameState(std::vector<uint8_t>& out) {
+    out.clear();
+    out.insert(out.end(), SAVE_STATE_MAGIC, SAVE_STATE_MAGIC + 4);
+    putStateValue<uint32_t>(out, SAVE_STATE_VERSION);
+
+    putStateValue<uint16_t>(out, static_cast<uint16_t>(g_gridWidth));
+    putStateValue<uint16_t>(out, static_cast<uint16_t>(g_gridHeight));
+    putStateValue<int32_t>(out, g_mazeStartX);
+    putStateValue<int32_t>(out, g_mazeEndX);
+    putStateValue<int32_t>(out, g_currentStage);
+    putStateValue<int32_t>(out, g_score);
+    putStateValue<int32_t>(out, g_lives);
+    putStateValue<uint8_t>(out, static_cast<uint8_t>(g_gameState));
+
+    putStateValue<uint8_t>(out, g_ghostSlowActive ? 1 : 0);
+    putStateValue<float>(out, g_ghostSlowTimer);
+    putStateValue<float>(out, g_ghostSpeedScale);
+    putStateValue<int32_t>(out, g_totalPellets);
+    putStateValue<int32_t>(out, g_remainingPellets);
+    putStateValue<double>(out, g_simTime);
+    putStateValue<uint8_t>(out, static_cast<uint8_t>(g_ghostPhaseIndex));
+    putStateValue<float>(out, g_ghostPhaseTimer);
+    putStateValue<float>(out, g_frightenedTimer);
+    putStateValue<uint8_t>(out, static_cast<uint8_t>(std::min(g_ghostEatCombo, 255)));
+
+    putStateValue<uint8_t>(out, static_cast<uint8_t>(g_world.playerCount));
+    for (int p = 0; p < g_world.playerCount; ++p) {
+        const Transform& player = playerTransform(p);
+        const GridCell& playerCell = getComponent(g_world.cells, g_world.players[p]);
+        const Render& playerRender = getComponent(g_world.renders, g_world.players[p]);
+        putStateValue<float>(out, player.x);
+        putStateValue<float>(out, player.z);
+        putStateValue<float>(out, player.angleY);
+        putStateValue<int16_t>(out, static_cast<int16_t>(playerCell.x));
+        putStateValue<int16_t>(out, static_cast<int16_t>(playerCell.z));
+        putStateValue<float>(out, playerRender.anim);
+        putStateValue<float>(out, playerRender.animDir);
+        putStateValue<float>(out, g_playerYaw[p]);
+    }
+
+    putStateValue<uint16_t>(out, static_cast<uint16_t>(g_world.movements.data.size()));
+    for (size_t i = 0; i < g_world.movements.data.size(); ++i) {
+        Entity e = g_world.movements.owner[i];
+        const Movement& move = g_world.movements.data[i];
+        const Transform& t = getComponent(g_world.transforms, e);
+        const GridCell& cell = getComponent(g_world.cells, e);
+        const Render& render = getComponent(g_world.renders, e);
+        putStateValue<float>(out, t.x);
+        putStateValue<float>(out, t.z);
+        putStateValue<float>(out, t.angleY);
+        putStateValue<int16_t>(out, static_cast<int16_t>(cell.x));
+        putStateValue<int16_t>(out, static_cast<int16_t>(cell.z));
+        putStateValue<float>(out, move.speed);
+        putStateValue<int8_t>(out, static_cast<int8_t>(move.dirX));
+        putStateValue<int8_t>(out, static_cast<int8_t>(move.dirZ));
+        putStateValue<float>(out, render.color.x);
+        putStateValue<float>(out, render.color.y);
+        putStateValue<float>(out, render.color.z);
+        const GhostBrain& brain = getComponent(g_world.brains, e);
+        putStateValue<uint8_t>(out, static_cast<uint8_t>(brain.personality));
+        putStateValue<uint8_t>(out, brain.corner);
+        putStateValue<uint8_t>(out, static_cast<uint8_t>(brain.mode));
+        putStateValue<float>(out, move.lodPending);
+        putStateValue<uint8_t>(out, move.lodWait);
+    }
+
+    auto itemIs = [](int x, int z, CollectibleKind kind) {
+        Entity e = collectibleAt(x, z);
+        return e != INVALID_ENTITY && getComponent(g_world.collectibles, e).kind == kind;
+    };
+    putGridLayer(out, [](int x, int z) { return g_maze[z][x] == WALL; });
+    putGridLayer(out, [&](int x, int z) { return itemIs(x, z, CollectibleKind::PELLET); });
+    putGridLayer(out, [&](int x, int z) { return itemIs(x, z, CollectibleKind::SLOW_ITEM); });
+    putGridLayer(out, [&](int x, int z) { return itemIs(x, z, CollectibleKind::POWER_PELLET); });
+
+    putRandomEngine(out, g_randomEngine);
+}
 
-    init();
-    glutMainLoop();
+// 실패하면(형식/버전/크기가 안 맞으면) 현재 상태를 건드리지 않고 false
+bool restoreGameState(const uint8_t* data, size_t size) {
+    StateReader r;
+    r.data = data;
+    r.size = size;
+    if (size < 8 || std::memcmp(data, SAVE_STATE_MAGIC, 4) != 0) return false;
+    r.pos = 4;
+    if (readStateValue<uint32_t>(r) != SAVE_STATE_VERSION) return false;
+
+    int width = readStateValue<uint16_t>(r);
+    int height = readStateValue<uint16_t>(r);
+    if (!r.ok || width < 3 || height < 3 || width > SAVE_STATE_MAX_DIM || height > SAVE_STATE_MAX_DIM) return false;
+
+    // 뒤쪽(격자, 난수)까지 먼저 다 읽어서 검증한 다음에 적용한다
+    int32_t startX = readStateValue<int32_t>(r);
+    int32_t endX = readStateValue<int32_t>(r);
+    int32_t stage = readStateValue<int32_t>(r);
+    int32_t score = readStateValue<int32_t>(r);
+    int32_t lives = readStateValue<int32_t>(r);
+    uint8_t gameState = readStateValue<uint8_t>(r);
+    bool slowActive = readStateValue<uint8_t>(r) != 0;
+    float slowTimer = readStateValue<float>(r);
+    float speedScale = readStateValue<float>(r);
+    int32_t totalPellets = readStateValue<int32_t>(r);
+    int32_t remainingPellets = readStateValue<int32_t>(r);
+    double simTime = readStateValue<double>(r);
+    int phaseIndex = readStateValue<uint8_t>(r);
+    float phaseTimer = readStateValue<float>(r);
+    float frightenedTimer = readStateValue<float>(r);
+    int eatCombo = readStateValue<uint8_t>(r);
+
+    int playerCount = readStateValue<uint8_t>(r);
+    if (playerCount < 1 || playerCount > MAX_PLAYERS) return false;
+    Transform players[MAX_PLAYERS];
+    GridCell playerCells[MAX_PLAYERS];
+    float mouthAnim[MAX_PLAYERS], mouthDir[MAX_PLAYERS], yaws[MAX_PLAYERS];
+    for (int p = 0; p < playerCount; ++p) {
+        players[p].x = readStateValue<float>(r);
+        players[p].z = readStateValue<float>(r);
+        players[p].angleY = readStateValue<float>(r);
+        playerCells[p].x = readStateValue<int16_t>(r);
+        playerCells[p].z = readStateValue<int16_t>(r);
+        mouthAnim[p] = readStateValue<float>(r);
+        mouthDir[p] = readStateValue<float>(r);
+        yaws[p] = readStateValue<float>(r);
+    }
+
+    size_t ghostStart = 0;
+    int ghostCount = readStateValue<uint16_t>(r);
+    const size_t GHOST_BYTES = 3 * sizeof(float) + 2 * sizeof(int16_t) + sizeof(float) + 2 * sizeof(int8_t) + 3 * sizeof(float)
+        + 3 * sizeof(uint8_t) + sizeof(float) + sizeof(uint8_t);
+    if (r.ok && r.pos + ghostCount * GHOST_BYTES <= size) {
+        ghostStart = r.pos;
+        r.pos += ghostCount * GHOST_BYTES;
+    }
+    else {
+        r.ok = false;
+    }
+
+    const uint8_t* wallBits = readGridLayer(r, width, height);
+    const uint8_t* pelletBits = readGridLayer(r, width, height);
+    const uint8_t* slowBits = readGridLayer(r, width, height);
+    const uint8_t* powerBits = readGridLayer(r, width, height);
+    std::mt19937 engine;
+    if (!r.ok || !readRandomEngine(r, engine) || gameState > static_cast<uint8_t>(GameState::GAME_OVER) || stage > MAX_STAGE) return false;
+
+    g_gridWidth = width;
+    g_gridHeight = height;
+    g_mazeStartX = startX;
+    g_mazeEndX = endX;
+    g_currentStage = stage;
+    g_score = score;
+    g_lives = lives;
+    g_gameState = static_cast<GameState>(gameState);
+    g_ghostSlowActive = slowActive;
+    g_ghostSlowTimer = slowTimer;
+    g_ghostSpeedScale = std::isfinite(speedScale) ? std::min(std::max(speedScale, 0.0f), 1.0f) : 1.0f;
+    g_totalPellets = totalPellets;
+    g_remainingPellets = remainingPellets;
+    g_simTime = simTime;
+    g_ghostPhaseIndex = std::min(phaseIndex, GHOST_PHASE_COUNT);
+    g_ghostPhaseTimer = phaseTimer;
+    g_frightenedTimer = frightenedTimer;
+    g_ghostEatCombo = eatCombo;
+    g_randomEngine = engine;
+    closeTiledWorld(g_exploreWorld);
+    g_exploreActive = false;
+
+    g_maze.assign(height, std::vector<CellType>(width, PATH));
+    for (int z = 0, i = 0; z < height; ++z) {
+        for (int x = 0; x < width; ++x, ++i) {
+            g_maze[z][x] = gridLayerBit(wallBits, i) ? WALL : PATH;
+        }
+    }
+    g_mazeVersion++;
+
+    clearWorld();
+    g_world.collectibleAt.assign(width * height, INVALID_ENTITY);
+
+    for (int p = 0; p < playerCount; ++p) {
+        Entity e = spawnPlayer(playerCells[p].x, playerCells[p].z, p);
+        getComponent(g_world.transforms, e) = players[p];
+        Render& mouth = getComponent(g_world.renders, e);
+        mouth.anim = mouthAnim[p];
+        mouth.animDir = mouthDir[p];
+        g_playerYaw[p] = yaws[p];
+    }
+
+    r.pos = ghostStart;
+    for (int i = 0; i < ghostCount; ++i) {
+        Transform t;
+        GridCell cell;
+        t.x = readStateValue<float>(r);
+        t.z = readStateValue<float>(r);
+        t.angleY = readStateValue<float>(r);
+        cell.x = readStateValue<int16_t>(r);
+        cell.z = readStateValue<int16_t>(r);
+        float speed = readStateValue<float>(r);
+        int dirX = readStateValue<int8_t>(r);
+        int dirZ = readStateValue<int8_t>(r);
+        glm::vec3 color;
+        color.x = readStateValue<float>(r);
+        color.y = readStateValue<float>(r);
+        color.z = readStateValue<float>(r);
+        int personality = readStateValue<uint8_t>(r);
+        uint8_t corner = readStateValue<uint8_t>(r);
+        int mode = readStateValue<uint8_t>(r);
+        float lodPending = readStateValue<float>(r);
+        uint8_t lodWait = readStateValue<uint8_t>(r);
+        personality = std::min(personality, static_cast<int>(GhostPersonality::COUNT) - 1);
+        mode = std::min(mode, static_cast<int>(GhostMode::EATEN));
+
+        Entity e = spawnGhost(cell.x, cell.z, dirX, dirZ, static_cast<GhostPersonality>(personality), corner & 3);
+        getComponent(g_world.transforms, e) = t;
+        Movement& move = getComponent(g_world.movements, e);
+        // 시뮬레이션 LOD 간격이 이 값들로 정해지므로 깨진 파일이 안전 조건을 못 넘게 자른다
+        move.speed = std::isfinite(speed) ? std::min(std::max(speed, 0.0f), PLAYER_MOVE_SPEED) : 0.0f;
+        move.lodPending = std::isfinite(lodPending) ? std::min(std::max(lodPending, 0.0f), 1.0f) : 0.0f;
+        move.lodWait = static_cast<uint8_t>(std::min<int>(lodWait, (1 << (SIM_LOD_LEVELS - 1)) - 1));
+        getComponent(g_world.renders, e).color = color;
+        getComponent(g_world.brains, e).mode = static_cast<GhostMode>(mode);
+    }
+
+    for (int z = 0, i = 0; z < height; ++z) {
+        for (int x = 0; x < width; ++x, ++i) {
+            if (gridLayerBit(pelletBits, i)) spawnCollectible(x, z, CollectibleKind::PELLET);
+            else if (gridLayerBit(slowBits, i)) spawnCollectible(x, z, CollectibleKind::SLOW_ITEM);
+            else if (gridLayerBit(powerBits, i)) spawnCollectible(x, z, CollectibleKind::POWER_PELLET);
+        }
+    }
+    return true;
+}
+
+bool writeGameStateFile(const std::string& path, const std::vector<uint8_t>& state) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    file.write(reinterpret_cast<const char*>(state.data()), static_cast<std::streamsize>(state.size()));
+    return static_cast<bool>(file);
+}
+
+bool readGameStateFile(const std::string& path, std::vector<uint8_t>& state) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    state.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !state.empty();
+}
+
+bool loadGameStateFile(const std::string& path) {
+    std::vector<uint8_t> state;
+    if (!readGameStateFile(path, state) || !restoreGameState(state.data(), state.size())) {
+        std::cerr << "[state] failed to load " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 되감기: 플레이 중 REWIND_INTERVAL(시뮬레이션 시간)마다 스냅샷을 링에 남긴다. 버퍼는 재사용.
+// 탐험 스테이지는 칸이 타일 월드에 있어서 세이브 스테이트에 담기지 않으므로 남기지 않는다.
+const int REWIND_SLOTS = 20;
+const double REWIND_INTERVAL = 0.5;
+
+struct RewindBuffer {
+    std::vector<uint8_t> slots[REWIND_SLOTS];
+    int head = 0;                 // 다음에 쓸 슬롯
+    int count = 0;
+    double lastCapture = -1.0;
+    bool enabled = false;         // GLUT 게임에서만 켬 (봇 러너는 스냅샷 비용을 안 냄)
+};
+
+thread_local RewindBuffer g_rewind;
+thread_local std::vector<uint8_t> g_quickSave;
+
+void captureRewindPoint() {
+    RewindBuffer& rw = g_rewind;
+    if (!rw.enabled || g_gameState != GameState::PLAYING || g_exploreActive) return;
+    if (rw.lastCapture >= 0.0 && g_simTime - rw.lastCapture < REWIND_INTERVAL) return;
+    saveGameState(rw.slots[rw.head]);
+    rw.head = (rw.head + 1) % REWIND_SLOTS;
+    rw.count = std::min(rw.count + 1, REWIND_SLOTS);
+    rw.lastCapture = g_simTime;
+}
+
+// 가장 최근 지점으로 돌아가고 그 지점은 링에서 뺀다 (연달아 누르면 더 뒤로)
+bool rewindGameState() {
+    RewindBuffer& rw = g_rewind;
+    if (rw.count == 0) return false;
+    rw.head = (rw.head + REWIND_SLOTS - 1) % REWIND_SLOTS;
+    rw.count--;
+    const std::vector<uint8_t>& slot = rw.slots[rw.head];
+    if (!restoreGameState(slot.data(), slot.size())) return false;
+    rw.lastCapture = g_simTime;
+    return true;
+}
+
+// F5 = 빠른 저장(메모리 + quicksave.pmss), F9 = 빠른 불러오기, F6 = 되감기.
+// 입력 이벤트로 시뮬레이션 스텝 안에서 처리하므로 입력 기록/재생에도 그대로 남는다.
+void processStateCommand(int specialKey) {
+    auto t0 = std::chrono::steady_clock::now();
+    auto elapsedMs = [&]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    };
+
+    if (specialKey == GLUT_KEY_F5 && g_gameState == GameState::PLAYING && g_exploreActive) {
+        std::cout << "[state] the exploration stage cannot be saved (its cells live in the tiled world)\n";
+    }
+    else if (specialKey == GLUT_KEY_F5 && g_gameState == GameState::PLAYING) {
+        saveGameState(g_quickSave);
+        double ms = elapsedMs();
+        bool written = writeGameStateFile(QUICKSAVE_PATH, g_quickSave);
+        std::cout << "[state] saved " << g_quickSave.size() << " bytes in " << ms << " ms"
+            << (written ? "" : " (file write failed)") << "\n";
+    }
+    else if (specialKey == GLUT_KEY_F9) {
+        if (g_quickSave.empty()) readGameStateFile(QUICKSAVE_PATH, g_quickSave);
+        if (!g_quickSave.empty() && restoreGameState(g_quickSave.data(), g_quickSave.size())) {
+            std::cout << "[state] loaded " << g_quickSave.size() << " bytes in " << elapsedMs() << " ms\n";
+        }
+    }
+    else if (specialKey == GLUT_KEY_F6 && g_gameState == GameState::PLAYING) {
+        if (rewindGameState()) {
+            std::cout << "[state] rewound to t=" << g_simTime << " s (" << g_rewind.count << " points left)\n";
+        }
+    }
+}
+
+// ---- 입력 이벤트 큐 ----
+// GLUT 콜백은 상태를 직접 바꾸지 않고 시각이 찍힌 이벤트만 큐에 넣는다.
+// 시뮬레이션 스텝이 시작할 때 큐를 한꺼번에 비우면서 키 상태/명령/마우스 회전을 반영하므로
+// 입력이 움직임에 반영되기까지의 지연은 최대 한 스텝이다. 봇과 입력 재생도 같은 큐로 들어온다.
+
+enum class InputEventType : uint8_t {
+    KEY_DOWN,
+    KEY_UP,
+    SPECIAL_DOWN,
+    SPECIAL_UP,
+    YAW_DELTA        // 마우스 회전량(도). 감도는 넣을 때 이미 곱해져 있음
+};
+
+struct InputEvent {
+    int64_t timeUs = 0;     // 발생 시각 (steady_clock, 마이크로초)
+    InputEventType type = InputEventType::KEY_DOWN;
+    int code = 0;           // 키 코드
+    float value = 0.0f;     // YAW_DELTA의 회전량
+};
+
+// 생산자 하나 / 소비자 하나용 락프리 링 버퍼
+template <typename T, size_t Capacity>
+struct SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    std::atomic<size_t> head{ 0 };   // 소비자가 다음에 읽을 위치
+    std::atomic<size_t> tail{ 0 };   // 생산자가 다음에 쓸 위치
+    T items[Capacity];
+
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// 한 스텝(16ms) 동안 이만큼 쌓일 일은 없지만, 가득 차면 이벤트를 버리고 개수를 센다
+typedef SpscQueue<InputEvent, 1024> InputQueue;
+
+InputQueue g_inputQueue;                 // GLUT 콜백 -> 시뮬레이션
+std::atomic<int> g_inputDropped{ 0 };
+thread_local bool g_quitRequested = false;   // 시뮬레이션에서 처리한 종료 명령 (Esc)
+thread_local bool g_netClientActive = false;   // --connect: 게임 명령은 서버가 처리하므로 키는 이동 / 종료에만 쓴다
+
+// 큐에서 꺼낸 시점까지 이벤트가 기다린 시간 = 입력이 움직임에 반영되기까지의 지연
+struct InputLatencyStats {
+    long long count = 0;
+    double sumMs = 0.0;
+    double maxMs = 0.0;
+    int64_t frameOldestUs = 0;   // 마지막 렌더 스냅샷 이후 처리한 이벤트 중 가장 오래된 발생 시각 (0 = 없음)
+};
+
+thread_local InputLatencyStats g_inputLatency;
+
+int64_t inputNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void pushInputEvent(InputQueue& queue, InputEventType type, int code, float value) {
+    InputEvent ev;
+    ev.timeUs = inputNowUs();
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    if (!queue.push(ev)) {
+        g_inputDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// 입력 기록 파일: 헤더("PMIN", 버전, 시드) 뒤에 스텝별 이벤트와 스텝 끝 표시(deltaTime)가 이어진다.
+// 같은 시드로 시작해 같은 이벤트와 deltaTime을 넣으면 같은 게임이 재현된다.
+const char INPUT_RECORD_MAGIC[4] = { 'P', 'M', 'I', 'N' };
+const uint32_t INPUT_RECORD_VERSION = 1;
+const uint8_t INPUT_RECORD_STEP_END = 0xFF;
+
+struct InputRecord {
+    uint32_t step;
+    uint8_t type;        // InputEventType 또는 INPUT_RECORD_STEP_END
+    uint8_t pad[3];
+    int32_t code;
+    float value;         // YAW_DELTA의 회전량, 스텝 끝이면 deltaTime
+};
+
+struct InputRecorder {
+    std::ofstream file;
+    uint32_t step = 0;
+};
+
+InputRecorder g_inputRecorder;
+
+bool openInputRecorder(InputRecorder& recorder, const std::string& path, unsigned int seed) {
+    recorder.file.open(path, std::ios::binary);
+    if (!recorder.file) {
+        std::cerr << "[input] failed to open " << path << std::endl;
+        return false;
+    }
+    uint32_t header[2] = { INPUT_RECORD_VERSION, seed };
+    recorder.file.write(INPUT_RECORD_MAGIC, sizeof(INPUT_RECORD_MAGIC));
+    recorder.file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    recorder.step = 0;
+    return true;
+}
+
+void writeInputRecord(InputRecorder& recorder, uint8_t type, int code, float value) {
+    InputRecord record = {};
+    record.step = recorder.step;
+    record.type = type;
+    record.code = code;
+    record.value = value;
+    recorder.file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+}
+
+void recordInputStep(InputRecorder& recorder, float deltaTime) {
+    writeInputRecord(recorder, INPUT_RECORD_STEP_END, 0, deltaTime);
+    recorder.step++;
+}
+
+struct InputReplay {
+    std::ifstream file;
+    unsigned int seed = 0;
+    int steps = 0;
+};
+
+bool openInputReplay(InputReplay& replay, const std::string& path) {
+    replay.file.open(path, std::ios::binary);
+    char magic[4] = {};
+    uint32_t header[2] = {};
+    replay.file.read(magic, sizeof(magic));
+    replay.file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!replay.file || std::memcmp(magic, INPUT_RECORD_MAGIC, sizeof(magic)) != 0 || header[0] != INPUT_RECORD_VERSION) {
+        std::cerr << "[input] " << path << " is not an input recording" << std::endl;
+        return false;
+    }
+    replay.seed = header[1];
+    replay.steps = 0;
+    return true;
+}
+
+// 기록된 다음 스텝의 이벤트를 큐에 넣고 그 스텝의 deltaTime을 돌려준다. 기록이 끝나면 false.
+bool replayInputStep(InputReplay& replay, InputQueue& queue, float& deltaTime) {
+    InputRecord record;
+    while (replay.file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        if (record.type == INPUT_RECORD_STEP_END) {
+            deltaTime = record.value;
+            replay.steps++;
+            return true;
+        }
+        pushInputEvent(queue, static_cast<InputEventType>(record.type), record.code, record.value);
+    }
+    return false;
+}
+
+// 게임 상태에 따른 키 명령. 시뮬레이션 스텝 안에서 순서대로 처리된다.
+void processKeyCommand(unsigned char key) {
+    switch (g_gameState) {
+    case GameState::TITLE:
+        if (key == 13 || key == ' ') {
+            startNewGame();
+        }
+        break;
+
+    case GameState::PLAYING:
+        if (key == 'k' || key == 'K') {
+            goToGameOver();
+        }
+        else if (key == 'v' || key == 'V') {
+            goToGameClear();
+        }
+        else {
+            switch (key) {
+            case 27:
+                g_quitRequested = true;
+                break;
+            case 'c': case 'C':
+                reset();
+                break;
+            }
+        }
+        break;
+
+    case GameState::GAME_OVER:
+        if (key == 'r' || key == 'R') {
+            startNewGame();
+        }
+        else if (key == 't' || key == 'T') {
+            goToTitle();
+        }
+        break;
+
+    case GameState::GAME_CLEAR:
+        if (key == 'n' || key == 'N') {
+            if (g_currentStage < lastStage()) {
+                g_currentStage++;
+                reset();
+                g_gameState = GameState::PLAYING;
+            }
+        }
+        else if (key == 'r' || key == 'R') {
+            reset();
+            g_gameState = GameState::PLAYING;
+        }
+        else if (key == 't' || key == 'T') {
+            goToTitle();
+        }
+        break;
+    }
+}
+
+void applyInputEvent(const InputEvent& ev) {
+    switch (ev.type) {
+    case InputEventType::KEY_DOWN:
+        g_keyStates[ev.code & 0xFF] = true;
+        g_keyTapped[ev.code & 0xFF] = true;
+        if (!g_netClientActive) processKeyCommand(static_cast<unsigned char>(ev.code));
+        else if ((ev.code & 0xFF) == 27) g_quitRequested = true;
+        break;
+
+    case InputEventType::KEY_UP: {
+        int key = ev.code & 0xFF;
+        g_keyStates[key] = false;
+        if (key >= 'a' && key <= 'z') {
+            g_keyStates[key - 32] = false;
+        }
+        else if (key >= 'A' && key <= 'Z') {
+            g_keyStates[key + 32] = false;
+        }
+        break;
+    }
+
+    case InputEventType::SPECIAL_DOWN:
+        if (ev.code >= 0 && ev.code < 128) {
+            g_specialKeyStates[ev.code] = true;
+            g_specialKeyTapped[ev.code] = true;
+        }
+        if (!g_netClientActive) processStateCommand(ev.code);
+        break;
+
+    case InputEventType::SPECIAL_UP:
+        if (ev.code >= 0 && ev.code < 128) {
+            g_specialKeyStates[ev.code] = false;
+        }
+        break;
+
+    case InputEventType::YAW_DELTA:
+        // 스텝 사이에 들어온 마우스 이동은 여기서 모두 더해진다
+        g_playerYaw[0] += ev.value;
+        break;
+    }
+}
+
+// 스텝 시작 시 호출. 쌓인 이벤트를 발생 순서대로 반영하고 recorder가 있으면 기록한다.
+int drainInputEvents(InputQueue& queue, InputRecorder* recorder) {
+    for (int i = 0; i < 256; i++) g_keyTapped[i] = false;
+    for (int i = 0; i < 128; i++) g_specialKeyTapped[i] = false;
+
+    int64_t now = inputNowUs();
+    int count = 0;
+    InputEvent ev;
+    while (queue.pop(ev)) {
+        double latencyMs = (now - ev.timeUs) / 1000.0;
+        g_inputLatency.count++;
+        g_inputLatency.sumMs += latencyMs;
+        g_inputLatency.maxMs = std::max(g_inputLatency.maxMs, latencyMs);
+        if (g_inputLatency.frameOldestUs == 0 || ev.timeUs < g_inputLatency.frameOldestUs) {
+            g_inputLatency.frameOldestUs = ev.timeUs;
+        }
+
+        applyInputEvent(ev);
+        if (recorder) writeInputRecord(*recorder, static_cast<uint8_t>(ev.type), ev.code, ev.value);
+        count++;
+    }
+    return count;
+}
+
+void printInputStats() {
+    const InputLatencyStats& stats = g_inputLatency;
+    std::cout << "[input] " << stats.count << " events, latency avg "
+        << (stats.count > 0 ? stats.sumMs / stats.count : 0.0) << " ms, max " << stats.maxMs << " ms, dropped "
+        << g_inputDropped.load() << "\n";
+}
+
+// handlePlayerInput이 소비하는 이동 입력. 키보드와 봇이 같은 형식으로 만든다.
+struct PlayerInput {
+    bool forward = false;
+    bool back = false;
+    bool left = false;
+    bool right = false;
+    float yaw = 0.0f;   // 이동 기준이 되는 카메라 yaw(도)
+    float turn = 0.0f;  // 마우스가 없는 플레이어의 제자리 회전 (-1 = 왼쪽, +1 = 오른쪽)
+};
+
+// 누르고 있거나 이번 스텝 사이에 눌렸던 키 (스텝 사이의 짧은 탭도 놓치지 않게)
+bool isKeyActive(unsigned char key) {
+    return g_keyStates[key] || g_keyTapped[key];
+}
+
+bool isSpecialKeyActive(int key) {
+    return g_specialKeyStates[key] || g_specialKeyTapped[key];
+}
+
+// 2인 이상이면 1P는 WASD + 마우스, 2P 방향키, 3P TFGH, 4P 숫자패드 8456.
+// 마우스가 없는 2P~4P는 좌우 키로 카메라째 돌고(탱크 조작) 앞뒤 키로 움직인다
+PlayerInput readKeyboardInput(int player = 0) {
+    PlayerInput input;
+    input.yaw = g_playerYaw[player];
+    if (player == 0) {
+        bool arrows = g_playerCount == 1;
+        input.forward = (arrows && isSpecialKeyActive(GLUT_KEY_UP)) || isKeyActive('w') || isKeyActive('W');
+        input.back = (arrows && isSpecialKeyActive(GLUT_KEY_DOWN)) || isKeyActive('s') || isKeyActive('S');
+        input.left = (arrows && isSpecialKeyActive(GLUT_KEY_LEFT)) || isKeyActive('a') || isKeyActive('A');
+        input.right = (arrows && isSpecialKeyActive(GLUT_KEY_RIGHT)) || isKeyActive('d') || isKeyActive('D');
+        return input;
+    }
+
+    bool left = false;
+    bool right = false;
+    if (player == 1) {
+        input.forward = isSpecialKeyActive(GLUT_KEY_UP);
+        input.back = isSpecialKeyActive(GLUT_KEY_DOWN);
+        left = isSpecialKeyActive(GLUT_KEY_LEFT);
+        right = isSpecialKeyActive(GLUT_KEY_RIGHT);
+    }
+    else {
+        static const unsigned char KEYS[2][4] = { { 't', 'g', 'f', 'h' }, { '8', '5', '4', '6' } };
+        const unsigned char* keys = KEYS[player - 2];
+        input.forward = isKeyActive(keys[0]);
+        input.back = isKeyActive(keys[1]);
+        left = isKeyActive(keys[2]);
+        right = isKeyActive(keys[3]);
+    }
+    input.turn = (right ? 1.0f : 0.0f) - (left ? 1.0f : 0.0f);
+    return input;
+}
+
+// ---- 갈림길 그래프 ----
+// 미로를 갈림길 / 막다른 길(노드)과 그 사이 통로(가중치 = 칸 수인 간선)로 줄인 그래프.
+// 통로는 꺾여도 한 간선이다 (되돌아가지 않으면 갈 곳이 하나뿐이라서). 길 칸마다 자기 간선과 간선 안 위치를
+// 기억하므로 유령은 노드에 도착했을 때만 방향을 고르고, 통로 칸에서는 나가는 방향 비트만 보고 그대로 간다.
+// 거리 필드도 이 그래프에서 다익스트라로 구한 뒤 칸에 펼친다. 미로(g_mazeVersion)마다 한 번 만든다.
+
+const int JUNCTION_DIR_X[4] = { 1, -1, 0, 0 };
+const int JUNCTION_DIR_Z[4] = { 0, 0, 1, -1 };
+
+inline int junctionReverseDir(int dir) {
+    return dir ^ 1;   // +x <-> -x, +z <-> -z
+}
+
+inline int junctionDirIndex(int dx, int dz) {
+    if (dx > 0) return 0;
+    if (dx < 0) return 1;
+    if (dz > 0) return 2;
+    if (dz < 0) return 3;
+    return -1;
+}
+
+struct JunctionEdge {
+    int from;
+    int to;
+    int length;            // from 노드에서 to 노드까지 걸음 수 (= 통로 칸 수 + 1)
+    int firstCell;         // JunctionGraph::edgeCells 안에서 통로 칸들이 시작하는 위치 (from 쪽부터)
+    uint8_t fromDir;       // from 노드에서 이 간선으로 나가는 방향
+    uint8_t toDir;         // to 노드에서 이 간선으로 나가는 방향
+};
+
+struct JunctionGraph {
+    int mazeVersion = -1;
+    int width = 0;
+    std::vector<uint8_t> exits;          // 칸 -> 열린 이웃 방향 비트 (JUNCTION_DIR 순서)
+    std::vector<int> nodeOfCell;         // 칸 -> 노드 번호 (-1 = 노드 아님)
+    std::vector<int> edgeOfCell;         // 통로 칸 -> 간선 번호 (-1 = 통로 아님)
+    std::vector<int> offsetOfCell;       // 통로 칸 -> 간선의 from 노드로부터 걸음 수 (1 ~ length - 1)
+    std::vector<int> nodeCells;          // 노드 -> 칸 인덱스
+    std::vector<int> nodeEdges;          // 노드 * 4 + 방향 -> 간선 번호 (-1 = 막힘)
+    std::vector<JunctionEdge> edges;
+    std::vector<int> edgeCells;          // 간선마다 통로 칸 인덱스를 from 쪽부터 이어 붙임
+
+    // 다익스트라 작업 버퍼 (재사용)
+    std::vector<int> nodeDist;
+    std::vector<std::pair<int, int>> heap;   // (-거리, 노드): std::push_heap은 최대 힙이라 부호를 뒤집음
+};
+
+thread_local JunctionGraph g_junctions;
+
+inline bool isJunctionNode(uint8_t exits) {
+    int count = (exits & 1) + ((exits >> 1) & 1) + ((exits >> 2) & 1) + ((exits >> 3) & 1);
+    return count != 2;
+}
+
+void buildJunctionGraph(JunctionGraph& g) {
+    const int cellCount = g_gridWidth * g_gridHeight;
+    g.width = g_gridWidth;
+    g.exits.assign(cellCount, 0);
+    g.nodeOfCell.assign(cellCount, -1);
+    g.edgeOfCell.assign(cellCount, -1);
+    g.offsetOfCell.assign(cellCount, 0);
+    g.nodeCells.clear();
+    g.nodeEdges.clear();
+    g.edges.clear();
+    g.edgeCells.clear();
+
+    for (int z = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x) {
+            if (!isPathCell(x, z)) continue;
+            uint8_t mask = 0;
+            for (int d = 0; d < 4; ++d) {
+                if (isPathCell(x + JUNCTION_DIR_X[d], z + JUNCTION_DIR_Z[d])) mask |= static_cast<uint8_t>(1 << d);
+            }
+            int idx = z * g_gridWidth + x;
+            g.exits[idx] = mask;
+            if (isJunctionNode(mask)) {
+                g.nodeOfCell[idx] = static_cast<int>(g.nodeCells.size());
+                g.nodeCells.push_back(idx);
+            }
+        }
+    }
+
+    auto addNode = [&](int idx) {
+        g.nodeOfCell[idx] = static_cast<int>(g.nodeCells.size());
+        g.nodeCells.push_back(idx);
+        g.nodeEdges.insert(g.nodeEdges.end(), 4, -1);
+    };
+    g.nodeEdges.assign(g.nodeCells.size() * 4, -1);
+
+    // 노드에서 아직 간선이 없는 방향마다 다음 노드까지 통로를 따라간다
+    auto walkEdges = [&](int node) {
+        for (int dir = 0; dir < 4; ++dir) {
+            int start = g.nodeCells[node];
+            if (!(g.exits[start] & (1 << dir)) || g.nodeEdges[node * 4 + dir] >= 0) continue;
+
+            JunctionEdge edge;
+            edge.from = node;
+            edge.fromDir = static_cast<uint8_t>(dir);
+            edge.firstCell = static_cast<int>(g.edgeCells.size());
+            int edgeIndex = static_cast<int>(g.edges.size());
+
+            int cell = start;
+            int heading = dir;
+            int steps = 0;
+            for (;;) {
+                cell += JUNCTION_DIR_X[heading] + JUNCTION_DIR_Z[heading] * g_gridWidth;
+                steps++;
+                if (g.nodeOfCell[cell] >= 0) break;
+                g.edgeOfCell[cell] = edgeIndex;
+                g.offsetOfCell[cell] = steps;
+                g.edgeCells.push_back(cell);
+                // 통로 칸: 들어온 방향이 아닌 남은 한쪽으로
+                heading = highestBit(g.exits[cell] & ~(1u << junctionReverseDir(heading)));
+            }
+            edge.to = g.nodeOfCell[cell];
+            edge.toDir = static_cast<uint8_t>(junctionReverseDir(heading));
+            edge.length = steps;
+            g.nodeEdges[node * 4 + dir] = edgeIndex;
+            g.nodeEdges[edge.to * 4 + edge.toDir] = edgeIndex;
+            g.edges.push_back(edge);
+        }
+    };
+
+    for (size_t node = 0; node < g.nodeCells.size(); ++node) walkEdges(static_cast<int>(node));
+
+    // 갈림길도 막다른 길도 없는 닫힌 고리는 어느 노드에서도 닿지 않으므로 칸 하나를 노드로 삼는다
+    for (int cell = 0; cell < cellCount; ++cell) {
+        if (g.exits[cell] == 0 || g.nodeOfCell[cell] >= 0 || g.edgeOfCell[cell] >= 0) continue;
+        addNode(cell);
+        walkEdges(g.nodeOfCell[cell]);
+    }
+    g.mazeVersion = g_mazeVersion;
+}
+
+const JunctionGraph& junctionGraph() {
+    if (g_junctions.mazeVersion != g_mazeVersion || g_junctions.width != g_gridWidth) buildJunctionGraph(g_junctions);
+    return g_junctions;
+}
+
+// 통로 칸에서 되돌아가지 않고 갈 수 있는 유일한 방향. 노드이거나 지금 방향으로는 정할 수 없으면 -1
+int junctionCorridorDir(const JunctionGraph& g, int cell, int dirX, int dirZ) {
+    if (g.edgeOfCell[cell] < 0) return -1;
+    int dir = junctionDirIndex(dirX, dirZ);
+    if (dir < 0) return -1;
+    unsigned forward = g.exits[cell] & ~(1u << junctionReverseDir(dir));
+    if (forward == 0 || (forward & (forward - 1)) != 0) return -1;
+    return highestBit(forward);
+}
+
+// ---- 파워 펠릿 / 겁먹은 유령 ----
+// 파워 펠릿을 먹으면 유령이 GHOST_FRIGHTENED_DURATION 동안 겁먹고 플레이어에게서 멀어지는 쪽으로 달아난다.
+// 겁먹은 유령을 잡으면 200, 400, 800, 1600점(아케이드 콤보)이고, 잡힌 유령은 집 칸까지 돌아가서 되살아난다.
+// 방향은 유령마다 길을 찾지 않고 모든 유령이 같이 쓰는 거리 필드 두 장의 기울기를 따른다:
+//   flee: 플레이어 칸까지의 거리. 플레이어가 다른 칸으로 옮겼고 누군가 겁먹었을 때만 다시 계산
+//   home: 집 칸까지의 거리. 벽은 안 바뀌므로 미로(g_mazeVersion)마다 한 번
+// 그래서 유령이 몇 마리든 비용은 플레이어가 칸을 옮길 때 갈림길 그래프 탐색 한 번이다.
+
+const int FIELD_UNREACHED = std::numeric_limits<int>::max();
+
+struct GhostFields {
+    std::vector<int> flee[MAX_PLAYERS];   // 플레이어마다 따로 (번갈아 다시 계산하지 않게)
+    std::vector<int> home;
+    int fleeSource[MAX_PLAYERS] = { -1, -1, -1, -1 };   // flee를 계산한 플레이어 칸 인덱스
+    int fleeMazeVersion[MAX_PLAYERS] = { -1, -1, -1, -1 };
+    int homeMazeVersion = -1;
+    glm::ivec2 homeCell = glm::ivec2(1, 1);
+};
+
+thread_local GhostFields g_ghostFields;
+
+// source 칸까지의 칸 거리 (칸 BFS와 같은 값). 갈림길 그래프에서 다익스트라로 노드 거리만 구한 뒤
+// 통로 칸은 양 끝 노드 거리 + 간선 안 위치로 채운다. source가 길이 아니면 전부 FIELD_UNREACHED
+void computeDistanceField(std::vector<int>& dist, glm::ivec2 source) {
+    junctionGraph();
+    JunctionGraph& g = g_junctions;
+    dist.assign(g_gridWidth * g_gridHeight, FIELD_UNREACHED);
+    if (!isPathCell(source.x, source.y)) return;
+
+    g.nodeDist.assign(g.nodeCells.size(), FIELD_UNREACHED);
+    g.heap.clear();
+    auto relax = [&](int node, int d) {
+        if (d >= g.nodeDist[node]) return;
+        g.nodeDist[node] = d;
+        g.heap.push_back(std::make_pair(-d, node));
+        std::push_heap(g.heap.begin(), g.heap.end());
+    };
+
+    int sourceIdx = source.y * g_gridWidth + source.x;
+    int sourceEdge = g.edgeOfCell[sourceIdx];
+    int sourceOffset = g.offsetOfCell[sourceIdx];
+    if (sourceEdge < 0) {
+        relax(g.nodeOfCell[sourceIdx], 0);
+    }
+    else {
+        const JunctionEdge& e = g.edges[sourceEdge];
+        relax(e.from, sourceOffset);
+        relax(e.to, e.length - sourceOffset);
+    }
+
+    while (!g.heap.empty()) {
+        std::pop_heap(g.heap.begin(), g.heap.end());
+        int d = -g.heap.back().first;
+        int node = g.heap.back().second;
+        g.heap.pop_back();
+        if (d > g.nodeDist[node]) continue;
+        for (int dir = 0; dir < 4; ++dir) {
+            int edgeIndex = g.nodeEdges[node * 4 + dir];
+            if (edgeIndex < 0) continue;
+            const JunctionEdge& e = g.edges[edgeIndex];
+            int other = (e.from == node && e.fromDir == dir) ? e.to : e.from;
+            relax(other, d + e.length);
+        }
+    }
+
+    for (size_t node = 0; node < g.nodeCells.size(); ++node) dist[g.nodeCells[node]] = g.nodeDist[node];
+    for (size_t edgeIndex = 0; edgeIndex < g.edges.size(); ++edgeIndex) {
+        const JunctionEdge& e = g.edges[edgeIndex];
+        int fromDist = g.nodeDist[e.from];
+        int toDist = g.nodeDist[e.to];
+        for (int offset = 1; offset < e.length; ++offset) {
+            int d = FIELD_UNREACHED;
+            if (fromDist != FIELD_UNREACHED) d = fromDist + offset;
+            if (toDist != FIELD_UNREACHED) d = std::min(d, toDist + e.length - offset);
+            if (static_cast<int>(edgeIndex) == sourceEdge) d = std::min(d, std::abs(offset - sourceOffset));
+            dist[g.edgeCells[e.firstCell + offset - 1]] = d;
+        }
+    }
+}
+
+// 집 칸 = 미로 가운데에서 가장 가까운 길 칸
+glm::ivec2 findGhostHomeCell() {
+    return nearestPathCell(g_gridWidth / 2, g_gridHeight / 2);
+}
+
+const std::vector<int>& ghostHomeField() {
+    GhostFields& f = g_ghostFields;
+    if (f.homeMazeVersion != g_mazeVersion) {
+        f.homeCell = findGhostHomeCell();
+        computeDistanceField(f.home, f.homeCell);
+        f.homeMazeVersion = g_mazeVersion;
+    }
+    return f.home;
+}
+
+glm::ivec2 ghostHomeCell() {
+    ghostHomeField();
+    return g_ghostFields.homeCell;
+}
+
+const std::vector<int>& ghostFleeField(glm::ivec2 playerCell, int player = 0) {
+    GhostFields& f = g_ghostFields;
+    int source = playerCell.y * g_gridWidth + playerCell.x;
+    if (f.fleeMazeVersion[player] != g_mazeVersion || f.fleeSource[player] != source) {
+        computeDistanceField(f.flee[player], playerCell);
+        f.fleeSource[player] = source;
+        f.fleeMazeVersion[player] = g_mazeVersion;
+    }
+    return f.flee[player];
+}
+
+// 필드 기울기를 따라 한 칸: ascend면 값이 커지는 쪽(도망), 아니면 작아지는 쪽(귀가). 동점이면 무작위
+void followDistanceField(Movement& ghost, const std::vector<int>& field, glm::ivec2 grid, bool ascend, bool allowReverse) {
+    const int dirX[4] = { 1, -1, 0, 0 };
+    const int dirZ[4] = { 0, 0, 1, -1 };
+    int best[4];
+    int bestCount = 0;
+    int bestValue = 0;
+
+    for (int pass = 0; pass < 2 && bestCount == 0; ++pass) {
+        // 첫 번째는 되돌아가기 빼고, 막다른 길이면 두 번째에 허용
+        bool reverseOk = allowReverse || pass == 1;
+        for (int i = 0; i < 4; ++i) {
+            int nx = grid.x + dirX[i];
+            int nz = grid.y + dirZ[i];
+            if (!isPathCell(nx, nz)) continue;
+            if (!reverseOk && dirX[i] == -ghost.dirX && dirZ[i] == -ghost.dirZ) continue;
+
+            int value = field[nz * g_gridWidth + nx];
+            if (!ascend) value = (value == FIELD_UNREACHED) ? -FIELD_UNREACHED : -value;
+            if (bestCount == 0 || value > bestValue) {
+                bestValue = value;
+                bestCount = 0;
+            }
+            if (value == bestValue) best[bestCount++] = i;
+        }
+    }
+
+    if (bestCount == 0) return;
+    std::uniform_int_distribution<int> pick(0, bestCount - 1);
+    int chosen = best[pick(g_randomEngine)];
+    ghost.dirX = dirX[chosen];
+    ghost.dirZ = dirZ[chosen];
+}
+
+// 잡힌 유령이 아닌 모든 유령을 겁먹게 하고 방향을 뒤집는다. 콤보는 펠릿마다 새로 시작
+void frightenGhosts() {
+    g_frightenedTimer = GHOST_FRIGHTENED_DURATION;
+    g_ghostEatCombo = 0;
+    for (size_t i = 0; i < g_world.movements.data.size(); ++i) {
+        GhostBrain& brain = getComponent(g_world.brains, g_world.movements.owner[i]);
+        if (brain.mode == GhostMode::EATEN) continue;
+        brain.mode = GhostMode::FRIGHTENED;
+        Movement& move = g_world.movements.data[i];
+        move.dirX = -move.dirX;
+        move.dirZ = -move.dirZ;
+    }
+}
+
+void updateFrightenedTimer(float deltaTime) {
+    if (g_frightenedTimer <= 0.0f) return;
+    g_frightenedTimer -= deltaTime;
+    if (g_frightenedTimer > 0.0f) return;
+    g_frightenedTimer = 0.0f;
+    for (GhostBrain& brain : g_world.brains.data) {
+        if (brain.mode == GhostMode::FRIGHTENED) brain.mode = GhostMode::NORMAL;
+    }
+}
+
+glm::vec3 ghostModeColor(const GhostBrain& brain) {
+    switch (brain.mode) {
+    case GhostMode::FRIGHTENED:
+        // 끝나갈 때 0.2초 간격으로 흰색과 번갈아
+        if (g_frightenedTimer < GHOST_FRIGHTENED_FLASH && std::fmod(g_frightenedTimer, 0.4f) < 0.2f) {
+            return glm::vec3(0.9f, 0.9f, 1.0f);
+        }
+        return glm::vec3(0.15f, 0.2f, 0.9f);
+    case GhostMode::EATEN:
+        return glm::vec3(0.15f, 0.15f, 0.25f);
+    default:
+        return GHOST_COLORS[static_cast<int>(brain.personality)];
+    }
+}
+
+void eatGhost(GhostBrain& brain, const Transform& ghost) {
+    brain.mode = GhostMode::EATEN;
+    g_score += GHOST_EAT_BASE_SCORE << std::min(g_ghostEatCombo, GHOST_EAT_MAX_COMBO);
+    g_ghostEatCombo++;
+    countMetric(MC_GHOSTS_EATEN);
+    emitParticles(ParticleType::SLOW_BURST, glm::vec3(ghost.x, FLOOR_SCALE * CUBE_SIZE * 0.5f + GHOST_HEIGHT * 0.5f, ghost.z),
+        glm::vec3(0.15f, 0.2f, 0.9f), 120);
+}
+
+// 칸 -> 아이템 색인으로 바로 찾으므로 아이템 배열이나 격자를 훑지 않는다
+void collectItemsAt(int x, int z) {
+    if (!isPathCell(x, z)) return;
+
+    // 탐험 스테이지는 타일 월드 칸 코드가 원본이다. 먹은 칸은 타일에 적어서 창을 옮겼다 돌아와도 비어 있다
+    if (g_exploreActive) {
+        if (exploreCell(x, z) < TILE_PELLET) return;
+        setTiledCell(g_exploreWorld, g_exploreOriginX + x, g_exploreOriginZ + z, TILE_PATH);
+    }
+    Entity e = collectibleAt(x, z);
+    if (e == INVALID_ENTITY) return;
+    Collectible item = getComponent(g_world.collectibles, e);
+    glm::vec3 itemColor = getComponent(g_world.renders, e).color;
+    removeCollectibleAt(x, z);
+
+    glm::vec3 effectPos = getWorldPos(x, z);
+    effectPos.y = FLOOR_SCALE * CUBE_SIZE * 0.5f + 0.1f;
+
+    switch (item.kind) {
+    case CollectibleKind::PELLET:
+        emitParticles(ParticleType::PELLET_BURST, effectPos, itemColor);
+        countMetric(MC_PELLETS_EATEN);
+        g_remainingPellets--;
+        g_score += item.score;
+
+        if (g_remainingPellets <= 0) {
+            goToGameClear();
+        }
+        break;
+
+    case CollectibleKind::POWER_PELLET:
+        emitParticles(ParticleType::SLOW_BURST, effectPos, itemColor, 160);
+        countMetric(MC_PELLETS_EATEN);
+        g_remainingPellets--;
+        g_score += item.score;
+        frightenGhosts();
+
+        if (g_remainingPellets <= 0) {
+            goToGameClear();
+        }
+        break;
+
+    case CollectibleKind::SLOW_ITEM:
+        emitParticles(ParticleType::SLOW_BURST, effectPos, itemColor);
+        g_ghostSlowActive = true;
+        g_ghostSlowTimer = GHOST_SLOW_DURATION;
+        g_ghostSpeedScale = GHOST_SLOW_SCALE;
+        break;
+    }
+}
+
+// 벽에 막힐 때 경계에서 이만큼 떨어져 멈춘다 (경계 위에 서서 칸 판정이 흔들리지 않게)
+const float SWEEP_SKIN = 1e-3f;
+
+// from -> to 로 스윕 이동한 결과 좌표. 막힌 칸 직전에서 멈추고 지나간 칸의 아이템은 모두 먹는다.
+glm::vec2 sweepPlayerMove(glm::vec2 from, glm::vec2 to) {
+    float t = sweepGrid(from.x, from.y, to.x, to.y, [](int x, int z) {
+        if (!isPathCell(x, z)) return false;
+        collectItemsAt(x, z);
+        return true;
+    });
+    if (t >= 1.0f) return to;
+
+    float len = glm::length(to - from);
+    if (len <= 0.0f) return from;
+    float travel = std::max(0.0f, t * len - SWEEP_SKIN);
+    return from + (to - from) * (travel / len);
+}
+
+void handlePlayerInput(const PlayerInput& input, int index, float deltaTime) {
+    glm::vec3 moveVector(0.0f, 0.0f, 0.0f);
+
+    float yaw = input.yaw;
+    if (input.turn != 0.0f) {
+        yaw += input.turn * PLAYER_TURN_SPEED * deltaTime;
+        g_playerYaw[index] = yaw;
+    }
+    float yawRad = glm::radians(yaw);
+    glm::vec3 camForward(sin(yawRad), 0.0f, cos(yawRad));
+    glm::vec3 camRight = glm::normalize(glm::cross(camForward, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    glm::vec3 camForwardDir = glm::normalize(camForward);
+    glm::vec3 camRightDir   = glm::normalize(camRight);
+
+    if (input.forward) moveVector += camForwardDir;
+    if (input.back)    moveVector -= camForwardDir;
+    if (input.left)    moveVector -= camRightDir;
+    if (input.right)   moveVector += camRightDir;
+
+    if (glm::length(moveVector) > 0.0f) {
+        glm::vec3 moveDir = glm::normalize(moveVector);
+        moveVector = moveDir * PLAYER_MOVE_SPEED * deltaTime;
+
+        // 축별로 스윕 (벽을 따라 미끄러지는 기존 동작 유지). 지나가는 칸을 모두 검사하므로
+        // 프레임이 끊겨 deltaTime이 커져도 한 칸 두께의 벽을 뚫지 않는다.
+        Transform& player = playerTransform(index);
+        glm::vec2 pos(player.x, player.z);
+        pos = sweepPlayerMove(pos, glm::vec2(pos.x + moveVector.x, pos.y));
+        pos = sweepPlayerMove(pos, glm::vec2(pos.x, pos.y + moveVector.z));
+        player.x = pos.x;
+        player.z = pos.y;
+
+        float ang = std::atan2(moveDir.x, moveDir.z);
+        player.angleY = glm::degrees(ang);
+
+    }
+
+    const Transform& player = playerTransform(index);
+    glm::ivec2 playerGrid = getGridCoord(player.x, player.z);
+    getComponent(g_world.cells, g_world.players[index]) = GridCell{ playerGrid.x, playerGrid.y };
+    collectItemsAt(playerGrid.x, playerGrid.y);
+}
+
+// ---- 유령 행동 프로그램 ----
+// 성격마다 (명령, 인자) 2바이트 단위의 짧은 바이트코드가 있고, 유령이 칸 중심에 설 때마다 실행해서
+// 목표 칸을 정한다. 방향 결정은 모든 성격이 같다: 목표에 가장 가까워지는 이웃 칸 (되돌아가기는 다른 길이
+// 없을 때만, 동점이면 무작위). 유령마다 저장하는 건 프로그램 번호와 구석 번호뿐이라 수백 마리여도
+// 틱당 비용은 유령 수에 비례하고 할당이 없다. 새 성격은 표에 프로그램 한 줄을 추가하면 된다.
+
+enum GhostOp : uint8_t {
+    GOP_END,              // 지금 목표로 방향 결정
+    GOP_TARGET_PLAYER,    // 목표 = 플레이어 칸
+    GOP_AHEAD,            // 목표 += 플레이어 진행 방향 * 인자 칸
+    GOP_TARGET_CORNER,    // 목표 = 이 유령의 구석
+    GOP_WANDER,           // 목표 없이 갈림길마다 무작위
+    GOP_JUMP_IF_SCATTER,  // 흩어지기 단계면 인자 위치(명령 번호)로
+    GOP_JUMP_IF_NEAR,     // 플레이어가 nearCells 칸 이내면 인자 위치로
+};
+
+const int GHOST_PROGRAM_MAX = 8;   // 프로그램당 최대 명령 수
+
+struct GhostProgram {
+    const char* name;
+    int nearCells;                          // GOP_JUMP_IF_NEAR 거리
+    uint8_t code[GHOST_PROGRAM_MAX][2];
+};
+
+// GhostPersonality 순서
+const GhostProgram GHOST_PROGRAMS[] = {
+    // 추격: 플레이어 칸을 곧장 노림
+    { "chaser", 0, { { GOP_JUMP_IF_SCATTER, 3 }, { GOP_TARGET_PLAYER, 0 }, { GOP_END, 0 },
+                  { GOP_TARGET_CORNER, 0 }, { GOP_END, 0 } } },
+    // 매복: 플레이어가 가는 방향 4칸 앞을 노림
+    { "ambusher", 0, { { GOP_JUMP_IF_SCATTER, 4 }, { GOP_TARGET_PLAYER, 0 }, { GOP_AHEAD, 4 }, { GOP_END, 0 },
+                    { GOP_TARGET_CORNER, 0 }, { GOP_END, 0 } } },
+    // 순찰: 멀면 쫓아가고 4칸 안으로 들어오면 자기 구석으로 물러남
+    { "patrol", 4, { { GOP_JUMP_IF_SCATTER, 4 }, { GOP_JUMP_IF_NEAR, 4 }, { GOP_TARGET_PLAYER, 0 }, { GOP_END, 0 },
+                     { GOP_TARGET_CORNER, 0 }, { GOP_END, 0 } } },
+    // 배회: 단계와 상관없이 무작위
+    { "wanderer", 0, { { GOP_WANDER, 0 }, { GOP_END, 0 } } },
+};
+
+// 틱마다 한 번 계산해서 모든 유령이 같이 쓰는 값
+struct GhostContext {
+    int player;                  // 이 유령이 노리는 (가장 가까운) 플레이어
+    glm::ivec2 playerCell;
+    glm::ivec2 playerHeading;    // 플레이어가 바라보는 축 방향 (칸 단위)
+    bool scatter;
+};
+
+bool ghostScatterPhase() {
+    return g_ghostPhaseIndex < GHOST_PHASE_COUNT && (g_ghostPhaseIndex % 2) == 0;
+}
+
+// 단계가 바뀌면 모든 유령이 방향을 뒤집는다 (아케이드처럼 단계 전환이 눈에 보이게).
+// 겁먹음 모드 동안은 단계 시간이 멈춘다
+void updateGhostPhase(float deltaTime) {
+    if (g_ghostPhaseIndex >= GHOST_PHASE_COUNT || g_frightenedTimer > 0.0f) return;
+    g_ghostPhaseTimer += deltaTime;
+    if (g_ghostPhaseTimer < GHOST_PHASE_SECONDS[g_ghostPhaseIndex]) return;
+    g_ghostPhaseTimer = 0.0f;
+    g_ghostPhaseIndex++;
+    for (size_t i = 0; i < g_world.movements.data.size(); ++i) {
+        if (getComponent(g_world.brains, g_world.movements.owner[i]).mode == GhostMode::EATEN) continue;
+        Movement& move = g_world.movements.data[i];
+        move.dirX = -move.dirX;
+        move.dirZ = -move.dirZ;
+    }
+}
+
+glm::ivec2 ghostCornerCell(uint8_t corner) {
+    int x = (corner & 1) ? g_gridWidth - 2 : 1;
+    int z = (corner & 2) ? g_gridHeight - 2 : 1;
+    return glm::ivec2(x, z);
+}
+
+// 칸 중심에 선 유령의 다음 방향
+void chooseGhostDirection(Movement& ghost, const GhostBrain& brain, glm::ivec2 grid, const GhostContext& ctx) {
+    if (brain.mode == GhostMode::FRIGHTENED) {
+        followDistanceField(ghost, ghostFleeField(ctx.playerCell, ctx.player), grid, true, false);
+        return;
+    }
+    if (brain.mode == GhostMode::EATEN) {
+        followDistanceField(ghost, ghostHomeField(), grid, false, true);
+        return;
+    }
+
+    const GhostProgram& program = GHOST_PROGRAMS[static_cast<int>(brain.personality)];
+    glm::ivec2 target = ctx.playerCell;
+    bool wander = false;
+
+    for (int pc = 0, executed = 0; pc < GHOST_PROGRAM_MAX && executed < GHOST_PROGRAM_MAX; ++executed) {
+        uint8_t op = program.code[pc][0];
+        uint8_t arg = program.code[pc][1];
+        if (op == GOP_END) break;
+        pc++;
+        switch (op) {
+        case GOP_TARGET_PLAYER: target = ctx.playerCell; break;
+        case GOP_AHEAD: target += ctx.playerHeading * static_cast<int>(arg); break;
+        case GOP_TARGET_CORNER: target = ghostCornerCell(brain.corner); break;
+        case GOP_WANDER: wander = true; break;
+        case GOP_JUMP_IF_SCATTER:
+            if (ctx.scatter) pc = arg;
+            break;
+        case GOP_JUMP_IF_NEAR: {
+            glm::ivec2 d = grid - ctx.playerCell;
+            if (d.x * d.x + d.y * d.y <= program.nearCells * program.nearCells) pc = arg;
+            break;
+        }
+        }
+    }
+
+    struct Candidate {
+        int dx;
+        int dz;
+        bool isReverse;
+        int distance;    // 목표까지 칸 거리 제곱 (배회면 0)
+    };
+
+    Candidate candidates[4];
+    int candidateCount = 0;
+    const int dirX[4] = { 1, -1, 0, 0 };
+    const int dirZ[4] = { 0, 0, 1, -1 };
+    for (int i = 0; i < 4; ++i) {
+        int nx = grid.x + dirX[i];
+        int nz = grid.y + dirZ[i];
+        if (!isPathCell(nx, nz)) continue;
+
+        int ddx = nx - target.x;
+        int ddz = nz - target.y;
+        bool isReverse = (dirX[i] == -ghost.dirX && dirZ[i] == -ghost.dirZ);
+        candidates[candidateCount++] = { dirX[i], dirZ[i], isReverse, wander ? 0 : ddx * ddx + ddz * ddz };
+    }
+
+    if (candidateCount == 0) return;
+
+    Candidate bestCandidates[4];
+    int bestCount = 0;
+
+    auto evaluateCandidates = [&](bool allowReverse) {
+        int localBest = std::numeric_limits<int>::max();
+        bestCount = 0;
+        for (int i = 0; i < candidateCount; ++i) {
+            const Candidate& c = candidates[i];
+            if (!allowReverse && c.isReverse) continue;
+            if (c.distance < localBest) {
+                localBest = c.distance;
+                bestCount = 0;
+                bestCandidates[bestCount++] = c;
+            }
+            else if (c.distance == localBest) {
+                bestCandidates[bestCount++] = c;
+            }
+        }
+    };
+
+    evaluateCandidates(false);
+    if (bestCount == 0) {
+        evaluateCandidates(true);
+    }
+
+    if (bestCount > 0) {
+        std::uniform_int_distribution<int> dist(0, bestCount - 1);
+        const Candidate& chosen = bestCandidates[dist(g_randomEngine)];
+        ghost.dirX = chosen.dx;
+        ghost.dirZ = chosen.dz;
+    }
+}
+
+// 점 p와 선분 ab 사이의 거리
+float distanceToSegment(glm::vec2 p, glm::vec2 a, glm::vec2 b) {
+    glm::vec2 ab = b - a;
+    float len2 = glm::dot(ab, ab);
+    float t = (len2 > 0.0f) ? glm::clamp(glm::dot(p - a, ab) / len2, 0.0f, 1.0f) : 0.0f;
+    return glm::length(p - (a + ab * t));
+}
+
+// ---- 유령 시뮬레이션 LOD ----
+// 큰 미로에서 플레이어와 먼 유령은 미니맵에만 보이므로 매 틱 움직일 필요가 없다. 가장 가까운 플레이어에서
+// g_simLodFullCells 칸 안은 매 틱, 그 두 배 / 네 배 / 더 먼 고리는 2 / 4 / 8틱에 한 번 갱신한다.
+// 건너뛴 틱의 시간은 Movement::lodPending에 모았다가 다음 갱신에 한 번에 적분한다. 유령 이동은 스윕이라
+// (칸 중심마다 방향을 정함) deltaTime이 길어도 길을 벗어나거나 갈림길을 놓치지 않는다.
+// 고리로 정한 간격은 안전 조건으로 줄인다: 다음 갱신까지 유령과 플레이어가 최고 속도로 마주 달려도 충돌 거리에
+// 닿지 못해야 한다. 그래서 플레이어에 닿을 수 있는 유령은 그 전에 반드시 매 틱으로 올라온다.
+// 단계 전환 / 겁먹음 / 느려짐처럼 모든 유령을 바꾸는 일이 이번 틱에 일어날 수 있으면, 먼저 밀린 유령을
+// 따라잡게 해서(flush) 밀린 시간은 바뀌기 전 규칙으로 보낸다.
+
+const float GHOST_COLLISION_DISTANCE = 0.4f;
+bool g_simLodEnabled = true;               // --no-sim-lod로 끔 (비교용)
+int g_simLodFullCells = 8;                 // 이 칸 수 안은 매 틱
+
+struct SimLodStats {
+    long long updates[SIM_LOD_LEVELS] = {};   // 유령 갱신 수 (갱신 뒤 정한 등급별)
+    long long deferred = 0;                   // 건너뛴 유령-틱
+    long long flushes = 0;                    // 전역 상태가 바뀌기 전에 따라잡게 한 횟수
+    long long unsafeDeferrals = 0;            // 건너뛰는 동안 플레이어에 닿았을 수도 있는 유령-틱 (0이어야 함)
+};
+
+thread_local SimLodStats g_simLodStats;
+
+// 틱마다 한 번 만드는 플레이어 쪽 값. 유령은 가장 가까운 플레이어의 컨텍스트를 쓴다
+struct GhostFrame {
+    int playerCount = 0;
+    GhostContext contexts[MAX_PLAYERS];
+    glm::vec2 playerPos2D[MAX_PLAYERS];
+};
+
+void buildGhostFrame(GhostFrame& frame) {
+    frame.playerCount = g_world.playerCount;
+    bool scatter = ghostScatterPhase();
+    for (int p = 0; p < frame.playerCount; ++p) {
+        const Transform& player = playerTransform(p);
+        frame.playerPos2D[p] = glm::vec2(player.x, player.z);
+        GhostContext& ctx = frame.contexts[p];
+        ctx.player = p;
+        ctx.playerCell = getGridCoord(player.x, player.z);
+        float headingRad = glm::radians(player.angleY);
+        float headingX = std::sin(headingRad);
+        float headingZ = std::cos(headingRad);
+        ctx.playerHeading = (std::abs(headingX) > std::abs(headingZ))
+            ? glm::ivec2(headingX > 0.0f ? 1 : -1, 0)
+            : glm::ivec2(0, headingZ > 0.0f ? 1 : -1);
+        ctx.scatter = scatter;
+    }
+}
+
+// 갱신을 마친 유령이 다음에 갱신될 때까지 건너뛸 틱 수를 정한다
+void scheduleGhostLod(Movement& move, const Transform& ghost, const GhostFrame& frame, float deltaTime) {
+    int level = 0;
+    if (g_simLodEnabled && deltaTime > 0.0f && frame.playerCount > 0) {
+        float nearest2 = std::numeric_limits<float>::max();
+        for (int p = 0; p < frame.playerCount; ++p) {
+            glm::vec2 d = frame.playerPos2D[p] - glm::vec2(ghost.x, ghost.z);
+            nearest2 = std::min(nearest2, glm::dot(d, d));
+        }
+        float nearest = std::sqrt(nearest2);
+        float ring = g_simLodFullCells * (CUBE_SIZE + GRID_SPACING);
+        while (level + 1 < SIM_LOD_LEVELS && nearest >= ring * (1 << level)) level++;
+
+        // 어느 모드로 바뀌어도 낼 수 있는 가장 빠른 속도로 곧장 온다고 보고, 틱 길이가 흔들릴 여유로 한 틱을 더한다
+        float closingSpeed = ghostTopSpeed(move) + PLAYER_MOVE_SPEED;
+        while (level > 0 && nearest - GHOST_COLLISION_DISTANCE <= closingSpeed * deltaTime * ((1 << level) + 1)) level--;
+    }
+    move.lodWait = static_cast<uint8_t>((1 << level) - 1);
+    g_simLodStats.updates[level]++;
+}
+
+// 유령 하나를 deltaTime만큼 움직이고 AI, 플레이어와의 충돌까지 처리한다.
+// 잡혀서 reset()했으면 false (월드를 새로 만들었으므로 호출한 쪽은 바로 멈춰야 함)
+bool stepGhost(size_t i, float deltaTime, const GhostFrame& frame, const JunctionGraph& graph) {
+    const float turnThreshold = 0.05f;
+    const float unitSize = CUBE_SIZE + GRID_SPACING;
+    const float collisionDistance = GHOST_COLLISION_DISTANCE;
+    const int playerCount = frame.playerCount;
+    const glm::vec2* playerPos2D = frame.playerPos2D;
+
+    Movement& move = g_world.movements.data[i];
+    Entity e = g_world.movements.owner[i];
+    Transform& ghost = getComponent(g_world.transforms, e);
+    GhostBrain& brain = getComponent(g_world.brains, e);
+
+    glm::ivec2 grid = getGridCoord(ghost.x, ghost.z);
+    if (!isPathCell(grid.x, grid.y)) {
+        glm::ivec2 nearest = nearestPathCell(grid.x, grid.y);
+        glm::vec3 nearestPos = getWorldPos(nearest.x, nearest.y);
+        ghost.x = nearestPos.x;
+        ghost.z = nearestPos.z;
+        grid = nearest;
+    }
+
+    int target = 0;
+    float targetDist2 = std::numeric_limits<float>::max();
+    for (int p = 0; p < playerCount; ++p) {
+        glm::vec2 d = playerPos2D[p] - glm::vec2(ghost.x, ghost.z);
+        float d2 = glm::dot(d, d);
+        if (d2 < targetDist2) {
+            targetDist2 = d2;
+            target = p;
+        }
+    }
+    const GhostContext& ctx = frame.contexts[target];
+
+    // 스윕 이동: 칸 중심에 닿을 때마다 그 자리에서 방향을 정하고 남은 거리만큼 계속 간다.
+    // 한 틱에 여러 칸을 가도 turnThreshold 구간을 건너뛰어 갈림길을 놓치지 않는다.
+    float moveSpeed = ghostBaseSpeed(move);
+    if (brain.mode == GhostMode::EATEN) moveSpeed *= GHOST_EATEN_SCALE;
+    else if (brain.mode == GhostMode::FRIGHTENED) moveSpeed *= GHOST_FRIGHTENED_SCALE * g_ghostSpeedScale;
+    else moveSpeed *= g_ghostSpeedScale;
+    float remaining = moveSpeed * deltaTime;
+    int maxSteps = static_cast<int>(remaining / unitSize) + 3;
+    bool caught = false;
+
+    for (int step = 0; step < maxSteps && remaining > 0.0f; ++step) {
+        grid = getGridCoord(ghost.x, ghost.z);
+        glm::vec3 cellCenter = getWorldPos(grid.x, grid.y);
+        glm::vec2 offset(ghost.x - cellCenter.x, ghost.z - cellCenter.z);
+        float along = offset.x * move.dirX + offset.y * move.dirZ;   // 진행 방향 기준 중심으로부터의 위치
+
+        float distToNext;
+        if (along <= 0.0f && glm::length(offset) < turnThreshold) {
+            // 중심에 도착(또는 아직 지나치지 않음): 중심에 맞추고 방향 결정
+            ghost.x = cellCenter.x;
+            ghost.z = cellCenter.z;
+            if (brain.mode == GhostMode::EATEN && grid == ghostHomeCell()) {
+                brain.mode = GhostMode::NORMAL;   // 집에 도착하면 되살아남
+            }
+            // 통로 칸은 갈 곳이 하나뿐이라 고르지 않는다. 잡힌 유령은 집 쪽으로 돌아설 수 있어야 해서 제외
+            int corridorDir = (brain.mode == GhostMode::EATEN) ? -1
+                : junctionCorridorDir(graph, grid.y * g_gridWidth + grid.x, move.dirX, move.dirZ);
+            if (corridorDir >= 0) {
+                move.dirX = JUNCTION_DIR_X[corridorDir];
+                move.dirZ = JUNCTION_DIR_Z[corridorDir];
+            }
+            else {
+                chooseGhostDirection(move, brain, grid, ctx);
+            }
+            if (!isPathCell(grid.x + move.dirX, grid.y + move.dirZ)) break;   // 갈 곳이 없으면 제자리
+            distToNext = unitSize;
+        }
+        else {
+            // 다가오는 중이면 이 칸 중심까지, 이미 지나쳤으면 다음 칸 중심까지
+            distToNext = (along < 0.0f) ? -along : unitSize - along;
+        }
+
+        glm::vec2 from(ghost.x, ghost.z);
+        if (remaining >= distToNext) {
+            // 다음 칸 중심에 정확히 맞춰 두어야 다음 반복에서 방향을 정한다
+            glm::ivec2 nextCell = getGridCoord(ghost.x + move.dirX * distToNext, ghost.z + move.dirZ * distToNext);
+            glm::vec3 nextCenter = getWorldPos(nextCell.x, nextCell.y);
+            ghost.x = nextCenter.x;
+            ghost.z = nextCenter.z;
+            remaining -= distToNext;
+        }
+        else {
+            ghost.x += move.dirX * remaining;
+            ghost.z += move.dirZ * remaining;
+            remaining = 0.0f;
+        }
+
+        // 이동 구간 전체로 충돌 검사 (큰 deltaTime에 플레이어를 통과해 버리지 않게). 잡힌 유령은 통과
+        if (brain.mode != GhostMode::EATEN) {
+            for (int p = 0; p < playerCount && !caught; ++p) {
+                caught = distanceToSegment(playerPos2D[p], from, glm::vec2(ghost.x, ghost.z)) < collisionDistance;
+            }
+            if (caught) break;
+        }
+    }
+
+    if (move.dirX != 0 || move.dirZ != 0) {
+        float angleRad = std::atan2(static_cast<float>(move.dirX), static_cast<float>(move.dirZ));
+        ghost.angleY = glm::degrees(angleRad);
+    }
+    grid = getGridCoord(ghost.x, ghost.z);
+    getComponent(g_world.cells, e) = GridCell{ grid.x, grid.y };
+
+    Render& render = getComponent(g_world.renders, e);
+    render.color = ghostModeColor(brain);
+
+    // 꼬리: 느려진 동안에는 슬로우 아이템 색으로. 가산 블렌딩으로 겹치므로 어둡게 낸다
+    bool slowTrail = g_ghostSlowActive && brain.mode == GhostMode::NORMAL;
+    glm::vec3 trailColor = 0.4f * (slowTrail ? glm::vec3(0.2f, 0.8f, 1.0f) : render.color);
+    emitParticles(ParticleType::GHOST_TRAIL, glm::vec3(ghost.x, FLOOR_SCALE * CUBE_SIZE * 0.5f + GHOST_HEIGHT * 0.35f, ghost.z), trailColor);
+
+    // 목숨과 점수는 함께 쓰므로 누구에게 닿든 같다
+    bool touchingPlayer = false;
+    for (int p = 0; p < playerCount && !touchingPlayer; ++p) {
+        glm::vec2 d = playerPos2D[p] - glm::vec2(ghost.x, ghost.z);
+        touchingPlayer = glm::dot(d, d) < collisionDistance * collisionDistance;
+    }
+
+    bool touching = brain.mode != GhostMode::EATEN && (caught || touchingPlayer);
+    if (touching && brain.mode == GhostMode::FRIGHTENED) {
+        eatGhost(brain, ghost);
+        render.color = ghostModeColor(brain);
+    }
+    else if (touching) {
+        countMetric(MC_DEATHS);
+        g_lives--;
+        if (g_lives <= 0) {
+            goToGameOver();
+        }
+        else {
+            reset();
+            g_gameState = GameState::PLAYING;
+        }
+        return false;
+    }
+    return true;
+}
+
+// Movement 컴포넌트를 가진 엔티티 = 유령. 이번 틱 차례인 유령만 밀린 시간까지 더해 움직인다
+void updateGhosts(float deltaTime) {
+    GhostFrame frame;
+    buildGhostFrame(frame);
+    const JunctionGraph& graph = junctionGraph();
+
+    for (size_t i = 0; i < g_world.movements.data.size(); ++i) {
+        Movement& move = g_world.movements.data[i];
+        if (move.lodWait > 0) {
+            move.lodWait--;
+            move.lodPending += deltaTime;
+            g_simLodStats.deferred++;
+            // 안전 조건 검사: 밀린 시간 동안 최고 속도로 움직였어도 충돌 거리 밖이어야 한다
+            const Transform& ghost = getComponent(g_world.transforms, g_world.movements.owner[i]);
+            float reach = GHOST_COLLISION_DISTANCE + ghostTopSpeed(move) * move.lodPending;
+            for (int p = 0; p < frame.playerCount; ++p) {
+                glm::vec2 d = frame.playerPos2D[p] - glm::vec2(ghost.x, ghost.z);
+                if (glm::dot(d, d) <= reach * reach) {
+                    g_simLodStats.unsafeDeferrals++;
+                    break;
+                }
+            }
+            continue;
+        }
+        float ghostDelta = move.lodPending + deltaTime;
+        move.lodPending = 0.0f;
+        if (!stepGhost(i, ghostDelta, frame, graph)) return;
+        scheduleGhostLod(g_world.movements.data[i], getComponent(g_world.transforms, g_world.movements.owner[i]), frame, deltaTime);
+    }
+}
+
+// 이번 틱에 모든 유령의 규칙이 바뀔 수 있는지 (틀려도 되는 쪽으로 넉넉히): 단계 전환, 겁먹음 / 느려짐의 끝,
+// 플레이어가 이번 틱에 닿을 수 있는 칸의 파워 펠릿 / 슬로우 아이템
+bool ghostRulesMayChange(float deltaTime) {
+    if (g_ghostSlowActive && g_ghostSlowTimer - deltaTime <= 0.0f) return true;
+    if (g_frightenedTimer > 0.0f && g_frightenedTimer - deltaTime <= 0.0f) return true;
+    if (g_ghostPhaseIndex < GHOST_PHASE_COUNT && g_ghostPhaseTimer + deltaTime >= GHOST_PHASE_SECONDS[g_ghostPhaseIndex]) return true;
+    int reach = 1 + static_cast<int>(PLAYER_MOVE_SPEED * deltaTime / (CUBE_SIZE + GRID_SPACING));
+    for (int p = 0; p < g_world.playerCount; ++p) {
+        const GridCell& cell = getComponent(g_world.cells, g_world.players[p]);
+        for (int z = std::max(0, cell.z - reach); z <= std::min(g_gridHeight - 1, cell.z + reach); ++z) {
+            for (int x = std::max(0, cell.x - reach); x <= std::min(g_gridWidth - 1, cell.x + reach); ++x) {
+                Entity item = collectibleAt(x, z);
+                if (item != INVALID_ENTITY && getComponent(g_world.collectibles, item).kind != CollectibleKind::PELLET) return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 밀린 유령을 지금까지 따라잡게 하고 다음 틱에 등급을 다시 정하게 한다. 잡혀서 reset()했으면 false
+bool flushGhostLod() {
+    bool pending = false;
+    for (const Movement& move : g_world.movements.data) pending = pending || move.lodPending > 0.0f;
+    if (!pending) return true;
+    g_simLodStats.flushes++;
+
+    GhostFrame frame;
+    buildGhostFrame(frame);
+    const JunctionGraph& graph = junctionGraph();
+    for (size_t i = 0; i < g_world.movements.data.size(); ++i) {
+        Movement& move = g_world.movements.data[i];
+        float ghostDelta = move.lodPending;
+        move.lodPending = 0.0f;
+        move.lodWait = 0;
+        if (ghostDelta > 0.0f && !stepGhost(i, ghostDelta, frame, graph)) return false;
+    }
+    return true;
+}
+
+// 한 틱 분량의 게임 로직. GLUT 타이머와 헤드리스 봇 러너가 함께 사용한다.
+// inputs[p] = p번 플레이어 입력. inputCount 이후의 플레이어는 같은 스텝의 키 상태에서 읽는다
+void stepSimulation(const PlayerInput* inputs, int inputCount, float deltaTime) {
+    bool timed = metricsTiming();
+    std::chrono::steady_clock::time_point stepStart;
+    if (timed) stepStart = std::chrono::steady_clock::now();
+    countMetric(MC_TICKS);
+
+    // 스텝 경계에서 찍어야 복원 후 진행이 원래와 같다
+    captureRewindPoint();
+
+    // 유령 규칙이 바뀔 수 있는 틱이면 밀린 유령(시뮬레이션 LOD)을 먼저 따라잡게 한다. 그러다 잡히면 이 틱은 끝
+    bool caughtWhileFlushing = g_gameState == GameState::PLAYING && ghostRulesMayChange(deltaTime) && !flushGhostLod();
+
+    if (g_ghostSlowActive) {
+        g_ghostSlowTimer -= deltaTime;
+        if (g_ghostSlowTimer <= 0.0f) {
+            g_ghostSlowActive = false;
+            g_ghostSlowTimer = 0.0f;
+            g_ghostSpeedScale = 1.0f;
+        }
+    }
+
+    if (g_gameState == GameState::PLAYING && !caughtWhileFlushing) {
+        g_simTime += deltaTime;
+        for (int p = 0; p < g_world.playerCount; ++p) {
+            handlePlayerInput(p < inputCount ? inputs[p] : readKeyboardInput(p), p, deltaTime);
+        }
+        if (g_exploreActive) updateExploreWindow();
+        updateFrightenedTimer(deltaTime);
+        updateGhostPhase(deltaTime);
+        updateGhosts(deltaTime);
+
+        // 팩맨 입 애니메이션
+        for (int p = 0; p < g_world.playerCount; ++p) {
+            Render& mouth = getComponent(g_world.renders, g_world.players[p]);
+            mouth.anim += mouth.animDir * PACMAN_MOUTH_SPEED * deltaTime;
+            if (mouth.anim > PACMAN_MOUTH_MAX) {
+                mouth.anim = PACMAN_MOUTH_MAX;
+                mouth.animDir = -1.0f;
+            }
+            else if (mouth.anim < 0.0f) {
+                mouth.anim = 0.0f;
+                mouth.animDir = 1.0f;
+            }
+        }
+    }
+
+    if (timed) {
+        setMetricGauge(MG_GHOSTS, g_world.movements.data.size());
+        setMetricGauge(MG_REMAINING_PELLETS, static_cast<uint64_t>(std::max(0, g_remainingPellets)));
+        recordMetricNs(MH_TICK, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - stepStart).count()));
+    }
+}
+
+// input은 1P(또는 봇) 것
+void stepSimulation(const PlayerInput& input, float deltaTime) {
+    stepSimulation(&input, 1, deltaTime);
+}
+
+// ---- 프레임 페이싱 ----
+// glutTimerFunc(16) 대신 glutMainLoopEvent를 직접 돌리면서 고해상도 시계로 그리기 주기를 맞춘다.
+// 시뮬레이션은 별도 스레드에서 고정 스텝, 그리기는 모드에 따라 vsync / 제한 없음 / 목표 FPS(sleep 후 spin 대기).
+
+enum class PacingMode {
+    VSYNC,        // 스왑이 수직 동기까지 기다림
+    UNCAPPED,     // 기다리지 않음 (벤치마크용)
+    TARGET_FPS    // 목표 프레임 시간까지 sleep 후 spin
+};
+
+const char* PACING_MODE_NAMES[] = { "VSYNC", "UNCAPPED", "TARGET" };
+
+const double SIM_STEP_SECONDS = 1.0 / 120.0;   // 고정 시뮬레이션 스텝
+const double MAX_FRAME_DELTA = 0.1;            // 시뮬레이션이 이보다 밀리면 따라잡지 않고 버림
+const double PACING_SPIN_MARGIN = 0.002;       // 목표 시각 이만큼 전까지만 sleep하고 나머지는 spin
+const double FRAME_STATS_INTERVAL = 0.5;       // 오버레이 통계 갱신 간격(초)
+
+// 구간 통계 (프레임 시간, 입력->화면 지연)
+struct TimingStats {
+    long long count = 0;
+    double sum = 0.0;
+    double sumSq = 0.0;
+    double maxValue = 0.0;
+};
+
+void addTiming(TimingStats& stats, double value) {
+    stats.count++;
+    stats.sum += value;
+    stats.sumSq += value * value;
+    stats.maxValue = std::max(stats.maxValue, value);
+}
+
+void mergeTiming(TimingStats& into, const TimingStats& from) {
+    into.count += from.count;
+    into.sum += from.sum;
+    into.sumSq += from.sumSq;
+    into.maxValue = std::max(into.maxValue, from.maxValue);
+}
+
+double timingMean(const TimingStats& stats) {
+    return stats.count > 0 ? stats.sum / stats.count : 0.0;
+}
+
+double timingStdDev(const TimingStats& stats) {
+    if (stats.count < 2) return 0.0;
+    double mean = timingMean(stats);
+    return std::sqrt(std::max(0.0, stats.sumSq / stats.count - mean * mean));
+}
+
+struct FramePacer {
+    PacingMode mode = PacingMode::TARGET_FPS;
+    double targetFps = 60.0;
+    bool running = false;
+    bool showStats = false;
+    bool swapControl = true;      // 스왑 간격을 바꿀 수 있음 (안 되면 vsync 모드를 못 씀)
+
+    TimingStats frameMs;          // 현재 구간
+    TimingStats latencyMs;
+    TimingStats totalFrameMs;     // 실행 전체
+    TimingStats totalLatencyMs;
+    double windowStart = 0.0;
+};
+
+FramePacer g_pacer;
+
+double pacerNow() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 목표 시각까지 대부분은 sleep으로 쉬고, OS 스케줄러 오차가 생기는 마지막 구간은 spin으로 맞춘다
+void waitUntil(double deadline) {
+    double remaining = deadline - pacerNow();
+    if (remaining > PACING_SPIN_MARGIN) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(remaining - PACING_SPIN_MARGIN));
+    }
+    while (pacerNow() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+// 현재 컨텍스트의 스왑 간격을 바꾼다. 확장이 없으면 false (드라이버 기본값 그대로)
+bool setSwapInterval(int interval) {
+#ifdef _WIN32
+    return WGLEW_EXT_swap_control && wglSwapIntervalEXT(interval);
+#else
+#ifdef PACMAN_WITH_EGL
+    if (eglGetCurrentContext() != EGL_NO_CONTEXT) return eglSwapInterval(eglGetCurrentDisplay(), interval) == EGL_TRUE;
+#endif
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    if (GLXEW_EXT_swap_control && drawable) {
+        glXSwapIntervalEXT(glXGetCurrentDisplay(), drawable, interval);
+        return true;
+    }
+    if (GLXEW_MESA_swap_control) return glXSwapIntervalMESA(static_cast<unsigned int>(interval)) == 0;
+    return false;
+#endif
+}
+
+void applyPacingMode(PacingMode mode) {
+    g_pacer.swapControl = setSwapInterval(mode == PacingMode::VSYNC ? 1 : 0);
+    if (mode == PacingMode::VSYNC && !g_pacer.swapControl) {
+        // 스왑이 기다려 주지 않으면 vsync 모드는 제한 없음과 같아지므로 목표 FPS로 대신한다
+        std::cout << "[pacing] mode VSYNC unsupported (no swap control extension), using TARGET instead" << std::endl;
+        mode = PacingMode::TARGET_FPS;
+    }
+    g_pacer.mode = mode;
+    std::cout << "[pacing] mode " << PACING_MODE_NAMES[static_cast<int>(mode)];
+    if (mode == PacingMode::TARGET_FPS) std::cout << " (" << g_pacer.targetFps << " fps)";
+    if (!g_pacer.swapControl) std::cout << ", swap interval left at the driver default";
+    std::cout << std::endl;
+}
+
+// F2: 다음 모드 (스왑 간격을 못 바꾸면 vsync는 건너뜀)
+PacingMode nextPacingMode(PacingMode mode) {
+    PacingMode next = static_cast<PacingMode>((static_cast<int>(mode) + 1) % 3);
+    if (next == PacingMode::VSYNC && !g_pacer.swapControl) next = PacingMode::UNCAPPED;
+    return next;
+}
+
+bool parsePacingModeName(const std::string& name, PacingMode& mode) {
+    if (name == "vsync") mode = PacingMode::VSYNC;
+    else if (name == "uncapped") mode = PacingMode::UNCAPPED;
+    else if (name == "target") mode = PacingMode::TARGET_FPS;
+    else {
+        std::cerr << "--pacing wants vsync, uncapped or target (got " << name << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void stopFrameLoop() {
+    captureFlush();
+    g_pacer.running = false;
+}
+
+void updateFrameStatsText() {
+    const FramePacer& p = g_pacer;
+    if (!p.showStats) {
+        g_frameStatsText.clear();
+        return;
+    }
+    char text[256];
+    double meanMs = timingMean(p.frameMs);
+    const CullStats& cull = g_cullStats;
+    double culled = cull.cells > 0 ? 100.0 * cull.frustumCulled / cull.cells : 0.0;
+    std::snprintf(text, sizeof(text), "%s  FPS %.1f  FRAME %.2f MS SD %.2f MAX %.2f  INPUT->PHOTON %.1f MS MAX %.1f  PARTICLES %d  CULLED %.0f%%  RES %.0f%%",
+        PACING_MODE_NAMES[static_cast<int>(p.mode)], meanMs > 0.0 ? 1000.0 / meanMs : 0.0,
+        meanMs, timingStdDev(p.frameMs), p.frameMs.maxValue, timingMean(p.latencyMs), p.latencyMs.maxValue,
+        liveParticleCount(), culled, g_dynres.scale * 100.0f);
+    g_frameStatsText = text;
+}
+
+void printPacingStats() {
+    const FramePacer& p = g_pacer;
+    std::cout << "[pacing] " << p.totalFrameMs.count << " frames, frame time avg " << timingMean(p.totalFrameMs)
+        << " ms, stddev " << timingStdDev(p.totalFrameMs) << " ms, max " << p.totalFrameMs.maxValue
+        << " ms; input-to-photon avg " << timingMean(p.totalLatencyMs) << " ms, max " << p.totalLatencyMs.maxValue
+        << " ms (" << p.totalLatencyMs.count << " frames with input)\n";
+}
+
+void printCullStats() {
+    const CullStats& s = g_cullStats;
+    if (s.cells == 0) return;
+    std::cout << "[cull] culled " << (100.0 * s.frustumCulled / s.cells) << "% of main-view cells by frustum ("
+        << s.frustumCulled << " of " << s.cells << ")\n";
+}
+
+// ---- 시뮬레이션 스레드 / 렌더 스냅샷 ----
+// GLUT 게임에서는 시뮬레이션이 자기 스레드에서 고정 스텝으로 돌고, 스텝마다 렌더 스냅샷을 게시한다.
+// 게임 상태는 thread_local이라 GL 스레드의 g_world, g_maze 등은 스냅샷을 받아 채우는 사본(미러)이고
+// renderFrame은 지금처럼 그 전역만 읽는다. 주고받기는 슬롯 3개를 atomic 교환으로 돌리는 트리플 버퍼라
+// 어느 쪽도 락을 잡지 않고, 그리는 동안 시뮬레이션이 기다리는 일도 없다.
+// (봇 러너와 오프스크린 모드는 결정성을 위해 지금처럼 한 스레드에서 스텝과 그리기를 번갈아 한다.)
+
+struct GhostPose {
+    Transform transform;
+    glm::vec3 color = glm::vec3(1.0f);
+};
+
+// 스냅샷 사이에 일어난 일. 어느 스텝(스냅샷 tick)에서 생겼는지 붙여 둔다.
+struct TaggedItemChange {
+    uint64_t tick;
+    ItemChange change;
+};
+
+struct TaggedEmit {
+    uint64_t tick;
+    ParticleType type;
+    ParticleEmit emit;
+};
+
+struct InputMark {
+    uint64_t tick;
+    int64_t oldestUs;                // 그 스텝들에서 반영된 입력 중 가장 오래된 발생 시각
+};
+
+// 렌더 스레드가 스냅샷을 건너뛸 수 있으므로 이벤트 목록은 "마지막으로 읽힌 게 확인된 스냅샷" 이후 것을
+// 모두 담고, 렌더 스레드는 이미 반영한 tick 이하의 항목을 무시한다.
+const size_t SNAPSHOT_MAX_EMITS = 256;
+const size_t SNAPSHOT_MAX_INPUT_MARKS = 64;
+
+struct RenderSnapshot {
+    uint64_t tick = 0;
+    double publishTime = 0.0;        // pacerNow() 기준 (보간용)
+
+    // HUD / 화면 상태
+    GameState gameState = GameState::TITLE;
+    int score = 0;
+    int lives = 0;
+    int stage = 1;
+    bool slowActive = false;
+    float slowTimer = 0.0f;
+    float frightenedTimer = 0.0f;
+    double simTime = 0.0;
+    bool quitRequested = false;
+
+    int playerCount = 0;
+    Transform players[MAX_PLAYERS];
+    float mouthAnim[MAX_PLAYERS] = {};
+    float playerYaw[MAX_PLAYERS] = {};
+    std::vector<GhostPose> ghosts;
+
+    // 미로 / 아이템: 미로가 바뀐 뒤 아직 안 읽혔으면 전체(fullSync), 아니면 바뀐 칸만
+    int mazeVersion = 0;
+    bool fullSync = false;
+    int gridWidth = 0;
+    int gridHeight = 0;
+    std::vector<uint8_t> walls;          // fullSync일 때만, 칸마다 1 = 벽
+    std::vector<uint8_t> items;          // fullSync일 때만, 0 = 없음, 1 + CollectibleKind
+    std::vector<TaggedItemChange> itemChanges;
+    std::vector<TaggedEmit> emits;
+    std::vector<InputMark> inputMarks;
+};
+
+const int SNAPSHOT_SLOT_MASK = 3;
+const int SNAPSHOT_FRESH = 4;        // 가운데 슬롯이 아직 안 읽힌 새 스냅샷
+
+struct SnapshotExchange {
+    RenderSnapshot slots[3];
+    std::atomic<int> middle{ 1 };    // 슬롯 번호 | SNAPSHOT_FRESH
+    int back = 0;                    // 시뮬레이션 스레드 전용 (쓰는 중)
+    int front = 2;                   // 렌더 스레드 전용 (읽는 중)
+
+    // 시뮬레이션 스레드 전용: 아직 읽혔다고 확인되지 않은 이벤트
+    std::vector<TaggedItemChange> pendingItemChanges;
+    std::vector<TaggedEmit> pendingEmits;
+    std::vector<InputMark> pendingInputs;
+    int deliveredMazeVersion = -1;   // 읽힌 게 확인된 스냅샷의 미로
+    int pendingMazeVersion = -1;     // pendingItemChanges가 속한 미로
+    uint64_t lastPublishedTick = 0;
+    int lastPublishedMazeVersion = -1;
+};
+
+SnapshotExchange g_snapshots;
+
+// 이미 읽힌 tick 이하의 항목을 버린다
+template <typename T>
+void dropDelivered(std::vector<T>& items, uint64_t deliveredTick) {
+    items.erase(std::remove_if(items.begin(), items.end(), [&](const T& item) { return item.tick <= deliveredTick; }), items.end());
+}
+
+// 시뮬레이션 스레드: 현재 상태를 back 슬롯에 쓰고 가운데와 맞바꾼다
+void publishRenderSnapshot(uint64_t tick) {
+    SnapshotExchange& ex = g_snapshots;
+    RenderSnapshot& s = ex.slots[ex.back];
+
+    // 이번 스텝들에서 생긴 이벤트를 대기 목록에 붙인다
+    if (ex.pendingMazeVersion != g_mazeVersion) {
+        ex.pendingItemChanges.clear();   // 미로가 바뀌면 전체를 보내므로 이전 미로의 칸 목록은 필요 없음
+        ex.pendingMazeVersion = g_mazeVersion;
+    }
+    for (const ItemChange& change : g_itemChanges) ex.pendingItemChanges.push_back(TaggedItemChange{ tick, change });
+    g_itemChanges.clear();
+    for (int t = 0; t < PARTICLE_TYPE_COUNT; ++t) {
+        ParticleEmitQueue& queue = g_particleEmits[t];
+        for (int i = 0; i < queue.size && ex.pendingEmits.size() < SNAPSHOT_MAX_EMITS; ++i) {
+            ex.pendingEmits.push_back(TaggedEmit{ tick, static_cast<ParticleType>(t), queue.items[i] });
+        }
+        queue.size = 0;
+    }
+    if (g_inputLatency.frameOldestUs != 0 && ex.pendingInputs.size() < SNAPSHOT_MAX_INPUT_MARKS) {
+        ex.pendingInputs.push_back(InputMark{ tick, g_inputLatency.frameOldestUs });
+    }
+    g_inputLatency.frameOldestUs = 0;
+
+    s.tick = tick;
+    s.publishTime = pacerNow();
+    s.gameState = g_gameState;
+    s.score = g_score;
+    s.lives = g_lives;
+    s.stage = g_currentStage;
+    s.slowActive = g_ghostSlowActive;
+    s.slowTimer = g_ghostSlowTimer;
+    s.frightenedTimer = g_frightenedTimer;
+    s.simTime = g_simTime;
+    s.quitRequested = g_quitRequested;
+
+    bool hasWorld = g_world.playerCount > 0;
+    s.playerCount = g_world.playerCount;
+    for (int p = 0; p < g_world.playerCount; ++p) {
+        s.players[p] = playerTransform(p);
+        s.mouthAnim[p] = getComponent(g_world.renders, g_world.players[p]).anim;
+        s.playerYaw[p] = g_playerYaw[p];
+    }
+    s.ghosts.clear();
+    for (size_t i = 0; i < g_world.movements.data.size(); ++i) {
+        Entity e = g_world.movements.owner[i];
+        s.ghosts.push_back(GhostPose{ getComponent(g_world.transforms, e), getComponent(g_world.renders, e).color });
+    }
+
+    s.mazeVersion = g_mazeVersion;
+    s.fullSync = hasWorld && ex.deliveredMazeVersion != g_mazeVersion;
+    if (s.fullSync) {
+        s.gridWidth = g_gridWidth;
+        s.gridHeight = g_gridHeight;
+        s.walls.resize(g_gridWidth * g_gridHeight);
+        s.items.resize(g_gridWidth * g_gridHeight);
+        for (int z = 0, i = 0; z < g_gridHeight; ++z) {
+            for (int x = 0; x < g_gridWidth; ++x, ++i) {
+                s.walls[i] = (g_maze[z][x] == WALL) ? 1 : 0;
+                Entity item = g_world.collectibleAt[i];
+                s.items[i] = (item == INVALID_ENTITY) ? 0
+                    : static_cast<uint8_t>(1 + static_cast<int>(getComponent(g_world.collectibles, item).kind));
+            }
+        }
+    }
+    s.itemChanges = ex.pendingItemChanges;
+    s.emits = ex.pendingEmits;
+    s.inputMarks = ex.pendingInputs;
+
+    int previous = ex.middle.exchange(ex.back | SNAPSHOT_FRESH, std::memory_order_acq_rel);
+    ex.back = previous & SNAPSHOT_SLOT_MASK;
+    if (!(previous & SNAPSHOT_FRESH)) {
+        // FRESH가 지워져 있음 = 렌더 스레드가 직전 게시본을 가져갔음. 거기까지의 이벤트는 전달됨
+        dropDelivered(ex.pendingItemChanges, ex.lastPublishedTick);
+        dropDelivered(ex.pendingEmits, ex.lastPublishedTick);
+        dropDelivered(ex.pendingInputs, ex.lastPublishedTick);
+        ex.deliveredMazeVersion = ex.lastPublishedMazeVersion;
+    }
+    ex.lastPublishedTick = tick;
+    ex.lastPublishedMazeVersion = g_mazeVersion;
+}
+
+// 렌더 스레드: 새 스냅샷이 있으면 front로 가져온다
+const RenderSnapshot* acquireRenderSnapshot() {
+    SnapshotExchange& ex = g_snapshots;
+    if (!(ex.middle.load(std::memory_order_acquire) & SNAPSHOT_FRESH)) return nullptr;
+    int previous = ex.middle.exchange(ex.front, std::memory_order_acq_rel);
+    ex.front = previous & SNAPSHOT_SLOT_MASK;
+    return &ex.slots[ex.front];
+}
+
+// 렌더 스레드 쪽 보간 상태. 직전과 최신 스냅샷의 자세만 복사해 둔다 (슬롯은 곧 시뮬레이션에 돌려줌).
+struct RenderMirror {
+    bool hasSnapshot = false;
+    uint64_t appliedTick = 0;        // 이 tick까지의 이벤트는 반영함
+    double prevTime = 0.0;
+    double currTime = 0.0;
+    Transform prevPlayers[MAX_PLAYERS];
+    Transform currPlayers[MAX_PLAYERS];
+    float prevMouth[MAX_PLAYERS] = {};
+    float currMouth[MAX_PLAYERS] = {};
+    std::vector<Transform> prevGhosts;
+    std::vector<Transform> currGhosts;
+    std::vector<Entity> ghostEntities;
+};
+
+RenderMirror g_renderMirror;
+
+void rebuildMirrorWorld(const RenderSnapshot& s) {
+    g_gridWidth = s.gridWidth;
+    g_gridHeight = s.gridHeight;
+    g_maze.assign(g_gridHeight, std::vector<CellType>(g_gridWidth, PATH));
+    for (int z = 0, i = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x, ++i) {
+            g_maze[z][x] = s.walls[i] ? WALL : PATH;
+        }
+    }
+
+    clearWorld();
+    g_world.collectibleAt.assign(g_gridWidth * g_gridHeight, INVALID_ENTITY);
+    for (int p = 0; p < s.playerCount; ++p) {
+        glm::ivec2 playerCell = getGridCoord(s.players[p].x, s.players[p].z);
+        spawnPlayer(playerCell.x, playerCell.y, p);
+    }
+    g_renderMirror.ghostEntities.clear();
+    for (int z = 0, i = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x, ++i) {
+            if (s.items[i] != 0) spawnCollectible(x, z, static_cast<CollectibleKind>(s.items[i] - 1));
+        }
+    }
+}
+
+// 스냅샷의 상태를 미러 전역에 반영. 반환값 = 이 스냅샷으로 처음 화면에 나갈 입력의 발생 시각
+int64_t applyRenderSnapshot(const RenderSnapshot& s) {
+    RenderMirror& m = g_renderMirror;
+
+    g_gameState = s.gameState;
+    g_score = s.score;
+    g_lives = s.lives;
+    g_currentStage = s.stage;
+    g_ghostSlowActive = s.slowActive;
+    g_ghostSlowTimer = s.slowTimer;
+    g_frightenedTimer = s.frightenedTimer;
+    for (int p = 0; p < s.playerCount; ++p) g_playerYaw[p] = s.playerYaw[p];
+    g_simTime = s.simTime;
+
+    // 전체 데이터는 미로가 바뀐 게 아직 확인 안 된 동안 계속 오므로, 미러와 다를 때만 다시 만든다
+    bool rebuilt = s.fullSync && (g_world.playerCount != s.playerCount || g_mazeVersion != s.mazeVersion);
+    if (rebuilt) {
+        rebuildMirrorWorld(s);
+        g_mazeVersion = s.mazeVersion;
+    }
+    else if (g_world.playerCount > 0) {
+        // 다시 만들었으면 전체 데이터에 이미 반영돼 있음 (reset()이 같은 칸을 비웠다 다시 채우기도 함)
+        for (const TaggedItemChange& tagged : s.itemChanges) {
+            if (tagged.tick <= m.appliedTick) continue;
+            int x = tagged.change.cell % g_gridWidth;
+            int z = tagged.change.cell / g_gridWidth;
+            if (tagged.change.item == 0) removeCollectibleAt(x, z);
+            else if (collectibleAt(x, z) == INVALID_ENTITY) spawnCollectible(x, z, static_cast<CollectibleKind>(tagged.change.item - 1));
+        }
+    }
+
+    // 유령 수가 바뀌었으면 유령 엔티티만 다시 만든다
+    bool teleported = !m.hasSnapshot || rebuilt;
+    if (g_world.playerCount > 0 && m.ghostEntities.size() != s.ghosts.size()) {
+        for (Entity e : m.ghostEntities) destroyEntity(e);
+        m.ghostEntities.clear();
+        for (const GhostPose& ghost : s.ghosts) {
+            glm::ivec2 cell = getGridCoord(ghost.transform.x, ghost.transform.z);
+            m.ghostEntities.push_back(spawnGhost(cell.x, cell.y, 0, 0));
+        }
+        teleported = true;
+    }
+    for (size_t i = 0; i < m.ghostEntities.size(); ++i) {
+        getComponent(g_world.renders, m.ghostEntities[i]).color = s.ghosts[i].color;
+    }
+
+    m.prevTime = m.currTime;
+    for (int p = 0; p < MAX_PLAYERS; ++p) {
+        m.prevPlayers[p] = m.currPlayers[p];
+        m.prevMouth[p] = m.currMouth[p];
+    }
+    m.prevGhosts.swap(m.currGhosts);
+    m.currTime = s.publishTime;
+    for (int p = 0; p < s.playerCount; ++p) {
+        m.currPlayers[p] = s.players[p];
+        m.currMouth[p] = s.mouthAnim[p];
+    }
+    m.currGhosts.resize(s.ghosts.size());
+    for (size_t i = 0; i < s.ghosts.size(); ++i) m.currGhosts[i] = s.ghosts[i].transform;
+    if (teleported || m.prevGhosts.size() != m.currGhosts.size()) {
+        m.prevTime = m.currTime;
+        for (int p = 0; p < MAX_PLAYERS; ++p) {
+            m.prevPlayers[p] = m.currPlayers[p];
+            m.prevMouth[p] = m.currMouth[p];
+        }
+        m.prevGhosts = m.currGhosts;
+    }
+    m.hasSnapshot = true;
+
+    for (const TaggedEmit& tagged : s.emits) {
+        if (tagged.tick > m.appliedTick) emitParticles(tagged.type, tagged.emit.pos, tagged.emit.color, tagged.emit.count);
+    }
+    int64_t oldestInputUs = 0;
+    for (const InputMark& mark : s.inputMarks) {
+        if (mark.tick > m.appliedTick && (oldestInputUs == 0 || mark.oldestUs < oldestInputUs)) oldestInputUs = mark.oldestUs;
+    }
+    m.appliedTick = s.tick;
+    return oldestInputUs;
+}
+
+Transform lerpTransform(const Transform& a, const Transform& b, float t) {
+    Transform out;
+    out.x = a.x + (b.x - a.x) * t;
+    out.z = a.z + (b.z - a.z) * t;
+    float turn = std::fmod(b.angleY - a.angleY + 540.0f, 360.0f) - 180.0f;   // 짧은 쪽으로 회전
+    out.angleY = a.angleY + turn * t;
+    return out;
+}
+
+// 한 스텝 늦게 그리는 대신 직전과 최신 스냅샷 사이를 보간해서 스텝 주기와 프레임 주기가 달라도 끊기지 않게
+void applyInterpolatedPoses(double now) {
+    RenderMirror& m = g_renderMirror;
+    if (!m.hasSnapshot || g_world.playerCount == 0) return;
+    double span = m.currTime - m.prevTime;
+    float t = (span > 1e-6) ? static_cast<float>((now - SIM_STEP_SECONDS - m.prevTime) / span) : 1.0f;
+    t = std::max(0.0f, std::min(t, 1.0f));
+
+    for (int p = 0; p < g_world.playerCount; ++p) {
+        Transform player = lerpTransform(m.prevPlayers[p], m.currPlayers[p], t);
+        glm::ivec2 playerCell = getGridCoord(player.x, player.z);
+        playerTransform(p) = player;
+        getComponent(g_world.cells, g_world.players[p]) = GridCell{ playerCell.x, playerCell.y };
+        getComponent(g_world.renders, g_world.players[p]).anim = m.prevMouth[p] + (m.currMouth[p] - m.prevMouth[p]) * t;
+    }
+
+    for (size_t i = 0; i < m.ghostEntities.size() && i < m.currGhosts.size(); ++i) {
+        Transform ghost = lerpTransform(m.prevGhosts[i], m.currGhosts[i], t);
+        glm::ivec2 cell = getGridCoord(ghost.x, ghost.z);
+        getComponent(g_world.transforms, m.ghostEntities[i]) = ghost;
+        getComponent(g_world.cells, m.ghostEntities[i]) = GridCell{ cell.x, cell.y };
+    }
+}
+
+// ---- 네트워크: UDP / 지연·손실 심 / 스냅샷 / 예측 클라이언트 ----
+// 권한 서버(--server)가 게임 틱을 돌리고 클라이언트(--connect)는 입력만 보내고 스냅샷을 받는다. 루프백에서 모두
+// 시험할 수 있게 보내는 쪽마다 지연 / 흔들림 / 손실을 흉내 내는 심을 둔다 (--latency MS --jitter MS --loss P,
+// --replay P --replay-delay MS: 보낸 패킷을 한참 뒤 한 번 더 보냄).
+//
+// 스냅샷은 클라이언트가 마지막으로 받았다고 알린(ack) 틱의 상태를 기준으로 한 차이만 보낸다. 기준이 양쪽 기록에
+// 없거나 미로가 바뀌었으면 전체를 보낸다. 아이템은 칸당 1비트 집합에서 바뀐 32비트 워드 구간만, 플레이어 / 유령
+// 위치는 1/64 단위 정수로 양자화하고, 유령은 바뀐 것만 (조금 움직였으면 i8 차이로) 보낸다.
+// 클라이언트는 자기 팩맨을 입력대로 바로 움직이고(예측), 서버가 처리했다고 알린 입력 이후를 서버 위치에서 다시
+// 적용해 맞춘다(재조정). 유령과 다른 플레이어는 NET_INTERP_DELAY_TICKS만큼 늦게 두 스냅샷 사이를 보간한다.
+//
+// 패킷 (리틀 엔디언, 패딩 없음):
+//   HELLO     u8 type, "PMNT", u16 version
+//   WELCOME   u8 type, u8 slot (NET_NO_SLOT = 빈자리 없음), u8 playerCount
+//   INPUT     u8 type, u32 ackTick (0 = 전체 요청), u32 newestSeq, u8 count, [u8 keys, u16 yaw, i8 turn] * count (최신부터)
+//   SNAPSHOT  u8 type, u32 tick, u32 baseTick (0 = 전체), u32 ackInputSeq, i32 mazeVersion,
+//             u8 gameState, u8 stage, u8 lives, i32 score, u16 frightened (1/100초), u32 itemCrc
+//             전체면 u16 width, height, 벽 레이어 (세이브 스테이트와 같음), 아이템 종류 칸당 2비트 (0 = 없음, 1 + CollectibleKind)
+//             아이템 비트: 전체면 워드 전부, 아니면 u16 구간 수, [u16 첫 워드, u8 워드 수, u32 워드 * 수] * 구간 수
+//             u8 playerCount, [i16 x, z, u8 angle] * playerCount, 받는 사람 것은 f32 x, z, angleY로 한 번 더
+//             u16 ghostCount, 전체면 [i16 x, z, u8 angle, u8 flags] * ghostCount,
+//             아니면 바뀐 유령 비트마스크, 바뀐 유령마다 u8 wide, (wide ? i16 x, z : i8 dx, dz), u8 angle, u8 flags
+//   BYE       u8 type
+
+const uint16_t NET_PORT_DEFAULT = 7777;
+const char NET_MAGIC[4] = { 'P', 'M', 'N', 'T' };
+const uint16_t NET_VERSION = 1;
+const float NET_POS_SCALE = 64.0f;        // 위치 양자화 (1/64 단위)
+const int NET_STATE_RING = 128;           // 차이 기준으로 쓸 수 있는 과거 상태 (틱 번호 % 링)
+const int NET_SNAPSHOT_INTERVAL = 2;      // 스냅샷은 2틱(60Hz)마다
+const int NET_INPUT_REDUNDANCY = 4;       // 입력 패킷마다 최근 입력 몇 개를 겹쳐 보낼지 (손실 대비)
+const int NET_INTERP_DELAY_TICKS = 12;    // 보간 지연 (120Hz 기준 100ms)
+const size_t NET_MAX_HISTORY = 256;       // 서버 확인을 기다리는 입력 최대 수
+const double NET_HELLO_INTERVAL = 0.25;
+const float NET_CORRECTION_EPSILON = 1e-3f;
+const int NET_MAX_PACKET = 65507;
+const uint8_t NET_NO_SLOT = 0xFF;
+
+enum NetPacketType : uint8_t { NET_HELLO = 1, NET_WELCOME, NET_INPUT, NET_SNAPSHOT, NET_BYE };
+
+#ifdef _WIN32
+typedef SOCKET NetSocket;
+const NetSocket NET_INVALID_SOCKET = INVALID_SOCKET;
+#else
+typedef int NetSocket;
+const NetSocket NET_INVALID_SOCKET = -1;
+#endif
+
+bool netStartup() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+void netCloseSocket(NetSocket s) {
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+// 논블로킹 UDP 소켓. port가 0이면 운영체제가 고른 포트
+NetSocket netOpenSocket(uint32_t bindAddress, uint16_t port) {
+    NetSocket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == NET_INVALID_SOCKET) return s;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(bindAddress);
+    addr.sin_port = htons(port);
+    if (bind(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        netCloseSocket(s);
+        return NET_INVALID_SOCKET;
+    }
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    return s;
+}
+
+uint16_t netLocalPort(NetSocket s) {
+    sockaddr_in addr{};
+    socklen_t length = sizeof(addr);
+    getsockname(s, reinterpret_cast<sockaddr*>(&addr), &length);
+    return ntohs(addr.sin_port);
+}
+
+// "host:port", "host", ":port" (host 생략 시 127.0.0.1, port 생략 시 NET_PORT_DEFAULT)
+bool netResolve(const std::string& text, sockaddr_in& out) {
+    size_t colon = text.rfind(':');
+    std::string host = (colon == std::string::npos) ? text : text.substr(0, colon);
+    std::string port = (colon == std::string::npos) ? std::to_string(NET_PORT_DEFAULT) : text.substr(colon + 1);
+    if (host.empty()) host = "127.0.0.1";
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || result == nullptr) return false;
+    std::memcpy(&out, result->ai_addr, sizeof(sockaddr_in));
+    freeaddrinfo(result);
+    return true;
+}
+
+bool netSameAddress(const sockaddr_in& a, const sockaddr_in& b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+// 호출한 스레드가 쓴 CPU 시간 (서버의 클라이언트별 비용 측정용)
+double threadCpuSeconds() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user);
+    auto seconds = [](const FILETIME& f) { return ((uint64_t(f.dwHighDateTime) << 32) | f.dwLowDateTime) * 1e-7; };
+    return seconds(kernel) + seconds(user);
+#else
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+struct NetShimConfig {
+    double latencyMs = 0.0;    // 한 방향 지연
+    double jitterMs = 0.0;     // 지연에 더하는 ±흔들림 (크면 순서가 바뀜)
+    double loss = 0.0;         // 버릴 확률 (0~1)
+    double replay = 0.0;       // 보낸 패킷을 replayDelayMs 뒤에 한 번 더 보낼 확률 (늦게 도착한 옛 패킷 흉내)
+    double replayDelayMs = 0.0;
+};
+
+struct NetDelayedPacket {
+    double due;
+    sockaddr_in to;
+    std::vector<uint8_t> data;
+};
+
+// 소켓 + 보내는 쪽 심 + 트래픽 카운터
+struct NetEndpoint {
+    NetSocket socket = NET_INVALID_SOCKET;
+    NetShimConfig shim;
+    std::mt19937 shimRng;
+    std::vector<NetDelayedPacket> delayed;   // due 순
+    long long bytesSent = 0;
+    long long packetsSent = 0;
+    long long bytesReceived = 0;
+    long long packetsReceived = 0;
+    long long packetsDropped = 0;            // 심이 버린 것
+    long long packetsReplayed = 0;           // 심이 한 번 더 보낸 것
+};
+
+void netSendRaw(NetSocket s, const sockaddr_in& to, const std::vector<uint8_t>& data) {
+    sendto(s, reinterpret_cast<const char*>(data.data()), static_cast<int>(data.size()), 0,
+        reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+}
+
+void netSendDelayed(NetEndpoint& ep, const sockaddr_in& to, const std::vector<uint8_t>& data, double delayMs) {
+    NetDelayedPacket packet{ pacerNow() + std::max(0.0, delayMs) / 1000.0, to, data };
+    auto at = std::upper_bound(ep.delayed.begin(), ep.delayed.end(), packet.due,
+        [](double due, const NetDelayedPacket& p) { return due < p.due; });
+    ep.delayed.insert(at, std::move(packet));
+}
+
+// 심을 거쳐 보낸다. 버려져도 보낸 쪽 비용(bytesSent)에는 들어간다
+void netSend(NetEndpoint& ep, const sockaddr_in& to, const std::vector<uint8_t>& data) {
+    ep.bytesSent += data.size();
+    ep.packetsSent++;
+    const NetShimConfig& shim = ep.shim;
+    if (shim.replay > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(ep.shimRng) < shim.replay) {
+        ep.packetsReplayed++;
+        netSendDelayed(ep, to, data, shim.latencyMs + shim.replayDelayMs);
+    }
+    if (shim.loss > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(ep.shimRng) < shim.loss) {
+        ep.packetsDropped++;
+        return;
+    }
+    if (shim.latencyMs <= 0.0 && shim.jitterMs <= 0.0) {
+        netSendRaw(ep.socket, to, data);
+        return;
+    }
+    double delayMs = shim.latencyMs;
+    if (shim.jitterMs > 0.0) delayMs += std::uniform_real_distribution<double>(-shim.jitterMs, shim.jitterMs)(ep.shimRng);
+    netSendDelayed(ep, to, data, delayMs);
+}
+
+// 심에 묶여 있다가 시간이 된 패킷을 실제로 보낸다
+void netFlush(NetEndpoint& ep, double now) {
+    size_t sent = 0;
+    while (sent < ep.delayed.size() && ep.delayed[sent].due <= now) {
+        netSendRaw(ep.socket, ep.delayed[sent].to, ep.delayed[sent].data);
+        sent++;
+    }
+    ep.delayed.erase(ep.delayed.begin(), ep.delayed.begin() + sent);
+}
+
+// 받은 게 없으면 false
+bool netReceive(NetEndpoint& ep, std::vector<uint8_t>& buffer, sockaddr_in& from) {
+    buffer.resize(NET_MAX_PACKET);
+    socklen_t length = sizeof(from);
+    int n = static_cast<int>(recvfrom(ep.socket, reinterpret_cast<char*>(buffer.data()), NET_MAX_PACKET, 0,
+        reinterpret_cast<sockaddr*>(&from), &length));
+    if (n <= 0) return false;
+    buffer.resize(n);
+    ep.bytesReceived += n;
+    ep.packetsReceived++;
+    return true;
+}
+
+// 양자화된 자세. flags는 유령만: 성격(하위 3비트) | 모드 << 3
+struct NetPose {
+    int16_t x = 0;
+    int16_t z = 0;
+    uint8_t angle = 0;
+    uint8_t flags = 0;
+};
+
+bool operator==(const NetPose& a, const NetPose& b) {
+    return a.x == b.x && a.z == b.z && a.angle == b.angle && a.flags == b.flags;
+}
+
+int16_t netQuantizePos(float v) {
+    return static_cast<int16_t>(std::lround(glm::clamp(v * NET_POS_SCALE, -32768.0f, 32767.0f)));
+}
+
+uint16_t netWrapDegrees(float degrees, float steps) {
+    float wrapped = std::fmod(degrees, 360.0f);
+    if (wrapped < 0.0f) wrapped += 360.0f;
+    return static_cast<uint16_t>(static_cast<uint32_t>(std::lround(wrapped * steps / 360.0f)) % static_cast<uint32_t>(steps));
+}
+
+NetPose netPoseOf(const Transform& t, uint8_t flags) {
+    NetPose pose;
+    pose.x = netQuantizePos(t.x);
+    pose.z = netQuantizePos(t.z);
+    pose.angle = static_cast<uint8_t>(netWrapDegrees(t.angleY, 256.0f));
+    pose.flags = flags;
+    return pose;
+}
+
+Transform netPoseTransform(const NetPose& pose) {
+    Transform t;
+    t.x = pose.x / NET_POS_SCALE;
+    t.z = pose.z / NET_POS_SCALE;
+    t.angleY = pose.angle * (360.0f / 256.0f);
+    return t;
+}
+
+uint8_t netGhostFlags(const GhostBrain& brain) {
+    return static_cast<uint8_t>(static_cast<int>(brain.personality) | (static_cast<int>(brain.mode) << 3));
+}
+
+// 서버가 받는 것과 같은 값으로 예측하도록 보내기 전에 입력을 선로 정밀도로 맞춘다
+uint8_t netInputKeys(const PlayerInput& input) {
+    return static_cast<uint8_t>((input.forward ? 1 : 0) | (input.back ? 2 : 0) | (input.left ? 4 : 0) | (input.right ? 8 : 0));
+}
+
+PlayerInput netInputFromWire(uint8_t keys, uint16_t yaw, int8_t turn) {
+    PlayerInput input;
+    input.forward = (keys & 1) != 0;
+    input.back = (keys & 2) != 0;
+    input.left = (keys & 4) != 0;
+    input.right = (keys & 8) != 0;
+    input.yaw = yaw * (360.0f / 65536.0f);
+    input.turn = static_cast<float>(std::max(-1, std::min<int>(turn, 1)));
+    return input;
+}
+
+PlayerInput netQuantizeInput(const PlayerInput& input) {
+    return netInputFromWire(netInputKeys(input), netWrapDegrees(input.yaw, 65536.0f), static_cast<int8_t>(std::lround(input.turn)));
+}
+
+// 차이 기준이 되는 상태. 스칼라(점수 등)는 매번 통째로 보내므로 여기에는 없다
+struct NetWorldState {
+    uint32_t tick = 0;                 // 0 = 빈 슬롯
+    int mazeVersion = -1;
+    std::vector<uint32_t> items;       // 칸마다 아이템 있음 비트
+    std::vector<NetPose> players;
+    std::vector<NetPose> ghosts;
+};
+
+struct NetStateRing {
+    NetWorldState states[NET_STATE_RING];
+
+    NetWorldState& slot(uint32_t tick) { return states[tick % NET_STATE_RING]; }
+    const NetWorldState* find(uint32_t tick) const {
+        const NetWorldState& s = states[tick % NET_STATE_RING];
+        return (tick != 0 && s.tick == tick) ? &s : nullptr;
+    }
+};
+
+uint32_t netItemCrc(const std::vector<uint32_t>& items) {
+    return crc32Update(0, reinterpret_cast<const unsigned char*>(items.data()), items.size() * sizeof(uint32_t));
+}
+
+// 호출 스레드(서버)의 현재 게임 상태
+void netCaptureWorld(NetWorldState& s, uint32_t tick) {
+    s.tick = tick;
+    s.mazeVersion = g_mazeVersion;
+    const int cellCount = g_gridWidth * g_gridHeight;
+    s.items.assign((cellCount + 31) / 32, 0);
+    for (int i = 0; i < cellCount; ++i) {
+        if (g_world.collectibleAt[i] != INVALID_ENTITY) s.items[i >> 5] |= 1u << (i & 31);
+    }
+    s.players.clear();
+    for (int p = 0; p < g_world.playerCount; ++p) s.players.push_back(netPoseOf(playerTransform(p), 0));
+    s.ghosts.clear();
+    for (size_t i = 0; i < g_world.movements.data.size(); ++i) {
+        Entity e = g_world.movements.owner[i];
+        s.ghosts.push_back(netPoseOf(getComponent(g_world.transforms, e), netGhostFlags(getComponent(g_world.brains, e))));
+    }
+}
+
+struct NetSnapshotHeader {
+    uint32_t tick = 0;
+    uint32_t baseTick = 0;
+    uint32_t ackInputSeq = 0;
+    int32_t mazeVersion = -1;
+    uint8_t gameState = 0;
+    uint8_t stage = 1;
+    uint8_t lives = 0;
+    int32_t score = 0;
+    uint16_t frightenedCs = 0;
+    uint32_t itemCrc = 0;
+};
+
+// 바뀐 워드만 연속 구간으로
+void netWriteItemDelta(std::vector<uint8_t>& out, const std::vector<uint32_t>& items, const std::vector<uint32_t>& base) {
+    size_t countAt = out.size();
+    putStateValue<uint16_t>(out, 0);
+    uint16_t ranges = 0;
+    for (size_t w = 0; w < items.size();) {
+        if (items[w] == base[w]) {
+            ++w;
+            continue;
+        }
+        size_t end = w;
+        while (end < items.size() && end - w < 255 && items[end] != base[end]) ++end;
+        putStateValue<uint16_t>(out, static_cast<uint16_t>(w));
+        putStateValue<uint8_t>(out, static_cast<uint8_t>(end - w));
+        for (; w < end; ++w) putStateValue<uint32_t>(out, items[w]);
+        ranges++;
+    }
+    std::memcpy(out.data() + countAt, &ranges, sizeof(ranges));
+}
+
+void netWriteGhostDelta(std::vector<uint8_t>& out, const std::vector<NetPose>& ghosts, const std::vector<NetPose>& base) {
+    size_t maskAt = out.size();
+    out.resize(maskAt + (ghosts.size() + 7) / 8, 0);
+    for (size_t i = 0; i < ghosts.size(); ++i) {
+        if (ghosts[i] == base[i]) continue;
+        out[maskAt + (i >> 3)] |= static_cast<uint8_t>(1u << (i & 7));
+        int dx = ghosts[i].x - base[i].x;
+        int dz = ghosts[i].z - base[i].z;
+        bool wide = dx < -128 || dx > 127 || dz < -128 || dz > 127;
+        putStateValue<uint8_t>(out, wide ? 1 : 0);
+        if (wide) {
+            putStateValue<int16_t>(out, ghosts[i].x);
+            putStateValue<int16_t>(out, ghosts[i].z);
+        }
+        else {
+            putStateValue<int8_t>(out, static_cast<int8_t>(dx));
+            putStateValue<int8_t>(out, static_cast<int8_t>(dz));
+        }
+        putStateValue<uint8_t>(out, ghosts[i].angle);
+        putStateValue<uint8_t>(out, ghosts[i].flags);
+    }
+}
+
+// 서버 스레드: 한 클라이언트에게 보낼 스냅샷. base가 없으면 미로까지 담은 전체
+void netEncodeSnapshot(std::vector<uint8_t>& out, const NetWorldState& cur, const NetWorldState* base,
+    uint32_t ackInputSeq, int slot) {
+    out.clear();
+    putStateValue<uint8_t>(out, NET_SNAPSHOT);
+    putStateValue<uint32_t>(out, cur.tick);
+    putStateValue<uint32_t>(out, base ? base->tick : 0);
+    putStateValue<uint32_t>(out, ackInputSeq);
+    putStateValue<int32_t>(out, cur.mazeVersion);
+    putStateValue<uint8_t>(out, static_cast<uint8_t>(g_gameState));
+    putStateValue<uint8_t>(out, static_cast<uint8_t>(g_currentStage));
+    putStateValue<uint8_t>(out, static_cast<uint8_t>(glm::clamp(g_lives, 0, 255)));
+    putStateValue<int32_t>(out, g_score);
+    putStateValue<uint16_t>(out, static_cast<uint16_t>(std::min(std::max(g_frightenedTimer * 100.0f, 0.0f), 65535.0f) + 0.5f));
+    putStateValue<uint32_t>(out, netItemCrc(cur.items));
+
+    if (base) {
+        netWriteItemDelta(out, cur.items, base->items);
+    }
+    else {
+        putStateValue<uint16_t>(out, static_cast<uint16_t>(g_gridWidth));
+        putStateValue<uint16_t>(out, static_cast<uint16_t>(g_gridHeight));
+        putGridLayer(out, [](int x, int z) { return g_maze[z][x] == WALL; });
+        const int cellCount = g_gridWidth * g_gridHeight;
+        size_t kindsAt = out.size();
+        out.resize(kindsAt + (cellCount * 2 + 7) / 8, 0);
+        for (int i = 0; i < cellCount; ++i) {
+            Entity item = g_world.collectibleAt[i];
+            if (item == INVALID_ENTITY) continue;
+            int kind = 1 + static_cast<int>(getComponent(g_world.collectibles, item).kind);
+            out[kindsAt + (i * 2) / 8] |= static_cast<uint8_t>(kind << ((i * 2) & 7));
+        }
+        for (uint32_t word : cur.items) putStateValue<uint32_t>(out, word);
+    }
+
+    putStateValue<uint8_t>(out, static_cast<uint8_t>(cur.players.size()));
+    for (const NetPose& pose : cur.players) {
+        putStateValue<int16_t>(out, pose.x);
+        putStateValue<int16_t>(out, pose.z);
+        putStateValue<uint8_t>(out, pose.angle);
+    }
+    // 재조정은 양자화 오차 없이 해야 매 스냅샷마다 조금씩 보정되지 않는다
+    if (slot >= 0 && slot < static_cast<int>(cur.players.size())) {
+        const Transform& own = playerTransform(slot);
+        putStateValue<float>(out, own.x);
+        putStateValue<float>(out, own.z);
+        putStateValue<float>(out, own.angleY);
+    }
+
+    putStateValue<uint16_t>(out, static_cast<uint16_t>(cur.ghosts.size()));
+    if (base) {
+        netWriteGhostDelta(out, cur.ghosts, base->ghosts);
+    }
+    else {
+        for (const NetPose& pose : cur.ghosts) {
+            putStateValue<int16_t>(out, pose.x);
+            putStateValue<int16_t>(out, pose.z);
+            putStateValue<uint8_t>(out, pose.angle);
+            putStateValue<uint8_t>(out, pose.flags);
+        }
+    }
+}
+
+// 전체 스냅샷에만 오는 미로
+struct NetMaze {
+    int version = -1;
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> walls;        // 칸마다 1 = 벽
+    std::vector<uint8_t> kinds;        // 칸마다 0 = 아이템 없음, 1 + CollectibleKind
+};
+
+struct NetInputRecord {
+    uint32_t seq;
+    PlayerInput input;
+    Transform predicted;               // 이 입력까지 적용한 예측 위치
+    double sentAt;
+};
+
+struct NetClientStats {
+    long long snapshots = 0;
+    long long fullSnapshots = 0;
+    long long received = 0;            // 해석까지 간 스냅샷 패킷 (버린 것 포함)
+    uint32_t firstTick = 0;
+    long long staleSnapshots = 0;      // 더 최근 것보다 늦게 도착
+    long long staleMazeFulls = 0;      // 그중 다른(옛) 미로의 전체 스냅샷
+    long long missingBase = 0;         // 기준 상태가 없어 버림 (전체를 다시 요청)
+    long long desyncs = 0;             // 적용 결과의 아이템 CRC가 서버와 다름
+    long long corrections = 0;         // 예측이 서버와 달라 위치를 고친 횟수
+    long long predictionChecks = 0;
+    double errorSum = 0.0;
+    double maxError = 0.0;
+    long long interpHolds = 0;         // 보간할 다음 스냅샷이 아직 없어 멈춘 틱
+    double rttSumMs = 0.0;
+    long long rttCount = 0;
+};
+
+struct NetClient {
+    NetEndpoint endpoint;
+    sockaddr_in server{};
+    int slot = -1;
+    bool rejected = false;
+    double lastHello = -1.0;
+    uint32_t nextInputSeq = 1;
+    uint32_t latestTick = 0;           // 받은 가장 최근 스냅샷 (ack로 돌려보냄)
+    bool needFull = true;
+    int worldMazeVersion = -1;         // 지금 클라이언트 월드가 만들어진 서버 미로
+    NetStateRing ring;
+    NetMaze maze;
+    std::deque<NetInputRecord> history;
+    std::vector<std::pair<int, uint32_t>> predictedPickups;   // (칸, 입력 번호): 서버가 아직 모르는 예측 획득
+    std::vector<Entity> ghostEntities;
+    double interpTick = 0.0;
+    std::vector<uint8_t> packet;
+    NetClientStats stats;
+};
+
+bool netOpenClient(NetClient& c, const std::string& address, const NetShimConfig& shim, unsigned int shimSeed) {
+    if (!netResolve(address, c.server)) return false;
+    c.endpoint.socket = netOpenSocket(INADDR_ANY, 0);
+    c.endpoint.shim = shim;
+    c.endpoint.shimRng.seed(shimSeed);
+    return c.endpoint.socket != NET_INVALID_SOCKET;
+}
+
+void netCloseClient(NetClient& c) {
+    if (c.endpoint.socket == NET_INVALID_SOCKET) return;
+    if (c.slot >= 0) {
+        std::vector<uint8_t> bye(1, NET_BYE);
+        netSendRaw(c.endpoint.socket, c.server, bye);   // 심을 거치지 않음 (곧 닫으므로)
+    }
+    netCloseSocket(c.endpoint.socket);
+    c.endpoint.socket = NET_INVALID_SOCKET;
+}
+
+// 서버 자리 번호 -> 클라이언트 월드의 플레이어 번호. 자기 자신이 항상 0번 (화면 / 키보드 / 봇이 0번을 씀)
+int netWorldIndex(const NetClient& c, int slot, int count) {
+    return (slot - c.slot + count) % count;
+}
+
+void netSetGhostPose(Entity e, const NetPose& pose, const Transform& transform) {
+    getComponent(g_world.transforms, e) = transform;
+    glm::ivec2 cell = getGridCoord(transform.x, transform.z);
+    getComponent(g_world.cells, e) = GridCell{ cell.x, cell.y };
+    GhostBrain& brain = getComponent(g_world.brains, e);
+    brain.personality = static_cast<GhostPersonality>(pose.flags & 7);
+    brain.mode = static_cast<GhostMode>((pose.flags >> 3) & 3);
+    getComponent(g_world.renders, e).color = ghostModeColor(brain);
+}
+
+// 서버 미로가 바뀌었으면 클라이언트 월드를 다시 만든다 (렌더 미러의 rebuildMirrorWorld와 같은 방식)
+void netClientRebuildWorld(NetClient& c, const NetWorldState& s) {
+    const NetMaze& m = c.maze;
+    g_gridWidth = m.width;
+    g_gridHeight = m.height;
+    clearWorld();
+    g_maze.assign(g_gridHeight, std::vector<CellType>(g_gridWidth, PATH));
+    for (int z = 0, i = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x, ++i) {
+            g_maze[z][x] = m.walls[i] ? WALL : PATH;
+        }
+    }
+    g_mazeVersion++;
+
+    g_world.collectibleAt.assign(g_gridWidth * g_gridHeight, INVALID_ENTITY);
+    const int count = static_cast<int>(s.players.size());
+    for (int w = 0; w < count; ++w) {
+        Transform pose = netPoseTransform(s.players[(c.slot + w) % count]);
+        glm::ivec2 cell = getGridCoord(pose.x, pose.z);
+        Entity e = spawnPlayer(cell.x, cell.y, w);
+        getComponent(g_world.transforms, e) = pose;
+    }
+    c.ghostEntities.clear();
+    for (const NetPose& pose : s.ghosts) {
+        Transform t = netPoseTransform(pose);
+        glm::ivec2 cell = getGridCoord(t.x, t.z);
+        Entity e = spawnGhost(cell.x, cell.y, 0, 0);
+        netSetGhostPose(e, pose, t);
+        c.ghostEntities.push_back(e);
+    }
+    c.predictedPickups.clear();
+    c.worldMazeVersion = s.mazeVersion;
+}
+
+// 입력 하나로 자기 팩맨을 움직이고, 그 사이 먹은 칸을 예측 획득으로 기억한다
+void netPredict(NetClient& c, uint32_t seq, const PlayerInput& input, float deltaTime) {
+    size_t before = g_itemChanges.size();
+    handlePlayerInput(input, 0, deltaTime);
+    for (size_t i = before; i < g_itemChanges.size(); ++i) {
+        if (g_itemChanges[i].item == 0) c.predictedPickups.push_back({ g_itemChanges[i].cell, seq });
+    }
+}
+
+// 새로 받은 가장 최근 스냅샷을 클라이언트 월드에 반영: 스칼라, 아이템, 자기 팩맨 재조정
+void netClientApplyAuthority(NetClient& c, const NetSnapshotHeader& h, const NetWorldState& s,
+    bool hasOwn, const Transform& own, double now) {
+    g_gameState = static_cast<GameState>(h.gameState);
+    g_currentStage = h.stage;
+    g_lives = h.lives;
+    g_score = h.score;
+    g_frightenedTimer = h.frightenedCs / 100.0f;
+
+    if (c.worldMazeVersion != s.mazeVersion || g_world.playerCount != static_cast<int>(s.players.size())) {
+        if (c.maze.version != s.mazeVersion) {
+            c.needFull = true;   // 미로 없이 차이만 받음 (전체가 유실됨)
+            return;
+        }
+        netClientRebuildWorld(c, s);
+    }
+
+    // 아이템: 서버 상태를 따르되, 서버가 아직 처리하지 않은 입력으로 먹은 칸은 비워 둔다
+    c.predictedPickups.erase(std::remove_if(c.predictedPickups.begin(), c.predictedPickups.end(),
+        [&](const std::pair<int, uint32_t>& p) { return p.second <= h.ackInputSeq; }), c.predictedPickups.end());
+    const int cellCount = g_gridWidth * g_gridHeight;
+    int remaining = 0;
+    for (int i = 0; i < cellCount; ++i) {
+        bool present = (s.items[i >> 5] >> (i & 31)) & 1;
+        bool have = g_world.collectibleAt[i] != INVALID_ENTITY;
+        if (!present && have) {
+            removeCollectibleAt(i % g_gridWidth, i / g_gridWidth);
+        }
+        else if (present && !have) {
+            bool predicted = false;
+            for (const auto& pickup : c.predictedPickups) predicted = predicted || pickup.first == i;
+            if (!predicted) {
+                int kind = c.maze.kinds[i] ? c.maze.kinds[i] - 1 : 0;
+                spawnCollectible(i % g_gridWidth, i / g_gridWidth, static_cast<CollectibleKind>(kind));
+                g_itemChanges.push_back(ItemChange{ i, static_cast<uint8_t>(1 + kind) });   // 렌더 미러도 되살린다 (벽은 그대로)
+            }
+        }
+        Entity item = g_world.collectibleAt[i];
+        if (item != INVALID_ENTITY && getComponent(g_world.collectibles, item).kind != CollectibleKind::SLOW_ITEM) remaining++;
+    }
+    g_remainingPellets = remaining;
+
+    // 재조정: 서버가 처리한 입력까지의 위치에서 그 뒤 입력을 다시 적용
+    if (!hasOwn || g_world.playerCount == 0) return;
+    while (!c.history.empty() && c.history.front().seq < h.ackInputSeq) c.history.pop_front();
+    if (!c.history.empty() && c.history.front().seq == h.ackInputSeq) {
+        const NetInputRecord& acked = c.history.front();
+        float error = glm::length(glm::vec2(acked.predicted.x - own.x, acked.predicted.z - own.z));
+        c.stats.predictionChecks++;
+        c.stats.errorSum += error;
+        c.stats.maxError = std::max(c.stats.maxError, static_cast<double>(error));
+        if (error > NET_CORRECTION_EPSILON) c.stats.corrections++;
+        c.stats.rttSumMs += (now - acked.sentAt) * 1000.0;
+        c.stats.rttCount++;
+        c.history.pop_front();
+    }
+
+    Transform& player = playerTransform(0);
+    player = own;
+    glm::ivec2 cell = getGridCoord(own.x, own.z);
+    getComponent(g_world.cells, g_world.players[0]) = GridCell{ cell.x, cell.y };
+    if (g_gameState != GameState::PLAYING) return;
+    const float stepSeconds = static_cast<float>(SIM_STEP_SECONDS);
+    for (NetInputRecord& record : c.history) {
+        netPredict(c, record.seq, record.input, stepSeconds);
+        record.predicted = playerTransform(0);
+    }
+}
+
+// 스냅샷 하나를 해석해 상태 링에 넣는다. 기준이 없거나 CRC가 다르면 버리고 전체를 요청한다
+void netClientApplySnapshot(NetClient& c, double now) {
+    StateReader r;
+    r.data = c.packet.data();
+    r.size = c.packet.size();
+    r.pos = 1;
+    NetSnapshotHeader h;
+    h.tick = readStateValue<uint32_t>(r);
+    h.baseTick = readStateValue<uint32_t>(r);
+    h.ackInputSeq = readStateValue<uint32_t>(r);
+    h.mazeVersion = readStateValue<int32_t>(r);
+    h.gameState = readStateValue<uint8_t>(r);
+    h.stage = readStateValue<uint8_t>(r);
+    h.lives = readStateValue<uint8_t>(r);
+    h.score = readStateValue<int32_t>(r);
+    h.frightenedCs = readStateValue<uint16_t>(r);
+    h.itemCrc = readStateValue<uint32_t>(r);
+    if (!r.ok || h.tick == 0) return;
+    c.stats.received++;
+    if (c.stats.firstTick == 0 || h.tick < c.stats.firstTick) c.stats.firstTick = h.tick;
+    // 더 최근 것보다 늦게 온 스냅샷은 풀지 않는다 (기준 상태가 이미 밀려나 전체를 다시 요청하거나,
+    // 옛 미로의 전체 스냅샷이 새 스테이지 미로를 덮어쓰지 않도록)
+    if (h.tick <= c.latestTick) {
+        c.stats.staleSnapshots++;
+        if (h.baseTick == 0 && h.mazeVersion != c.ring.slot(c.latestTick).mazeVersion) c.stats.staleMazeFulls++;
+        return;
+    }
+
+    const NetWorldState* base = nullptr;
+    if (h.baseTick != 0) {
+        base = c.ring.find(h.baseTick);
+        if (!base || base->mazeVersion != h.mazeVersion) {
+            c.stats.missingBase++;
+            c.needFull = true;
+            return;
+        }
+    }
+
+    NetWorldState next;
+    next.tick = h.tick;
+    next.mazeVersion = h.mazeVersion;
+    NetMaze maze;
+    if (base) {
+        next.items = base->items;
+        uint16_t ranges = readStateValue<uint16_t>(r);
+        for (uint16_t k = 0; k < ranges && r.ok; ++k) {
+            uint16_t first = readStateValue<uint16_t>(r);
+            uint8_t count = readStateValue<uint8_t>(r);
+            for (uint8_t w = 0; w < count && r.ok; ++w) {
+                uint32_t word = readStateValue<uint32_t>(r);
+                if (first + w < next.items.size()) next.items[first + w] = word;
+                else r.ok = false;
+            }
+        }
+    }
+    else {
+        maze.version = h.mazeVersion;
+        maze.width = readStateValue<uint16_t>(r);
+        maze.height = readStateValue<uint16_t>(r);
+        if (maze.width < 1 || maze.height < 1 || maze.width > SAVE_STATE_MAX_DIM || maze.height > SAVE_STATE_MAX_DIM) return;
+        const int cellCount = maze.width * maze.height;
+        const uint8_t* walls = readGridLayer(r, maze.width, maze.height);
+        size_t kindBytes = (cellCount * 2 + 7) / 8;
+        if (!r.ok || r.pos + kindBytes > r.size) return;
+        const uint8_t* kinds = r.data + r.pos;
+        r.pos += kindBytes;
+        maze.walls.resize(cellCount);
+        maze.kinds.resize(cellCount);
+        for (int i = 0; i < cellCount; ++i) {
+            maze.walls[i] = gridLayerBit(walls, i) ? 1 : 0;
+            maze.kinds[i] = (kinds[(i * 2) / 8] >> ((i * 2) & 7)) & 3;
+        }
+        next.items.resize((cellCount + 31) / 32);
+        for (uint32_t& word : next.items) word = readStateValue<uint32_t>(r);
+    }
+
+    int playerCount = readStateValue<uint8_t>(r);
+    if (playerCount > MAX_PLAYERS) return;
+    next.players.resize(playerCount);
+    for (NetPose& pose : next.players) {
+        pose.x = readStateValue<int16_t>(r);
+        pose.z = readStateValue<int16_t>(r);
+        pose.angle = readStateValue<uint8_t>(r);
+    }
+    bool hasOwn = c.slot < playerCount;
+    Transform own;
+    if (hasOwn) {
+        own.x = readStateValue<float>(r);
+        own.z = readStateValue<float>(r);
+        own.angleY = readStateValue<float>(r);
+    }
+
+    int ghostCount = readStateValue<uint16_t>(r);
+    next.ghosts.resize(ghostCount);
+    if (base) {
+        if (base->ghosts.size() != next.ghosts.size()) return;
+        size_t maskAt = r.pos;
+        r.pos += (ghostCount + 7) / 8;
+        if (r.pos > r.size) return;
+        for (int i = 0; i < ghostCount && r.ok; ++i) {
+            next.ghosts[i] = base->ghosts[i];
+            if (!((r.data[maskAt + (i >> 3)] >> (i & 7)) & 1)) continue;
+            NetPose& pose = next.ghosts[i];
+            if (readStateValue<uint8_t>(r)) {
+                pose.x = readStateValue<int16_t>(r);
+                pose.z = readStateValue<int16_t>(r);
+            }
+            else {
+                pose.x = static_cast<int16_t>(pose.x + readStateValue<int8_t>(r));
+                pose.z = static_cast<int16_t>(pose.z + readStateValue<int8_t>(r));
+            }
+            pose.angle = readStateValue<uint8_t>(r);
+            pose.flags = readStateValue<uint8_t>(r);
+        }
+    }
+    else {
+        for (NetPose& pose : next.ghosts) {
+            pose.x = readStateValue<int16_t>(r);
+            pose.z = readStateValue<int16_t>(r);
+            pose.angle = readStateValue<uint8_t>(r);
+            pose.flags = readStateValue<uint8_t>(r);
+        }
+    }
+    if (!r.ok) return;
+    if (netItemCrc(next.items) != h.itemCrc) {
+        c.stats.desyncs++;
+        c.needFull = true;
+        return;
+    }
+
+    c.stats.snapshots++;
+    if (!base) c.stats.fullSnapshots++;
+    if (!base) c.maze = std::move(maze);
+    NetWorldState& stored = c.ring.slot(h.tick);
+    stored = std::move(next);
+    c.latestTick = h.tick;
+    c.needFull = false;
+    netClientApplyAuthority(c, h, stored, hasOwn, own, now);
+}
+
+void netClientReceive(NetClient& c, double now) {
+    sockaddr_in from{};
+    while (netReceive(c.endpoint, c.packet, from)) {
+        if (!netSameAddress(from, c.server)) continue;
+        if (c.packet[0] == NET_WELCOME && c.packet.size() >= 3 && c.slot < 0) {
+            if (c.packet[1] == NET_NO_SLOT) c.rejected = true;
+            else c.slot = c.packet[1];
+        }
+        else if (c.packet[0] == NET_SNAPSHOT && c.slot >= 0) {
+            netClientApplySnapshot(c, now);
+        }
+    }
+}
+
+// 유령과 다른 플레이어: interpTick(최신 스냅샷보다 NET_INTERP_DELAY_TICKS 늦게 따라가는 시계)을 사이에 둔 두 상태를 보간
+void netClientInterpolate(NetClient& c) {
+    if (c.latestTick == 0 || g_world.playerCount == 0) return;
+    double target = static_cast<double>(c.latestTick) - NET_INTERP_DELAY_TICKS;
+    c.interpTick += 1.0;
+    if (std::abs(c.interpTick - target) > NET_INTERP_DELAY_TICKS * 2) c.interpTick = target;
+    else c.interpTick += (target - c.interpTick) * 0.02;   // 스냅샷 간격이 흔들려도 천천히 맞춘다
+
+    const NetWorldState* a = nullptr;
+    const NetWorldState* b = nullptr;
+    for (const NetWorldState& s : c.ring.states) {
+        if (s.tick == 0 || s.mazeVersion != c.worldMazeVersion) continue;
+        if (s.tick <= c.interpTick) {
+            if (!a || s.tick > a->tick) a = &s;
+        }
+        else if (!b || s.tick < b->tick) {
+            b = &s;
+        }
+    }
+    if (!a) {
+        a = b;
+        b = nullptr;
+    }
+    if (!a) return;
+    if (!b) c.stats.interpHolds++;
+    float t = b ? static_cast<float>((c.interpTick - a->tick) / (b->tick - a->tick)) : 0.0f;
+    t = glm::clamp(t, 0.0f, 1.0f);
+    if (b && (b->ghosts.size() != a->ghosts.size() || b->players.size() != a->players.size())) b = nullptr;
+    const NetWorldState& to = b ? *b : *a;
+
+    for (size_t i = 0; i < c.ghostEntities.size() && i < a->ghosts.size(); ++i) {
+        Transform pose = lerpTransform(netPoseTransform(a->ghosts[i]), netPoseTransform(to.ghosts[i]), t);
+        netSetGhostPose(c.ghostEntities[i], to.ghosts[i], pose);
+    }
+    const int count = static_cast<int>(a->players.size());
+    for (int slot = 0; slot < count && count == g_world.playerCount; ++slot) {
+        if (slot == c.slot) continue;
+        Transform pose = lerpTransform(netPoseTransform(a->players[slot]), netPoseTransform(to.players[slot]), t);
+        int w = netWorldIndex(c, slot, count);
+        playerTransform(w) = pose;
+        glm::ivec2 cell = getGridCoord(pose.x, pose.z);
+        getComponent(g_world.cells, g_world.players[w]) = GridCell{ cell.x, cell.y };
+    }
+}
+
+void netSendHello(NetClient& c) {
+    std::vector<uint8_t> hello;
+    putStateValue<uint8_t>(hello, NET_HELLO);
+    hello.insert(hello.end(), NET_MAGIC, NET_MAGIC + 4);
+    putStateValue<uint16_t>(hello, NET_VERSION);
+    netSend(c.endpoint, c.server, hello);
+}
+
+// 클라이언트 한 틱: 받은 스냅샷 반영 -> 입력 예측 + 전송 -> 유령 / 다른 플레이어 보간.
+// 호출 스레드의 게임 상태가 클라이언트 월드다
+void netClientTick(NetClient& c, const PlayerInput& rawInput, float deltaTime) {
+    double now = pacerNow();
+    netClientReceive(c, now);
+    if (c.slot < 0) {
+        if (!c.rejected && now - c.lastHello >= NET_HELLO_INTERVAL) {
+            netSendHello(c);
+            c.lastHello = now;
+        }
+        netFlush(c.endpoint, now);
+        return;
+    }
+
+    NetInputRecord record;
+    record.seq = c.nextInputSeq++;
+    record.input = netQuantizeInput(rawInput);
+    record.sentAt = now;
+    if (g_world.playerCount > 0) {
+        if (g_gameState == GameState::PLAYING) netPredict(c, record.seq, record.input, deltaTime);
+        record.predicted = playerTransform(0);
+    }
+    c.history.push_back(record);
+    if (c.history.size() > NET_MAX_HISTORY) c.history.pop_front();
+
+    std::vector<uint8_t> out;
+    putStateValue<uint8_t>(out, NET_INPUT);
+    putStateValue<uint32_t>(out, c.needFull ? 0 : c.latestTick);
+    putStateValue<uint32_t>(out, record.seq);
+    uint8_t count = static_cast<uint8_t>(std::min<size_t>(NET_INPUT_REDUNDANCY, c.history.size()));
+    putStateValue<uint8_t>(out, count);
+    for (size_t i = 0; i < count; ++i) {
+        const PlayerInput& input = c.history[c.history.size() - 1 - i].input;
+        putStateValue<uint8_t>(out, netInputKeys(input));
+        putStateValue<uint16_t>(out, netWrapDegrees(input.yaw, 65536.0f));
+        putStateValue<int8_t>(out, static_cast<int8_t>(std::lround(input.turn)));
+    }
+    netSend(c.endpoint, c.server, out);
+
+    netClientInterpolate(c);
+    netFlush(c.endpoint, now);
+}
+
+void printNetClientStats(const NetClient& c, int index) {
+    const NetClientStats& s = c.stats;
+    // 처음 받은 것부터 가장 최근 것 사이에 서버가 보냈을 수 중 오지 않은 것
+    long long expected = s.firstTick != 0 ? (c.latestTick - s.firstTick) / NET_SNAPSHOT_INTERVAL + 1 : 0;
+    long long lost = std::max(0LL, expected - s.received);
+    std::cout << "[net-client " << index << "] slot " << c.slot << ": snapshots " << s.snapshots << " (full " << s.fullSnapshots
+        << ", lost " << lost << ", late " << s.staleSnapshots << " (old maze full " << s.staleMazeFulls << "), missing base " << s.missingBase
+        << ", desync " << s.desyncs << "), rtt " << (s.rttCount > 0 ? s.rttSumMs / s.rttCount : 0.0) << " ms\n";
+    std::cout << "[net-client " << index << "] prediction: " << s.corrections << " corrections / " << s.predictionChecks
+        << " checks, error avg " << (s.predictionChecks > 0 ? s.errorSum / s.predictionChecks : 0.0) << " max " << s.maxError
+        << "; interpolation held " << s.interpHolds << " ticks; sent " << c.endpoint.bytesSent << " B, received "
+        << c.endpoint.bytesReceived << " B, shim dropped " << c.endpoint.packetsDropped << " packets\n";
+}
+
+// --connect HOST:PORT로 띄운 GLUT 게임의 시뮬레이션 스레드. 게임 틱 대신 서버 스냅샷을 반영하고
+// 평소와 같은 렌더 스냅샷을 게시하므로 렌더 스레드는 로컬 게임과 구별하지 않는다
+void netClientThreadMain(const std::string& address, const NetShimConfig& shim, const std::atomic<bool>& running) {
+    NetClient client;
+    if (!netOpenClient(client, address, shim, static_cast<unsigned int>(std::time(0)))) {
+        std::cerr << "cannot connect to " << address << std::endl;
+        g_quitRequested = true;
+        publishRenderSnapshot(0);
+        return;
+    }
+    g_netClientActive = true;
+    const float stepSeconds = static_cast<float>(SIM_STEP_SECONDS);
+    uint64_t tick = 0;
+    publishRenderSnapshot(tick);
+
+    double nextStep = pacerNow();
+    while (running.load(std::memory_order_acquire)) {
+        nextStep += SIM_STEP_SECONDS;
+        double now = pacerNow();
+        if (nextStep > now) std::this_thread::sleep_for(std::chrono::duration<double>(nextStep - now));
+        else if (now - nextStep > MAX_FRAME_DELTA) nextStep = now;
+
+        drainInputEvents(g_inputQueue, nullptr);
+        netClientTick(client, readKeyboardInput(), stepSeconds);
+        if (client.rejected) {
+            std::cerr << "server " << address << " is full" << std::endl;
+            g_quitRequested = true;
+        }
+        publishRenderSnapshot(++tick);
+        if (g_quitRequested) break;
+    }
+    netCloseClient(client);
+    printNetClientStats(client, 0);
+}
+
+struct SimThreadConfig {
+    bool seedLocked = false;
+    unsigned int seed = 0;
+    std::string statePath;           // 비어 있지 않으면 이 세이브 스테이트에서 시작
+    std::string connectAddress;      // 비어 있지 않으면 이 서버에 붙는 네트워크 클라이언트
+    NetShimConfig shim;
+};
+
+std::thread g_simThread;
+std::atomic<bool> g_simRunning{ false };
+
+void simulationThreadMain(SimThreadConfig config) {
+    if (!config.connectAddress.empty()) {
+        netClientThreadMain(config.connectAddress, config.shim, g_simRunning);
+        return;
+    }
+    g_seedLocked = config.seedLocked;
+    if (config.seedLocked) g_randomEngine.seed(config.seed);
+    reset();   // 타이틀 화면 뒤에 미리 미로 하나 (예전 init()과 같은 시작 상태)
+    if (!config.statePath.empty()) loadGameStateFile(config.statePath);
+    g_rewind.enabled = true;
+
+    InputRecorder* recorder = g_inputRecorder.file.is_open() ? &g_inputRecorder : nullptr;
+    const float stepSeconds = static_cast<float>(SIM_STEP_SECONDS);
+    uint64_t tick = 0;
+    publishRenderSnapshot(tick);
+
+    double nextStep = pacerNow();
+    while (g_simRunning.load(std::memory_order_acquire)) {
+        nextStep += SIM_STEP_SECONDS;
+        double now = pacerNow();
+        if (nextStep > now) std::this_thread::sleep_for(std::chrono::duration<double>(nextStep - now));
+        else if (now - nextStep > MAX_FRAME_DELTA) nextStep = now;   // 멈췄다 돌아오면 몰아서 따라잡지 않음
+
+        drainInputEvents(g_inputQueue, recorder);
+        if (!g_quitRequested) {
+            stepSimulation(readKeyboardInput(), stepSeconds);
+            if (recorder) recordInputStep(*recorder, stepSeconds);
+        }
+        publishRenderSnapshot(++tick);
+        if (g_quitRequested) break;   // 렌더 스레드가 스냅샷에서 보고 프레임 루프를 멈춘다
+    }
+    printInputStats();
+}
+
+void startSimulationThread(const SimThreadConfig& config) {
+    g_simRunning = true;
+    g_simThread = std::thread(simulationThreadMain, config);
+}
+
+void stopSimulationThread() {
+    g_simRunning = false;
+    if (g_simThread.joinable()) g_simThread.join();
+}
+
+// glutMainLoop 대신 돈다. 입력 콜백은 큐에 넣기만 하고, 그리기는 대기가 끝난 뒤 가장 최근 스냅샷으로 한다.
+void runFrameLoop() {
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+    applyPacingMode(g_pacer.mode);
+    g_pacer.running = true;
+
+    double lastFrameStart = pacerNow();
+    double nextDeadline = lastFrameStart;
+    g_pacer.windowStart = lastFrameStart;
+
+    while (g_pacer.running) {
+        if (g_pacer.mode == PacingMode::TARGET_FPS) {
+            waitUntil(nextDeadline);
+        }
+
+        double frameStart = pacerNow();
+        glutMainLoopEvent();
+        if (!g_pacer.running) break;
+
+        // 시뮬레이션 스레드가 게시한 최신 스냅샷을 반영하고 그 사이를 보간해서 그린다
+        int64_t oldestInputUs = 0;
+        if (const RenderSnapshot* snapshot = acquireRenderSnapshot()) {
+            oldestInputUs = applyRenderSnapshot(*snapshot);
+            if (snapshot->quitRequested) {
+                stopFrameLoop();
+                break;
+            }
+        }
+        applyInterpolatedPoses(pacerNow());
+
+        display();
+        // 드라이버가 프레임을 쌓아 두지 않게 스왑이 끝날 때까지 기다림 (제한 없음 모드는 처리량 우선)
+        if (g_pacer.mode != PacingMode::UNCAPPED) glFinish();
+
+        double presented = pacerNow();
+        addTiming(g_pacer.frameMs, (frameStart - lastFrameStart) * 1000.0);
+        countMetric(MC_FRAMES);
+        countMetric(MC_DRAW_CALLS, g_frameDrawCalls);
+        g_frameDrawCalls = 0;
+        recordMetricSeconds(MH_FRAME, frameStart - lastFrameStart);
+        if (oldestInputUs != 0) {
+            addTiming(g_pacer.latencyMs, presented * 1000.0 - oldestInputUs / 1000.0);
+        }
+        lastFrameStart = frameStart;
+
+        if (presented - g_pacer.windowStart >= FRAME_STATS_INTERVAL) {
+            updateFrameStatsText();
+            mergeTiming(g_pacer.totalFrameMs, g_pacer.frameMs);
+            mergeTiming(g_pacer.totalLatencyMs, g_pacer.latencyMs);
+            g_pacer.frameMs = TimingStats();
+            g_pacer.latencyMs = TimingStats();
+            g_pacer.windowStart = presented;
+        }
+
+        // 밀렸으면 따라잡으려 몰아 그리지 않고 지금부터 다시 맞춘다
+        nextDeadline += 1.0 / std::max(1.0, g_pacer.targetFps);
+        if (nextDeadline < presented) nextDeadline = presented;
+    }
+
+    mergeTiming(g_pacer.totalFrameMs, g_pacer.frameMs);
+    mergeTiming(g_pacer.totalLatencyMs, g_pacer.latencyMs);
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+void windowClosed() {
+    stopFrameLoop();
+}
+
+// 창/캡처 키는 GLUT 쪽에서 바로 처리하고, 나머지는 이벤트로 넣어 시뮬레이션 스텝에서 처리한다.
+void keyboard(unsigned char key, int x, int y) {
+    // 공통 종료 키
+    if (key == 'q' || key == 'Q') {
+        stopFrameLoop();
+        return;
+    }
+
+    // 공통 캡처 키
+    if (key == 'p' || key == 'P') {
+        requestScreenshot();
+        return;
+    }
+    if (key == 'm' || key == 'M') {
+        toggleRecording();
+        return;
+    }
+
+    pushInputEvent(g_inputQueue, InputEventType::KEY_DOWN, key, 0.0f);
+}
+
+void keyboardUp(unsigned char key, int x, int y) {
+    pushInputEvent(g_inputQueue, InputEventType::KEY_UP, key, 0.0f);
+}
+
+void specialKey(int key, int x, int y) {
+    // 페이싱 키: F2 = 모드 변경, F3 = 프레임 통계 표시
+    if (key == GLUT_KEY_F2) {
+        applyPacingMode(nextPacingMode(g_pacer.mode));
+        return;
+    }
+    if (key == GLUT_KEY_F3) {
+        g_pacer.showStats = !g_pacer.showStats;
+        updateFrameStatsText();
+        return;
+    }
+    pushInputEvent(g_inputQueue, InputEventType::SPECIAL_DOWN, key, 0.0f);
+}
+
+void specialKeyUp(int key, int x, int y) {
+    pushInputEvent(g_inputQueue, InputEventType::SPECIAL_UP, key, 0.0f);
+}
+
+void mouseMotion(int x, int y) {
+    (void)y;
+    if (g_lastMouseX < 0) {
+        g_lastMouseX = static_cast<float>(x);
+        return;
+    }
+
+    float dx = static_cast<float>(x) - g_lastMouseX;
+    g_lastMouseX = static_cast<float>(x);
+
+    pushInputEvent(g_inputQueue, InputEventType::YAW_DELTA, 0, dx * g_mouseSensitivity);
+}
+
+// ---- 봇 드라이버 (부하 / 장시간 테스트용) ----
+// 봇은 키보드/마우스와 같은 입력 이벤트를 큐에 넣고, 시뮬레이션은 사람이 할 때와 똑같이 큐를 비운다.
+
+enum class BotPolicy {
+    RANDOM_WALK,     // 갈림길마다 무작위 선택
+    GREEDY_PELLET,   // BFS로 가장 가까운 펠릿을 향해 이동
+    AVOID_GHOSTS     // 가까운 펠릿을 향하되 유령 근처는 피해서 이동
+};
+
+struct BotState {
+    BotPolicy policy = BotPolicy::RANDOM_WALK;
+    std::mt19937 rng;                            // 게임 RNG와 분리된 봇 전용 난수
+    glm::ivec2 target = glm::ivec2(-1, -1);      // 지금 향하고 있는 칸
+    glm::ivec2 lastDir = glm::ivec2(0, 0);
+
+    // BFS 작업 버퍼 (결정할 때마다 새로 할당하지 않도록 재사용)
+    std::vector<int> parent;
+    std::vector<int> ghostDist;
+    std::vector<int> queue;
+};
+
+const int BOT_DANGER_RADIUS = 3;       // 유령과 이 칸 수 이하로 가까우면 위험
+const int BOT_GHOST_SCAN_RADIUS = 8;   // 유령 거리 필드를 계산할 최대 반경
+
+const int BOT_DIR_X[4] = { 1, -1, 0, 0 };
+const int BOT_DIR_Z[4] = { 0, 0, 1, -1 };
+
+// 유령들로부터의 칸 거리 (다중 시작점 BFS, BOT_GHOST_SCAN_RADIUS 까지만)
+void botComputeGhostDistance(BotState& bot) {
+    const int cellCount = g_gridWidth * g_gridHeight;
+    bot.ghostDist.assign(cellCount, std::numeric_limits<int>::max());
+    bot.queue.clear();
+
+    for (size_t i = 0; i < g_world.movements.owner.size(); ++i) {
+        Entity e = g_world.movements.owner[i];
+        if (getComponent(g_world.brains, e).mode != GhostMode::NORMAL) continue;   // 겁먹었거나 잡힌 유령은 위험하지 않음
+        const GridCell& g = getComponent(g_world.cells, e);
+        if (!isPathCell(g.x, g.z)) continue;
+        int idx = g.z * g_gridWidth + g.x;
+        if (bot.ghostDist[idx] == 0) continue;
+        bot.ghostDist[idx] = 0;
+        bot.queue.push_back(idx);
+    }
+
+    for (size_t head = 0; head < bot.queue.size(); ++head) {
+        int idx = bot.queue[head];
+        int d = bot.ghostDist[idx];
+        if (d >= BOT_GHOST_SCAN_RADIUS) continue;
+        int x = idx % g_gridWidth;
+        int z = idx / g_gridWidth;
+        for (int i = 0; i < 4; ++i) {
+            int nx = x + BOT_DIR_X[i];
+            int nz = z + BOT_DIR_Z[i];
+            if (!isPathCell(nx, nz)) continue;
+            int nIdx = nz * g_gridWidth + nx;
+            if (bot.ghostDist[nIdx] <= d + 1) continue;
+            bot.ghostDist[nIdx] = d + 1;
+            bot.queue.push_back(nIdx);
+        }
+    }
+}
+
+// 시작 칸에서 BFS로 가장 가까운 펠릿(또는 슬로우 아이템)까지 가는 첫 걸음 방향.
+// avoidGhosts면 유령 거리 BOT_DANGER_RADIUS 이하인 칸은 지나가지 않는다. 못 찾으면 (0, 0).
+glm::ivec2 botStepTowardNearestPellet(BotState& bot, glm::ivec2 start, bool avoidGhosts) {
+    const int cellCount = g_gridWidth * g_gridHeight;
+    bot.parent.assign(cellCount, -1);
+    bot.queue.clear();
+
+    int startIdx = start.y * g_gridWidth + start.x;
+    bot.parent[startIdx] = startIdx;
+    bot.queue.push_back(startIdx);
+
+    for (size_t head = 0; head < bot.queue.size(); ++head) {
+        int idx = bot.queue[head];
+        int x = idx % g_gridWidth;
+        int z = idx / g_gridWidth;
+
+        if (idx != startIdx && collectibleAt(x, z) != INVALID_ENTITY) {
+            // 시작 칸 바로 다음 칸까지 거슬러 올라감
+            while (bot.parent[idx] != startIdx) {
+                idx = bot.parent[idx];
+            }
+            return glm::ivec2(idx % g_gridWidth - start.x, idx / g_gridWidth - start.y);
+        }
+
+        for (int i = 0; i < 4; ++i) {
+            int nx = x + BOT_DIR_X[i];
+            int nz = z + BOT_DIR_Z[i];
+            if (!isPathCell(nx, nz)) continue;
+            int nIdx = nz * g_gridWidth + nx;
+            if (bot.parent[nIdx] != -1) continue;
+            if (avoidGhosts && bot.ghostDist[nIdx] <= BOT_DANGER_RADIUS) continue;
+            bot.parent[nIdx] = idx;
+            bot.queue.push_back(nIdx);
+        }
+    }
+    return glm::ivec2(0, 0);
+}
+
+glm::ivec2 botPolicyRandomWalk(BotState& bot, glm::ivec2 cell) {
+    glm::ivec2 options[4];
+    int count = 0;
+    glm::ivec2 reverse(-bot.lastDir.x, -bot.lastDir.y);
+
+    for (int i = 0; i < 4; ++i) {
+        glm::ivec2 dir(BOT_DIR_X[i], BOT_DIR_Z[i]);
+        if (!isPathCell(cell.x + dir.x, cell.y + dir.y)) continue;
+        if (dir == reverse) continue;
+        options[count++] = dir;
+    }
+
+    if (count == 0) {
+        // 막다른 길: 되돌아감
+        return isPathCell(cell.x + reverse.x, cell.y + reverse.y) ? reverse : glm::ivec2(0, 0);
+    }
+    std::uniform_int_distribution<int> pick(0, count - 1);
+    return options[pick(bot.rng)];
+}
+
+glm::ivec2 botPolicyGreedyPellet(BotState& bot, glm::ivec2 cell) {
+    glm::ivec2 dir = botStepTowardNearestPellet(bot, cell, false);
+    if (dir == glm::ivec2(0, 0)) {
+        return botPolicyRandomWalk(bot, cell);
+    }
+    return dir;
+}
+
+glm::ivec2 botPolicyAvoidGhosts(BotState& bot, glm::ivec2 cell) {
+    botComputeGhostDistance(bot);
+
+    int here = bot.ghostDist[cell.y * g_gridWidth + cell.x];
+    if (here <= BOT_DANGER_RADIUS) {
+        // 위험: 유령 거리가 가장 멀어지는 이웃 칸으로 도망
+        glm::ivec2 best(0, 0);
+        int bestDist = -1;
+        for (int i = 0; i < 4; ++i) {
+            int nx = cell.x + BOT_DIR_X[i];
+            int nz = cell.y + BOT_DIR_Z[i];
+            if (!isPathCell(nx, nz)) continue;
+            int d = bot.ghostDist[nz * g_gridWidth + nx];
+            if (d > bestDist) {
+                bestDist = d;
+                best = glm::ivec2(BOT_DIR_X[i], BOT_DIR_Z[i]);
+            }
+        }
+        return best;
+    }
+
+    glm::ivec2 dir = botStepTowardNearestPellet(bot, cell, true);
+    if (dir == glm::ivec2(0, 0)) {
+        return botPolicyRandomWalk(bot, cell);
+    }
+    return dir;
+}
+
+typedef glm::ivec2 (*BotPolicyFn)(BotState& bot, glm::ivec2 cell);
+
+struct BotPolicyEntry {
+    BotPolicy policy;
+    const char* name;
+    BotPolicyFn decide;
+};
+
+const BotPolicyEntry BOT_POLICIES[] = {
+    { BotPolicy::RANDOM_WALK,   "random", botPolicyRandomWalk },
+    { BotPolicy::GREEDY_PELLET, "greedy", botPolicyGreedyPellet },
+    { BotPolicy::AVOID_GHOSTS,  "avoid",  botPolicyAvoidGhosts },
+};
+
+const BotPolicyEntry& findBotPolicy(BotPolicy policy) {
+    for (const BotPolicyEntry& entry : BOT_POLICIES) {
+        if (entry.policy == policy) return entry;
+    }
+    return BOT_POLICIES[0];
+}
+
+// 이름으로 정책을 찾는다. 없으면 쓸 수 있는 이름을 알려 주고 false
+bool parseBotPolicyName(const std::string& name, BotPolicy& policy) {
+    for (const BotPolicyEntry& entry : BOT_POLICIES) {
+        if (name == entry.name) {
+            policy = entry.policy;
+            return true;
+        }
+    }
+    std::cerr << "unknown bot policy: " << name << " (expected";
+    for (const BotPolicyEntry& entry : BOT_POLICIES) std::cerr << " " << entry.name;
+    std::cerr << ")" << std::endl;
+    return false;
+}
+
+// 칸 단위로 다음 목표를 정하고, 목표 칸 중심을 바라보며 전진하는 입력을 만든다.
+PlayerInput botThink(BotState& bot, float deltaTime, int playerIndex = 0) {
+    PlayerInput input;
+    const Transform& player = playerTransform(playerIndex);
+    glm::ivec2 cell = getGridCoord(player.x, player.z);
+    if (!isPathCell(cell.x, cell.y)) return input;
+
+    // 한 틱 이동량보다 가까우면 도착으로 본다 (큰 deltaTime에서도 목표 주변을 맴돌지 않게)
+    float arriveDist = std::max(0.1f, PLAYER_MOVE_SPEED * deltaTime);
+
+    bool needTarget = bot.target.x < 0;
+    if (!needTarget) {
+        // 리셋 등으로 목표가 인접 칸이 아니게 되면 다시 결정
+        if (std::abs(bot.target.x - cell.x) + std::abs(bot.target.y - cell.y) > 1) {
+            needTarget = true;
+        }
+        else {
+            glm::vec3 targetPos = getWorldPos(bot.target.x, bot.target.y);
+            float dx = targetPos.x - player.x;
+            float dz = targetPos.z - player.z;
+            needTarget = (dx * dx + dz * dz) < arriveDist * arriveDist;
+        }
+    }
+
+    if (needTarget) {
+        glm::ivec2 dir = findBotPolicy(bot.policy).decide(bot, cell);
+        if (dir != glm::ivec2(0, 0)) {
+            bot.lastDir = dir;
+        }
+        bot.target = cell + dir;
+    }
+
+    glm::vec3 targetPos = getWorldPos(bot.target.x, bot.target.y);
+    float dx = targetPos.x - player.x;
+    float dz = targetPos.z - player.z;
+    if (dx * dx + dz * dz > 1e-6f) {
+        input.forward = true;
+        input.yaw = glm::degrees(std::atan2(dx, dz));
+    }
+    return input;
+}
+
+// botThink의 결정을 입력 이벤트로 바꿔 넣는다: 카메라 회전(YAW_DELTA)과 'w' 누름/뗌.
+// 키 상태는 시뮬레이션 쪽 값과 비교하므로 reset()으로 키가 풀려도 다시 누른다.
+// 이보다 작은 시선 차이는 보내지 않는다 (직진 중 atan2 반올림 차이로 매 틱 YAW_DELTA가 기록되지 않게)
+const float BOT_YAW_EPSILON = 0.01f;   // 도
+
+void botEmitInput(const PlayerInput& desired, InputQueue& queue) {
+    if (desired.forward && std::fabs(desired.yaw - g_playerYaw[0]) > BOT_YAW_EPSILON) {
+        pushInputEvent(queue, InputEventType::YAW_DELTA, 0, desired.yaw - g_playerYaw[0]);
+    }
+    if (desired.forward != g_keyStates['w']) {
+        pushInputEvent(queue, desired.forward ? InputEventType::KEY_DOWN : InputEventType::KEY_UP, 'w', 0.0f);
+    }
+}
+
+// 플레이어 칸에서 닿을 수 없는 펠릿/아이템 수 (0이 아니면 미로 생성 이상)
+int countUnreachableCollectibles(std::vector<int>& visited, std::vector<int>& queue) {
+    glm::ivec2 start = getGridCoord(playerTransform().x, playerTransform().z);
+    visited.assign(g_gridWidth * g_gridHeight, 0);
+    queue.clear();
+
+    if (isPathCell(start.x, start.y)) {
+        int startIdx = start.y * g_gridWidth + start.x;
+        visited[startIdx] = 1;
+        queue.push_back(startIdx);
+    }
+
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int x = queue[head] % g_gridWidth;
+        int z = queue[head] / g_gridWidth;
+        for (int i = 0; i < 4; ++i) {
+            int nx = x + BOT_DIR_X[i];
+            int nz = z + BOT_DIR_Z[i];
+            if (!isPathCell(nx, nz)) continue;
+            int nIdx = nz * g_gridWidth + nx;
+            if (visited[nIdx]) continue;
+            visited[nIdx] = 1;
+            queue.push_back(nIdx);
+        }
+    }
+
+    int unreachable = 0;
+    for (size_t i = 0; i < g_world.collectibles.owner.size(); ++i) {
+        const GridCell& cell = getComponent(g_world.cells, g_world.collectibles.owner[i]);
+        if (!visited[cell.z * g_gridWidth + cell.x]) {
+            unreachable++;
+        }
+    }
+    return unreachable;
+}
+
+struct BotSoakConfig {
+    int games = 64;
+    int threads = 0;                       // 0 = 하드웨어 스레드 수
+    int maxTicks = 60 * 60 * 5;            // 게임당 최대 틱 (60Hz 기준 5분)
+    float tickSeconds = 1.0f / 60.0f;
+    BotPolicy policy = BotPolicy::AVOID_GHOSTS;
+    unsigned int seed = 1;
+};
+
+struct BotSoakStats {
+    long long ticks = 0;
+    int games = 0;
+    int wins = 0;
+    int losses = 0;
+    int timeouts = 0;
+    long long scoreSum = 0;
+    int stuckCount = 0;
+    int unreachableCount = 0;
+    std::vector<std::string> anomalies;    // 재현용 시드가 들어간 메시지
+    SimLodStats lod;
+};
+
+const float BOT_STUCK_SECONDS = 5.0f;      // 같은 칸에 이만큼 머무르면 stuck으로 기록
+const size_t BOT_MAX_ANOMALY_LOGS = 16;
+
+void botRecordAnomaly(BotSoakStats& stats, const std::string& message) {
+    if (stats.anomalies.size() < BOT_MAX_ANOMALY_LOGS) {
+        stats.anomalies.push_back(message);
+    }
+}
+
+// 게임 하나를 끝까지(클리어 / 게임오버 / 틱 제한) 돌린다. 호출 스레드의 게임 상태를 사용.
+void runBotGame(const BotSoakConfig& config, int gameIndex, BotSoakStats& stats) {
+    unsigned int gameSeed = config.seed + static_cast<unsigned int>(gameIndex);
+    g_seedLocked = true;
+    g_randomEngine.seed(gameSeed);
+
+    BotState bot;
+    bot.policy = config.policy;
+    bot.rng.seed(gameSeed * 2654435761u);
+
+    std::vector<int> visited;
+    std::vector<int> queue;
+    InputQueue inputQueue;
+
+    startNewGame();
+
+    const int stuckLimit = std::max(1, static_cast<int>(BOT_STUCK_SECONDS / config.tickSeconds));
+    int stuckTicks = 0;
+    bool stuckReported = false;
+    glm::ivec2 lastCell = getGridCoord(playerTransform().x, playerTransform().z);
+    int lastLives = g_lives;
+    bool newMaze = true;
+
+    for (int tick = 0; tick < config.maxTicks; ++tick) {
+        if (newMaze) {
+            // 탐험 창은 큰 미로를 잘라 낸 것이라 창 안에서는 끊겨 보이는 펠릿이 있다 (생성기가 이어짐을 보장)
+            int unreachable = g_exploreActive ? 0 : countUnreachableCollectibles(visited, queue);
+            if (unreachable > 0) {
+                stats.unreachableCount++;
+                botRecordAnomaly(stats, "game " + std::to_string(gameIndex) + " (seed " + std::to_string(gameSeed) +
+                    "): " + std::to_string(unreachable) + " unreachable pellets on stage " + std::to_string(g_currentStage));
+            }
+            bot.target = glm::ivec2(-1, -1);
+            stuckTicks = 0;
+            newMaze = false;
+        }
+
+        botEmitInput(botThink(bot, config.tickSeconds), inputQueue);
+        drainInputEvents(inputQueue, nullptr);
+        stepSimulation(readKeyboardInput(), config.tickSeconds);
+        stats.ticks++;
+
+        if (g_gameState == GameState::GAME_OVER) {
+            stats.losses++;
+            stats.scoreSum += g_score;
+            return;
+        }
+        if (g_gameState == GameState::GAME_CLEAR) {
+            if (g_currentStage < lastStage()) {
+                g_currentStage++;
+                reset();
+                g_gameState = GameState::PLAYING;
+                newMaze = true;
+                lastLives = g_lives;
+                continue;
+            }
+            stats.wins++;
+            stats.scoreSum += g_score;
+            return;
+        }
+        if (g_lives != lastLives) {
+            // 유령에게 잡혀 reset()으로 미로가 새로 만들어짐
+            lastLives = g_lives;
+            newMaze = true;
+            continue;
+        }
+
+        glm::ivec2 cell = getGridCoord(playerTransform().x, playerTransform().z);
+        if (cell == lastCell) {
+            if (++stuckTicks >= stuckLimit && !stuckReported) {
+                stuckReported = true;
+                stats.stuckCount++;
+                botRecordAnomaly(stats, "game " + std::to_string(gameIndex) + " (seed " + std::to_string(gameSeed) +
+                    "): player stuck at (" + std::to_string(cell.x) + ", " + std::to_string(cell.y) +
+                    ") on stage " + std::to_string(g_currentStage) + " tick " + std::to_string(tick));
+            }
+        }
+        else {
+            stuckTicks = 0;
+            lastCell = cell;
+        }
+    }
+
+    stats.timeouts++;
+    stats.scoreSum += g_score;
+}
+
+int runBotSoak(const BotSoakConfig& config) {
+    int threadCount = config.threads > 0 ? config.threads : static_cast<int>(std::thread::hardware_concurrency());
+    if (threadCount <= 0) threadCount = 1;
+    threadCount = std::min(threadCount, std::max(1, config.games));
+
+    std::atomic<int> nextGame(0);
+    std::vector<BotSoakStats> workerStats(threadCount);
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&, t]() {
+            for (;;) {
+                int gameIndex = nextGame.fetch_add(1);
+                if (gameIndex >= config.games) break;
+                runBotGame(config, gameIndex, workerStats[t]);
+                workerStats[t].games++;
+            }
+            workerStats[t].lod = g_simLodStats;
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    BotSoakStats total;
+    for (const BotSoakStats& w : workerStats) {
+        total.ticks += w.ticks;
+        total.games += w.games;
+        total.wins += w.wins;
+        total.losses += w.losses;
+        total.timeouts += w.timeouts;
+        total.scoreSum += w.scoreSum;
+        total.stuckCount += w.stuckCount;
+        total.unreachableCount += w.unreachableCount;
+        for (int level = 0; level < SIM_LOD_LEVELS; ++level) total.lod.updates[level] += w.lod.updates[level];
+        total.lod.deferred += w.lod.deferred;
+        total.lod.flushes += w.lod.flushes;
+        total.lod.unsafeDeferrals += w.lod.unsafeDeferrals;
+        for (const std::string& msg : w.anomalies) botRecordAnomaly(total, msg);
+    }
+    if (seconds <= 0.0) seconds = 1e-9;
+
+    std::cout << "[bot-soak] policy=" << findBotPolicy(config.policy).name
+        << " games=" << total.games << " threads=" << threadCount << " seed=" << config.seed << "\n";
+    std::cout << "[bot-soak] " << seconds << " s, " << (total.games / seconds) << " games/s, "
+        << (total.ticks / seconds) << " ticks/s (" << total.ticks << " ticks)\n";
+    std::cout << "[bot-soak] wins " << total.wins << " / losses " << total.losses << " / timeouts " << total.timeouts
+        << ", avg score " << (total.games > 0 ? total.scoreSum / total.games : 0) << "\n";
+    long long ghostTicks = total.lod.deferred;
+    for (long long updates : total.lod.updates) ghostTicks += updates;
+    std::cout << "[bot-soak] sim lod " << (g_simLodEnabled ? "on" : "off") << ": ghost updates full/half/quarter/eighth "
+        << total.lod.updates[0] << " / " << total.lod.updates[1] << " / " << total.lod.updates[2] << " / " << total.lod.updates[3]
+        << ", skipped " << (ghostTicks > 0 ? 100.0 * total.lod.deferred / ghostTicks : 0.0) << "% of ghost ticks, "
+        << total.lod.flushes << " flushes\n";
+    std::cout << "[bot-soak] anomalies: stuck " << total.stuckCount
+        << ", unreachable pellets " << total.unreachableCount << ", unsafe lod deferrals " << total.lod.unsafeDeferrals << "\n";
+    for (const std::string& msg : total.anomalies) {
+        std::cout << "  - " << msg << "\n";
+    }
+
+    return (total.stuckCount + total.unreachableCount + total.lod.unsafeDeferrals) > 0 ? 1 : 0;
+}
+
+// --bot-soak [--games N] [--threads N] [--ticks N] [--policy random|greedy|avoid] [--seed N]
+int runBotSoakFromArgs(int argc, char** argv) {
+    BotSoakConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--games" && hasValue) config.games = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) config.threads = std::atoi(argv[++i]);
+        else if (arg == "--ticks" && hasValue) config.maxTicks = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--policy" && hasValue && !parseBotPolicyName(argv[++i], config.policy)) return 2;
+    }
+    return runBotSoak(config);
+}
+
+// ---- 네트워크: 권한 서버 / 루프백 시험 (--server, --net-test) ----
+// 서버는 120Hz 고정 스텝으로 게임을 돌리고 2틱마다 접속한 클라이언트마다 스냅샷을 만든다. 클라이언트 입력은
+// 번호순으로 쌓아 두었다가 틱마다 하나씩 쓴다. 비었으면 직전 입력을 반복하고(굶음), 너무 쌓이면 오래된 것을 버린다.
+// 빈 자리는 --bot이 주어지면 서버 봇이, 아니면 가만히 선 팩맨이 채운다.
+
+const int NET_MAX_PENDING_INPUTS = 16;   // 120Hz 기준 약 130ms. 흔들림이 이보다 크면 오래된 입력을 버린다
+const double NET_CLIENT_TIMEOUT = 5.0;
+const double NET_RESTART_DELAY = 3.0;     // 게임오버 / 마지막 스테이지 클리어 뒤 새 게임까지
+
+struct NetServerConfig {
+    uint16_t port = NET_PORT_DEFAULT;
+    bool loopbackOnly = false;
+    int players = 1;                      // 자리 수 (reset()이 만드는 팩맨 수)
+    long long maxTicks = 0;               // 0 = 끝없이
+    bool botFill = false;                 // 빈 자리를 서버 봇으로 채우고 바로 시작
+    BotPolicy botPolicy = BotPolicy::GREEDY_PELLET;
+    bool seedLocked = false;
+    unsigned int seed = 0;
+    NetShimConfig shim;
+};
+
+struct NetPendingInput {
+    uint32_t seq;
+    PlayerInput input;
+};
+
+struct NetServerClient {
+    bool connected = false;
+    sockaddr_in address{};
+    double lastHeard = 0.0;
+    uint32_t ackedTick = 0;               // 클라이언트가 가진 가장 최근 스냅샷 (0 = 전체 필요)
+    uint32_t lastInputSeq = 0;            // 마지막으로 적용한 입력
+    std::vector<NetPendingInput> pending; // 아직 적용 안 한 입력 (seq 순)
+    PlayerInput lastInput;
+    long long bytesSent = 0;
+    long long snapshots = 0;
+    long long fullSnapshots = 0;
+    long long starvedTicks = 0;
+    long long droppedInputs = 0;
+    double cpuSeconds = 0.0;              // 이 클라이언트 스냅샷을 만들고 보내는 데 쓴 시간
+};
+
+struct NetServer {
+    NetServerConfig config;
+    NetEndpoint endpoint;
+    NetServerClient clients[MAX_PLAYERS];
+    NetStateRing history;
+    BotState bots[MAX_PLAYERS];
+    uint32_t tick = 1;
+    double restartAt = -1.0;
+    std::vector<uint8_t> packet;
+    std::vector<uint8_t> out;
+    long long simTicks = 0;
+    double simCpuSeconds = 0.0;
+    long long deltaBytes = 0;
+    long long fullBytes = 0;
+    long long deltaCount = 0;
+    long long fullCount = 0;
+};
+
+int netConnectedClients(const NetServer& s) {
+    int n = 0;
+    for (int p = 0; p < s.config.players; ++p) n += s.clients[p].connected ? 1 : 0;
+    return n;
+}
+
+void netServerWelcome(NetServer& s, const sockaddr_in& to, uint8_t slot) {
+    std::vector<uint8_t> welcome;
+    putStateValue<uint8_t>(welcome, NET_WELCOME);
+    putStateValue<uint8_t>(welcome, slot);
+    putStateValue<uint8_t>(welcome, static_cast<uint8_t>(s.config.players));
+    netSend(s.endpoint, to, welcome);
+}
+
+void netServerHandleInput(NetServerClient& client, NetServer& s) {
+    StateReader r;
+    r.data = s.packet.data();
+    r.size = s.packet.size();
+    r.pos = 1;
+    uint32_t ackTick = readStateValue<uint32_t>(r);
+    uint32_t newestSeq = readStateValue<uint32_t>(r);
+    uint8_t count = readStateValue<uint8_t>(r);
+    if (!r.ok) return;
+    if (ackTick == 0) client.ackedTick = 0;
+    else client.ackedTick = std::max(client.ackedTick, ackTick);
+
+    for (uint8_t i = 0; i < count; ++i) {
+        uint8_t keys = readStateValue<uint8_t>(r);
+        uint16_t yaw = readStateValue<uint16_t>(r);
+        int8_t turn = readStateValue<int8_t>(r);
+        if (!r.ok || newestSeq < i + 1u) break;
+        uint32_t seq = newestSeq - i;
+        if (seq <= client.lastInputSeq) break;   // 나머지는 더 오래됨
+        auto at = std::lower_bound(client.pending.begin(), client.pending.end(), seq,
+            [](const NetPendingInput& p, uint32_t value) { return p.seq < value; });
+        if (at != client.pending.end() && at->seq == seq) continue;
+        client.pending.insert(at, NetPendingInput{ seq, netInputFromWire(keys, yaw, turn) });
+    }
+}
+
+void netServerReceive(NetServer& s, double now) {
+    sockaddr_in from{};
+    while (netReceive(s.endpoint, s.packet, from)) {
+        int slot = -1;
+        for (int p = 0; p < s.config.players; ++p) {
+            if (s.clients[p].connected && netSameAddress(s.clients[p].address, from)) slot = p;
+        }
+        uint8_t type = s.packet[0];
+        if (type == NET_HELLO) {
+            if (s.packet.size() < 7 || std::memcmp(s.packet.data() + 1, NET_MAGIC, 4) != 0) continue;
+            uint16_t version;
+            std::memcpy(&version, s.packet.data() + 5, sizeof(version));
+            if (version != NET_VERSION) continue;
+            if (slot < 0) {
+                for (int p = 0; p < s.config.players && slot < 0; ++p) {
+                    if (!s.clients[p].connected) slot = p;
+                }
+                if (slot >= 0) {
+                    s.clients[slot] = NetServerClient();
+                    s.clients[slot].connected = true;
+                    s.clients[slot].address = from;
+                    std::cout << "[net-server] client joined slot " << slot << std::endl;
+                }
+            }
+            if (slot >= 0) s.clients[slot].lastHeard = now;
+            netServerWelcome(s, from, slot >= 0 ? static_cast<uint8_t>(slot) : NET_NO_SLOT);   // WELCOME이 유실되면 HELLO가 다시 옴
+            continue;
+        }
+        if (slot < 0) continue;
+        NetServerClient& client = s.clients[slot];
+        client.lastHeard = now;
+        if (type == NET_INPUT) {
+            netServerHandleInput(client, s);
+        }
+        else if (type == NET_BYE) {
+            client.connected = false;
+            std::cout << "[net-server] client left slot " << slot << std::endl;
+        }
+    }
+    for (int p = 0; p < s.config.players; ++p) {
+        if (s.clients[p].connected && now - s.clients[p].lastHeard > NET_CLIENT_TIMEOUT) {
+            s.clients[p].connected = false;
+            std::cout << "[net-server] client timed out in slot " << p << std::endl;
+        }
+    }
+}
+
+// 틱마다 자리마다 입력 하나
+PlayerInput netServerNextInput(NetServer& s, int slot, float deltaTime) {
+    NetServerClient& client = s.clients[slot];
+    if (!client.connected) {
+        if (s.config.botFill && g_gameState == GameState::PLAYING) return botThink(s.bots[slot], deltaTime, slot);
+        return PlayerInput();
+    }
+    while (client.pending.size() > static_cast<size_t>(NET_MAX_PENDING_INPUTS)) {
+        client.pending.erase(client.pending.begin());
+        client.droppedInputs++;
+    }
+    if (client.pending.empty()) {
+        if (g_gameState == GameState::PLAYING) client.starvedTicks++;
+        return client.lastInput;
+    }
+    NetPendingInput next = client.pending.front();
+    client.pending.erase(client.pending.begin());
+    client.lastInputSeq = next.seq;
+    client.lastInput = next.input;
+    return next.input;
+}
+
+// 다음 스테이지 / 새 게임 (GLUT 게임에서는 키로 넘기는 부분)
+void netServerAdvanceGame(NetServer& s, double now) {
+    int connected = netConnectedClients(s);
+    if (g_gameState == GameState::TITLE) {
+        if (connected > 0 && (s.config.botFill || connected == s.config.players)) {
+            startNewGame();
+            for (BotState& bot : s.bots) bot.target = glm::ivec2(-1, -1);
+        }
+    }
+    else if (g_gameState == GameState::GAME_CLEAR && g_currentStage < MAX_STAGE) {
+        g_currentStage++;
+        reset();
+        g_gameState = GameState::PLAYING;
+        for (BotState& bot : s.bots) bot.target = glm::ivec2(-1, -1);
+    }
+    else if (g_gameState == GameState::GAME_OVER || g_gameState == GameState::GAME_CLEAR) {
+        if (s.restartAt < 0.0) s.restartAt = now + NET_RESTART_DELAY;
+        if (now >= s.restartAt) {
+            s.restartAt = -1.0;
+            goToTitle();
+        }
+    }
+    else if (connected == 0 && !s.config.botFill) {
+        goToTitle();   // 모두 나가면 다음 사람이 처음부터
+    }
+}
+
+void netServerSendSnapshots(NetServer& s) {
+    NetWorldState& cur = s.history.slot(s.tick);
+    netCaptureWorld(cur, s.tick);
+    for (int p = 0; p < s.config.players; ++p) {
+        NetServerClient& client = s.clients[p];
+        if (!client.connected) continue;
+        double cpuStart = threadCpuSeconds();
+        const NetWorldState* base = s.history.find(client.ackedTick);
+        if (base && (base == &cur || base->mazeVersion != cur.mazeVersion || base->ghosts.size() != cur.ghosts.size())) base = nullptr;
+        netEncodeSnapshot(s.out, cur, base, client.lastInputSeq, p);
+        long long before = s.endpoint.bytesSent;
+        netSend(s.endpoint, client.address, s.out);
+        client.bytesSent += s.endpoint.bytesSent - before;
+        client.snapshots++;
+        if (base) {
+            s.deltaBytes += s.out.size();
+            s.deltaCount++;
+        }
+        else {
+            client.fullSnapshots++;
+            s.fullBytes += s.out.size();
+            s.fullCount++;
+        }
+        client.cpuSeconds += threadCpuSeconds() - cpuStart;
+    }
+}
+
+void printNetServerStats(const NetServer& s) {
+    long long ticks = std::max<long long>(1, s.simTicks);
+    std::cout << "[net-server] " << s.simTicks << " ticks, sim " << (s.simCpuSeconds / ticks * 1e6) << " us/tick cpu\n";
+    std::cout << "[net-server] snapshots: " << s.deltaCount << " delta (avg "
+        << (s.deltaCount > 0 ? s.deltaBytes / s.deltaCount : 0) << " B), " << s.fullCount << " full (avg "
+        << (s.fullCount > 0 ? s.fullBytes / s.fullCount : 0) << " B); sent " << s.endpoint.bytesSent << " B ("
+        << (static_cast<double>(s.endpoint.bytesSent) / ticks) << " B/tick), shim dropped " << s.endpoint.packetsDropped
+        << ", replayed " << s.endpoint.packetsReplayed << "\n";
+    for (int p = 0; p < s.config.players; ++p) {
+        const NetServerClient& c = s.clients[p];
+        if (c.snapshots == 0) continue;
+        std::cout << "[net-server] slot " << p << ": " << (static_cast<double>(c.bytesSent) / ticks) << " B/tick, "
+            << c.snapshots << " snapshots (" << c.fullSnapshots << " full), " << (c.cpuSeconds / ticks * 1e6)
+            << " us/tick cpu, starved " << c.starvedTicks << " ticks, dropped " << c.droppedInputs << " inputs\n";
+    }
+}
+
+// running이 false가 되거나 maxTicks를 채울 때까지 서버를 돌린다. 호출 스레드의 게임 상태가 권한 월드
+int runNetServer(NetServer& s, const std::atomic<bool>& running) {
+    g_playerCount = s.config.players;
+    g_seedLocked = s.config.seedLocked;
+    if (s.config.seedLocked) g_randomEngine.seed(s.config.seed);
+    for (int p = 0; p < MAX_PLAYERS; ++p) {
+        s.bots[p].policy = s.config.botPolicy;
+        s.bots[p].rng.seed(s.config.seed * 2654435761u + p);
+    }
+    reset();
+    g_gameState = GameState::TITLE;
+
+    const float stepSeconds = static_cast<float>(SIM_STEP_SECONDS);
+    PlayerInput inputs[MAX_PLAYERS];
+    double nextStep = pacerNow();
+    while (running.load(std::memory_order_acquire) && (s.config.maxTicks <= 0 || s.simTicks < s.config.maxTicks)) {
+        nextStep += SIM_STEP_SECONDS;
+        double now = pacerNow();
+        if (nextStep > now) std::this_thread::sleep_for(std::chrono::duration<double>(nextStep - now));
+        else if (now - nextStep > MAX_FRAME_DELTA) nextStep = now;
+        now = pacerNow();
+
+        netServerReceive(s, now);
+        netServerAdvanceGame(s, now);
+
+        double cpuStart = threadCpuSeconds();
+        for (int p = 0; p < s.config.players; ++p) inputs[p] = netServerNextInput(s, p, stepSeconds);
+        stepSimulation(inputs, s.config.players, stepSeconds);
+        g_itemChanges.clear();   // 렌더 스냅샷을 만들지 않으므로
+        s.simCpuSeconds += threadCpuSeconds() - cpuStart;
+        s.simTicks++;
+
+        if (s.tick % NET_SNAPSHOT_INTERVAL == 0) netServerSendSnapshots(s);
+        s.tick++;
+        netFlush(s.endpoint, pacerNow());
+    }
+    return 0;
+}
+
+bool netOpenServer(NetServer& s) {
+    s.endpoint.socket = netOpenSocket(s.config.loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY, s.config.port);
+    if (s.endpoint.socket == NET_INVALID_SOCKET) {
+        std::cerr << "cannot bind UDP port " << s.config.port << std::endl;
+        return false;
+    }
+    s.endpoint.shim = s.config.shim;
+    s.endpoint.shimRng.seed(s.config.seed ^ 0x5eedu);
+    s.config.port = netLocalPort(s.endpoint.socket);
+    return true;
+}
+
+bool parseNetShimArg(const std::string& arg, int& i, int argc, char** argv, NetShimConfig& shim) {
+    if (i + 1 >= argc) return false;
+    if (arg == "--latency") shim.latencyMs = std::atof(argv[++i]);
+    else if (arg == "--jitter") shim.jitterMs = std::atof(argv[++i]);
+    else if (arg == "--loss") shim.loss = std::min(std::max(std::atof(argv[++i]), 0.0), 1.0);
+    else if (arg == "--replay") shim.replay = std::min(std::max(std::atof(argv[++i]), 0.0), 1.0);
+    else if (arg == "--replay-delay") shim.replayDelayMs = std::max(std::atof(argv[++i]), 0.0);
+    else return false;
+    return true;
+}
+
+// --server [--port N] [--loopback] [--ticks N] [--bot POLICY] [--seed N] [--latency MS] [--jitter MS] [--loss P]
+//          [--replay P] [--replay-delay MS]
+// 자리 수는 --players (기본 1)
+int runNetServerFromArgs(int argc, char** argv) {
+    NetServer server;
+    NetServerConfig& config = server.config;
+    config.players = g_playerCount;
+    config.seed = static_cast<unsigned int>(std::time(0));
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (parseNetShimArg(arg, i, argc, argv, config.shim)) continue;
+        if (arg == "--port" && hasValue) config.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        else if (arg == "--loopback") config.loopbackOnly = true;
+        else if (arg == "--ticks" && hasValue) config.maxTicks = std::atoll(argv[++i]);
+        else if (arg == "--seed" && hasValue) {
+            config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+            config.seedLocked = true;
+        }
+        else if (arg == "--bot" && hasValue) {
+            if (!parseBotPolicyName(argv[++i], config.botPolicy)) return 2;
+            config.botFill = true;
+        }
+    }
+    if (!netStartup() || !netOpenServer(server)) return 2;
+    std::cout << "[net-server] listening on UDP port " << config.port << " for " << config.players << " player(s)" << std::endl;
+    std::atomic<bool> running{ true };
+    runNetServer(server, running);
+    printNetServerStats(server);
+    netCloseSocket(server.endpoint.socket);
+    return 0;
+}
+
+struct NetTestConfig {
+    int clients = 2;
+    long long ticks = 1200;
+    BotPolicy policy = BotPolicy::GREEDY_PELLET;
+    unsigned int seed = 1;
+    NetShimConfig shim;
+    bool staleFull = false;
+};
+
+// 헤드리스 봇 클라이언트: 예측 월드에서 botThink로 입력을 만든다. 받아 둔 미로가 월드와 다른 틱을 센다
+void netTestClientMain(NetClient& client, const NetTestConfig& config, int index, const std::atomic<bool>& running,
+    long long& mazeMismatchTicks) {
+    BotState bot;
+    bot.policy = config.policy;
+    bot.rng.seed(config.seed * 2246822519u + index);
+    const float stepSeconds = static_cast<float>(SIM_STEP_SECONDS);
+    int lastMaze = -1;
+    double nextStep = pacerNow();
+    while (running.load(std::memory_order_acquire)) {
+        nextStep += SIM_STEP_SECONDS;
+        double now = pacerNow();
+        if (nextStep > now) std::this_thread::sleep_for(std::chrono::duration<double>(nextStep - now));
+        else if (now - nextStep > MAX_FRAME_DELTA) nextStep = now;
+
+        if (client.worldMazeVersion != lastMaze) {
+            lastMaze = client.worldMazeVersion;
+            bot.target = glm::ivec2(-1, -1);
+        }
+        PlayerInput input;
+        if (g_world.playerCount > 0 && g_gameState == GameState::PLAYING) input = botThink(bot, stepSeconds);
+        netClientTick(client, input, stepSeconds);
+        g_itemChanges.clear();   // 렌더 스냅샷을 만들지 않으므로
+        if (client.worldMazeVersion >= 0 && client.maze.version != client.worldMazeVersion) mazeMismatchTicks++;
+    }
+}
+
+// --net-test [--clients N] [--ticks N] [--policy NAME] [--seed N] [--latency MS] [--jitter MS] [--loss P]
+//            [--replay P] [--replay-delay MS] [--stale-full]
+// 루프백 포트에 서버를 띄우고 봇 클라이언트 N개를 붙여 같은 프로세스에서 돌린다. 지연 / 손실은 양쪽 보내는 쪽에 건다.
+// --stale-full이면 첫 클라이언트만 먼저 붙여 타이틀 미로를 받게 하고, 서버 쪽 심이 모든 패킷을 1초 뒤 한 번 더
+// 보내게 한다. 나머지가 붙어 새 게임 미로로 바뀐 뒤에 옛 미로의 전체 스냅샷이 다시 도착한다.
+// 접속 못 한 클라이언트, 동기화 어긋남(아이템 CRC 불일치), 월드와 다른 미로를 든 클라이언트가 있으면 1
+int runNetTestFromArgs(int argc, char** argv) {
+    NetTestConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (parseNetShimArg(arg, i, argc, argv, config.shim)) continue;
+        if (arg == "--clients" && hasValue) config.clients = std::max(1, std::min(std::atoi(argv[++i]), MAX_PLAYERS));
+        else if (arg == "--ticks" && hasValue) config.ticks = std::atoll(argv[++i]);
+        else if (arg == "--seed" && hasValue) config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--policy" && hasValue && !parseBotPolicyName(argv[++i], config.policy)) return 2;
+        else if (arg == "--stale-full") config.staleFull = true;
+    }
+    if (config.staleFull) config.clients = std::max(config.clients, 2);   // 늦게 붙을 클라이언트가 있어야 미로가 바뀐다
+    if (!netStartup()) return 2;
+
+    g_playerCount = config.clients;
+    NetServer server;
+    server.config.port = 0;
+    server.config.loopbackOnly = true;
+    server.config.players = config.clients;
+    server.config.maxTicks = config.ticks;
+    server.config.seedLocked = true;
+    server.config.seed = config.seed;
+    server.config.botPolicy = config.policy;
+    server.config.shim = config.shim;
+    if (config.staleFull) {
+        server.config.shim.replay = 1.0;
+        server.config.shim.replayDelayMs = 1000.0;
+    }
+    if (!netOpenServer(server)) return 2;
+    std::cout << "[net-test] " << config.clients << " client(s), " << config.ticks << " ticks, latency "
+        << config.shim.latencyMs << " ms, jitter " << config.shim.jitterMs << " ms, loss " << config.shim.loss
+        << ", server port " << server.config.port << std::endl;
+
+    std::vector<NetClient> clients(config.clients);
+    std::string address = "127.0.0.1:" + std::to_string(server.config.port);
+    for (int c = 0; c < config.clients; ++c) {
+        if (!netOpenClient(clients[c], address, config.shim, config.seed * 31u + c)) return 2;
+    }
+
+    std::atomic<bool> serverRunning{ true };
+    std::atomic<bool> clientsRunning{ true };
+    std::thread serverThread([&]() { runNetServer(server, serverRunning); });
+    std::vector<std::thread> clientThreads;
+    std::vector<long long> mazeMismatchTicks(config.clients, 0);
+    for (int c = 0; c < config.clients; ++c) {
+        clientThreads.emplace_back([&, c]() {
+            if (config.staleFull && c > 0) std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            netTestClientMain(clients[c], config, c, clientsRunning, mazeMismatchTicks[c]);
+        });
+    }
+    serverThread.join();
+    clientsRunning.store(false, std::memory_order_release);
+    for (std::thread& t : clientThreads) t.join();
+
+    printNetServerStats(server);
+    int failures = 0;
+    long long staleMazeFulls = 0;
+    for (int c = 0; c < config.clients; ++c) {
+        printNetClientStats(clients[c], c);
+        staleMazeFulls += clients[c].stats.staleMazeFulls;
+        if (clients[c].slot < 0 || clients[c].stats.snapshots == 0 || clients[c].stats.desyncs > 0) failures++;
+        if (mazeMismatchTicks[c] > 0) {
+            std::cout << "[net-client " << c << "] held a maze other than its world's for " << mazeMismatchTicks[c] << " ticks\n";
+            failures++;
+        }
+        netCloseClient(clients[c]);
+    }
+    if (config.staleFull && staleMazeFulls == 0) {
+        std::cout << "[net-test] no client received an old-maze full snapshot late\n";
+        failures++;
+    }
+    netCloseSocket(server.endpoint.socket);
+    std::cout << "[net-test] " << (failures == 0 ? "ok" : "FAILED") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// ---- 미로 팩 생성기 (--build-maze-pack) ----
+// 시드마다 generateStageMaze + pickGhostSpawns를 돌려 검사하고, 통과한 미로를 팩 파일 하나로 쓴다.
+// 후보 i의 시드는 base + i이고 결과는 인덱스 자리에 모으므로 스레드 수와 상관없이 같은 파일이 나온다.
+
+struct MazePackBuildConfig {
+    std::string outPath;
+    int count = 1000;                      // 스테이지마다 만들 후보 수
+    std::vector<int> stages;               // 비어 있으면 1..MAX_STAGE
+    unsigned int seed = 1;
+    int threads = 0;                       // 0 = 하드웨어 스레드 수
+    float minLoopDensity = 0.05f;          // 독립 고리 수 / 길 칸 수 (0이면 고리 없는 나무 미로)
+    float maxLoopDensity = 1.0f;
+    int minGhostDistance = 4;              // 유령 시작 칸과 플레이어 시작 칸 사이 최소 걸음 수
+};
+
+enum MazeReject {
+    MAZE_OK,
+    MAZE_REJECT_EXIT,                      // 입구에서 출구로 못 감
+    MAZE_REJECT_UNREACHABLE,               // 닿을 수 없는 펠릿 칸
+    MAZE_REJECT_LOOPS,                     // 고리 밀도가 범위 밖
+    MAZE_REJECT_GHOST,                     // 유령 시작 칸이 벽이거나 플레이어와 너무 가까움
+    MAZE_REJECT_COUNT
+};
+
+const char* const MAZE_REJECT_NAMES[MAZE_REJECT_COUNT] = { "ok", "exit", "unreachable", "loops", "ghost" };
+
+// 현재 스레드의 미로를 검사한다. 길 칸마다 펠릿이 놓이므로 모든 길 칸이 입구에서 닿아야 한다
+MazeReject validateStageMaze(const MazePackBuildConfig& config, const std::vector<glm::ivec2>& ghostSpawns,
+    float& loopDensity, std::vector<int>& dist, std::vector<int>& queue) {
+    const int w = g_gridWidth;
+    const int h = g_gridHeight;
+    dist.assign(w * h, -1);
+    queue.clear();
+    int start = g_mazeStartX;
+    dist[start] = 0;
+    queue.push_back(start);
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int x = queue[head] % w;
+        int z = queue[head] / w;
+        for (int i = 0; i < 4; ++i) {
+            int nx = x + BOT_DIR_X[i];
+            int nz = z + BOT_DIR_Z[i];
+            if (!isPathCell(nx, nz) || dist[nz * w + nx] >= 0) continue;
+            dist[nz * w + nx] = dist[queue[head]] + 1;
+            queue.push_back(nz * w + nx);
+        }
+    }
+
+    // 고리 밀도: 길 칸 그래프의 독립 고리 수(E - V + 1)를 칸 수로 나눈 값
+    int cells = 0;
+    int links = 0;
+    for (int z = 0; z < h; ++z) {
+        for (int x = 0; x < w; ++x) {
+            if (g_maze[z][x] != PATH) continue;
+            cells++;
+            if (x + 1 < w && g_maze[z][x + 1] == PATH) links++;
+            if (z + 1 < h && g_maze[z + 1][x] == PATH) links++;
+        }
+    }
+    loopDensity = cells > 0 ? static_cast<float>(links - cells + 1) / cells : 0.0f;
+
+    if (dist[(h - 1) * w + g_mazeEndX] < 0) return MAZE_REJECT_EXIT;
+    if (static_cast<int>(queue.size()) != cells) return MAZE_REJECT_UNREACHABLE;
+    if (loopDensity < config.minLoopDensity || loopDensity > config.maxLoopDensity) return MAZE_REJECT_LOOPS;
+    for (const glm::ivec2& spawn : ghostSpawns) {
+        if (!isPathCell(spawn.x, spawn.y)) return MAZE_REJECT_GHOST;
+        int d = dist[spawn.y * w + spawn.x];
+        if (d < config.minGhostDistance) return MAZE_REJECT_GHOST;
+    }
+    return MAZE_OK;
+}
+
+struct MazePackCandidate {
+    MazeReject result = MAZE_OK;
+    MazePackEntry entry;
+    std::vector<uint8_t> data;             // 벽 비트 + 유령 시작 칸
+};
+
+void buildMazePackCandidate(const MazePackBuildConfig& config, int stage, unsigned int seed,
+    MazePackCandidate& out, std::vector<int>& dist, std::vector<int>& queue, std::vector<glm::ivec2>& spawns) {
+    StageParams params = stageParams(stage);
+    g_randomEngine.seed(seed);
+    generateStageMaze(params);
+    pickGhostSpawns(params.ghostCount, spawns);
+
+    float loopDensity = 0.0f;
+    out.result = validateStageMaze(config, spawns, loopDensity, dist, queue);
+    out.data.clear();
+    if (out.result != MAZE_OK) return;
+
+    MazePackEntry& e = out.entry;
+    e.seed = seed;
+    e.stage = static_cast<uint16_t>(stage);
+    e.width = static_cast<uint16_t>(g_gridWidth);
+    e.height = static_cast<uint16_t>(g_gridHeight);
+    e.startX = static_cast<uint16_t>(g_mazeStartX);
+    e.endX = static_cast<uint16_t>(g_mazeEndX);
+    e.ghostCount = static_cast<uint16_t>(spawns.size());
+    e.dataOffset = 0;
+    e.loopDensity = loopDensity;
+
+    out.data.assign(mazePackDataSize(g_gridWidth, g_gridHeight, e.ghostCount), 0);
+    for (int z = 0; z < g_gridHeight; ++z) {
+        for (int x = 0; x < g_gridWidth; ++x) {
+            int bit = z * g_gridWidth + x;
+            if (g_maze[z][x] == WALL) out.data[bit >> 3] |= static_cast<uint8_t>(1u << (bit & 7));
+        }
+    }
+    uint8_t* ghostData = out.data.data() + mazePackWallBytes(g_gridWidth, g_gridHeight);
+    for (size_t i = 0; i < spawns.size(); ++i) {
+        uint16_t xz[2] = { static_cast<uint16_t>(spawns[i].x), static_cast<uint16_t>(spawns[i].y) };
+        std::memcpy(ghostData + i * 4, xz, sizeof(xz));
+    }
+}
+
+int buildMazePack(const MazePackBuildConfig& config) {
+    std::vector<int> stages = config.stages;
+    if (stages.empty()) {
+        for (int s = 1; s <= MAX_STAGE; ++s) stages.push_back(s);
+    }
+    std::sort(stages.begin(), stages.end());
+    stages.erase(std::unique(stages.begin(), stages.end()), stages.end());
+    if (stages.front() < 1 || stages.back() > MAX_STAGE) {
+        std::cerr << "maze pack: stages must be between 1 and " << MAX_STAGE << std::endl;
+        return 2;
+    }
+    const int count = std::max(1, config.count);
+    const int jobCount = count * static_cast<int>(stages.size());
+
+    int threadCount = config.threads > 0 ? config.threads : static_cast<int>(std::thread::hardware_concurrency());
+    if (threadCount <= 0) threadCount = 1;
+    threadCount = std::min(threadCount, jobCount);
+
+    std::vector<MazePackCandidate> candidates(jobCount);
+    std::atomic<int> nextJob(0);
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&]() {
+            std::vector<int> dist;
+            std::vector<int> queue;
+            std::vector<glm::ivec2> spawns;
+            for (;;) {
+                int job = nextJob.fetch_add(1);
+                if (job >= jobCount) break;
+                unsigned int seed = config.seed + static_cast<unsigned int>(job % count);
+                buildMazePackCandidate(config, stages[job / count], seed, candidates[job], dist, queue, spawns);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds <= 0.0) seconds = 1e-9;
+
+    // 후보는 스테이지, 시드 순으로 놓여 있으므로 통과한 것만 차례로 모으면 스테이지 표가 된다
+    MazePackHeader header;
+    std::memcpy(header.magic, MAZE_PACK_MAGIC, 4);
+    header.version = MAZE_PACK_VERSION;
+    header.stageCount = static_cast<uint32_t>(stages.back());
+    std::vector<MazePackStage> stageTable(header.stageCount, MazePackStage{ 0, 0 });
+    std::vector<MazePackEntry> entries;
+    int rejects[MAX_STAGE][MAZE_REJECT_COUNT] = {};
+    float densityMin[MAX_STAGE], densityMax[MAX_STAGE];
+    double densitySum[MAX_STAGE] = {};
+    std::fill(densityMin, densityMin + MAX_STAGE, std::numeric_limits<float>::max());
+    std::fill(densityMax, densityMax + MAX_STAGE, 0.0f);
+    for (int job = 0; job < jobCount; ++job) {
+        int stage = stages[job / count];
+        const MazePackCandidate& c = candidates[job];
+        rejects[stage - 1][c.result]++;
+        if (c.result != MAZE_OK) continue;
+        if (stageTable[stage - 1].count == 0) stageTable[stage - 1].first = static_cast<uint32_t>(entries.size());
+        stageTable[stage - 1].count++;
+        entries.push_back(c.entry);
+        densityMin[stage - 1] = std::min(densityMin[stage - 1], c.entry.loopDensity);
+        densityMax[stage - 1] = std::max(densityMax[stage - 1], c.entry.loopDensity);
+        densitySum[stage - 1] += c.entry.loopDensity;
+    }
+    header.entryCount = static_cast<uint32_t>(entries.size());
+
+    size_t offset = sizeof(header) + stageTable.size() * sizeof(MazePackStage) + entries.size() * sizeof(MazePackEntry);
+    for (size_t i = 0, job = 0; i < entries.size(); ++job) {
+        if (candidates[job].result != MAZE_OK) continue;
+        entries[i++].dataOffset = static_cast<uint32_t>(offset);
+        offset += candidates[job].data.size();
+    }
+
+    std::ofstream out(config.outPath, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(stageTable.data()), stageTable.size() * sizeof(MazePackStage));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MazePackEntry));
+    for (const MazePackCandidate& c : candidates) {
+        if (c.result == MAZE_OK) out.write(reinterpret_cast<const char*>(c.data.data()), c.data.size());
+    }
+    if (!out) {
+        std::cerr << "maze pack: cannot write " << config.outPath << std::endl;
+        return 2;
+    }
+
+    std::cout << "[maze-pack] " << jobCount << " candidates, threads=" << threadCount << ", seed=" << config.seed
+        << ", " << seconds << " s (" << (jobCount / seconds) << " mazes/s)\n";
+    for (int stage : stages) {
+        std::cout << "[maze-pack] stage " << stage << ": " << rejects[stage - 1][MAZE_OK] << " / " << count << " accepted";
+        for (int r = MAZE_OK + 1; r < MAZE_REJECT_COUNT; ++r) {
+            if (rejects[stage - 1][r] > 0) std::cout << ", " << MAZE_REJECT_NAMES[r] << " " << rejects[stage - 1][r];
+        }
+        int accepted = rejects[stage - 1][MAZE_OK];
+        if (accepted > 0) {
+            std::cout << "; loop density " << densityMin[stage - 1] << " / " << (densitySum[stage - 1] / accepted)
+                << " / " << densityMax[stage - 1] << " (min / avg / max)";
+        }
+        std::cout << "\n";
+    }
+    std::cout << "[maze-pack] wrote " << header.entryCount << " mazes, " << offset << " bytes to " << config.outPath << std::endl;
+    return header.entryCount > 0 ? 0 : 1;
+}
+
+// --build-maze-pack OUT [--count N] [--stages 1,2] [--seed N] [--threads N]
+//                       [--min-loops F] [--max-loops F] [--min-ghost-distance N]
+int runMazePackBuilderFromArgs(int argc, char** argv) {
+    MazePackBuildConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--build-maze-pack" && hasValue) config.outPath = argv[++i];
+        else if (arg == "--count" && hasValue) config.count = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--threads" && hasValue) config.threads = std::atoi(argv[++i]);
+        else if (arg == "--min-loops" && hasValue) config.minLoopDensity = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--max-loops" && hasValue) config.maxLoopDensity = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--min-ghost-distance" && hasValue) config.minGhostDistance = std::atoi(argv[++i]);
+        else if (arg == "--stages" && hasValue) {
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (!item.empty()) config.stages.push_back(std::atoi(item.c_str()));
+            }
+        }
+    }
+    if (config.outPath.empty()) {
+        std::cerr << "usage: --build-maze-pack OUT [--count N] [--stages 1,2] [--seed N] [--threads N]"
+            " [--min-loops F] [--max-loops F] [--min-ghost-distance N]" << std::endl;
+        return 2;
+    }
+    return buildMazePack(config);
+}
+
+// ---- 타일 월드 생성기 ----
+// 타일마다 따로 만들 수 있어야 하므로 전역 탐색이 필요 없는 이진 트리 미로를 쓴다. 홀수 좌표 칸이 마디이고,
+// 마디마다 (시드, 좌표) 해시로 위 / 왼쪽 중 하나로 뚫는다. 맨 윗줄은 왼쪽, 맨 왼쪽 줄은 위로만 뚫으므로
+// 모든 마디가 (1, 1)로 이어진다(길 칸이 모두 닿음). --loops 확률로 둘 다 뚫어 고리를 만든다.
+// --clearings 확률로 256x256 구역 가운데를 벽 없는 광장으로 튼다. 길만 늘리므로 이어짐은 그대로이고,
+// 8줄마다 펠릿 없는 통로를 둬서 광장 안 타일은 RLE, 가장자리 타일은 RAW로 압축된다.
+
+struct TiledWorldBuildConfig {
+    std::string outPath;
+    uint32_t width = 16384;
+    uint32_t height = 16384;
+    unsigned int seed = 1;
+    int threads = 0;                       // 0 = 하드웨어 스레드 수
+    float loops = 0.1f;                    // 마디가 두 방향 모두 뚫을 확률
+    uint32_t powerEvery = 512;             // 길 칸 이만큼에 하나꼴로 파워 펠릿
+    float clearings = 0.0f;                // 구역마다 광장이 될 확률
+};
+
+const int TILED_ZONE_SHIFT = 8;            // 광장 구역 한 변 256칸
+const int TILED_CLEARING_INSET = 32;       // 구역 가장자리에서 광장까지 남기는 미로 폭
+
+inline uint32_t tiledHash(uint32_t x, uint32_t z, uint32_t seed) {
+    uint64_t h = (static_cast<uint64_t>(x) << 32 | z) ^ (static_cast<uint64_t>(seed) * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return static_cast<uint32_t>(h);
+}
+
+// 마디 (x, z)가 위 / 왼쪽으로 뚫렸는지 (bit 0 = 위, bit 1 = 왼쪽)
+inline int tiledNodeOpenings(const TiledWorldBuildConfig& config, uint32_t x, uint32_t z) {
+    if (z == 1 && x == 1) return 0;
+    if (z == 1) return 2;
+    if (x == 1) return 1;
+    uint32_t h = tiledHash(x, z, config.seed);
+    if ((h >> 16) < static_cast<uint32_t>(config.loops * 65536.0f)) return 3;
+    return (h & 1) ? 1 : 2;
+}
+
+inline bool tiledIsNode(const TiledWorldBuildConfig& config, uint32_t x, uint32_t z) {
+    return (x & 1) && (z & 1) && x + 1 < config.width && z + 1 < config.height;
+}
+
+// 맵 안에 통째로 들어가는 구역만 광장이 된다 (맵 가장자리 벽은 그대로)
+inline bool tiledInClearing(const TiledWorldBuildConfig& config, uint32_t x, uint32_t z) {
+    if (config.clearings <= 0.0f) return false;
+    const uint32_t zone = 1u << TILED_ZONE_SHIFT;
+    uint32_t zx = x >> TILED_ZONE_SHIFT;
+    uint32_t zz = z >> TILED_ZONE_SHIFT;
+    if ((zx + 1) * zone >= config.width || (zz + 1) * zone >= config.height) return false;
+    uint32_t lx = x & (zone - 1);
+    uint32_t lz = z & (zone - 1);
+    if (lx < TILED_CLEARING_INSET || lz < TILED_CLEARING_INSET || lx >= zone - TILED_CLEARING_INSET || lz >= zone - TILED_CLEARING_INSET) return false;
+    return (tiledHash(zx, zz, config.seed ^ 0x5C5C5C5Cu) >> 16) < static_cast<uint32_t>(config.clearings * 65536.0f);
+}
+
+int tiledGeneratedCell(const TiledWorldBuildConfig& config, uint32_t x, uint32_t z) {
+    bool path;
+    if (tiledInClearing(config, x, z)) {
+        if ((z & 7) == 0) return TILE_PATH;
+        path = true;
+    }
+    else if (tiledIsNode(config, x, z)) path = true;
+    else if ((x & 1) && !(z & 1)) path = tiledIsNode(config, x, z + 1) && (tiledNodeOpenings(config, x, z + 1) & 1);
+    else if (!(x & 1) && (z & 1)) path = tiledIsNode(config, x + 1, z) && (tiledNodeOpenings(config, x + 1, z) & 2);
+    else path = false;
+    if (!path) return TILE_WALL;
+    return (tiledHash(z, x, config.seed ^ 0xA5A5A5A5u) % config.powerEvery == 0) ? TILE_POWER_PELLET : TILE_PELLET;
+}
+
+int buildTiledWorld(const TiledWorldBuildConfig& config) {
+    if (config.width < 3 || config.height < 3 || config.width > TILED_WORLD_MAX_DIM || config.height > TILED_WORLD_MAX_DIM) {
+        std::cerr << "tiled world: size must be between 3 and " << TILED_WORLD_MAX_DIM << std::endl;
+        return 2;
+    }
+    TiledWorldHeader header{};
+    std::memcpy(header.magic, TILED_WORLD_MAGIC, 4);
+    header.version = TILED_WORLD_VERSION;
+    header.width = config.width;
+    header.height = config.height;
+    header.tilesX = (config.width + TILE_SIZE - 1) / TILE_SIZE;
+    header.tilesZ = (config.height + TILE_SIZE - 1) / TILE_SIZE;
+    header.startX = 1;
+    header.startZ = 1;
+    header.seed = config.seed;
+    const size_t tileCount = static_cast<size_t>(header.tilesX) * header.tilesZ;
+
+    int threadCount = config.threads > 0 ? config.threads : static_cast<int>(std::thread::hardware_concurrency());
+    if (threadCount <= 0) threadCount = 1;
+    threadCount = static_cast<int>(std::min<size_t>(threadCount, header.tilesZ));
+
+    std::ofstream out(config.outPath, std::ios::binary);
+    std::vector<TiledWorldTile> index(tileCount);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(TiledWorldTile));
+    uint64_t offset = sizeof(header) + index.size() * sizeof(TiledWorldTile);
+
+    // 타일 한 줄씩 스레드들이 나눠 압축하고, 파일에는 줄 순서대로 쓴다 (스레드 수와 상관없이 같은 파일)
+    std::vector<std::vector<uint8_t>> rowData(header.tilesX);
+    std::atomic<long long> roundTripFailures(0);
+    long long encodingCounts[3] = {};
+    long long pathCells = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t tz = 0; tz < header.tilesZ; ++tz) {
+        std::atomic<uint32_t> nextTile(0);
+        std::vector<long long> workerPaths(threadCount, 0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threadCount; ++t) {
+            workers.emplace_back([&, t]() {
+                uint8_t cells[TILE_BYTES];
+                uint8_t decoded[TILE_BYTES];
+                for (;;) {
+                    uint32_t tx = nextTile.fetch_add(1);
+                    if (tx >= header.tilesX) break;
+                    for (int i = 0; i < TILE_CELLS; ++i) {
+                        uint32_t x = tx * TILE_SIZE + (i & (TILE_SIZE - 1));
+                        uint32_t z = tz * TILE_SIZE + (i >> TILE_SHIFT);
+                        int code = (x < config.width && z < config.height) ? tiledGeneratedCell(config, x, z) : TILE_WALL;
+                        setTileCellCode(cells, i, code);
+                        workerPaths[t] += code != TILE_WALL ? 1 : 0;
+                    }
+                    TiledWorldTile& entry = index[static_cast<size_t>(tz) * header.tilesX + tx];
+                    entry.encoding = encodeTile(cells, rowData[tx], entry.fill);
+                    // 쓰기 전에 풀어 봐서 원래 칸과 같은지 확인 (RLE / FILL 경로 검사)
+                    if (!decodeTile(static_cast<TileEncoding>(entry.encoding), entry.fill, rowData[tx].data(), rowData[tx].size(), decoded)
+                        || std::memcmp(decoded, cells, TILE_BYTES) != 0) {
+                        roundTripFailures++;
+                    }
+                }
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        for (long long paths : workerPaths) pathCells += paths;
+        for (uint32_t tx = 0; tx < header.tilesX; ++tx) {
+            TiledWorldTile& entry = index[static_cast<size_t>(tz) * header.tilesX + tx];
+            entry.offset = offset;
+            entry.size = static_cast<uint32_t>(rowData[tx].size());
+            encodingCounts[entry.encoding]++;
+            out.write(reinterpret_cast<const char*>(rowData[tx].data()), rowData[tx].size());
+            offset += rowData[tx].size();
+        }
+    }
+    out.seekp(sizeof(header));
+    out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(TiledWorldTile));
+    if (!out) {
+        std::cerr << "tiled world: cannot write " << config.outPath << std::endl;
+        return 2;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cells = static_cast<double>(config.width) * config.height;
+    std::cout << "[tiled-world] " << config.width << "x" << config.height << " (" << tileCount << " tiles of "
+        << TILE_SIZE << "x" << TILE_SIZE << "), " << pathCells << " path cells, threads=" << threadCount << ", " << seconds << " s\n";
+    std::cout << "[tiled-world] tiles: " << encodingCounts[TILE_FILL] << " fill, " << encodingCounts[TILE_RAW] << " raw, "
+        << encodingCounts[TILE_RLE] << " rle; wrote " << offset << " bytes (" << (offset * 8.0 / cells) << " bits/cell) to "
+        << config.outPath << std::endl;
+    if (roundTripFailures > 0) {
+        std::cerr << "tiled world: " << roundTripFailures << " tile(s) did not decode back to the generated cells" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// --build-tiled-world OUT [--size N | --size WxH] [--seed N] [--threads N] [--loops P] [--power-every N] [--clearings P]
+int runTiledWorldBuilderFromArgs(int argc, char** argv) {
+    TiledWorldBuildConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--build-tiled-world" && hasValue) config.outPath = argv[++i];
+        else if (arg == "--size" && hasValue) {
+            std::string size = argv[++i];
+            size_t x = size.find('x');
+            config.width = static_cast<uint32_t>(std::strtoul(size.substr(0, x).c_str(), nullptr, 10));
+            config.height = (x == std::string::npos) ? config.width : static_cast<uint32_t>(std::strtoul(size.substr(x + 1).c_str(), nullptr, 10));
+        }
+        else if (arg == "--seed" && hasValue) config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--threads" && hasValue) config.threads = std::atoi(argv[++i]);
+        else if (arg == "--loops" && hasValue) config.loops = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--power-every" && hasValue) config.powerEvery = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        else if (arg == "--clearings" && hasValue) config.clearings = std::min(std::max(static_cast<float>(std::atof(argv[++i])), 0.0f), 1.0f);
+    }
+    if (config.outPath.empty()) {
+        std::cerr << "usage: --build-tiled-world OUT [--size N|WxH] [--seed N] [--threads N] [--loops P] [--power-every N] [--clearings P]" << std::endl;
+        return 2;
+    }
+    return buildTiledWorld(config);
+}
+
+// ---- 타일 월드 탐험 부하 시험 ----
+// 탐험자 여럿이 맵 곳곳에서 칸 단위로 걸으며(플레이어 속도, 120Hz 틱) 펠릿을 먹는다. 틱마다 탐험자 주변 타일을
+// 미리 올리고, 걸을 때는 tiledCell로 이웃 칸을 본다. 먹은 칸 일부를 기억해 두었다가 끝에 다시 읽어,
+// 캐시에서 내보냈다 다시 올린 뒤에도 먹은 상태가 남아 있는지 확인한다.
+
+struct TileStressConfig {
+    std::string path;
+    long long ticks = 120 * 60;            // 120Hz 기준 1분
+    int explorers = 8;
+    int cacheTiles = 1024;                 // 풀린 타일 1KB씩
+    int prefetchRadius = 1;                // 탐험자 주변 몇 타일까지 미리 올릴지
+    float speed = 1.0f;                    // 플레이어 속도 배수 (캐시 교체를 더 자주 일으키려면 크게)
+    unsigned int seed = 1;
+};
+
+struct TileExplorer {
+    int x = 0;
+    int z = 0;
+    int dirX = 1;
+    int dirZ = 0;
+    float progress = 0.0f;                 // 다음 칸까지 간 비율
+};
+
+const size_t TILE_STRESS_MAX_CHECKS = 1 << 16;
+
+// 길 칸으로 한 칸 간다. 펠릿이 있는 이웃 > 직진 > 무작위 순 (되돌아가기는 막혔을 때만)
+void tileExplorerStep(TiledWorld& w, TileExplorer& e, std::mt19937& rng) {
+    int options[4];
+    int optionCount = 0;
+    int pelletOption = -1;
+    for (int i = 0; i < 4; ++i) {
+        if (BOT_DIR_X[i] == -e.dirX && BOT_DIR_Z[i] == -e.dirZ) continue;
+        int code = tiledCell(w, e.x + BOT_DIR_X[i], e.z + BOT_DIR_Z[i]);
+        if (code == TILE_WALL) continue;
+        options[optionCount++] = i;
+        if (code >= TILE_PELLET && (pelletOption < 0 || (BOT_DIR_X[i] == e.dirX && BOT_DIR_Z[i] == e.dirZ))) pelletOption = i;
+    }
+    int choice;
+    if (pelletOption >= 0) choice = pelletOption;
+    else if (optionCount > 0) choice = options[std::uniform_int_distribution<int>(0, optionCount - 1)(rng)];
+    else {
+        e.dirX = -e.dirX;   // 막다른 길
+        e.dirZ = -e.dirZ;
+        if (tiledCell(w, e.x + e.dirX, e.z + e.dirZ) == TILE_WALL) return;
+        choice = -1;
+    }
+    if (choice >= 0) {
+        e.dirX = BOT_DIR_X[choice];
+        e.dirZ = BOT_DIR_Z[choice];
+    }
+    e.x += e.dirX;
+    e.z += e.dirZ;
+}
+
+int runTileStress(const TileStressConfig& config) {
+    TiledWorld world;
+    if (!openTiledWorld(world, config.path, config.cacheTiles)) return 2;
+    const TiledWorldHeader& h = world.header;
+    uint64_t rssBefore = residentMemoryBytes();
+
+    // 탐험자는 무작위 마디에서 시작 (0번은 파일의 시작 칸)
+    std::mt19937 rng(config.seed);
+    std::vector<TileExplorer> explorers(std::max(1, config.explorers));
+    for (size_t i = 0; i < explorers.size(); ++i) {
+        TileExplorer& e = explorers[i];
+        if (i == 0) {
+            e.x = h.startX;
+            e.z = h.startZ;
+        }
+        else {
+            e.x = static_cast<int>(std::uniform_int_distribution<uint32_t>(0, (h.width - 3) / 2)(rng)) * 2 + 1;
+            e.z = static_cast<int>(std::uniform_int_distribution<uint32_t>(0, (h.height - 3) / 2)(rng)) * 2 + 1;
+        }
+    }
+
+    const float stepSeconds = static_cast<float>(SIM_STEP_SECONDS);
+    const float cellsPerTick = PLAYER_MOVE_SPEED * config.speed / (CUBE_SIZE + GRID_SPACING) * stepSeconds;
+    std::vector<std::pair<int, int>> eaten;   // 확인용 표본
+    long long pellets = 0;
+    long long powerPellets = 0;
+    long long cellsWalked = 0;
+    int workingSet = (2 * config.prefetchRadius + 1) * (2 * config.prefetchRadius + 1) * static_cast<int>(explorers.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (long long tick = 0; tick < config.ticks; ++tick) {
+        for (TileExplorer& e : explorers) {
+            tiledPrefetch(world, e.x, e.z, config.prefetchRadius);
+            e.progress += cellsPerTick;
+            while (e.progress >= 1.0f) {
+                e.progress -= 1.0f;
+                tileExplorerStep(world, e, rng);
+                cellsWalked++;
+                int code = tiledCell(world, e.x, e.z);
+                if (code < TILE_PELLET) continue;
+                setTiledCell(world, e.x, e.z, TILE_PATH);
+                (code == TILE_POWER_PELLET ? powerPellets : pellets)++;
+                if (eaten.size() < TILE_STRESS_MAX_CHECKS) eaten.push_back({ e.x, e.z });
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds <= 0.0) seconds = 1e-9;
+    TiledWorldStats stats = world.stats;
+    size_t resident = tiledResidentBytes(world);
+    uint64_t rssAfter = residentMemoryBytes();
+
+    int lost = 0;
+    for (const auto& cell : eaten) lost += tiledCell(world, cell.first, cell.second) >= TILE_PELLET ? 1 : 0;
+
+    // 같은 맵을 스테이지처럼 펼쳤을 때: g_maze 4B + collectibleAt 4B, 길 칸마다 펠릿 엔티티
+    // (Transform 12B, GridCell 8B, Render 24B, Collectible 8B, 배열 소유자 / 슬롯 4 x 8B)
+    double cells = static_cast<double>(h.width) * h.height;
+    double dense = cells * 8.0 + cells * 0.5 * 84.0;
+    std::cout << "[tile-stress] " << h.width << "x" << h.height << ", " << explorers.size() << " explorers, cache "
+        << world.capacity << " tiles (working set " << workingSet << "), " << config.ticks << " ticks in " << seconds << " s ("
+        << (config.ticks / seconds) << " ticks/s)\n";
+    std::cout << "[tile-stress] " << stats.lookups << " cell lookups (" << (stats.lookups / seconds / 1e6) << " M/s), "
+        << "miss " << (stats.lookups > 0 ? 100.0 * stats.misses / stats.lookups : 0.0) << "%; " << stats.loads << " tile loads ("
+        << (stats.loads > 0 ? stats.loadSeconds / stats.loads * 1e6 : 0.0) << " us avg), " << stats.evictions << " evictions, "
+        << stats.writebacks << " write-backs; loaded " << stats.loadsByEncoding[TILE_FILL] << " fill / "
+        << stats.loadsByEncoding[TILE_RAW] << " raw / " << stats.loadsByEncoding[TILE_RLE] << " rle\n";
+    std::cout << "[tile-stress] walked " << cellsWalked << " cells, ate " << pellets << " pellets + " << powerPellets
+        << " power pellets; " << eaten.size() << " re-checked at the end, " << lost << " reverted\n";
+    std::cout << "[tile-stress] store " << (resident / 1024.0 / 1024.0) << " MB (cache "
+        << (world.cells.size() / 1024.0 / 1024.0) << " MB, overlay " << (world.overlayBytes / 1024.0 / 1024.0) << " MB), file "
+        << (world.file.size / 1024.0 / 1024.0) << " MB mapped; process RSS " << (rssBefore / 1024.0 / 1024.0) << " -> "
+        << (rssAfter / 1024.0 / 1024.0) << " MB; dense stage layers would need ~" << (dense / 1024.0 / 1024.0 / 1024.0) << " GB\n";
+    closeTiledWorld(world);
+    return lost == 0 ? 0 : 1;
+}
+
+// --tile-stress FILE [--ticks N] [--explorers N] [--cache-tiles N] [--radius N] [--speed X] [--seed N]
+int runTileStressFromArgs(int argc, char** argv) {
+    TileStressConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--tile-stress" && hasValue) config.path = argv[++i];
+        else if (arg == "--ticks" && hasValue) config.ticks = std::atoll(argv[++i]);
+        else if (arg == "--explorers" && hasValue) config.explorers = std::atoi(argv[++i]);
+        else if (arg == "--cache-tiles" && hasValue) config.cacheTiles = std::atoi(argv[++i]);
+        else if (arg == "--radius" && hasValue) config.prefetchRadius = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--speed" && hasValue) config.speed = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        else if (arg == "--seed" && hasValue) config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    if (config.path.empty()) {
+        std::cerr << "usage: --tile-stress FILE [--ticks N] [--explorers N] [--cache-tiles N] [--radius N] [--speed X] [--seed N]" << std::endl;
+        return 2;
+    }
+    return runTileStress(config);
+}
+
+// ---- 오프스크린 렌더 모드 (CI 프레임 캡처 / 렌더 처리량 측정) ----
+
+struct OffscreenConfig {
+    int frames = 300;
+    int width = 1024;
+    int height = 768;
+    std::vector<int> captureFrames;     // 저장할 프레임 번호
+    int captureEvery = 0;               // 0이 아니면 이 간격마다 저장
+    std::string outDir = ".";
+    std::string format = "png";         // png | ppm
+    std::string goldenDir;              // 비어 있지 않으면 같은 이름의 골든 이미지와 비교
+    int tolerance = 8;                  // 채널당 허용 오차 (0~255)
+    double maxMismatch = 0.001;         // 허용 오차를 넘는 픽셀 비율 한계
+    unsigned int seed = 1;
+    int stage = 1;
+    float tickSeconds = 1.0f / 60.0f;
+    bool useBot = false;
+    BotPolicy botPolicy = BotPolicy::AVOID_GHOSTS;
+    std::string replayPath;             // 비어 있지 않으면 기록된 입력을 재생 (시드와 deltaTime도 기록을 따름)
+    std::string statePath;              // 비어 있지 않으면 이 세이브 스테이트에서 시작 (게임 중간부터 벤치마크)
+    std::string metricsPath;            // 비어 있지 않으면 Prometheus 텍스트 지표를 이 파일에 주기적으로 씀
+    double metricsInterval = 1.0;
+};
+
+#ifdef PACMAN_WITH_EGL
+struct OffscreenContext {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+};
+
+bool createOffscreenContext(OffscreenContext& ctx) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        ctx.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (ctx.display == EGL_NO_DISPLAY) {
+        ctx.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (ctx.display == EGL_NO_DISPLAY || !eglInitialize(ctx.display, nullptr, nullptr)) {
+        std::cerr << "[offscreen] EGL display init failed" << std::endl;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "[offscreen] EGL has no desktop OpenGL" << std::endl;
+        return false;
+    }
+
+    // main()의 GLUT 창과 같은 3.3 compatibility (HUD가 glWindowPos/glBitmap을 씀)
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    ctx.context = eglCreateContext(ctx.display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (ctx.context == EGL_NO_CONTEXT) {
+        const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLint configCount = 0;
+        if (eglChooseConfig(ctx.display, configAttribs, &config, 1, &configCount) && configCount > 0) {
+            ctx.context = eglCreateContext(ctx.display, config, EGL_NO_CONTEXT, contextAttribs);
+        }
+    }
+    if (ctx.context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx.context)) {
+        std::cerr << "[offscreen] surfaceless EGL context failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void destroyOffscreenContext(OffscreenContext& ctx) {
+    eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (ctx.context != EGL_NO_CONTEXT) eglDestroyContext(ctx.display, ctx.context);
+    eglTerminate(ctx.display);
+}
+#endif
+
+std::string captureFileName(int frameIndex, const std::string& format) {
+    std::string number = std::to_string(frameIndex);
+    if (number.size() < 6) number.insert(0, 6 - number.size(), '0');
+    return "frame_" + number + "." + format;
+}
+
+int runOffscreen(const OffscreenConfig& config, int argc, char** argv) {
+#ifdef PACMAN_WITH_EGL
+    OffscreenContext ctx;
+    if (!createOffscreenContext(ctx)) return 2;
+    g_useBuiltinFont = true;
+#else
+    // EGL이 없는 플랫폼: 숨긴 GLUT 창의 컨텍스트만 빌려 쓰고 그리기는 FBO에 한다
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(64, 64);
+    glutInitContextVersion(3, 3);
+    glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
+    glutCreateWindow("FreeGLUT Maze Project (offscreen)");
+    glutHideWindow();
+#endif
+    (void)argc;
+    (void)argv;
+
+    g_windowWidth = config.width;
+    g_windowHeight = config.height;
+    initRenderer();
+
+    GLuint fbo = 0, colorRb = 0, depthRb = 0;
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &colorRb);
+    glGenRenderbuffers(1, &depthRb);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, config.width, config.height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, config.width, config.height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRb);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRb);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[offscreen] framebuffer incomplete" << std::endl;
+        return 2;
+    }
+
+    InputReplay replay;
+    bool replaying = !config.replayPath.empty();
+    if (replaying && !openInputReplay(replay, config.replayPath)) return 2;
+
+    // 골든 이미지와 비교하려면 매 실행이 같아야 하므로 시드와 틱 간격을 고정
+    g_seedLocked = true;
+    if (replaying) {
+        // 기록할 때와 같은 순서로 시작: 타이틀 화면에서 시뮬레이션 스레드 시작 때의 reset() 한 번
+        g_randomEngine.seed(replay.seed);
+        reset();
+        g_gameState = GameState::TITLE;
+    }
+    else {
+        g_randomEngine.seed(config.seed);
+        startNewGame();
+        if (config.stage > 1) {
+            g_currentStage = std::min(config.stage, lastStage());
+            reset();
+            g_gameState = GameState::PLAYING;
+        }
+        if (!config.statePath.empty() && !loadGameStateFile(config.statePath)) return 2;
+    }
+    InputQueue inputQueue;
+
+    BotState bot;
+    bot.policy = config.botPolicy;
+    bot.rng.seed(config.seed);
+
+    PixelReadback readback;
+    readbackInit(readback, config.width, config.height);
+
+    int captured = 0;
+    int failures = 0;
+    double captureSeconds = 0.0;
+    Image image;
+    Image golden;
+
+    auto sink = [&](int frameIndex, const unsigned char* rgba, int width, int height) {
+        auto t0 = std::chrono::steady_clock::now();
+        rgbaToImage(rgba, width, height, image);
+        std::string name = captureFileName(frameIndex, config.format);
+        if (!writeImage(config.outDir + "/" + name, image)) {
+            std::cerr << "[offscreen] failed to write " << config.outDir << "/" << name << std::endl;
+            failures++;
+        }
+        captured++;
+
+        if (!config.goldenDir.empty()) {
+            std::string goldenPath = config.goldenDir + "/" + name;
+            if (!readImage(goldenPath, golden)) {
+                std::cout << "[offscreen] " << name << ": golden missing or unreadable (" << goldenPath << ")\n";
+                failures++;
+            }
+            else {
+                ImageDiff diff = compareImages(image, golden, config.tolerance);
+                bool ok = diff.mismatchRatio <= config.maxMismatch;
+                std::cout << "[offscreen] " << name << ": " << (ok ? "match" : "MISMATCH")
+                    << " (max channel diff " << diff.maxChannelDiff
+                    << ", " << diff.mismatchRatio * 100.0 << "% pixels over tolerance)\n";
+                if (!ok) failures++;
+            }
+        }
+        captureSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    };
+
+    auto shouldCapture = [&](int frameIndex) {
+        if (config.captureEvery > 0 && frameIndex % config.captureEvery == 0) return true;
+        return std::find(config.captureFrames.begin(), config.captureFrames.end(), frameIndex) != config.captureFrames.end();
+    };
+
+    if (!config.metricsPath.empty()) startMetricsExporter(config.metricsPath, config.metricsInterval);
+
+    auto start = std::chrono::steady_clock::now();
+    auto lastFrameEnd = start;
+    int frames = 0;
+    for (int frameIndex = 0; frameIndex < config.frames; ++frameIndex) {
+        if (frameIndex > 0) {
+            float deltaTime = config.tickSeconds;
+            if (replaying) {
+                if (!replayInputStep(replay, inputQueue, deltaTime)) break;
+            }
+            else if (config.useBot) {
+                botEmitInput(botThink(bot, deltaTime), inputQueue);
+            }
+            drainInputEvents(inputQueue, nullptr);
+            if (g_quitRequested) break;
+            stepSimulation(readKeyboardInput(), deltaTime);
+        }
+        frames++;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        renderFrame();
+        countMetric(MC_FRAMES);
+        countMetric(MC_DRAW_CALLS, g_frameDrawCalls);
+        g_frameDrawCalls = 0;
+        auto frameEnd = std::chrono::steady_clock::now();
+        if (frameIndex > 0) recordMetricSeconds(MH_FRAME, std::chrono::duration<double>(frameEnd - lastFrameEnd).count());
+        lastFrameEnd = frameEnd;
+
+        if (shouldCapture(frameIndex)) {
+            readbackRequest(readback, frameIndex, sink, true);
+        }
+        readbackCollect(readback, false, sink);
+    }
+    readbackCollect(readback, true, sink);
+    glFinish();
+    stopMetricsExporter();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double renderSeconds = std::max(1e-9, seconds - captureSeconds);
+
+    std::cout << "[offscreen] " << glGetString(GL_RENDERER) << ", " << config.width << "x" << config.height << "\n";
+    std::cout << "[offscreen] " << frames << " frames in " << seconds << " s -> "
+        << (frames / renderSeconds) << " fps (" << (renderSeconds * 1000.0 / std::max(1, frames))
+        << " ms/frame excluding " << captureSeconds * 1000.0 << " ms spent writing " << captured << " captures)\n";
+    if (replaying) {
+        std::cout << "[offscreen] replayed " << replay.steps << " input steps, score " << g_score << ", lives " << g_lives << "\n";
+    }
+    printCullStats();
+    printDynamicResolutionStats();
+
+    readbackDestroy(readback);
+    destroyDynamicResolution();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(1, &colorRb);
+    glDeleteRenderbuffers(1, &depthRb);
+    glDeleteFramebuffers(1, &fbo);
+#ifdef PACMAN_WITH_EGL
+    destroyOffscreenContext(ctx);
+#endif
+    return failures > 0 ? 1 : 0;
+}
+
+// --offscreen [--frames N] [--size WxH] [--capture a,b,c] [--capture-every K] [--out DIR] [--format png|ppm]
+//             [--golden DIR] [--tolerance T] [--max-mismatch F] [--seed S] [--stage N] [--bot POLICY]
+//             [--replay-input FILE] [--load-state FILE] [--metrics FILE] [--metrics-interval SEC]
+int runOffscreenFromArgs(int argc, char** argv) {
+    OffscreenConfig config;
+    // 골든 이미지와 같아야 하므로 오프스크린은 기본이 창 해상도 고정 (--render-scale로 켬)
+    g_dynres.minScale = g_dynres.maxScale = g_dynres.scale = 1.0f;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--frames" && hasValue) config.frames = std::atoi(argv[++i]);
+        else if (arg == "--size" && hasValue) {
+            std::string size = argv[++i];
+            size_t x = size.find('x');
+            if (x != std::string::npos) {
+                config.width = std::max(1, std::atoi(size.substr(0, x).c_str()));
+                config.height = std::max(1, std::atoi(size.substr(x + 1).c_str()));
+            }
+        }
+        else if (arg == "--capture" && hasValue) {
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (!item.empty()) config.captureFrames.push_back(std::atoi(item.c_str()));
+            }
+        }
+        else if (arg == "--capture-every" && hasValue) config.captureEvery = std::atoi(argv[++i]);
+        else if (arg == "--out" && hasValue) config.outDir = argv[++i];
+        else if (arg == "--format" && hasValue) config.format = (std::string(argv[++i]) == "ppm") ? "ppm" : "png";
+        else if (arg == "--golden" && hasValue) config.goldenDir = argv[++i];
+        else if (arg == "--tolerance" && hasValue) config.tolerance = std::atoi(argv[++i]);
+        else if (arg == "--max-mismatch" && hasValue) config.maxMismatch = std::atof(argv[++i]);
+        else if (arg == "--seed" && hasValue) config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--stage" && hasValue) config.stage = std::atoi(argv[++i]);
+        else if (arg == "--replay-input" && hasValue) config.replayPath = argv[++i];
+        else if (arg == "--load-state" && hasValue) config.statePath = argv[++i];
+        else if (arg == "--metrics" && hasValue) config.metricsPath = argv[++i];
+        else if (arg == "--metrics-interval" && hasValue) config.metricsInterval = std::atof(argv[++i]);
+        else if (arg == "--render-scale" && hasValue && !parseRenderScaleArg(argv[++i])) return 2;
+        else if (arg == "--frame-budget" && hasValue) g_dynres.budgetMs = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--bot" && hasValue) {
+            if (!parseBotPolicyName(argv[++i], config.botPolicy)) return 2;
+            config.useBot = true;
+        }
+    }
+    if (g_dynres.budgetMs <= 0.0f) g_dynres.budgetMs = DYNRES_DEFAULT_BUDGET_MS;
+    return runOffscreen(config, argc, argv);
+}
+
+// ---- 메쉬 형식 벤치마크 (--mesh-bench) ----
+// 기본 메쉬마다 예전 형식(float 정점 24바이트, 32비트 인덱스, 만든 순서 그대로)과 지금 형식(12바이트, 16비트 인덱스,
+// 캐시 순서)을 같은 장면으로 그려 삼각형 처리량을 비교한다. 예전 형식은 법선만 지금 셰이더가 읽을 수 있게
+// 팔면체 float 두 개로 둔다 (크기는 예전 위치 + 법선 float 여섯 개와 같음).
+// 작은 화면에 아주 작게 많이 찍어서 래스터화보다 정점 가져오기 / 정점 셰이더 비용이 드러나게 한다.
+// llvmpipe처럼 작은 삼각형 셋업이 비싼 구현에서는 --vertex-only로 정점 단계만 따로 볼 수 있다.
+
+struct MeshBenchConfig {
+    int frames = 20;
+    int instances = 4096;
+    int width = 256;
+    int height = 256;
+    bool vertexOnly = false;           // 래스터화를 끄고(GL_RASTERIZER_DISCARD) 정점 단계만 잰다
+};
+
+struct MeshBenchBuffers {
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    GLsizei indexCount = 0;
+    size_t bytes = 0;
+};
+
+// 예전 형식: 위치 3 + 턱 1 + 법선 2 float, 32비트 인덱스
+MeshBenchBuffers uploadFloatMesh(const MeshData& mesh) {
+    std::vector<GLfloat> vertices;
+    for (size_t v = 0; v < mesh.positions.size(); ++v) {
+        const glm::vec3& p = mesh.positions[v];
+        float u, w;
+        octEncode(mesh.normals[v], u, w);
+        vertices.insert(vertices.end(), { p.x, p.y, p.z, mesh.jaws.empty() ? 0.0f : mesh.jaws[v], u, w });
+    }
+    MeshBenchBuffers b;
+    glGenVertexArrays(1, &b.vao);
+    glGenBuffers(1, &b.vbo);
+    glGenBuffers(1, &b.ebo);
+    glBindVertexArray(b.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, b.vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), mesh.indices.data(), GL_STATIC_DRAW);
+    const GLsizei stride = 6 * sizeof(GLfloat);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    b.indexCount = static_cast<GLsizei>(mesh.indices.size());
+    b.bytes = vertices.size() * sizeof(GLfloat) + mesh.indices.size() * sizeof(GLuint);
+    return b;
+}
+
+// 장면을 frames번 그린 평균 ms (glFinish까지)
+double timeMeshBench(const MeshBenchBuffers& b, GLenum indexType, GLuint idBuffer, const MeshBenchConfig& config) {
+    glBindVertexArray(b.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, idBuffer);
+    glVertexAttribIPointer(3, 1, GL_INT, 0, (void*)0);
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(3);
+    auto drawOnce = [&]() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDrawElementsInstanced(GL_TRIANGLES, b.indexCount, indexType, (void*)0, config.instances);
+    };
+    drawOnce();   // 셰이더 변형 / 버퍼 준비는 재지 않는다
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < config.frames; ++frame) drawOnce();
+    glFinish();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return ms / std::max(1, config.frames);
+}
+
+int runMeshBench(const MeshBenchConfig& config, int argc, char** argv) {
+#ifdef PACMAN_WITH_EGL
+    OffscreenContext ctx;
+    if (!createOffscreenContext(ctx)) return 2;
+#else
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(64, 64);
+    glutInitContextVersion(3, 3);
+    glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
+    glutCreateWindow("FreeGLUT Maze Project (mesh bench)");
+    glutHideWindow();
+#endif
+    (void)argc;
+    (void)argv;
+    initRenderer();
+
+    GLuint fbo = 0, colorRb = 0, depthRb = 0;
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &colorRb);
+    glGenRenderbuffers(1, &depthRb);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, config.width, config.height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, config.width, config.height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRb);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRb);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[mesh-bench] framebuffer incomplete" << std::endl;
+        return 2;
+    }
+    glViewport(0, 0, config.width, config.height);
+
+    // 인스턴스: side x side 격자, 칸마다 메쉬 하나 (직교 투영으로 화면을 꽉 채움)
+    int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(config.instances)))));
+    std::vector<glm::mat4> models(config.instances);
+    std::vector<GLint> ids(config.instances);
+    for (int i = 0; i < config.instances; ++i) {
+        glm::vec3 center((i % side) + 0.5f, (i / side) + 0.5f, 0.0f);
+        models[i] = glm::rotate(glm::translate(glm::mat4(1.0f), center), 0.6f, glm::vec3(1.0f, 1.0f, 0.0f));
+        models[i] = glm::scale(models[i], glm::vec3(0.45f));
+        ids[i] = i;
+    }
+    GLuint modelBuffer = 0, modelTexture = 0, idBuffer = 0;
+    glGenBuffers(1, &modelBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, modelBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, models.size() * sizeof(glm::mat4), models.data(), GL_STATIC_DRAW);
+    glGenTextures(1, &modelTexture);
+    glActiveTexture(GL_TEXTURE0 + INSTANCE_MODEL_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, modelTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, modelBuffer);
+    glActiveTexture(GL_TEXTURE0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glGenBuffers(1, &idBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, idBuffer);
+    glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLint), ids.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(side), 0.0f, static_cast<float>(side), -10.0f, 10.0f);
+    glm::mat4 view(1.0f);
+    glUseProgram(g_shaderProgram);
+    glUniformMatrix4fv(g_projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(g_viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniform3f(g_colorLoc, 1.0f, 1.0f, 0.0f);
+    glUniform3f(g_lightPosLoc, side * 0.5f, side * 0.5f, 5.0f);
+    glUniform1f(g_lightRangeLoc, static_cast<float>(side));
+    glUniform1i(g_shadowsEnabledLoc, 0);
+    glUniform1f(g_mouthAngleLoc, 0.4f);
+    glUniform1i(g_sceneInstances.useInstancesLoc, 1);
+    if (config.vertexOnly) glEnable(GL_RASTERIZER_DISCARD);
+
+    struct BenchMesh { const char* name; MeshData mesh; };
+    BenchMesh meshes[] = {
+        { "cube", buildCubeMesh() },
+        { "sphere", buildSphereMesh(24, 16) },
+        { "cylinder", buildCylinderMesh(24) },
+        { "pacman", buildPacmanMesh(24, 16) },
+    };
+    std::cout << "[mesh-bench] " << config.instances << " instances, " << config.width << "x" << config.height << ", "
+        << config.frames << " frames per format" << (config.vertexOnly ? " (vertex stage only)" : "") << "; ACMR = vertex shader runs per triangle (FIFO " << MESH_VCACHE_SIZE << ")\n";
+    double totalBefore = 0.0;
+    double totalAfter = 0.0;
+    for (BenchMesh& entry : meshes) {
+        MeshData optimized = entry.mesh;
+        optimizeMesh(optimized);
+        MeshBenchBuffers before = uploadFloatMesh(entry.mesh);
+        MeshBenchBuffers after;
+        after.indexCount = uploadMesh(optimized, after.vao, after.vbo, after.ebo);
+        after.bytes = optimized.positions.size() * sizeof(PackedVertex) + optimized.indices.size() * sizeof(MeshIndex);
+
+        double beforeMs = timeMeshBench(before, GL_UNSIGNED_INT, idBuffer, config);
+        double afterMs = timeMeshBench(after, MESH_INDEX_TYPE, idBuffer, config);
+        totalBefore += beforeMs;
+        totalAfter += afterMs;
+        double triangles = entry.mesh.indices.size() / 3.0 * config.instances;
+        std::cout << "[mesh-bench] " << entry.name << ": " << entry.mesh.positions.size() << " verts, "
+            << entry.mesh.indices.size() / 3 << " tris; " << before.bytes << " -> " << after.bytes << " bytes, ACMR "
+            << meshCacheMissRatio(entry.mesh.indices, MESH_VCACHE_SIZE) << " -> " << meshCacheMissRatio(optimized.indices, MESH_VCACHE_SIZE)
+            << "; " << beforeMs << " -> " << afterMs << " ms/frame (" << (triangles / beforeMs / 1e3) << " -> "
+            << (triangles / afterMs / 1e3) << " Mtri/s)\n";
+
+        for (MeshBenchBuffers* b : { &before, &after }) {
+            glDeleteVertexArrays(1, &b->vao);
+            glDeleteBuffers(1, &b->vbo);
+            glDeleteBuffers(1, &b->ebo);
+        }
+    }
+    std::cout << "[mesh-bench] all meshes: " << totalBefore << " -> " << totalAfter << " ms/frame ("
+        << (totalAfter > 0.0 ? totalBefore / totalAfter : 0.0) << "x)" << std::endl;
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    glUniform1i(g_sceneInstances.useInstancesLoc, 0);
+    glUseProgram(0);
+    glDeleteBuffers(1, &idBuffer);
+    glDeleteTextures(1, &modelTexture);
+    glDeleteBuffers(1, &modelBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(1, &colorRb);
+    glDeleteRenderbuffers(1, &depthRb);
+    glDeleteFramebuffers(1, &fbo);
+#ifdef PACMAN_WITH_EGL
+    destroyOffscreenContext(ctx);
+#endif
+    return 0;
+}
+
+// --mesh-bench [--frames N] [--instances N] [--size WxH] [--vertex-only]
+int runMeshBenchFromArgs(int argc, char** argv) {
+    MeshBenchConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--frames" && hasValue) config.frames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--vertex-only") config.vertexOnly = true;
+        else if (arg == "--instances" && hasValue) config.instances = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--size" && hasValue) {
+            std::string size = argv[++i];
+            size_t x = size.find('x');
+            if (x != std::string::npos) {
+                config.width = std::max(1, std::atoi(size.substr(0, x).c_str()));
+                config.height = std::max(1, std::atoi(size.substr(x + 1).c_str()));
+            }
+        }
+    }
+    return runMeshBench(config, argc, argv);
+}
+
+int main(int argc, char** argv) {
+    std::string recordInputPath;
+    std::string statePath;
+    std::string metricsPath;
+    double metricsInterval = 1.0;
+    SimThreadConfig simConfig;
+    // --maze-pack FILE: 스테이지 미로를 미리 만든 팩에서 고른다. --players N: 화면 분할 인원 (1~4).
+    // --no-sim-lod / --sim-lod-cells N: 먼 유령을 드물게 갱신하는 시뮬레이션 LOD를 끄거나 매 틱 반경을 바꾼다.
+    // --explore FILE: 스테이지 2 뒤에 타일 월드(--build-tiled-world로 만든 파일) 탐험 스테이지를 붙인다.
+    // 모든 모드에서 쓰므로 먼저 읽는다
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--maze-pack" && hasValue && !openMazePack(g_mazePack, argv[i + 1])) return 2;
+        if (arg == "--players" && hasValue) g_playerCount = std::max(1, std::min(std::atoi(argv[i + 1]), MAX_PLAYERS));
+        if (arg == "--no-sim-lod") g_simLodEnabled = false;
+        if (arg == "--sim-lod-cells" && hasValue) g_simLodFullCells = std::max(1, std::atoi(argv[i + 1]));
+        if (arg == "--explore" && hasValue) {
+            // 게임 스레드마다 따로 열므로 여기서는 파일만 확인한다
+            TiledWorld world;
+            if (!openTiledWorld(world, argv[i + 1], 1)) return 2;
+            closeTiledWorld(world);
+            g_exploreWorldPath = argv[i + 1];
+        }
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--build-maze-pack") {
+            return runMazePackBuilderFromArgs(argc, argv);
+        }
+        if (std::string(argv[i]) == "--build-tiled-world") {
+            return runTiledWorldBuilderFromArgs(argc, argv);
+        }
+        if (std::string(argv[i]) == "--tile-stress") {
+            return runTileStressFromArgs(argc, argv);
+        }
+        if (std::string(argv[i]) == "--bot-soak") {
+            return runBotSoakFromArgs(argc, argv);
+        }
+        if (std::string(argv[i]) == "--offscreen") {
+            return runOffscreenFromArgs(argc, argv);
+        }
+        if (std::string(argv[i]) == "--mesh-bench") {
+            return runMeshBenchFromArgs(argc, argv);
+        }
+        if (std::string(argv[i]) == "--server") {
+            return runNetServerFromArgs(argc, argv);
+        }
+        if (std::string(argv[i]) == "--net-test") {
+            return runNetTestFromArgs(argc, argv);
+        }
+        // --connect HOST:PORT: 서버에 붙는 클라이언트로 (--latency / --jitter / --loss로 보내는 쪽 심)
+        if (std::string(argv[i]) == "--connect" && i + 1 < argc) {
+            simConfig.connectAddress = argv[++i];
+        }
+        if (parseNetShimArg(argv[i], i, argc, argv, simConfig.shim)) continue;
+        if (std::string(argv[i]) == "--record-input" && i + 1 < argc) {
+            recordInputPath = argv[++i];
+        }
+        if (std::string(argv[i]) == "--load-state" && i + 1 < argc) {
+            statePath = argv[++i];
+        }
+        // --metrics FILE: Prometheus 텍스트 지표를 주기적으로 씀 (--metrics-interval 초 간격, 기본 1)
+        if (std::string(argv[i]) == "--metrics" && i + 1 < argc) {
+            metricsPath = argv[++i];
+        }
+        if (std::string(argv[i]) == "--metrics-interval" && i + 1 < argc) {
+            metricsInterval = std::atof(argv[++i]);
+        }
+        // --pacing vsync|uncapped|target, --fps N (target 모드의 목표)
+        if (std::string(argv[i]) == "--pacing" && i + 1 < argc && !parsePacingModeName(argv[++i], g_pacer.mode)) return 2;
+        if (std::string(argv[i]) == "--fps" && i + 1 < argc) {
+            g_pacer.targetFps = std::max(1.0, std::atof(argv[++i]));
+        }
+        // --render-scale MIN[:MAX] (기본 0.5:1), --frame-budget MS (기본 1000 / 목표 FPS): 동적 해상도
+        if (std::string(argv[i]) == "--render-scale" && i + 1 < argc && !parseRenderScaleArg(argv[++i])) return 2;
+        if (std::string(argv[i]) == "--frame-budget" && i + 1 < argc) {
+            g_dynres.budgetMs = static_cast<float>(std::atof(argv[++i]));
+        }
+    }
+
+    // 입력 기록: 재생할 때 같은 미로가 나오도록 시드를 고정하고 파일에 남긴다
+    simConfig.statePath = statePath;
+    if (!recordInputPath.empty()) {
+        unsigned int seed = static_cast<unsigned int>(std::time(0));
+        if (openInputRecorder(g_inputRecorder, recordInputPath, seed)) {
+            simConfig.seedLocked = true;
+            simConfig.seed = seed;
+        }
+    }
+
+    if (!simConfig.connectAddress.empty() && !netStartup()) return 2;
+    if (g_dynres.budgetMs <= 0.0f) g_dynres.budgetMs = static_cast<float>(1000.0 / g_pacer.targetFps);
+
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(g_windowWidth, g_windowHeight);
+    glutInitContextVersion(3, 3);
+    glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
+    glutCreateWindow("FreeGLUT Maze Project");
+
+    glutDisplayFunc(display);
+    glutReshapeFunc(reshape);
+    glutSetKeyRepeat(GLUT_KEY_REPEAT_OFF);
+    glutKeyboardFunc(keyboard);
+    glutKeyboardUpFunc(keyboardUp);
+    glutSpecialFunc(specialKey);
+    glutSpecialUpFunc(specialKeyUp);
+    glutPassiveMotionFunc(mouseMotion);
+    glutCloseFunc(windowClosed);
+    // 창을 닫아도 exit() 대신 프레임 루프에서 돌아오게 해서 캡처 인코더를 정리한다
+    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+
+    initRenderer();
+    if (!metricsPath.empty()) startMetricsExporter(metricsPath, metricsInterval);
+    startSimulationThread(simConfig);
+    runFrameLoop();
+    stopSimulationThread();   // 입력 통계는 시뮬레이션 스레드가 끝나면서 출력
+    stopMetricsExporter();
+    captureShutdown();
+    printPacingStats();
+    printCullStats();
+    printDynamicResolutionStats();
 
     glDeleteVertexArrays(1, &g_cubeVAO);
     glDeleteBuffers(1, &g_cubeVBO);
     glDeleteBuffers(1, &g_cubeEBO);
+    glDeleteVertexArrays(1, &g_pacmanVAO);
+    glDeleteBuffers(1, &g_pacmanVBO);
+    glDeleteBuffers(1, &g_pacmanEBO);
+    destroyShadowMaps();
+    destroyParticles();
+    destroyDynamicResolution();
     glDeleteProgram(g_shaderProgram);
+    glDeleteProgram(g_shadowProgram);
     return 0;
 }
\ No newline at end of file
@@ -1,23 +1,59 @@
 #version 330 core
 
 in vec3 FragPos;
+in vec3 Normal;
 
 uniform vec3 objectColor;
-uniform vec3 lightPos;   // 포인트 라이트 위치
+uniform vec3 lightPos;     // 포인트 라이트 위치
+uniform float lightRange;  // 이 거리에서 밝기가 절반 정도로 줄어듦
+
+// 그림자 큐브맵: 빛에서 가장 가까운 표면까지의 거리 / shadowFar
+// 정적(벽)은 스테이지마다 한 번, 동적(팩맨, 유령)은 매 프레임 그린다
+uniform samplerCube staticShadowMap;
+uniform samplerCube dynamicShadowMap;
+uniform float shadowFar;
+uniform int shadowsEnabled;
 
 out vec4 FragColor;
 
+const vec3 PCF_OFFSETS[8] = vec3[](
+    vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1),
+    vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1)
+);
+
+float shadowVisibility(vec3 normal, vec3 lightDir)
+{
+    vec3 toFrag = FragPos - lightPos;
+    float current = length(toFrag) / shadowFar;
+    // 빛과 비스듬한 면일수록 바이어스를 키워 그림자 여드름 방지
+    float bias = mix(0.004, 0.012, 1.0 - max(dot(normal, lightDir), 0.0));
+    float radius = 0.02 * length(toFrag);
+
+    float lit = 0.0;
+    for (int i = 0; i < 8; ++i) {
+        vec3 dir = toFrag + PCF_OFFSETS[i] * radius;
+        float closest = min(texture(staticShadowMap, dir).r, texture(dynamicShadowMap, dir).r);
+        lit += (current - bias > closest) ? 0.0 : 1.0;
+    }
+    return lit / 8.0;
+}
+
 void main()
 {
-    float dist = length(FragPos - lightPos);
+    vec3 normal = normalize(Normal);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float dist = length(lightPos - FragPos);
+
+    // 거리 기반 감쇠 + 램버트 난반사
+    float attenuation = 1.0 / (1.0 + (dist * dist) / (lightRange * lightRange));
+    float diffuse = max(dot(normal, lightDir), 0.0);
 
-    // 거리 기반 감쇠
-    float attenuation = 1.0 / (1.0 + 0.4 * dist + 0.6 * dist * dist);
+    float visibility = (shadowsEnabled != 0) ? shadowVisibility(normal, lightDir) : 1.0;
 
     // 약간의 주변광
     vec3 ambient = objectColor * 0.15;
 
-    vec3 color = ambient + objectColor * attenuation;
+    vec3 color = ambient + objectColor * diffuse * attenuation * visibility;
     color = clamp(color, 0.0, 1.0);
 
     FragColor = vec4(color, 1.0);
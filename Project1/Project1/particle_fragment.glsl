@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec2 Corner;
+in vec4 ParticleColor;
+
+out vec4 FragColor;
+
+// 둥근 점. 가산 블렌딩이라 가장자리로 갈수록 알파를 줄인다
+void main()
+{
+    float d2 = dot(Corner, Corner);
+    if (d2 > 1.0) discard;
+    FragColor = vec4(ParticleColor.rgb, ParticleColor.a * (1.0 - d2));
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+// 점 -> 카메라를 향한 빌보드 사각형. 개수는 트랜스폼 피드백이 GPU에 남긴 그대로 쓰므로 CPU가 몰라도 된다
+layout(points) in;
+layout(triangle_strip, max_vertices = 4) out;
+
+in float vSize[];
+in vec4 vColor[];
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec2 Corner;
+out vec4 ParticleColor;
+
+const vec2 CORNERS[4] = vec2[4](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(-1.0, 1.0), vec2(1.0, 1.0));
+
+void main()
+{
+    // 뷰 행렬의 행 = 카메라의 오른쪽/위쪽 축
+    vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+    for (int i = 0; i < 4; ++i) {
+        vec3 pos = gl_in[0].gl_Position.xyz + (right * CORNERS[i].x + up * CORNERS[i].y) * vSize[0];
+        Corner = CORNERS[i];
+        ParticleColor = vColor[0];
+        gl_Position = projection * view * vec4(pos, 1.0);
+        EmitVertex();
+    }
+    EndPrimitive();
+}
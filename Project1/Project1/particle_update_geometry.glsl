@@ -0,0 +1,26 @@
+#version 330 core
+
+// 수명이 다한 파티클은 내보내지 않는다 -> 트랜스폼 피드백 버퍼에는 살아있는 것만 앞에서부터 채워짐
+layout(points) in;
+layout(points, max_vertices = 1) out;
+
+in vec3 vPos[];
+in vec3 vVel[];
+in vec2 vAgeLife[];
+in vec3 vColor[];
+
+out vec3 tfPos;
+out vec3 tfVel;
+out vec2 tfAgeLife;
+out vec3 tfColor;
+
+void main()
+{
+    if (vAgeLife[0].x >= vAgeLife[0].y) return;
+    tfPos = vPos[0];
+    tfVel = vVel[0];
+    tfAgeLife = vAgeLife[0];
+    tfColor = vColor[0];
+    EmitVertex();
+    EndPrimitive();
+}
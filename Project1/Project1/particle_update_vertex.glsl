@@ -0,0 +1,73 @@
+#version 330 core
+
+// 트랜스폼 피드백 파티클 갱신. 같은 프로그램으로 두 번 그린다:
+//  emitMode = 0 : 이전 버퍼의 살아있는 파티클을 적분 (속성 입력 사용)
+//  emitMode = 1 : 이번 프레임 이미터 요청에서 새 파티클 생성 (gl_VertexID로 이미터 선택, 속성 입력 없음)
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inVel;
+layout(location = 2) in vec2 inAgeLife;   // x = 나이(초), y = 수명(초)
+layout(location = 3) in vec3 inColor;
+
+const int MAX_EMITS = 32;
+
+uniform int emitMode;
+uniform float dt;
+uniform float gravity;
+uniform float drag;
+uniform float floorY;
+
+uniform int emitCount;
+uniform vec3 emitPos[MAX_EMITS];
+uniform vec3 emitColor[MAX_EMITS];
+uniform int emitEnd[MAX_EMITS];   // 이미터별 누적 파티클 수 (gl_VertexID < emitEnd[i] 이면 i번 이미터)
+uniform float emitSpeed;
+uniform float emitUpBias;         // 0 = 구 전체, 1 = 위쪽 반구로 치우침
+uniform float emitLife;
+uniform float seed;
+
+out vec3 vPos;
+out vec3 vVel;
+out vec2 vAgeLife;
+out vec3 vColor;
+
+float hash(float n)
+{
+    return fract(sin(n) * 43758.5453123);
+}
+
+void main()
+{
+    if (emitMode == 0) {
+        vec3 vel = inVel * max(1.0 - drag * dt, 0.0) + vec3(0.0, -gravity * dt, 0.0);
+        vec3 pos = inPos + vel * dt;
+        // 바닥에 닿으면 살짝 튕기고 멈춤
+        if (pos.y < floorY) {
+            pos.y = floorY;
+            vel = vec3(vel.x * 0.5, abs(vel.y) * 0.3, vel.z * 0.5);
+        }
+        vPos = pos;
+        vVel = vel;
+        vAgeLife = vec2(inAgeLife.x + dt, inAgeLife.y);
+        vColor = inColor;
+        return;
+    }
+
+    int index = 0;
+    for (int i = 0; i < MAX_EMITS; ++i) {
+        if (i >= emitCount || gl_VertexID < emitEnd[i]) break;
+        index = i + 1;
+    }
+    index = min(index, MAX_EMITS - 1);
+
+    float n = float(gl_VertexID) * 7.13 + seed;
+    float z = mix(-1.0, 1.0, hash(n + 1.0));
+    z = mix(z, abs(z), emitUpBias);
+    float a = 6.2831853 * hash(n + 2.0);
+    float r = sqrt(max(1.0 - z * z, 0.0));
+    vec3 dir = vec3(r * cos(a), z, r * sin(a));
+
+    vPos = emitPos[index];
+    vVel = dir * emitSpeed * mix(0.4, 1.0, hash(n + 3.0));
+    vAgeLife = vec2(0.0, emitLife * mix(0.6, 1.2, hash(n + 4.0)));
+    vColor = emitColor[index];
+}
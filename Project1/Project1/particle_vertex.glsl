@@ -0,0 +1,19 @@
+#version 330 core
+
+// 파티클 하나 = 점 하나 (트랜스폼 피드백 버퍼를 그대로 읽음). 카메라를 향한 사각형은 지오메트리 셰이더가 만든다
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec2 aAgeLife;
+layout(location = 2) in vec3 aColor;
+
+uniform float particleSize;
+
+out float vSize;
+out vec4 vColor;
+
+void main()
+{
+    float t = clamp(aAgeLife.x / aAgeLife.y, 0.0, 1.0);
+    vSize = particleSize * (1.0 - 0.5 * t);
+    vColor = vec4(aColor, 1.0 - t);
+    gl_Position = vec4(aPos, 1.0);
+}
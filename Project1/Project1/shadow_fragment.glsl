@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec3 FragPos;
+
+uniform vec3 lightPos;
+uniform float shadowFar;
+
+// 그림자 큐브맵 패스: 깊이 대신 빛까지의 선형 거리(0~1)를 기록 (정점 셰이더는 vertex.glsl을 같이 씀)
+void main()
+{
+    gl_FragDepth = length(FragPos - lightPos) / shadowFar;
+}
@@ -1,16 +1,51 @@
 #version 330 core
 
 layout(location = 0) in vec3 aPos;
+layout(location = 1) in float aJaw;   // +1 = 윗턱, -1 = 아랫턱, 0 = 일반 메쉬
+layout(location = 2) in vec2 aNormal;   // 팔면체(octahedral) 인코딩 법선
+layout(location = 3) in int aInstance;   // useInstances일 때 instanceModels에서 읽을 행렬 번호
 
 uniform mat4 model;
+uniform int useInstances;
+uniform samplerBuffer instanceModels;    // 행렬마다 텍셀 4개 (열 순서)
 uniform mat4 view;
 uniform mat4 projection;
+uniform float mouthAngle;   // 팩맨 입 벌림 각도 (라디안)
 
 out vec3 FragPos;
+out vec3 Normal;
+
+// 팔면체 위의 xy를 단위 벡터로. 네 귀퉁이로 접힌 곳은 아래 반구(z < 0)
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+}
 
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    // 턱 가중치만큼 X축 기준으로 회전 (jaw = 0 이면 그대로). 법선도 같이 돌린다
+    float angle = aJaw * mouthAngle;
+    float c = cos(angle);
+    float s = sin(angle);
+    vec3 pos = vec3(aPos.x, c * aPos.y - s * aPos.z, s * aPos.y + c * aPos.z);
+    vec3 n = octDecode(aNormal);
+    vec3 normal = vec3(n.x, c * n.y - s * n.z, s * n.y + c * n.z);
+
+    mat4 m = model;
+    if (useInstances != 0) {
+        int base = aInstance * 4;
+        m = mat4(texelFetch(instanceModels, base), texelFetch(instanceModels, base + 1),
+                 texelFetch(instanceModels, base + 2), texelFetch(instanceModels, base + 3));
+    }
+
+    vec4 worldPos = m * vec4(pos, 1.0);
     FragPos = worldPos.xyz;
+    // 비균등 스케일(벽 큐브)에서도 법선이 면에 수직이도록 역전치 행렬 사용
+    Normal = mat3(transpose(inverse(m))) * normal;
     gl_Position = projection * view * worldPos;
 }